@@ -0,0 +1,206 @@
+/**
+ * @file micro_bench.cpp
+ * @brief mxvm-microbench — Google Benchmark fixtures for interpreter hot paths
+ * @author Jared Bruni
+ *
+ * Each benchmark isolates one primitive the interpreter executes per
+ * instruction: variable lookup, ADD with an immediate or a variable operand,
+ * the operand stack, an INVOKE round trip into a native module, printf-style
+ * formatting (parsed per call and pre-parsed), copying a string variable and
+ * scanning source text. The
+ * fixture parses a small program once, so iterations measure only the
+ * primitive itself.
+ *
+ * Modules are loaded from MXVM_BENCH_MODULE_PATH (the build directory by
+ * default, overridable with the environment variable of the same name).
+ */
+#include "mxvm/mxvm.hpp"
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <memory>
+#include <sstream>
+#include <string>
+
+#ifndef MXVM_BENCH_MODULE_PATH
+#define MXVM_BENCH_MODULE_PATH "."
+#endif
+
+namespace {
+
+    const char *micro_source = R"(program Micro {
+    section module { std }
+    section data {
+        int x = 0
+        int y = 7
+        int r = 0
+        float f = 2.5
+        string name = "mxvm"
+        string fmt = "x=%lld y=%lld f=%f name=%s\n"
+    }
+    section code {
+    start:
+        add x, x, 1
+        add x, x, y
+        invoke abs, y
+        return r
+        done
+    }
+}
+)";
+
+    std::string modulePath() {
+        const char *env = std::getenv("MXVM_BENCH_MODULE_PATH");
+        return env != nullptr ? env : MXVM_BENCH_MODULE_PATH;
+    }
+
+    /** @brief Source with @p lines copies of a representative data/code mix, for scanner throughput */
+    std::string largeSource(int lines) {
+        std::ostringstream src;
+        src << "program Large {\n    section data {\n";
+        for (int i = 0; i < lines / 4; ++i)
+            src << "        int v" << i << " = " << i << "\n";
+        src << "        string fmt = \"%lld\\n\"\n    }\n    section code {\n    start:\n";
+        for (int i = 0; i < lines; ++i) {
+            int v = i % (lines / 4);
+            src << "        add v" << v << ", v" << v << ", " << i << "\n"
+                << "        cmp v" << v << ", 1000\n"
+                << "        jg label" << i << "\n"
+                << "    label" << i << ":\n";
+        }
+        src << "        print fmt, v0\n        done\n    }\n}\n";
+        return src.str();
+    }
+
+} // namespace
+
+/** @brief A parsed, flattened program ready for individual exec_* calls */
+class ProgramFixture : public benchmark::Fixture {
+  public:
+    void SetUp(const benchmark::State &) override {
+        program = std::make_unique<mxvm::Program>();
+        program->setMainBase(program.get());
+        mxvm::Parser parser(micro_source);
+        parser.module_path = modulePath();
+        parser.scan();
+        if (!parser.generateProgramCode(mxvm::Mode::MODE_INTERPRET, program))
+            throw mx::Exception("micro benchmark program failed to parse");
+        program->flatten(program.get());
+    }
+
+    void TearDown(const benchmark::State &) override {
+        program.reset();
+    }
+
+  protected:
+    std::unique_ptr<mxvm::Program> program;
+
+    /** @brief The @p nth instruction with opcode @p op (0-based) */
+    const mxvm::Instruction *find(Inc op, int nth = 0) const {
+        for (const auto &i : program->inc)
+            if (i.instruction == op && nth-- == 0)
+                return &i;
+        return nullptr;
+    }
+};
+
+BENCHMARK_F(ProgramFixture, GetVariable)(benchmark::State &state) {
+    for (auto _ : state) {
+        mxvm::Variable &v = program->getVariable("y");
+        benchmark::DoNotOptimize(&v);
+    }
+}
+
+BENCHMARK_F(ProgramFixture, ExecAddImmediate)(benchmark::State &state) {
+    const mxvm::Instruction *add = find(ADD, 0);
+    if (add == nullptr) {
+        state.SkipWithError("add x, x, 1 not found");
+        return;
+    }
+    for (auto _ : state)
+        program->exec_add(*add);
+    benchmark::DoNotOptimize(program->getVariable("x").var_value.int_value);
+}
+
+BENCHMARK_F(ProgramFixture, ExecAddVariable)(benchmark::State &state) {
+    const mxvm::Instruction *add = find(ADD, 1);
+    if (add == nullptr) {
+        state.SkipWithError("add x, x, y not found");
+        return;
+    }
+    for (auto _ : state)
+        program->exec_add(*add);
+    benchmark::DoNotOptimize(program->getVariable("x").var_value.int_value);
+}
+
+BENCHMARK_F(ProgramFixture, ExecInvoke)(benchmark::State &state) {
+    const mxvm::Instruction *invoke = find(INVOKE, 0);
+    if (invoke == nullptr) {
+        state.SkipWithError("invoke abs, y not found");
+        return;
+    }
+    for (auto _ : state)
+        program->exec_invoke(*invoke);
+}
+
+BENCHMARK_F(ProgramFixture, PrintFormatted)(benchmark::State &state) {
+    std::vector<mxvm::Variable *> args{&program->getVariable("x"), &program->getVariable("y"), &program->getVariable("f"), &program->getVariable("name")};
+    const std::string format = program->getVariable("fmt").var_value.str_value;
+    for (auto _ : state) {
+        std::string text = program->printFormatted(format, args, false);
+        benchmark::DoNotOptimize(text.data());
+    }
+}
+
+BENCHMARK_F(ProgramFixture, FormatAppend)(benchmark::State &state) {
+    std::vector<mxvm::Variable *> args{&program->getVariable("x"), &program->getVariable("y"), &program->getVariable("f"), &program->getVariable("name")};
+    const mxvm::Format format(program->getVariable("fmt").var_value.str_value);
+    std::string buffer;
+    for (auto _ : state) {
+        buffer.clear();
+        format.append(buffer, args);
+        benchmark::DoNotOptimize(buffer.data());
+    }
+}
+
+BENCHMARK_F(ProgramFixture, CopyStringVariable)(benchmark::State &state) {
+    const mxvm::Variable &fmt = program->getVariable("fmt");
+    for (auto _ : state) {
+        mxvm::Variable copy(fmt);
+        benchmark::DoNotOptimize(&copy);
+    }
+}
+
+static void StackPushPop(benchmark::State &state) {
+    mxvm::Stack stack;
+    for (auto _ : state) {
+        stack.push(static_cast<int64_t>(42));
+        mxvm::StackValue v = stack.pop();
+        benchmark::DoNotOptimize(v);
+    }
+}
+BENCHMARK(StackPushPop);
+
+static void StackPushPopDeep(benchmark::State &state) {
+    mxvm::Stack stack;
+    const int64_t depth = state.range(0);
+    for (auto _ : state) {
+        for (int64_t i = 0; i < depth; ++i)
+            stack.push(i);
+        for (int64_t i = 0; i < depth; ++i)
+            benchmark::DoNotOptimize(stack.pop());
+    }
+    state.SetItemsProcessed(state.iterations() * depth);
+}
+BENCHMARK(StackPushPopDeep)->Arg(64)->Arg(4096);
+
+static void ParserScan(benchmark::State &state) {
+    const std::string source = largeSource(static_cast<int>(state.range(0)));
+    for (auto _ : state) {
+        mxvm::Parser parser(source);
+        benchmark::DoNotOptimize(parser.scan());
+    }
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(source.size()));
+}
+BENCHMARK(ParserScan)->Arg(1000)->Arg(20000)->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
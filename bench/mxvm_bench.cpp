@@ -0,0 +1,492 @@
+/**
+ * @file mxvm_bench.cpp
+ * @brief mxvm-bench — whole-program benchmark harness for the MXVM toolchain
+ * @author Jared Bruni
+ *
+ * Usage:
+ *   mxvm-bench --mxvmc path/mxvmc --mxx path/mxx --path module_dir
+ *              --programs bench/programs [--work dir] [--output bench.json]
+ *              [--runs N] [--modes interpret,native] [--filter name]
+ *
+ * Every .mxvm and .pas file in the programs directory is run headless in each
+ * execution mode. Pascal sources are compiled with mxx first. For every
+ * program and mode the harness records the median wall time of N runs, the
+ * peak resident set size, and instructions per second. The instruction count
+ * comes from one interpreted --profile run. Native builds report their build
+ * time separately. A program named empty measures startup cost. Output of
+ * each mode is compared against the interpreter, so a miscompile shows up as
+ * a failed benchmark instead of a fast one.
+ *
+ * The report is JSON so that runs from different commits can be diffed or
+ * plotted. The exit status is non-zero if any run failed.
+ */
+#include "argz.hpp"
+#include "version_info.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+/** @brief Result of running one child process */
+struct RunResult {
+    bool ok = false;          ///< exited normally with status 0
+    int exit_code = -1;       ///< exit status, or -signal if it was killed
+    double wall_ms = 0.0;     ///< wall-clock time from fork to reap
+    long peak_rss_kb = 0;     ///< ru_maxrss of the child
+};
+
+/** @brief Command-line configuration */
+struct BenchConfig {
+    std::string mxvmc;
+    std::string mxx;
+    std::string module_path;
+    std::string programs;
+    std::string work = "mxvm_bench_work";
+    std::string output;
+    std::string filter;
+    std::vector<std::string> modes{"interpret", "native"};
+    int runs = 3;
+};
+
+/** @brief Timings for one program in one mode */
+struct ModeResult {
+    std::string mode;
+    bool ok = false;
+    bool output_matches = true;
+    std::string error;
+    double build_ms = 0.0;
+    std::vector<double> samples;
+    long peak_rss_kb = 0;
+    std::string output;
+};
+
+/** @brief Everything measured for one program */
+struct Benchmark {
+    std::string name;
+    std::string source;
+    std::string program;   ///< program name declared in the source
+    uint64_t instructions = 0;
+    double frontend_ms = 0.0;
+    std::vector<ModeResult> modes;
+};
+
+/** Run argv[0] with the given arguments in dir, stdout to out_path and stderr to err_path. */
+static RunResult runProcess(const std::vector<std::string> &argv, const std::string &dir, const std::string &out_path, const std::string &err_path) {
+    RunResult result;
+    std::vector<char *> c_argv;
+    for (const auto &a : argv)
+        c_argv.push_back(const_cast<char *>(a.c_str()));
+    c_argv.push_back(nullptr);
+
+    auto start = std::chrono::steady_clock::now();
+    pid_t pid = fork();
+    if (pid < 0) {
+        std::cerr << "mxvm-bench: fork failed: " << std::strerror(errno) << "\n";
+        return result;
+    }
+    if (pid == 0) {
+        int in = open("/dev/null", O_RDONLY);
+        int out = open(out_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        int err = open(err_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (in < 0 || out < 0 || err < 0 || chdir(dir.c_str()) != 0)
+            _exit(127);
+        dup2(in, STDIN_FILENO);
+        dup2(out, STDOUT_FILENO);
+        dup2(err, STDERR_FILENO);
+        execvp(c_argv[0], c_argv.data());
+        _exit(127);
+    }
+    int status = 0;
+    struct rusage usage {};
+    if (wait4(pid, &status, 0, &usage) < 0) {
+        std::cerr << "mxvm-bench: wait failed: " << std::strerror(errno) << "\n";
+        return result;
+    }
+    result.wall_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+#ifdef __APPLE__
+    result.peak_rss_kb = usage.ru_maxrss / 1024;
+#else
+    result.peak_rss_kb = usage.ru_maxrss;
+#endif
+    if (WIFEXITED(status)) {
+        result.exit_code = WEXITSTATUS(status);
+        result.ok = result.exit_code == 0;
+    } else if (WIFSIGNALED(status)) {
+        result.exit_code = -WTERMSIG(status);
+    }
+    return result;
+}
+
+static std::string readFile(const std::string &path) {
+    std::ifstream f(path, std::ios::in | std::ios::binary);
+    std::ostringstream ss;
+    if (f.is_open())
+        ss << f.rdbuf();
+    return ss.str();
+}
+
+/** Return the identifier after the first "program" keyword (case-insensitive), skipping comments. */
+static std::string programName(const std::string &src) {
+    std::size_t pos = 0, n = src.size();
+    while (pos < n) {
+        char c = src[pos];
+        if (c == '{') {
+            while (pos < n && src[pos] != '}')
+                ++pos;
+            ++pos;
+            continue;
+        }
+        if (c == '#' || (c == '/' && pos + 1 < n && src[pos + 1] == '/')) {
+            while (pos < n && src[pos] != '\n')
+                ++pos;
+            continue;
+        }
+        if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+            std::size_t start = pos;
+            while (pos < n && (std::isalnum(static_cast<unsigned char>(src[pos])) || src[pos] == '_'))
+                ++pos;
+            std::string tok = src.substr(start, pos - start);
+            std::transform(tok.begin(), tok.end(), tok.begin(), [](unsigned char ch) { return static_cast<char>(std::tolower(ch)); });
+            if (tok == "program") {
+                while (pos < n && std::isspace(static_cast<unsigned char>(src[pos])))
+                    ++pos;
+                std::size_t ns = pos;
+                while (pos < n && (std::isalnum(static_cast<unsigned char>(src[pos])) || src[pos] == '_'))
+                    ++pos;
+                return src.substr(ns, pos - ns);
+            }
+            continue;
+        }
+        ++pos;
+    }
+    return {};
+}
+
+/** Instruction count from the first line of a flat profile ("MXVM flat profile: N instructions executed"). */
+static uint64_t profiledInstructions(const std::string &path) {
+    std::ifstream f(path);
+    std::string line;
+    if (!f.is_open() || !std::getline(f, line))
+        return 0;
+    auto colon = line.find(':');
+    if (colon == std::string::npos)
+        return 0;
+    try {
+        return std::stoull(line.substr(colon + 1));
+    } catch (const std::exception &) {
+        return 0;
+    }
+}
+
+static double median(std::vector<double> v) {
+    if (v.empty())
+        return 0.0;
+    std::sort(v.begin(), v.end());
+    size_t mid = v.size() / 2;
+    return v.size() % 2 ? v[mid] : (v[mid - 1] + v[mid]) / 2.0;
+}
+
+static std::string jsonEscape(const std::string &s) {
+    std::string out;
+    for (char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                out += buf;
+            } else {
+                out += c;
+            }
+        }
+    }
+    return out;
+}
+
+static std::vector<std::string> splitList(const std::string &s) {
+    std::vector<std::string> items;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty())
+            items.push_back(item);
+    return items;
+}
+
+/**
+ * Produce the command that runs a prepared program in one mode.
+ * interpret runs the .mxvm under mxvmc. native compiles it with
+ * `mxvmc -a compile` in the program's work directory and runs the
+ * executable. A new execution mode (for example a JIT) only needs
+ * another branch here.
+ */
+static bool prepareMode(const BenchConfig &cfg, const Benchmark &b, const fs::path &dir, const std::string &mxvm_file, ModeResult &m,
+                        std::vector<std::string> &command) {
+    if (m.mode == "interpret") {
+        command = {cfg.mxvmc, mxvm_file, "--path", cfg.module_path};
+        return true;
+    }
+    if (m.mode == "native") {
+#if defined(__x86_64__) || defined(_M_X64)
+        std::vector<std::string> build = {cfg.mxvmc, mxvm_file, "--path", cfg.module_path, "-a", "compile", "--no-cache"};
+        RunResult r = runProcess(build, dir.string(), (dir / "native.build.out").string(), (dir / "native.build.err").string());
+        m.build_ms = r.wall_ms;
+        fs::path exe = dir / b.program;
+        if (!r.ok || !fs::exists(exe)) {
+            m.error = "native build failed (see " + (dir / "native.build.err").string() + ")";
+            return false;
+        }
+        command = {exe.string()};
+        return true;
+#else
+        m.error = "native code generation targets x86_64 only";
+        return false;
+#endif
+    }
+    m.error = "unknown mode";
+    return false;
+}
+
+static void runBenchmark(const BenchConfig &cfg, const fs::path &source, Benchmark &b) {
+    b.source = source.filename().string();
+    b.name = source.stem().string();
+    fs::path dir = fs::absolute(fs::path(cfg.work) / b.name);
+    fs::create_directories(dir);
+
+    std::string mxvm_file = fs::absolute(source).string();
+    if (source.extension() == ".pas") {
+        mxvm_file = (dir / (b.name + ".mxvm")).string();
+        RunResult r = runProcess({cfg.mxx, "-i", fs::absolute(source).string(), "-o", mxvm_file}, dir.string(), (dir / "mxx.out").string(), (dir / "mxx.err").string());
+        b.frontend_ms = r.wall_ms;
+        if (!r.ok) {
+            ModeResult m;
+            m.mode = "frontend";
+            m.error = "mxx failed (see " + (dir / "mxx.err").string() + ")";
+            b.modes.push_back(m);
+            return;
+        }
+    }
+    b.program = programName(readFile(mxvm_file));
+
+    // One profiled run gives the instruction count used for every mode's rate
+    RunResult prof = runProcess({cfg.mxvmc, mxvm_file, "--path", cfg.module_path, "--profile"}, dir.string(), (dir / "profile.out").string(), (dir / "profile.err").string());
+    if (prof.ok)
+        b.instructions = profiledInstructions((dir / (b.program + ".profile.txt")).string());
+
+    std::string reference;
+    bool have_reference = false;
+    for (const auto &mode : cfg.modes) {
+        ModeResult m;
+        m.mode = mode;
+        std::vector<std::string> command;
+        if (prepareMode(cfg, b, dir, mxvm_file, m, command)) {
+            std::string out = (dir / (mode + ".out")).string();
+            std::string err = (dir / (mode + ".err")).string();
+            m.ok = true;
+            for (int i = 0; i < cfg.runs; ++i) {
+                RunResult r = runProcess(command, dir.string(), out, err);
+                if (!r.ok) {
+                    m.ok = false;
+                    m.error = "exit status " + std::to_string(r.exit_code) + " (see " + err + ")";
+                    break;
+                }
+                m.samples.push_back(r.wall_ms);
+                m.peak_rss_kb = std::max(m.peak_rss_kb, r.peak_rss_kb);
+            }
+            m.output = readFile(out);
+            if (m.ok) {
+                if (!have_reference) {
+                    reference = m.output;
+                    have_reference = true;
+                } else if (m.output != reference) {
+                    m.output_matches = false;
+                    m.ok = false;
+                    m.error = "output differs from " + cfg.modes.front();
+                }
+            }
+        }
+        b.modes.push_back(m);
+    }
+}
+
+static void writeJson(std::ostream &out, const BenchConfig &cfg, const std::vector<Benchmark> &benchmarks) {
+    std::time_t now = std::time(nullptr);
+    char stamp[32];
+    std::strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+    out << std::fixed << std::setprecision(3);
+    out << "{\n";
+    out << "  \"mxvm_version\": \"" << VERSION_INFO << "\",\n";
+    out << "  \"timestamp\": \"" << stamp << "\",\n";
+    out << "  \"runs\": " << cfg.runs << ",\n";
+
+    out << "  \"startup_ms\": {";
+    bool first = true;
+    for (const auto &b : benchmarks) {
+        if (b.name != "empty")
+            continue;
+        for (const auto &m : b.modes) {
+            if (!m.ok)
+                continue;
+            out << (first ? "" : ", ") << "\"" << jsonEscape(m.mode) << "\": " << median(m.samples);
+            first = false;
+        }
+    }
+    out << "},\n";
+
+    out << "  \"benchmarks\": [";
+    for (size_t i = 0; i < benchmarks.size(); ++i) {
+        const auto &b = benchmarks[i];
+        out << (i ? "," : "") << "\n    {\n";
+        out << "      \"name\": \"" << jsonEscape(b.name) << "\",\n";
+        out << "      \"source\": \"" << jsonEscape(b.source) << "\",\n";
+        out << "      \"instructions\": " << b.instructions << ",\n";
+        out << "      \"frontend_ms\": " << b.frontend_ms << ",\n";
+        out << "      \"modes\": {";
+        for (size_t j = 0; j < b.modes.size(); ++j) {
+            const auto &m = b.modes[j];
+            double wall = median(m.samples);
+            out << (j ? "," : "") << "\n        \"" << jsonEscape(m.mode) << "\": {";
+            out << "\"ok\": " << (m.ok ? "true" : "false");
+            if (m.ok) {
+                out << ", \"wall_ms\": " << wall;
+                out << ", \"min_ms\": " << *std::min_element(m.samples.begin(), m.samples.end());
+                out << ", \"max_ms\": " << *std::max_element(m.samples.begin(), m.samples.end());
+                // The count is of interpreted instructions, so it says nothing about native code
+                if (m.mode == "interpret")
+                    out << ", \"instructions_per_sec\": " << std::setprecision(0) << (wall > 0.0 ? static_cast<double>(b.instructions) * 1000.0 / wall : 0.0) << std::setprecision(3);
+                out << ", \"peak_rss_kb\": " << m.peak_rss_kb;
+            } else {
+                out << ", \"error\": \"" << jsonEscape(m.error) << "\"";
+            }
+            if (m.build_ms > 0.0)
+                out << ", \"build_ms\": " << m.build_ms;
+            out << "}";
+        }
+        out << "\n      }\n    }";
+    }
+    out << "\n  ]\n}\n";
+}
+
+int main(int argc, char **argv) {
+    mx::Argz<std::string> args(argc, argv);
+    args.addOptionDoubleValue(128, "mxvmc", "path to the mxvmc executable")
+        .addOptionDoubleValue(129, "mxx", "path to the mxx Pascal frontend")
+        .addOptionDoubleValue(130, "path", "module path passed to mxvmc --path")
+        .addOptionDoubleValue(131, "programs", "directory of benchmark programs (.mxvm, .pas)")
+        .addOptionDoubleValue(132, "work", "scratch directory for generated files (default mxvm_bench_work)")
+        .addOptionDoubleValue(133, "output", "write the JSON report here instead of stdout")
+        .addOptionDoubleValue(134, "runs", "timed runs per program and mode (default 3)")
+        .addOptionDoubleValue(135, "modes", "comma separated modes: interpret,native")
+        .addOptionDoubleValue(136, "filter", "only run programs whose name contains this text")
+        .addOptionSingle('h', "show this help");
+
+    BenchConfig cfg;
+    mx::Argument<std::string> arg;
+    int opt;
+    try {
+        while ((opt = args.proc(arg)) != -1) {
+            switch (opt) {
+            case 128: cfg.mxvmc = arg.arg_value; break;
+            case 129: cfg.mxx = arg.arg_value; break;
+            case 130: cfg.module_path = arg.arg_value; break;
+            case 131: cfg.programs = arg.arg_value; break;
+            case 132: cfg.work = arg.arg_value; break;
+            case 133: cfg.output = arg.arg_value; break;
+            case 134:
+                try {
+                    cfg.runs = std::max(1, std::stoi(arg.arg_value));
+                } catch (const std::exception &) {
+                    std::cerr << "mxvm-bench: invalid run count: " << arg.arg_value << "\n";
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 135: cfg.modes = splitList(arg.arg_value); break;
+            case 136: cfg.filter = arg.arg_value; break;
+            case 'h':
+                std::cout << "mxvm-bench: MXVM whole-program benchmark harness v" << VERSION_INFO << "\n\n";
+                args.help(std::cout);
+                return EXIT_SUCCESS;
+            default: break;
+            }
+        }
+    } catch (const mx::ArgException<std::string> &e) {
+        std::cerr << "mxvm-bench: " << e.text() << "\n";
+        return EXIT_FAILURE;
+    }
+
+    if (cfg.mxvmc.empty() || cfg.module_path.empty() || cfg.programs.empty() || cfg.modes.empty()) {
+        std::cerr << "mxvm-bench: --mxvmc, --path and --programs are required (see -h)\n";
+        return EXIT_FAILURE;
+    }
+    cfg.mxvmc = fs::absolute(cfg.mxvmc).string();
+    cfg.module_path = fs::absolute(cfg.module_path).string();
+    if (!cfg.mxx.empty())
+        cfg.mxx = fs::absolute(cfg.mxx).string();
+
+    std::vector<fs::path> sources;
+    std::error_code ec;
+    for (const auto &entry : fs::directory_iterator(cfg.programs, ec)) {
+        auto ext = entry.path().extension();
+        if (!entry.is_regular_file() || (ext != ".mxvm" && ext != ".pas"))
+            continue;
+        if (ext == ".pas" && cfg.mxx.empty())
+            continue;
+        if (!cfg.filter.empty() && entry.path().stem().string().find(cfg.filter) == std::string::npos)
+            continue;
+        sources.push_back(entry.path());
+    }
+    if (ec || sources.empty()) {
+        std::cerr << "mxvm-bench: no benchmark programs found in " << cfg.programs << "\n";
+        return EXIT_FAILURE;
+    }
+    std::sort(sources.begin(), sources.end());
+
+    std::vector<Benchmark> benchmarks;
+    bool all_ok = true;
+    for (const auto &src : sources) {
+        Benchmark b;
+        runBenchmark(cfg, src, b);
+        for (const auto &m : b.modes) {
+            std::cerr << "mxvm-bench: " << std::left << std::setw(12) << b.name << std::setw(10) << m.mode;
+            if (m.ok) {
+                std::cerr << std::fixed << std::setprecision(1) << std::right << std::setw(10) << median(m.samples) << " ms" << std::setw(10) << m.peak_rss_kb << " KB\n";
+            } else {
+                std::cerr << "FAILED: " << m.error << "\n";
+                all_ok = false;
+            }
+        }
+        benchmarks.push_back(std::move(b));
+    }
+
+    if (cfg.output.empty()) {
+        writeJson(std::cout, cfg, benchmarks);
+    } else {
+        std::ofstream out(cfg.output);
+        if (!out.is_open()) {
+            std::cerr << "mxvm-bench: could not open output file: " << cfg.output << "\n";
+            return EXIT_FAILURE;
+        }
+        writeJson(out, cfg, benchmarks);
+        std::cerr << "mxvm-bench: wrote " << cfg.output << "\n";
+    }
+    return all_ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,14 @@
+{ Recursive Fibonacci: call/return and integer arithmetic }
+program BenchFib;
+
+function fib(n: integer): integer;
+begin
+  if n < 2 then
+    fib := n
+  else
+    fib := fib(n - 1) + fib(n - 2);
+end;
+
+begin
+  writeln(fib(24));
+end.
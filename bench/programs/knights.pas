@@ -0,0 +1,91 @@
+{ Knight's tour: Warnsdorff's heuristic from the first two rows of an 8x8 board.
+  Headless version of src/frontend/pas/knights_tour/knight.pas. }
+program BenchKnights;
+
+const
+  N = 8;
+  SQUARES = 64;
+
+var
+  board: array[0..63] of integer;
+  dx: array[0..7] of integer;
+  dy: array[0..7] of integer;
+  start, complete: integer;
+
+function onBoard(x, y: integer): boolean;
+begin
+  onBoard := (x >= 0) and (x < N) and (y >= 0) and (y < N);
+end;
+
+function degree(x, y: integer): integer;
+var
+  k, nx, ny, d: integer;
+begin
+  d := 0;
+  for k := 0 to 7 do
+  begin
+    nx := x + dx[k];
+    ny := y + dy[k];
+    if onBoard(nx, ny) then
+      if board[ny * N + nx] = 0 then
+        d := d + 1;
+  end;
+  degree := d;
+end;
+
+function tour(sx, sy: integer): integer;
+var
+  i, k, x, y, nx, ny, best, bestDeg, d, moves: integer;
+begin
+  for i := 0 to SQUARES - 1 do
+    board[i] := 0;
+  x := sx;
+  y := sy;
+  moves := 1;
+  board[y * N + x] := moves;
+  best := 0;
+  while best >= 0 do
+  begin
+    best := -1;
+    bestDeg := 9;
+    for k := 0 to 7 do
+    begin
+      nx := x + dx[k];
+      ny := y + dy[k];
+      if onBoard(nx, ny) then
+        if board[ny * N + nx] = 0 then
+        begin
+          d := degree(nx, ny);
+          if d < bestDeg then
+          begin
+            bestDeg := d;
+            best := k;
+          end;
+        end;
+    end;
+    if best >= 0 then
+    begin
+      x := x + dx[best];
+      y := y + dy[best];
+      moves := moves + 1;
+      board[y * N + x] := moves;
+    end;
+  end;
+  tour := moves;
+end;
+
+begin
+  dx[0] := 2;  dy[0] := 1;
+  dx[1] := 1;  dy[1] := 2;
+  dx[2] := -1; dy[2] := 2;
+  dx[3] := -2; dy[3] := 1;
+  dx[4] := -2; dy[4] := -1;
+  dx[5] := -1; dy[5] := -2;
+  dx[6] := 1;  dy[6] := -2;
+  dx[7] := 2;  dy[7] := -1;
+  complete := 0;
+  for start := 0 to 15 do
+    if tour(start mod N, start div N) = SQUARES then
+      complete := complete + 1;
+  writeln(complete);
+end.
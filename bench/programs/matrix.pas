@@ -0,0 +1,33 @@
+{ Dense real matrix multiply: floating-point arithmetic and 2D indexing }
+program BenchMatrix;
+
+const
+  SIZE = 60;
+
+var
+  a: array[0..3599] of real;
+  b: array[0..3599] of real;
+  c: array[0..3599] of real;
+  i, j, k: integer;
+  sum, trace: real;
+
+begin
+  for i := 0 to SIZE - 1 do
+    for j := 0 to SIZE - 1 do
+    begin
+      a[i * SIZE + j] := (i + j) / SIZE;
+      b[i * SIZE + j] := (i - j + 3) / SIZE;
+    end;
+  for i := 0 to SIZE - 1 do
+    for j := 0 to SIZE - 1 do
+    begin
+      sum := 0.0;
+      for k := 0 to SIZE - 1 do
+        sum := sum + a[i * SIZE + k] * b[k * SIZE + j];
+      c[i * SIZE + j] := sum;
+    end;
+  trace := 0.0;
+  for i := 0 to SIZE - 1 do
+    trace := trace + c[i * SIZE + i];
+  writeln(trace);
+end.
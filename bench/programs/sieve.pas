@@ -0,0 +1,38 @@
+{ Sieve of Eratosthenes: array stores and nested loops }
+program BenchSieve;
+
+const
+  LIMIT = 100000;
+  ROUNDS = 1;
+
+var
+  flags: array[0..100000] of integer;
+  i, j, round, count: integer;
+
+begin
+  for round := 1 to ROUNDS do
+  begin
+    for i := 0 to LIMIT do
+      flags[i] := 1;
+    flags[0] := 0;
+    flags[1] := 0;
+    i := 2;
+    while i * i <= LIMIT do
+    begin
+      if flags[i] = 1 then
+      begin
+        j := i * i;
+        while j <= LIMIT do
+        begin
+          flags[j] := 0;
+          j := j + i;
+        end;
+      end;
+      i := i + 1;
+    end;
+    count := 0;
+    for i := 0 to LIMIT do
+      count := count + flags[i];
+  end;
+  writeln(count);
+end.
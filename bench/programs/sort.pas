@@ -0,0 +1,33 @@
+{ Insertion sort of pseudo-random integers: array loads/stores and comparisons }
+program BenchSort;
+
+const
+  COUNT = 800;
+
+var
+  data: array[0..799] of integer;
+  i, j, key, seed, checksum: integer;
+
+begin
+  seed := 12345;
+  for i := 0 to COUNT - 1 do
+  begin
+    seed := (seed * 1103515245 + 12345) mod 2147483648;
+    data[i] := seed mod 100000;
+  end;
+  for i := 1 to COUNT - 1 do
+  begin
+    key := data[i];
+    j := i - 1;
+    while (j >= 0) and (data[j] > key) do
+    begin
+      data[j + 1] := data[j];
+      j := j - 1;
+    end;
+    data[j + 1] := key;
+  end;
+  checksum := 0;
+  for i := 0 to COUNT - 1 do
+    checksum := (checksum * 31 + data[i]) mod 1000000007;
+  writeln(checksum);
+end.
@@ -0,0 +1,91 @@
+/**
+ * @file cache.hpp
+ * @brief Content-hashed on-disk build cache for generated assembly and object files
+ * @author Jared Bruni
+ */
+#ifndef __CACHE_H_
+#define __CACHE_H_
+
+#include <cstdint>
+#include <string>
+
+namespace mxvm {
+
+    class Program;
+    enum class Platform;
+
+    /**
+     * @brief Directory of build artifacts addressed by a hash of their inputs
+     *
+     * An artifact is stored as `<dir>/<key><ext>`. A hit is copied into place
+     * instead of being rebuilt. Because keys hash content rather than
+     * timestamps, switching between versions of a source reuses earlier
+     * artifacts as well.
+     */
+    class BuildCache {
+      public:
+        /** @brief Open (and create if needed) a cache directory
+         * @param dir Cache directory; an empty string disables the cache
+         */
+        explicit BuildCache(const std::string &dir);
+
+        /** @brief true if the cache directory is usable */
+        bool enabled() const { return !dir.empty(); }
+
+        /** @brief 64-bit FNV-1a hash, chained through @p seed */
+        static uint64_t hash(const std::string &data, uint64_t seed = 14695981039346656037ULL);
+
+        /** @brief Hash of a file's contents chained through @p seed (the seed is returned unchanged if the file is missing) */
+        static uint64_t hashFile(const std::string &path, uint64_t seed = 14695981039346656037ULL);
+
+        /** @brief Format a hash as a fixed-width hex key */
+        static std::string toKey(uint64_t h);
+
+        /**
+         * @brief Key for the assembly generated from a program or object
+         *
+         * Covers the program's name, its source file, the sources of every
+         * object it loads, the declarations of the root program and of every
+         * object loaded for the build (which code generation can resolve
+         * names against), the module interfaces parsed for the build, the
+         * target platform and the code generation flags.
+         * @param program Program or object about to be translated
+         * @param flags Anything else that changes the generated code
+         */
+        static std::string sourceKey(Program &program, const std::string &flags);
+
+        /**
+         * @brief Seed for the keys of assembled objects and linked executables
+         *
+         * Covers the MXVM version and the target platform. Callers chain the
+         * full tool command line (assembler or linker plus the flags taken
+         * from the environment) and the input files through it.
+         */
+        static uint64_t toolSeed(Platform platform);
+
+        /** @brief Copy a cached artifact to @p dest
+         * @return true on a hit
+         */
+        bool fetch(const std::string &key, const std::string &ext, const std::string &dest) const;
+
+        /** @brief Store @p src in the cache under @p key (failures are ignored; the cache is an optimisation)
+         *
+         * The copy is written under a name unique to this call and renamed
+         * into place, so concurrent builds sharing a cache never see or
+         * clobber each other's partial artifacts.
+         */
+        void store(const std::string &key, const std::string &ext, const std::string &src) const;
+
+        /** @brief Read a small text record kept alongside the artifacts (empty if absent) */
+        std::string readRecord(const std::string &name) const;
+
+        /** @brief Write a small text record kept alongside the artifacts */
+        void writeRecord(const std::string &name, const std::string &value) const;
+
+      private:
+        std::string dir;
+    };
+
+} // namespace mxvm
+
+#endif
@@ -0,0 +1,79 @@
+/**
+ * @file emitter.hpp
+ * @brief Builds a Program from sections supplied in memory by a code generator
+ * @author Jared Bruni
+ */
+#ifndef __EMITTER_H_
+#define __EMITTER_H_
+
+#include "mxvm/instruct.hpp"
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mxvm {
+
+    class Parser;
+    class Program;
+
+    /**
+     * @brief Fills a Program's variables, labels and instructions directly
+     *
+     * Front ends that already hold a program's sections use this instead of
+     * printing MXVM source for Parser to scan again. Calls follow the order of
+     * a source file: objects and modules, then data, then code, then finish().
+     * Modules and objects are still loaded through the Parser that is passed
+     * in, so its module, include and object paths apply as they do to a parsed
+     * program.
+     */
+    class Emitter {
+      public:
+        /**
+         * @brief Start a program or object
+         * @param loader Parser used to load modules and objects (configured paths and mode)
+         * @param program Program to fill; should already have its context set up
+         * @param name Program or object name
+         * @param object true to emit an object instead of a program
+         */
+        Emitter(Parser &loader, std::unique_ptr<Program> &program, const std::string &name, bool object);
+
+        /** @brief Load an object from the object path (section object) */
+        void object(const std::string &name);
+        /** @brief Load a module and register its functions (section module) */
+        void module(const std::string &name);
+        /**
+         * @brief Declare a variable (section data)
+         * @param type Variable type
+         * @param name Name without the program prefix
+         * @param value Initial value as it would be written after `=` (string values unquoted)
+         */
+        void variable(VarType type, const std::string &name, const std::string &value);
+        /** @brief Declare a string buffer of @p size bytes (`string name, size`) */
+        void buffer(const std::string &name, size_t size);
+        /** @brief Mark the next instruction with a label; @p function for `function name:` */
+        void label(const std::string &name, bool function = false);
+        /**
+         * @brief Append an instruction
+         * @param mnemonic Instruction name as written in MXVM source (e.g. "mov")
+         * @param operands Operands built with constant() and symbol()
+         */
+        void instruction(const std::string &mnemonic, std::vector<Operand> operands);
+        /** @brief Resolve label operands and add the instructions to the program */
+        void finish();
+
+        /** @brief Integer constant operand from its decimal or 0x-prefixed text */
+        static Operand constant(const std::string &text);
+        /** @brief Variable, label or function operand; `Object.name` refers into another object */
+        static Operand symbol(const std::string &name);
+
+      private:
+        Parser &loader;
+        std::unique_ptr<Program> &program;
+        std::vector<Instruction> code;
+        std::unordered_map<std::string, size_t> labelMap;
+    };
+
+} // namespace mxvm
+
+#endif
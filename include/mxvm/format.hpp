@@ -0,0 +1,72 @@
+/**
+ * @file format.hpp
+ * @brief Pre-parsed printf-style format strings for print and string_print
+ * @author Jared Bruni
+ */
+#ifndef __FORMAT_H_
+#define __FORMAT_H_
+
+#include "mxvm/instruct.hpp"
+#include <string>
+#include <vector>
+
+namespace mxvm {
+
+    /**
+     * @brief A format string split once into literal text and conversions
+     *
+     * Parsing follows the interpreter's printf rules: flags, width, precision
+     * and length modifiers, then a conversion letter. `%%` is a literal percent,
+     * and a conversion without an argument is copied through unchanged.
+     * Each conversion is classified by its letter so the argument can be
+     * checked against it. Common cases such as `%lld`, `%d` and `%s` are
+     * appended directly, without going through snprintf.
+     */
+    class Format {
+      public:
+        Format() = default;
+
+        /** @brief Parse @p source */
+        explicit Format(const std::string &source);
+
+        /** @brief true if this was parsed from exactly @p text */
+        bool matches(const std::string &text) const { return parsed && text == src; }
+
+        /**
+         * @brief Append the formatted text to @p out
+         * @param out Output buffer (not cleared)
+         * @param args One Variable per conversion, in order
+         * @throws mx::Exception if a string conversion gets a number or a numeric conversion gets a string
+         */
+        void append(std::string &out, const std::vector<Variable *> &args) const;
+
+      private:
+        /** @brief What a segment is and, for conversions, which fast path applies */
+        enum class Kind : unsigned char {
+            LITERAL,   ///< text copied as is
+            INTEGER,   ///< d i u o x X c
+            FLOAT,     ///< f F e E g G a A
+            STRING,    ///< s
+            POINTER,   ///< p and anything else
+        };
+        /** @brief Conversions that are appended without snprintf */
+        enum class Fast : unsigned char {
+            NONE,
+            INT64,     ///< %lld %ld %lli %li
+            INT32,     ///< %d %i
+            STRING,    ///< %s
+        };
+        struct Segment {
+            Kind kind;
+            Fast fast;
+            std::string text; ///< literal text, or the whole conversion spec
+        };
+
+        std::string src;
+        bool parsed = false;
+        std::vector<Segment> segments;
+    };
+
+} // namespace mxvm
+
+#endif
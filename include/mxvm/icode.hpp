@@ -6,10 +6,18 @@
 #ifndef ICODE_HPP_
 #define ICODE_HPP_
 
+#include "mxvm/format.hpp"
 #include "mxvm/instruct.hpp"
+#include "mxvm/line_reader.hpp"
+#include "mxvm/output.hpp"
 #include "mxvm/parser.hpp"
+#include "mxvm/profile.hpp"
+#include "mxvm/stats.hpp"
 #include "scanner/exception.hpp"
 #include <functional>
+#include <memory>
+#include <set>
+#include <string>
 #include <unordered_map>
 #include <variant>
 #include <vector>
@@ -69,11 +77,58 @@ namespace mxvm {
     /** @brief Callback type for runtime-registered native functions */
     using runtime_call = std::function<void(Program *program, std::vector<Operand> &operands)>;
 
+    class Base;
+
+    /**
+     * @brief Per-VM state shared by a root program and all of its objects
+     *
+     * Every root Program owns its own Context, and objects loaded into it
+     * share that Context. Independent programs can therefore be loaded and
+     * run side by side, including on different threads. Module handles
+     * opened for a Context are released when its last Program is destroyed.
+     */
+    class Context {
+      public:
+        Context() = default;
+        Context(const Context &) = delete;
+        Context &operator=(const Context &) = delete;
+        /** @brief Release every module handle opened for this VM */
+        ~Context();
+
+        Base *base = nullptr;                                  ///< the root program
+        std::string root_name;                                 ///< name of the root program
+        std::vector<std::string> filenames;                    ///< generated object assembly files
+        std::unordered_map<std::string, Variable> allocated;   ///< heap-allocated variables
+        std::unordered_map<std::string, Program *> object_map; ///< object name -> Program mapping
+        std::unordered_map<std::string, void *> handles;       ///< dlopen handles by module path
+        uint64_t interface_hash = 0;                            ///< combined hash of the module interfaces parsed for this VM
+        std::unique_ptr<Stats> stats;                           ///< interpreter counters for --stats, nullptr when off
+        std::set<std::string> processing_files;                 ///< object files being loaded, to break include cycles
+        std::unordered_map<std::string, std::shared_ptr<void>> module_state; ///< per-VM state of native modules, by module name
+
+        /**
+         * @brief State a native module keeps for this VM, created on first use
+         *
+         * Modules reach it through the Program passed to every binding. It is
+         * released when the root program is destroyed, before its variables
+         * are freed and before the module libraries are closed.
+         */
+        template <typename T>
+        T &moduleState(const std::string &module) {
+            auto &state = module_state[module];
+            if (!state)
+                state = std::make_shared<T>();
+            return *static_cast<T *>(state.get());
+        }
+    };
+
     /**
      * @brief Wraps a dynamically loaded native function from a shared library module
      *
      * Manages dlopen handles and function pointers for external module calls.
-     * Shared library handles are cached in a static map.
+     * Shared library handles are cached per VM in its Context. Nothing is
+     * loaded when the function is declared: the module is opened and the
+     * symbol resolved on the first call, so unused modules are never loaded.
      */
     class RuntimeFunction {
       public:
@@ -81,7 +136,7 @@ namespace mxvm {
         RuntimeFunction() : func(nullptr), handle(nullptr) {}
 
         /** @brief Copy constructor */
-        RuntimeFunction(const RuntimeFunction &r) : func(r.func), handle(r.handle), mod_name(r.mod_name), fname(r.fname) {}
+        RuntimeFunction(const RuntimeFunction &r) : func(r.func), handle(r.handle), mod_name(r.mod_name), fname(r.fname), mod_path(r.mod_path), handles(r.handles) {}
 
         /** @brief Copy-assignment operator */
         RuntimeFunction &operator=(const RuntimeFunction &r) {
@@ -89,15 +144,28 @@ namespace mxvm {
             handle = r.handle;
             mod_name = r.mod_name;
             fname = r.fname;
+            mod_path = r.mod_path;
+            handles = r.handles;
             return *this;
         }
         ~RuntimeFunction() = default;
 
-        /** @brief Load a function symbol from a shared library
+        /** @brief Declare a function symbol in a shared library (resolved on first use)
          * @param mod Module/library name (without extension)
          * @param name Function symbol name to resolve
+         * @param handles Handle cache of the VM loading the module
+         */
+        RuntimeFunction(const std::string &mod, const std::string &name, std::unordered_map<std::string, void *> &handles);
+
+        /** @brief Open the module if this VM has not yet, and return its handle
+         * @throws mx::Exception if the shared library cannot be opened
+         */
+        void *module();
+
+        /** @brief Resolve the function symbol if it has not been resolved yet
+         * @throws mx::Exception if the module or symbol cannot be found
          */
-        RuntimeFunction(const std::string &mod, const std::string &name);
+        void resolve();
 
         /** @brief Invoke the loaded function
          * @param program Pointer to the running Program for variable access
@@ -108,7 +176,8 @@ namespace mxvm {
         void *handle = nullptr;  ///< dlopen handle
         std::string mod_name;    ///< module name
         std::string fname;       ///< function symbol name
-        static std::unordered_map<std::string, void *> handles; ///< cached library handles
+        std::string mod_path;    ///< shared library the symbol was resolved from
+        std::unordered_map<std::string, void *> *handles = nullptr; ///< handle cache of the owning VM
     };
 
     /**
@@ -130,7 +199,15 @@ namespace mxvm {
         /** @brief Set the root program base pointer (used for global variable lookup)
          * @param b Pointer to the main program's Base
          */
-        void setMainBase(Base *b) { Base::base = b; }
+        void setMainBase(Base *b) { context->base = b; }
+
+        /** @brief Root program of this VM, or nullptr if none has been set */
+        Base *mainBase() const { return context->base; }
+
+        /** @brief Join the VM of @p parent (used when loading objects into a program)
+         * @param parent Program whose Context is shared
+         */
+        void shareContext(const Base &parent) { context = parent.context; }
 
         /** @brief Append an instruction to the instruction stream
          * @param i Instruction to add
@@ -194,11 +271,7 @@ namespace mxvm {
         std::unordered_map<std::string, std::pair<uint64_t, bool>> labels; ///< label -> (address, is_function)
         std::vector<ExternalFunction> external;                      ///< declared external function imports
         std::unordered_map<std::string, RuntimeFunction> external_functions; ///< resolved runtime function bindings
-        static Base *base;                                           ///< pointer to the main program base
-        static std::string root_name;
-        static std::vector<std::string> filenames;
-        static std::unordered_map<std::string, Variable> allocated;  ///< heap-allocated variables
-        static std::unordered_map<std::string, Program *> object_map; ///< object name -> Program mapping
+        std::shared_ptr<Context> context = std::make_shared<Context>(); ///< state shared with the rest of this VM
         std::string assembly_code;                                   ///< generated assembly output for objects
     };
 
@@ -212,6 +285,7 @@ namespace mxvm {
     class Program : public Base {
       public:
         friend class Parser;
+        friend class Image;
         /** @brief Default constructor — initializes execution state (pc, flags, etc.) */
         Program();
         /** @brief Destructor — frees any heap-allocated variables */
@@ -329,9 +403,14 @@ namespace mxvm {
         void memoryDump(std::ostream &out);
 
         /** @brief Set the command-line arguments available to the program
+         *
+         * The std module's argc/argv read them from the root program, so
+         * argv[0] should name the host (as it does for a native executable).
          * @param argv Argument vector
          */
         void setArgs(const std::vector<std::string> &argv);
+        /** @brief Command-line arguments set with setArgs() */
+        const std::vector<std::string> &getArgs() const { return args; }
 
         /** @brief Mark this program as an object (no main entry point)
          * @param obj true for object mode, false for stand-alone program
@@ -395,6 +474,43 @@ namespace mxvm {
          */
         bool isFunctionValid(const std::string &label);
 
+        /**
+         * @brief Write this program, its objects and module imports as a bytecode image
+         *
+         * The image holds everything the interpreter needs after parsing, so
+         * loading it skips scanning, validation and code generation for the
+         * program and every object and module it pulls in.
+         * @param path Destination .mxb file
+         * @throws mx::Exception if the file cannot be written
+         */
+        void saveImage(const std::string &path);
+
+        /**
+         * @brief Memory-map a bytecode image written by saveImage into this root program
+         *
+         * Call after setMainBase(); modules are re-resolved under @p module_path.
+         * @param path .mxb file to load
+         * @param module_path Directory containing the modules/ tree
+         * @throws mx::Exception if the image is missing, truncated or from another version
+         */
+        void loadImage(const std::string &path, const std::string &module_path);
+
+        /** @brief Count instructions, calls and native call time during exec()
+         * @param enabled true to attach a Profiler on the next exec()
+         */
+        void setProfiling(bool enabled) { profiling = enabled; }
+
+        /** @brief Attach (or drop) interpreter counters for this VM; they only count in builds with MXVM_STATS
+         * @param enabled true to start counting from zero
+         */
+        void setStats(bool enabled) { context->stats = enabled ? std::make_unique<Stats>() : nullptr; }
+
+        /** @brief Counters attached with setStats(), or nullptr */
+        const Stats *getStats() const { return context->stats.get(); }
+
+        /** @brief Profiler filled by the last exec(), or nullptr if profiling was off */
+        const Profiler *getProfiler() const { return profiler.get(); }
+
       private:
         size_t pc;             ///< program counter
         bool running;          ///< interpreter running flag
@@ -407,6 +523,12 @@ namespace mxvm {
         std::vector<std::string> args;
         bool main_function;    ///< true if this program has a main entry point
         bool object_external = false;
+        bool profiling = false;              ///< attach a profiler on exec()
+        std::vector<RuntimeFunction *> invoke_cache; ///< per-instruction INVOKE target, filled on first execution
+        std::vector<Format> format_cache;    ///< per-instruction parsed PRINT/STRING_PRINT format, filled on first execution
+        std::string format_buffer;           ///< output buffer reused by PRINT/STRING_PRINT
+        LineReader line_reader;              ///< stdin reader reused by GETLINE
+        std::unique_ptr<Profiler> profiler;  ///< counters of the running exec(), if profiling
 
         /** @brief Tracks type of last comparison for conditional jumps */
         enum LastCmpType {
@@ -632,6 +754,7 @@ namespace mxvm {
 
         std::unordered_map<std::string, std::string> x64_reg_vars;   ///< Win64 variable-to-register mapping
         std::vector<std::string> x64_reg_save_order;
+        unsigned x64_sp_mod16 = 0; ///< Win64 codegen: bytes pushed since the last 16-byte aligned point, mod 16
 
         /** @brief Analyze variable usage and assign Win64 callee-saved registers
          * @param uses_std_module true if the program uses the std module (affects register choices)
@@ -829,18 +952,29 @@ namespace mxvm {
          */
         std::string printFormatted(const std::string &format, const std::vector<Variable *> &args, bool output = true);
 
-        /** @brief Set a variable's value from a constant string (integer, float, or string literal)
+        /** @brief Parsed form of @p format for the instruction being executed
+         *
+         * Instructions in the program body reuse a per-pc cache that is only
+         * re-parsed when the format text changes; any other caller parses
+         * into @p local.
+         */
+        const Format &formatFor(const Instruction &instr, const std::string &format, Format &local);
+
+        /** @brief Set a variable's value from a constant operand (integer, float, or string literal)
          * @param var Variable to modify
-         * @param value Constant string to parse
+         * @param op Constant operand; strings reuse its interned text
          */
-        void setVariableFromConstant(Variable &var, const std::string &value);
+        void setVariableFromConstant(Variable &var, const Operand &op);
 
-        /** @brief Create a temporary unnamed variable with the given type and value
+        /** @brief Create a temporary unnamed variable with the given type from a constant operand
          * @param type Variable type
-         * @param value Initial value as string
+         * @param op Constant operand; strings reuse its interned text
          * @return A new Variable
          */
-        Variable createTempVariable(VarType type, const std::string &value);
+        Variable createTempVariable(VarType type, const Operand &op);
+
+        /** @brief The text of a constant operand: the interned copy for string literals, a new string otherwise */
+        static SharedString constantText(const Operand &op);
 
         /** @brief Check whether a string represents a compile-time constant (number or quoted string)
          * @param value String to test
@@ -6,6 +6,7 @@
 #ifndef __INSTRUCT_HPP_X_
 #define __INSTRUCT_HPP_X_
 
+#include "mxvm/shared_string.hpp"
 #include <cstdint>
 #include <iostream>
 #include <string>
@@ -162,6 +163,7 @@ namespace mxvm {
         int op_value = 0;       ///< numeric operand value
         OperandType type;
         std::string object;     ///< owning object name for member access
+        SharedString text;      ///< interned copy of op for string literals, set when the instruction is loaded
     };
 
     /** @brief A complete MXVM instruction with opcode, operands, and optional label */
@@ -205,11 +207,12 @@ namespace mxvm {
      * @brief Runtime value storage for a variable
      *
      * Uses a union for int/float/pointer storage. Tracks pointer ownership
-     * and allocation state for memory management.
+     * and allocation state for memory management. String and label text
+     * are SharedString handles, so copying a value never copies text.
      */
     struct Variable_Value {
-        std::string str_value;
-        std::string label_value;
+        SharedString str_value;
+        SharedString label_value;
         union {
             int64_t int_value;
             double float_value;
@@ -222,7 +225,7 @@ namespace mxvm {
         bool owns = false;          ///< true if this value owns the allocated memory
         bool released = false;      ///< true if the owned memory has been freed
 
-        /** @brief Copy constructor — deep-copies all fields, dispatching on type for the union member
+        /** @brief Copy constructor — copies all fields (strings by reference), dispatching on type for the union member
          * @param other Source value to copy from
          */
         Variable_Value(const Variable_Value &other)
@@ -251,7 +254,7 @@ namespace mxvm {
             }
         }
 
-        /** @brief Copy-assignment operator — self-check then deep copy, dispatching on type
+        /** @brief Copy-assignment operator — self-check then copy (strings by reference), dispatching on type
          * @param other Source value to copy from
          * @return Reference to this
          */
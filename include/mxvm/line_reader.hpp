@@ -0,0 +1,46 @@
+/**
+ * @file line_reader.hpp
+ * @brief Reusable-buffer line reader for getline and the io module
+ * @author Jared Bruni
+ */
+#ifndef __LINE_READER_H_
+#define __LINE_READER_H_
+
+#include <cstdio>
+#include <string>
+#include <string_view>
+
+namespace mxvm {
+
+    /**
+     * @brief Reads lines of any length from a C stream
+     *
+     * One buffer is kept across calls and grows to the longest line seen, so
+     * reading a file line by line does not allocate once it has warmed up.
+     * Lines are returned without their trailing newline.
+     */
+    class LineReader {
+      public:
+        LineReader() = default;
+        ~LineReader();
+        LineReader(const LineReader &) = delete;
+        LineReader &operator=(const LineReader &) = delete;
+
+        /**
+         * @brief Read the next line of @p fp
+         * @param line Set to the line; valid until the next read
+         * @return false at end of file or on a read error
+         */
+        bool read(FILE *fp, std::string_view &line);
+
+        /** @brief Read the next line of @p fp into @p line, reusing its storage; empty at end of file */
+        bool read(FILE *fp, std::string &line);
+
+      private:
+        char *buffer = nullptr;
+        size_t capacity = 0;
+    };
+
+} // namespace mxvm
+
+#endif
@@ -6,5 +6,6 @@
 #ifndef __MXVM__HPP_
 #define __MXVM__HPP_
 #include "icode.hpp"
+#include "cache.hpp"
 #include"version_info.hpp"
 #endif
\ No newline at end of file
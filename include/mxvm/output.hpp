@@ -0,0 +1,36 @@
+/**
+ * @file output.hpp
+ * @brief Buffered stdout used by the interpreter's PRINT instruction
+ * @author Jared Bruni
+ */
+#ifndef __OUTPUT_H_
+#define __OUTPUT_H_
+
+#include <cstddef>
+
+namespace mxvm {
+
+    /** @brief Default size of the interpreter's stdout buffer in bytes */
+    inline constexpr size_t output_buffer_default = 64 * 1024;
+
+    /**
+     * @brief Give stdout a VM-owned buffer of @p size bytes
+     *
+     * stdout is flushed at each newline when it is a terminal, and only when
+     * the buffer fills up otherwise. The buffer is installed under the C
+     * stream, so native modules that write with printf/puts stay in order
+     * with PRINT. Call once, before anything is written to stdout; without
+     * it stdout keeps the C library's default buffering.
+     * @param size Buffer size in bytes (0 selects output_buffer_default)
+     */
+    void setOutputBuffer(size_t size);
+
+    /** @brief Append @p len bytes to stdout */
+    void writeOutput(const char *data, size_t len);
+
+    /** @brief Write out anything still held in the stdout buffer */
+    void flushOutput();
+
+} // namespace mxvm
+
+#endif
@@ -23,6 +23,7 @@ namespace mxvm {
     class CommentNode;
     class LabelNode;
     class Program;
+    class Profiler;
     class ModuleNode;
     class ObjectNode;
     struct Variable;
@@ -46,6 +47,7 @@ namespace mxvm {
     };
 
     class ModuleParser;
+    class Emitter;
 
     /**
      * @brief Main MXVM parser — tokenizes source, builds AST, and generates intermediate code
@@ -58,6 +60,7 @@ namespace mxvm {
 
       public:
         friend class ModuleParser;
+        friend class Emitter;
         /**
          * @brief Construct a parser from MXVM source text
          * @param source The MXVM source code to parse
@@ -74,7 +77,8 @@ namespace mxvm {
               include_path(other.include_path),
               object_mode(other.object_mode),
               object_name(other.object_name),
-              platform{other.platform} {}
+              platform{other.platform},
+              validate_source(other.validate_source) {}
 
         /** @brief Copy assignment */
         Parser &operator=(const Parser &other) {
@@ -89,6 +93,7 @@ namespace mxvm {
                 object_mode = other.object_mode;
                 object_name = other.object_name;
                 platform = other.platform;
+                validate_source = other.validate_source;
             }
             return *this;
         }
@@ -119,10 +124,14 @@ namespace mxvm {
          * @return true on success
          */
         bool generateProgramCode(const Mode &m, std::unique_ptr<Program> &program);
-        /** @brief Generate debug HTML output for the program */
+        /** @brief Generate debug HTML output for the program (annotated with hit counts when it ran with a profiler) */
         bool generateDebugHTML(std::ostream &out, std::unique_ptr<Program> &program);
-        /** @brief Generate a native assembly file for an object */
-        void generateObjectAssemblyFile(std::unique_ptr<Program> &objProgram);
+        /**
+         * @brief Generate a native assembly file for an object (safe to call for different objects concurrently)
+         * @param objProgram Object to translate
+         * @param key Cache key taken before any object was generated, empty when caching is off
+         */
+        void generateObjectAssemblyFile(std::unique_ptr<Program> &objProgram, const std::string &key);
         /** @brief Register external functions from an object into the main program */
         void registerObjectExterns(std::unique_ptr<Program> &mainProgram, const std::unique_ptr<Program> &objProgram);
         std::string source_file;
@@ -135,6 +144,9 @@ namespace mxvm {
         bool object_mode = false;           ///< true when parsing an object definition
         std::string object_name;
         Platform platform;
+        bool validate_source = true;        ///< false to skip the Validator pass for trusted, compiler-generated source
+        std::string cache_dir;              ///< build cache for generated object assembly (empty disables it)
+        unsigned int jobs = 1;              ///< worker threads used to generate object assembly
 
       private:
         std::unique_ptr<SectionNode> parseSection(uint64_t &index);
@@ -156,6 +168,7 @@ namespace mxvm {
         void resolveLabelReference(Operand &operand, const std::unordered_map<std::string, size_t> &labelMap);
         void collectObjectNames(std::vector<std::pair<std::string, std::string>> &names, const std::unique_ptr<Program> &program);
         void printObjectHTML(std::ostream &out, const std::unique_ptr<Program> &objPtr);
+        void printProfileHTML(std::ostream &out, const Profiler &profiler);
     };
 
     /** @brief Describes an external function imported from a module or object */
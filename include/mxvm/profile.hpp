@@ -0,0 +1,136 @@
+/**
+ * @file profile.hpp
+ * @brief Low-overhead execution profiler for the MXVM interpreter
+ * @author Jared Bruni
+ */
+#ifndef __PROFILE_H_
+#define __PROFILE_H_
+
+#include "mxvm/instruct.hpp"
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace mxvm {
+
+    /**
+     * @brief Counts where an interpreted program spends its time
+     *
+     * Every executed instruction increments a slot in a counter array
+     * indexed by program counter. It is also charged to the current node
+     * of a calling-context tree, which CALL and RET move down and up.
+     * Calls into native module functions are timed. When the program ends,
+     * the counters are written as a flat profile, a call graph and a
+     * folded-stack file.
+     */
+    class Profiler {
+      public:
+        /** @brief Cost of one function, summed over every context it ran in */
+        struct FunctionCost {
+            std::string name;        ///< function label (program name for top-level code)
+            uint64_t self = 0;       ///< instructions executed in the function itself
+            uint64_t inclusive = 0;  ///< self plus callees, counting recursion once
+            uint64_t calls = 0;      ///< times the function was called
+        };
+
+        /**
+         * @brief Prepare counters for a flattened instruction stream
+         * @param inc Instructions being executed
+         * @param labels Label table (address, is_function) of the same stream
+         * @param entry Name reported for code outside any function (the program name)
+         */
+        Profiler(const std::vector<Instruction> &inc, const std::unordered_map<std::string, std::pair<uint64_t, bool>> &labels, const std::string &entry);
+
+        /** @brief Count one execution of the instruction at @p pc */
+        void step(size_t pc) {
+            ++hits[pc];
+            ++current->self;
+        }
+
+        /** @brief Record a CALL that has just jumped to @p target */
+        void enter(size_t target);
+
+        /** @brief Record a RET leaving the current function */
+        void leave();
+
+        /** @brief Add the duration of one call to a native module function */
+        void invoked(const std::string &name, std::chrono::steady_clock::duration elapsed);
+
+        /** @brief Executions of the instruction at @p pc */
+        uint64_t count(size_t pc) const { return pc < hits.size() ? hits[pc] : 0; }
+
+        /** @brief Total instructions executed */
+        uint64_t total() const;
+
+        /** @brief Per-function costs, most expensive (self) first */
+        std::vector<FunctionCost> functionCosts() const;
+
+        /** @brief Instructions executed under each label, hottest first */
+        std::vector<std::pair<std::string, uint64_t>> blockCosts() const;
+
+        /** @brief Nearest label at or before @p pc (the basic block it belongs to) */
+        const std::string &blockOf(size_t pc) const { return block_of.at(pc); }
+
+        /** @brief Write per-function, per-label, hot-instruction and native-call tables */
+        void writeFlat(std::ostream &out) const;
+
+        /** @brief Write callers and callees of every function with call counts and inclusive cost */
+        void writeCallGraph(std::ostream &out) const;
+
+        /** @brief Write `main;f;g count` lines (weights are instructions executed) for flame graph tools */
+        void writeFolded(std::ostream &out) const;
+
+        /**
+         * @brief Write all three reports next to each other
+         * @param prefix Path prefix; files are prefix.profile.txt, prefix.callgraph.txt and prefix.folded
+         * @return true if every file was written
+         */
+        bool write(const std::string &prefix) const;
+
+      private:
+        /** @brief Deepest calling context kept; deeper calls are charged to the context at this depth,
+         * which bounds the tree walks and the node destructors on deeply recursive programs */
+        static constexpr size_t max_depth = 1024;
+
+        /** @brief Calling-context tree node: one distinct call stack */
+        struct Node {
+            size_t function;                         ///< index into functions
+            Node *parent;                            ///< caller context, nullptr at the root
+            uint64_t self = 0;                       ///< instructions executed in this context
+            uint64_t calls = 0;                      ///< times this context was entered
+            std::unordered_map<size_t, std::unique_ptr<Node>> children; ///< callee contexts by function
+        };
+
+        /** @brief Aggregated timing of one native function */
+        struct NativeCall {
+            uint64_t calls = 0;
+            std::chrono::steady_clock::duration time{};
+        };
+
+        const std::vector<Instruction> &inc;
+        std::vector<uint64_t> hits;              ///< executions per instruction
+        std::vector<std::string> functions;      ///< function names, [0] is the entry
+        std::vector<size_t> function_of;         ///< owning function per instruction
+        std::vector<std::string> block_of;       ///< nearest preceding label per instruction
+        std::unordered_map<uint64_t, size_t> function_at; ///< function entry address -> function index
+        std::unique_ptr<Node> root;
+        Node *current;
+        size_t depth = 0;                        ///< depth of current below the root
+        std::vector<size_t> beyond;              ///< functions of open calls entered past max_depth, charged to current
+        std::unordered_map<size_t, std::unordered_map<size_t, uint64_t>> beyond_edges; ///< caller -> callee call counts past max_depth
+        std::unordered_map<std::string, NativeCall> native;
+
+        uint64_t inclusive(const Node &n) const;
+        void collect(const Node &n, std::vector<uint64_t> &self, std::vector<uint64_t> &incl, std::vector<bool> &on_stack,
+                     std::unordered_map<size_t, std::unordered_map<size_t, uint64_t>> &edges) const;
+        void collectAll(std::vector<uint64_t> &self, std::vector<uint64_t> &incl,
+                        std::unordered_map<size_t, std::unordered_map<size_t, uint64_t>> &edges) const;
+    };
+
+} // namespace mxvm
+
+#endif
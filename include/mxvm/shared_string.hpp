@@ -0,0 +1,147 @@
+/**
+ * @file shared_string.hpp
+ * @brief Immutable, reference-counted and interned string payloads for Variable_Value
+ * @author Jared Bruni
+ */
+#ifndef __SHARED_STRING_H_
+#define __SHARED_STRING_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace mxvm {
+
+    /**
+     * @brief A copy-on-write string handle
+     *
+     * Copies share one heap block and bump its reference count; the text
+     * is only duplicated when a shared value is changed through mutate().
+     * Interned values (see intern()) are counted the same way, and at most
+     * one interned block exists per text, so two interned values are equal
+     * exactly when they share a block. The empty string holds no block at
+     * all.
+     */
+    class SharedString {
+      public:
+        SharedString() noexcept = default;
+        SharedString(const std::string &s) : rep(s.empty() ? nullptr : new Rep(s)) {}
+        SharedString(std::string &&s) : rep(s.empty() ? nullptr : new Rep(std::move(s))) {}
+        SharedString(const char *s) : SharedString(std::string(s ? s : "")) {}
+        SharedString(const SharedString &other) noexcept : rep(other.rep) { retain(); }
+        SharedString(SharedString &&other) noexcept : rep(other.rep) { other.rep = nullptr; }
+        ~SharedString() { release(); }
+
+        SharedString &operator=(const SharedString &other) noexcept {
+            if (rep != other.rep) {
+                other.retain();
+                release();
+                rep = other.rep;
+            }
+            return *this;
+        }
+        SharedString &operator=(SharedString &&other) noexcept {
+            if (this != &other) {
+                release();
+                rep = other.rep;
+                other.rep = nullptr;
+            }
+            return *this;
+        }
+        SharedString &operator=(const std::string &s) {
+            if (unique())
+                rep->text = s;
+            else
+                *this = SharedString(s);
+            return *this;
+        }
+        SharedString &operator=(std::string &&s) {
+            if (unique())
+                rep->text = std::move(s);
+            else
+                *this = SharedString(std::move(s));
+            return *this;
+        }
+        SharedString &operator=(const char *s) { return *this = std::string(s ? s : ""); }
+
+        /**
+         * @brief The process-wide shared copy of @p s
+         *
+         * Use for text that repeats for the life of a program, such as
+         * string constants and labels from the source. Each distinct
+         * string is stored once while any handle to it is alive; the last
+         * release removes it from the table and frees it.
+         */
+        static SharedString intern(std::string_view s);
+
+        const std::string &str() const noexcept { return rep ? rep->text : emptyString(); }
+        operator const std::string &() const noexcept { return str(); }
+        const char *c_str() const noexcept { return str().c_str(); }
+        const char *data() const noexcept { return str().data(); }
+        size_t size() const noexcept { return rep ? rep->text.size() : 0; }
+        size_t length() const noexcept { return size(); }
+        bool empty() const noexcept { return size() == 0; }
+        char operator[](size_t i) const { return str()[i]; }
+        bool interned() const noexcept { return rep != nullptr && rep->interned; }
+
+        /** @brief Writable text, copied first if the block is shared or interned */
+        std::string &mutate() {
+            if (!unique())
+                *this = SharedString(std::string(str()), true);
+            return rep->text;
+        }
+
+        /** @brief Equal text; a pointer comparison when both sides are interned */
+        bool operator==(const SharedString &other) const noexcept {
+            if (rep == other.rep)
+                return true;
+            if (interned() && other.interned())
+                return false;
+            return str() == other.str();
+        }
+
+      private:
+        struct Rep {
+            explicit Rep(std::string s, bool is_interned = false) : interned(is_interned), text(std::move(s)) {}
+            std::atomic<uint32_t> refs{1};
+            const bool interned;
+            std::string text;
+        };
+
+        Rep *rep = nullptr;
+
+        /** @brief Always allocate a block, even for empty text, so it can be mutated */
+        SharedString(std::string &&s, bool) : rep(new Rep(std::move(s))) {}
+        explicit SharedString(Rep *r) noexcept : rep(r) {}
+
+        /** @brief Remove a released interned block from the table and free it */
+        static void releaseInterned(Rep *r) noexcept;
+
+        bool unique() const noexcept {
+            return rep != nullptr && !rep->interned && rep->refs.load(std::memory_order_acquire) == 1;
+        }
+        void retain() const noexcept {
+            if (rep != nullptr)
+                rep->refs.fetch_add(1, std::memory_order_relaxed);
+        }
+        void release() noexcept {
+            if (rep != nullptr && rep->refs.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                if (rep->interned)
+                    releaseInterned(rep);
+                else
+                    delete rep;
+            }
+            rep = nullptr;
+        }
+        static const std::string &emptyString() noexcept {
+            static const std::string empty;
+            return empty;
+        }
+    };
+
+} // namespace mxvm
+
+#endif
@@ -0,0 +1,74 @@
+/**
+ * @file stats.hpp
+ * @brief Interpreter event counters reported by mxvmc --stats
+ * @author Jared Bruni
+ */
+#ifndef __STATS_H_
+#define __STATS_H_
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace mxvm {
+
+    /**
+     * @brief Counts what the interpreter does on behalf of a program
+     *
+     * Covers opcodes executed, variable lookups, operand stack depth, heap
+     * traffic from alloc/realloc/free, temporary Variables built for
+     * constant operands, and native module calls. Counting only happens
+     * when a Stats object is attached to the Context. The counting code
+     * itself is only built when MXVM_STATS is defined (CMake option
+     * WITH_STATS).
+     */
+    struct Stats {
+        Stats();
+
+        std::vector<uint64_t> opcodes;   ///< executions per opcode, indexed by Inc
+        uint64_t is_variable = 0;        ///< Program::isVariable calls
+        uint64_t get_variable = 0;       ///< Program::getVariable calls
+        uint64_t stack_peak = 0;         ///< deepest operand stack seen
+        uint64_t allocs = 0;             ///< ALLOC instructions
+        uint64_t alloc_bytes = 0;        ///< bytes requested by ALLOC
+        uint64_t reallocs = 0;           ///< REALLOC instructions
+        uint64_t realloc_bytes = 0;      ///< new sizes requested by REALLOC
+        uint64_t frees = 0;              ///< FREE instructions that released memory
+        uint64_t free_bytes = 0;         ///< bytes released by FREE
+        uint64_t temp_variables = 0;     ///< Program::createTempVariable calls
+        std::map<std::string, uint64_t> native_calls; ///< RuntimeFunction::call count by module.function
+
+        /** @brief Write all counters as a plain-text report */
+        void write(std::ostream &out) const;
+    };
+
+    /** @brief true if this build of libmxvm contains the counting code */
+#ifdef MXVM_STATS
+    inline constexpr bool stats_available = true;
+#else
+    inline constexpr bool stats_available = false;
+#endif
+
+} // namespace mxvm
+
+/**
+ * @brief Run @p stmt with `stats` bound to the Stats of @p ctx, if one is attached
+ *
+ * Expands to nothing unless MXVM_STATS is defined.
+ */
+#ifdef MXVM_STATS
+#define MXVM_STAT(ctx, stmt)                                  \
+    do {                                                      \
+        if (::mxvm::Stats *stats = (ctx)->stats.get()) {      \
+            stmt;                                             \
+        }                                                     \
+    } while (0)
+#else
+#define MXVM_STAT(ctx, stmt) \
+    do {                     \
+    } while (0)
+#endif
+
+#endif
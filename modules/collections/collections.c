@@ -0,0 +1,560 @@
+/**
+ * @file collections.c
+ * @brief Collections module C implementation — open-addressing hash maps, int vectors and a binary min-heap
+ * @author Jared Bruni
+ */
+#include "mx_collections.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Hash values 0 and 1 mark empty and deleted slots; real hashes are >= 2 */
+#define SLOT_EMPTY 0
+#define SLOT_DELETED 1
+#define MAP_MIN_CAPACITY 16
+
+typedef struct {
+    uint64_t hash;
+    int64_t key; /* the key, or a char * for string keys */
+    int64_t value;
+} mx_slot_t;
+
+typedef struct {
+    uint32_t kind;
+    int strings;
+    mx_slot_t *slots;
+    size_t cap;  /* power of two */
+    size_t count; /* live keys */
+    size_t used;  /* live keys plus deleted slots */
+} mx_map_t;
+
+typedef struct {
+    uint32_t kind;
+    int64_t *data;
+    size_t len, cap;
+} mx_vec_t;
+
+typedef struct {
+    int64_t priority;
+    int64_t value;
+} mx_heap_entry_t;
+
+typedef struct {
+    uint32_t kind;
+    mx_heap_entry_t *data;
+    size_t len, cap;
+} mx_heap_t;
+
+int collection_kind(const void *handle) {
+    if (!handle)
+        return MX_COLL_NONE;
+    return (int)*(const uint32_t *)handle;
+}
+
+static uint64_t hash_string(const char *s) {
+    uint64_t h = 14695981039346656037ULL;
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 1099511628211ULL;
+    }
+    return h < 2 ? h + 2 : h;
+}
+
+static uint64_t hash_int(int64_t k) {
+    uint64_t x = (uint64_t)k;
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x < 2 ? x + 2 : x;
+}
+
+static char *copy_key(const char *s) {
+    size_t n = strlen(s) + 1;
+    char *d = (char *)malloc(n);
+    if (d)
+        memcpy(d, s, n);
+    return d;
+}
+
+static mx_map_t *map_new(uint32_t kind, int strings) {
+    mx_map_t *m = (mx_map_t *)calloc(1, sizeof(mx_map_t));
+    if (!m)
+        return NULL;
+    m->slots = (mx_slot_t *)calloc(MAP_MIN_CAPACITY, sizeof(mx_slot_t));
+    if (!m->slots) {
+        free(m);
+        return NULL;
+    }
+    m->kind = kind;
+    m->strings = strings;
+    m->cap = MAP_MIN_CAPACITY;
+    return m;
+}
+
+static mx_map_t *map_of(void *m, uint32_t kind) {
+    return (m && ((mx_map_t *)m)->kind == kind) ? (mx_map_t *)m : NULL;
+}
+
+static void map_free(mx_map_t *m) {
+    size_t i;
+    if (!m)
+        return;
+    if (m->strings) {
+        for (i = 0; i < m->cap; ++i)
+            if (m->slots[i].hash >= 2)
+                free((char *)(intptr_t)m->slots[i].key);
+    }
+    free(m->slots);
+    m->kind = MX_COLL_NONE;
+    free(m);
+}
+
+static int key_equal(const mx_map_t *m, const mx_slot_t *slot, uint64_t hash, int64_t key) {
+    if (slot->hash != hash)
+        return 0;
+    if (m->strings)
+        return strcmp((const char *)(intptr_t)slot->key, (const char *)(intptr_t)key) == 0;
+    return slot->key == key;
+}
+
+/* Slot holding key, or -1 */
+static int64_t map_find(const mx_map_t *m, uint64_t hash, int64_t key) {
+    size_t mask = m->cap - 1;
+    size_t i = (size_t)hash & mask;
+    for (;;) {
+        const mx_slot_t *s = &m->slots[i];
+        if (s->hash == SLOT_EMPTY)
+            return -1;
+        if (key_equal(m, s, hash, key))
+            return (int64_t)i;
+        i = (i + 1) & mask;
+    }
+}
+
+/* Rebuild into a table of new_cap slots, dropping deleted markers */
+static int map_rehash(mx_map_t *m, size_t new_cap) {
+    size_t i, mask = new_cap - 1;
+    mx_slot_t *slots = (mx_slot_t *)calloc(new_cap, sizeof(mx_slot_t));
+    if (!slots)
+        return 0;
+    for (i = 0; i < m->cap; ++i) {
+        size_t j;
+        if (m->slots[i].hash < 2)
+            continue;
+        j = (size_t)m->slots[i].hash & mask;
+        while (slots[j].hash != SLOT_EMPTY)
+            j = (j + 1) & mask;
+        slots[j] = m->slots[i];
+    }
+    free(m->slots);
+    m->slots = slots;
+    m->cap = new_cap;
+    m->used = m->count;
+    return 1;
+}
+
+/* Slot for key, inserting it with value 0 if absent; -1 when out of memory */
+static int64_t map_slot(mx_map_t *m, uint64_t hash, int64_t key, int *added) {
+    size_t mask, i;
+    int64_t found = map_find(m, hash, key);
+    int64_t tomb = -1;
+    *added = 0;
+    if (found >= 0)
+        return found;
+    if ((m->used + 1) * 4 > m->cap * 3) {
+        /* Grow when mostly live keys, otherwise just sweep out deleted slots */
+        size_t new_cap = (m->count + 1) * 2 > m->cap ? m->cap * 2 : m->cap;
+        if (!map_rehash(m, new_cap))
+            return -1;
+    }
+    mask = m->cap - 1;
+    i = (size_t)hash & mask;
+    while (m->slots[i].hash != SLOT_EMPTY) {
+        if (m->slots[i].hash == SLOT_DELETED && tomb < 0)
+            tomb = (int64_t)i;
+        i = (i + 1) & mask;
+    }
+    if (tomb >= 0)
+        i = (size_t)tomb;
+    else
+        m->used++;
+    if (m->strings) {
+        char *copy = copy_key((const char *)(intptr_t)key);
+        if (!copy)
+            return -1;
+        key = (int64_t)(intptr_t)copy;
+    }
+    m->slots[i].hash = hash;
+    m->slots[i].key = key;
+    m->slots[i].value = 0;
+    m->count++;
+    *added = 1;
+    return (int64_t)i;
+}
+
+static int64_t map_put(mx_map_t *m, uint64_t hash, int64_t key, int64_t value) {
+    int added;
+    int64_t i = map_slot(m, hash, key, &added);
+    if (i < 0)
+        return 0;
+    m->slots[i].value = value;
+    return added;
+}
+
+static int64_t map_add(mx_map_t *m, uint64_t hash, int64_t key, int64_t delta) {
+    int added;
+    int64_t i = map_slot(m, hash, key, &added);
+    if (i < 0)
+        return 0;
+    m->slots[i].value = (int64_t)((uint64_t)m->slots[i].value + (uint64_t)delta);
+    return m->slots[i].value;
+}
+
+static int64_t map_del(mx_map_t *m, uint64_t hash, int64_t key) {
+    int64_t i = map_find(m, hash, key);
+    if (i < 0)
+        return 0;
+    if (m->strings)
+        free((char *)(intptr_t)m->slots[i].key);
+    m->slots[i].hash = SLOT_DELETED;
+    m->slots[i].key = 0;
+    m->count--;
+    return 1;
+}
+
+static int64_t map_next(const mx_map_t *m, int64_t slot) {
+    size_t i = slot < 0 ? 0 : (size_t)slot + 1;
+    for (; i < m->cap; ++i)
+        if (m->slots[i].hash >= 2)
+            return (int64_t)i;
+    return -1;
+}
+
+static const mx_slot_t *map_at(const mx_map_t *m, int64_t slot) {
+    if (slot < 0 || (size_t)slot >= m->cap || m->slots[slot].hash < 2)
+        return NULL;
+    return &m->slots[slot];
+}
+
+#define SKEY(k) ((int64_t)(intptr_t)(k))
+
+void *smap_new(void) {
+    return map_new(MX_COLL_SMAP, 1);
+}
+
+void smap_free(void *m) {
+    map_free(map_of(m, MX_COLL_SMAP));
+}
+
+int64_t smap_put(void *m, const char *key, int64_t value) {
+    mx_map_t *map = map_of(m, MX_COLL_SMAP);
+    return (map && key) ? map_put(map, hash_string(key), SKEY(key), value) : 0;
+}
+
+int64_t smap_add(void *m, const char *key, int64_t delta) {
+    mx_map_t *map = map_of(m, MX_COLL_SMAP);
+    return (map && key) ? map_add(map, hash_string(key), SKEY(key), delta) : 0;
+}
+
+int64_t smap_get(void *m, const char *key, int64_t fallback) {
+    mx_map_t *map = map_of(m, MX_COLL_SMAP);
+    int64_t i = (map && key) ? map_find(map, hash_string(key), SKEY(key)) : -1;
+    return i >= 0 ? map->slots[i].value : fallback;
+}
+
+int64_t smap_has(void *m, const char *key) {
+    mx_map_t *map = map_of(m, MX_COLL_SMAP);
+    return (map && key) ? map_find(map, hash_string(key), SKEY(key)) >= 0 : 0;
+}
+
+int64_t smap_del(void *m, const char *key) {
+    mx_map_t *map = map_of(m, MX_COLL_SMAP);
+    return (map && key) ? map_del(map, hash_string(key), SKEY(key)) : 0;
+}
+
+int64_t smap_count(void *m) {
+    mx_map_t *map = map_of(m, MX_COLL_SMAP);
+    return map ? (int64_t)map->count : 0;
+}
+
+int64_t smap_next(void *m, int64_t slot) {
+    mx_map_t *map = map_of(m, MX_COLL_SMAP);
+    return map ? map_next(map, slot) : -1;
+}
+
+const char *smap_key(void *m, int64_t slot) {
+    mx_map_t *map = map_of(m, MX_COLL_SMAP);
+    const mx_slot_t *s = map ? map_at(map, slot) : NULL;
+    return s ? (const char *)(intptr_t)s->key : NULL;
+}
+
+int64_t smap_value(void *m, int64_t slot) {
+    mx_map_t *map = map_of(m, MX_COLL_SMAP);
+    const mx_slot_t *s = map ? map_at(map, slot) : NULL;
+    return s ? s->value : 0;
+}
+
+void *imap_new(void) {
+    return map_new(MX_COLL_IMAP, 0);
+}
+
+void imap_free(void *m) {
+    map_free(map_of(m, MX_COLL_IMAP));
+}
+
+int64_t imap_put(void *m, int64_t key, int64_t value) {
+    mx_map_t *map = map_of(m, MX_COLL_IMAP);
+    return map ? map_put(map, hash_int(key), key, value) : 0;
+}
+
+int64_t imap_add(void *m, int64_t key, int64_t delta) {
+    mx_map_t *map = map_of(m, MX_COLL_IMAP);
+    return map ? map_add(map, hash_int(key), key, delta) : 0;
+}
+
+int64_t imap_get(void *m, int64_t key, int64_t fallback) {
+    mx_map_t *map = map_of(m, MX_COLL_IMAP);
+    int64_t i = map ? map_find(map, hash_int(key), key) : -1;
+    return i >= 0 ? map->slots[i].value : fallback;
+}
+
+int64_t imap_has(void *m, int64_t key) {
+    mx_map_t *map = map_of(m, MX_COLL_IMAP);
+    return map ? map_find(map, hash_int(key), key) >= 0 : 0;
+}
+
+int64_t imap_del(void *m, int64_t key) {
+    mx_map_t *map = map_of(m, MX_COLL_IMAP);
+    return map ? map_del(map, hash_int(key), key) : 0;
+}
+
+int64_t imap_count(void *m) {
+    mx_map_t *map = map_of(m, MX_COLL_IMAP);
+    return map ? (int64_t)map->count : 0;
+}
+
+int64_t imap_next(void *m, int64_t slot) {
+    mx_map_t *map = map_of(m, MX_COLL_IMAP);
+    return map ? map_next(map, slot) : -1;
+}
+
+int64_t imap_key(void *m, int64_t slot) {
+    mx_map_t *map = map_of(m, MX_COLL_IMAP);
+    const mx_slot_t *s = map ? map_at(map, slot) : NULL;
+    return s ? s->key : 0;
+}
+
+int64_t imap_value(void *m, int64_t slot) {
+    mx_map_t *map = map_of(m, MX_COLL_IMAP);
+    const mx_slot_t *s = map ? map_at(map, slot) : NULL;
+    return s ? s->value : 0;
+}
+
+void *pmap_new(void) {
+    return map_new(MX_COLL_PMAP, 1);
+}
+
+void pmap_free(void *m) {
+    map_free(map_of(m, MX_COLL_PMAP));
+}
+
+int64_t pmap_put(void *m, const char *key, void *value) {
+    mx_map_t *map = map_of(m, MX_COLL_PMAP);
+    return (map && key) ? map_put(map, hash_string(key), SKEY(key), (int64_t)(intptr_t)value) : 0;
+}
+
+void *pmap_get(void *m, const char *key) {
+    mx_map_t *map = map_of(m, MX_COLL_PMAP);
+    int64_t i = (map && key) ? map_find(map, hash_string(key), SKEY(key)) : -1;
+    return i >= 0 ? (void *)(intptr_t)map->slots[i].value : NULL;
+}
+
+int64_t pmap_has(void *m, const char *key) {
+    mx_map_t *map = map_of(m, MX_COLL_PMAP);
+    return (map && key) ? map_find(map, hash_string(key), SKEY(key)) >= 0 : 0;
+}
+
+int64_t pmap_del(void *m, const char *key) {
+    mx_map_t *map = map_of(m, MX_COLL_PMAP);
+    return (map && key) ? map_del(map, hash_string(key), SKEY(key)) : 0;
+}
+
+int64_t pmap_count(void *m) {
+    mx_map_t *map = map_of(m, MX_COLL_PMAP);
+    return map ? (int64_t)map->count : 0;
+}
+
+int64_t pmap_next(void *m, int64_t slot) {
+    mx_map_t *map = map_of(m, MX_COLL_PMAP);
+    return map ? map_next(map, slot) : -1;
+}
+
+const char *pmap_key(void *m, int64_t slot) {
+    mx_map_t *map = map_of(m, MX_COLL_PMAP);
+    const mx_slot_t *s = map ? map_at(map, slot) : NULL;
+    return s ? (const char *)(intptr_t)s->key : NULL;
+}
+
+void *pmap_value(void *m, int64_t slot) {
+    mx_map_t *map = map_of(m, MX_COLL_PMAP);
+    const mx_slot_t *s = map ? map_at(map, slot) : NULL;
+    return s ? (void *)(intptr_t)s->value : NULL;
+}
+
+static mx_vec_t *vec_of(void *v) {
+    return (v && ((mx_vec_t *)v)->kind == MX_COLL_VEC) ? (mx_vec_t *)v : NULL;
+}
+
+void *vec_new(void) {
+    mx_vec_t *v = (mx_vec_t *)calloc(1, sizeof(mx_vec_t));
+    if (v)
+        v->kind = MX_COLL_VEC;
+    return v;
+}
+
+void vec_free(void *v) {
+    mx_vec_t *vec = vec_of(v);
+    if (!vec)
+        return;
+    free(vec->data);
+    vec->kind = MX_COLL_NONE;
+    free(vec);
+}
+
+int64_t vec_push(void *v, int64_t x) {
+    mx_vec_t *vec = vec_of(v);
+    if (!vec)
+        return 0;
+    if (vec->len == vec->cap) {
+        size_t cap = vec->cap ? vec->cap * 2 : 16;
+        int64_t *data = (int64_t *)realloc(vec->data, cap * sizeof(int64_t));
+        if (!data)
+            return (int64_t)vec->len;
+        vec->data = data;
+        vec->cap = cap;
+    }
+    vec->data[vec->len++] = x;
+    return (int64_t)vec->len;
+}
+
+int64_t vec_pop(void *v) {
+    mx_vec_t *vec = vec_of(v);
+    return (vec && vec->len) ? vec->data[--vec->len] : 0;
+}
+
+int64_t vec_get(void *v, int64_t i) {
+    mx_vec_t *vec = vec_of(v);
+    return (vec && i >= 0 && (size_t)i < vec->len) ? vec->data[i] : 0;
+}
+
+int64_t vec_set(void *v, int64_t i, int64_t x) {
+    mx_vec_t *vec = vec_of(v);
+    if (!vec || i < 0 || (size_t)i >= vec->len)
+        return 0;
+    vec->data[i] = x;
+    return 1;
+}
+
+int64_t vec_len(void *v) {
+    mx_vec_t *vec = vec_of(v);
+    return vec ? (int64_t)vec->len : 0;
+}
+
+void vec_clear(void *v) {
+    mx_vec_t *vec = vec_of(v);
+    if (vec)
+        vec->len = 0;
+}
+
+int64_t *vec_data(void *v) {
+    mx_vec_t *vec = vec_of(v);
+    return vec ? vec->data : NULL;
+}
+
+static mx_heap_t *heap_of(void *h) {
+    return (h && ((mx_heap_t *)h)->kind == MX_COLL_HEAP) ? (mx_heap_t *)h : NULL;
+}
+
+void *heap_new(void) {
+    mx_heap_t *h = (mx_heap_t *)calloc(1, sizeof(mx_heap_t));
+    if (h)
+        h->kind = MX_COLL_HEAP;
+    return h;
+}
+
+void heap_free(void *h) {
+    mx_heap_t *heap = heap_of(h);
+    if (!heap)
+        return;
+    free(heap->data);
+    heap->kind = MX_COLL_NONE;
+    free(heap);
+}
+
+int64_t heap_push(void *h, int64_t priority, int64_t value) {
+    mx_heap_t *heap = heap_of(h);
+    size_t i;
+    if (!heap)
+        return 0;
+    if (heap->len == heap->cap) {
+        size_t cap = heap->cap ? heap->cap * 2 : 16;
+        mx_heap_entry_t *data = (mx_heap_entry_t *)realloc(heap->data, cap * sizeof(mx_heap_entry_t));
+        if (!data)
+            return (int64_t)heap->len;
+        heap->data = data;
+        heap->cap = cap;
+    }
+    i = heap->len++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (heap->data[parent].priority <= priority)
+            break;
+        heap->data[i] = heap->data[parent];
+        i = parent;
+    }
+    heap->data[i].priority = priority;
+    heap->data[i].value = value;
+    return (int64_t)heap->len;
+}
+
+int64_t heap_pop(void *h) {
+    mx_heap_t *heap = heap_of(h);
+    mx_heap_entry_t last;
+    int64_t top;
+    size_t i = 0, n;
+    if (!heap || heap->len == 0)
+        return 0;
+    top = heap->data[0].value;
+    last = heap->data[--heap->len];
+    n = heap->len;
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= n)
+            break;
+        if (child + 1 < n && heap->data[child + 1].priority < heap->data[child].priority)
+            ++child;
+        if (last.priority <= heap->data[child].priority)
+            break;
+        heap->data[i] = heap->data[child];
+        i = child;
+    }
+    if (n)
+        heap->data[i] = last;
+    return top;
+}
+
+int64_t heap_peek(void *h) {
+    mx_heap_t *heap = heap_of(h);
+    return (heap && heap->len) ? heap->data[0].value : 0;
+}
+
+int64_t heap_min(void *h) {
+    mx_heap_t *heap = heap_of(h);
+    return (heap && heap->len) ? heap->data[0].priority : 0;
+}
+
+int64_t heap_len(void *h) {
+    mx_heap_t *heap = heap_of(h);
+    return heap ? (int64_t)heap->len : 0;
+}
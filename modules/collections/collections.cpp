@@ -0,0 +1,410 @@
+/**
+ * @file collections.cpp
+ * @brief Collections module C++ runtime bindings for the MXVM interpreter
+ * @author Jared Bruni
+ */
+#include "mx_collections.h"
+#include <mxvm/icode.hpp>
+#include <string>
+
+static const char *kindName(int kind) {
+    switch (kind) {
+    case MX_COLL_SMAP:
+        return "smap";
+    case MX_COLL_IMAP:
+        return "imap";
+    case MX_COLL_PMAP:
+        return "pmap";
+    case MX_COLL_VEC:
+        return "vec";
+    case MX_COLL_HEAP:
+        return "heap";
+    default:
+        return "collection";
+    }
+}
+
+static void checkArgs(std::vector<mxvm::Operand> &operand, size_t count, const char *name, const char *usage) {
+    if (operand.size() != count)
+        throw mx::Exception(std::string(name) + " requires " + std::to_string(count) + " argument" + (count == 1 ? "" : "s") + " (" + usage + ").");
+}
+
+/** @brief The handle variable of a call, which must hold a live collection of @p kind */
+static mxvm::Variable &handleVar(mxvm::Program *program, const mxvm::Operand &op, int kind, const char *name) {
+    if (!program->isVariable(op.op))
+        throw mx::Exception(std::string(name) + " handle must be a pointer variable.");
+    mxvm::Variable &var = program->getVariable(op.op);
+    if (var.type != mxvm::VarType::VAR_POINTER)
+        throw mx::Exception(std::string(name) + " handle must be a pointer variable.");
+    mxvm::except_assert(std::string(name) + ": handle '" + op.op + "' is null", var.var_value.ptr_value != nullptr);
+    if (collection_kind(var.var_value.ptr_value) != kind)
+        throw mx::Exception(std::string(name) + ": '" + op.op + "' is not a " + kindName(kind));
+    return var;
+}
+
+static void *handleArg(mxvm::Program *program, const mxvm::Operand &op, int kind, const char *name) {
+    return handleVar(program, op, kind, name).var_value.ptr_value;
+}
+
+/** @brief A string key from a string or pointer variable */
+static const char *keyArg(mxvm::Program *program, const mxvm::Operand &op, const char *name) {
+    if (!program->isVariable(op.op))
+        throw mx::Exception(std::string(name) + " key must be a string or pointer variable, got: " + op.op);
+    mxvm::Variable &var = program->getVariable(op.op);
+    if (var.type == mxvm::VarType::VAR_STRING)
+        return var.var_value.str_value.c_str();
+    if (var.type == mxvm::VarType::VAR_POINTER) {
+        mxvm::except_assert(std::string(name) + ": key pointer '" + op.op + "' is null", var.var_value.ptr_value != nullptr);
+        return reinterpret_cast<const char *>(var.var_value.ptr_value);
+    }
+    throw mx::Exception(std::string(name) + " key '" + op.op + "' must be a string or pointer variable.");
+}
+
+/** @brief Integer argument from an integer variable or immediate */
+static int64_t intArg(mxvm::Program *program, const mxvm::Operand &op) {
+    if (!program->isVariable(op.op))
+        return op.op_value;
+    mxvm::Variable &var = program->getVariable(op.op);
+    if (var.type == mxvm::VarType::VAR_FLOAT)
+        return static_cast<int64_t>(var.var_value.float_value);
+    return var.var_value.int_value;
+}
+
+/** @brief Pointer argument stored in a pmap; null is allowed */
+static void *ptrArg(mxvm::Program *program, const mxvm::Operand &op, const char *name) {
+    if (!program->isVariable(op.op))
+        throw mx::Exception(std::string(name) + " value must be a pointer variable.");
+    mxvm::Variable &var = program->getVariable(op.op);
+    if (var.type != mxvm::VarType::VAR_POINTER)
+        throw mx::Exception(std::string(name) + " value must be a pointer variable.");
+    return var.var_value.ptr_value;
+}
+
+static void returnInt(mxvm::Program *program, int64_t value) {
+    program->vars["%rax"].type = mxvm::VarType::VAR_INTEGER;
+    program->vars["%rax"].var_value.type = mxvm::VarType::VAR_INTEGER;
+    program->vars["%rax"].var_value.int_value = value;
+}
+
+/** @brief Return a pointer the program does not own; @p count elements of @p size bytes when known */
+static void returnPtr(mxvm::Program *program, const void *value, uint64_t size = 0, uint64_t count = 0) {
+    program->vars["%rax"].type = mxvm::VarType::VAR_POINTER;
+    program->vars["%rax"].var_value.type = mxvm::VarType::VAR_POINTER;
+    program->vars["%rax"].var_value.ptr_value = const_cast<void *>(value);
+    program->vars["%rax"].var_value.owns = false;
+    program->vars["%rax"].var_value.ptr_size = size;
+    program->vars["%rax"].var_value.ptr_count = count;
+}
+
+static void returnHandle(mxvm::Program *program, void *handle, const char *name) {
+    if (handle == nullptr)
+        throw mx::Exception(std::string(name) + " failed to allocate");
+    returnPtr(program, handle);
+}
+
+/** @brief Free a handle and clear the variable so it cannot be used again */
+static void freeHandle(mxvm::Program *program, std::vector<mxvm::Operand> &operand, int kind, const char *name, void (*fn)(void *)) {
+    checkArgs(operand, 1, name, kindName(kind));
+    mxvm::Variable &var = handleVar(program, operand[0], kind, name);
+    fn(var.var_value.ptr_value);
+    var.var_value.ptr_value = nullptr;
+    var.var_value.owns = false;
+    var.var_value.ptr_size = 0;
+    var.var_value.ptr_count = 0;
+}
+
+/** @brief A slot from *_next that must still be occupied */
+static int64_t slotArg(mxvm::Program *program, const mxvm::Operand &op, void *m, int64_t (*next)(void *, int64_t), const char *name) {
+    int64_t slot = intArg(program, op);
+    if (slot < 0 || next(m, slot - 1) != slot)
+        throw mx::Exception(std::string(name) + ": slot " + std::to_string(slot) + " is empty");
+    return slot;
+}
+
+extern "C" void mxvm_collections_smap_new(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 0, "smap_new", "none");
+    returnHandle(program, smap_new(), "smap_new");
+}
+
+extern "C" void mxvm_collections_smap_free(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    freeHandle(program, operand, MX_COLL_SMAP, "smap_free", smap_free);
+}
+
+extern "C" void mxvm_collections_smap_put(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 3, "smap_put", "smap, key, value");
+    void *m = handleArg(program, operand[0], MX_COLL_SMAP, "smap_put");
+    returnInt(program, smap_put(m, keyArg(program, operand[1], "smap_put"), intArg(program, operand[2])));
+}
+
+extern "C" void mxvm_collections_smap_add(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 3, "smap_add", "smap, key, delta");
+    void *m = handleArg(program, operand[0], MX_COLL_SMAP, "smap_add");
+    returnInt(program, smap_add(m, keyArg(program, operand[1], "smap_add"), intArg(program, operand[2])));
+}
+
+extern "C" void mxvm_collections_smap_get(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 3, "smap_get", "smap, key, fallback");
+    void *m = handleArg(program, operand[0], MX_COLL_SMAP, "smap_get");
+    returnInt(program, smap_get(m, keyArg(program, operand[1], "smap_get"), intArg(program, operand[2])));
+}
+
+extern "C" void mxvm_collections_smap_has(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "smap_has", "smap, key");
+    void *m = handleArg(program, operand[0], MX_COLL_SMAP, "smap_has");
+    returnInt(program, smap_has(m, keyArg(program, operand[1], "smap_has")));
+}
+
+extern "C" void mxvm_collections_smap_del(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "smap_del", "smap, key");
+    void *m = handleArg(program, operand[0], MX_COLL_SMAP, "smap_del");
+    returnInt(program, smap_del(m, keyArg(program, operand[1], "smap_del")));
+}
+
+extern "C" void mxvm_collections_smap_count(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 1, "smap_count", "smap");
+    returnInt(program, smap_count(handleArg(program, operand[0], MX_COLL_SMAP, "smap_count")));
+}
+
+extern "C" void mxvm_collections_smap_next(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "smap_next", "smap, slot");
+    void *m = handleArg(program, operand[0], MX_COLL_SMAP, "smap_next");
+    returnInt(program, smap_next(m, intArg(program, operand[1])));
+}
+
+extern "C" void mxvm_collections_smap_key(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "smap_key", "smap, slot");
+    void *m = handleArg(program, operand[0], MX_COLL_SMAP, "smap_key");
+    returnPtr(program, smap_key(m, slotArg(program, operand[1], m, smap_next, "smap_key")));
+}
+
+extern "C" void mxvm_collections_smap_value(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "smap_value", "smap, slot");
+    void *m = handleArg(program, operand[0], MX_COLL_SMAP, "smap_value");
+    returnInt(program, smap_value(m, slotArg(program, operand[1], m, smap_next, "smap_value")));
+}
+
+extern "C" void mxvm_collections_imap_new(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 0, "imap_new", "none");
+    returnHandle(program, imap_new(), "imap_new");
+}
+
+extern "C" void mxvm_collections_imap_free(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    freeHandle(program, operand, MX_COLL_IMAP, "imap_free", imap_free);
+}
+
+extern "C" void mxvm_collections_imap_put(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 3, "imap_put", "imap, key, value");
+    void *m = handleArg(program, operand[0], MX_COLL_IMAP, "imap_put");
+    returnInt(program, imap_put(m, intArg(program, operand[1]), intArg(program, operand[2])));
+}
+
+extern "C" void mxvm_collections_imap_add(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 3, "imap_add", "imap, key, delta");
+    void *m = handleArg(program, operand[0], MX_COLL_IMAP, "imap_add");
+    returnInt(program, imap_add(m, intArg(program, operand[1]), intArg(program, operand[2])));
+}
+
+extern "C" void mxvm_collections_imap_get(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 3, "imap_get", "imap, key, fallback");
+    void *m = handleArg(program, operand[0], MX_COLL_IMAP, "imap_get");
+    returnInt(program, imap_get(m, intArg(program, operand[1]), intArg(program, operand[2])));
+}
+
+extern "C" void mxvm_collections_imap_has(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "imap_has", "imap, key");
+    void *m = handleArg(program, operand[0], MX_COLL_IMAP, "imap_has");
+    returnInt(program, imap_has(m, intArg(program, operand[1])));
+}
+
+extern "C" void mxvm_collections_imap_del(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "imap_del", "imap, key");
+    void *m = handleArg(program, operand[0], MX_COLL_IMAP, "imap_del");
+    returnInt(program, imap_del(m, intArg(program, operand[1])));
+}
+
+extern "C" void mxvm_collections_imap_count(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 1, "imap_count", "imap");
+    returnInt(program, imap_count(handleArg(program, operand[0], MX_COLL_IMAP, "imap_count")));
+}
+
+extern "C" void mxvm_collections_imap_next(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "imap_next", "imap, slot");
+    void *m = handleArg(program, operand[0], MX_COLL_IMAP, "imap_next");
+    returnInt(program, imap_next(m, intArg(program, operand[1])));
+}
+
+extern "C" void mxvm_collections_imap_key(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "imap_key", "imap, slot");
+    void *m = handleArg(program, operand[0], MX_COLL_IMAP, "imap_key");
+    returnInt(program, imap_key(m, slotArg(program, operand[1], m, imap_next, "imap_key")));
+}
+
+extern "C" void mxvm_collections_imap_value(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "imap_value", "imap, slot");
+    void *m = handleArg(program, operand[0], MX_COLL_IMAP, "imap_value");
+    returnInt(program, imap_value(m, slotArg(program, operand[1], m, imap_next, "imap_value")));
+}
+
+extern "C" void mxvm_collections_pmap_new(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 0, "pmap_new", "none");
+    returnHandle(program, pmap_new(), "pmap_new");
+}
+
+extern "C" void mxvm_collections_pmap_free(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    freeHandle(program, operand, MX_COLL_PMAP, "pmap_free", pmap_free);
+}
+
+extern "C" void mxvm_collections_pmap_put(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 3, "pmap_put", "pmap, key, pointer");
+    void *m = handleArg(program, operand[0], MX_COLL_PMAP, "pmap_put");
+    returnInt(program, pmap_put(m, keyArg(program, operand[1], "pmap_put"), ptrArg(program, operand[2], "pmap_put")));
+}
+
+extern "C" void mxvm_collections_pmap_get(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "pmap_get", "pmap, key");
+    void *m = handleArg(program, operand[0], MX_COLL_PMAP, "pmap_get");
+    returnPtr(program, pmap_get(m, keyArg(program, operand[1], "pmap_get")));
+}
+
+extern "C" void mxvm_collections_pmap_has(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "pmap_has", "pmap, key");
+    void *m = handleArg(program, operand[0], MX_COLL_PMAP, "pmap_has");
+    returnInt(program, pmap_has(m, keyArg(program, operand[1], "pmap_has")));
+}
+
+extern "C" void mxvm_collections_pmap_del(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "pmap_del", "pmap, key");
+    void *m = handleArg(program, operand[0], MX_COLL_PMAP, "pmap_del");
+    returnInt(program, pmap_del(m, keyArg(program, operand[1], "pmap_del")));
+}
+
+extern "C" void mxvm_collections_pmap_count(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 1, "pmap_count", "pmap");
+    returnInt(program, pmap_count(handleArg(program, operand[0], MX_COLL_PMAP, "pmap_count")));
+}
+
+extern "C" void mxvm_collections_pmap_next(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "pmap_next", "pmap, slot");
+    void *m = handleArg(program, operand[0], MX_COLL_PMAP, "pmap_next");
+    returnInt(program, pmap_next(m, intArg(program, operand[1])));
+}
+
+extern "C" void mxvm_collections_pmap_key(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "pmap_key", "pmap, slot");
+    void *m = handleArg(program, operand[0], MX_COLL_PMAP, "pmap_key");
+    returnPtr(program, pmap_key(m, slotArg(program, operand[1], m, pmap_next, "pmap_key")));
+}
+
+extern "C" void mxvm_collections_pmap_value(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "pmap_value", "pmap, slot");
+    void *m = handleArg(program, operand[0], MX_COLL_PMAP, "pmap_value");
+    returnPtr(program, pmap_value(m, slotArg(program, operand[1], m, pmap_next, "pmap_value")));
+}
+
+extern "C" void mxvm_collections_vec_new(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 0, "vec_new", "none");
+    returnHandle(program, vec_new(), "vec_new");
+}
+
+extern "C" void mxvm_collections_vec_free(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    freeHandle(program, operand, MX_COLL_VEC, "vec_free", vec_free);
+}
+
+extern "C" void mxvm_collections_vec_push(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "vec_push", "vec, value");
+    void *v = handleArg(program, operand[0], MX_COLL_VEC, "vec_push");
+    int64_t len = vec_len(v);
+    int64_t result = vec_push(v, intArg(program, operand[1]));
+    if (result == len)
+        throw mx::Exception("vec_push failed to grow the vector");
+    returnInt(program, result);
+}
+
+extern "C" void mxvm_collections_vec_pop(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 1, "vec_pop", "vec");
+    void *v = handleArg(program, operand[0], MX_COLL_VEC, "vec_pop");
+    if (vec_len(v) == 0)
+        throw mx::Exception("vec_pop: '" + operand[0].op + "' is empty");
+    returnInt(program, vec_pop(v));
+}
+
+/** @brief Index argument that must lie inside the vector */
+static int64_t indexArg(mxvm::Program *program, std::vector<mxvm::Operand> &operand, void *v, const char *name) {
+    int64_t index = intArg(program, operand[1]);
+    if (index < 0 || index >= vec_len(v))
+        throw mx::Exception(std::string(name) + ": index " + std::to_string(index) + " is outside '" + operand[0].op + "' (length " + std::to_string(vec_len(v)) + ")");
+    return index;
+}
+
+extern "C" void mxvm_collections_vec_get(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 2, "vec_get", "vec, index");
+    void *v = handleArg(program, operand[0], MX_COLL_VEC, "vec_get");
+    returnInt(program, vec_get(v, indexArg(program, operand, v, "vec_get")));
+}
+
+extern "C" void mxvm_collections_vec_set(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 3, "vec_set", "vec, index, value");
+    void *v = handleArg(program, operand[0], MX_COLL_VEC, "vec_set");
+    returnInt(program, vec_set(v, indexArg(program, operand, v, "vec_set"), intArg(program, operand[2])));
+}
+
+extern "C" void mxvm_collections_vec_len(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 1, "vec_len", "vec");
+    returnInt(program, vec_len(handleArg(program, operand[0], MX_COLL_VEC, "vec_len")));
+}
+
+extern "C" void mxvm_collections_vec_clear(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 1, "vec_clear", "vec");
+    vec_clear(handleArg(program, operand[0], MX_COLL_VEC, "vec_clear"));
+}
+
+extern "C" void mxvm_collections_vec_data(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 1, "vec_data", "vec");
+    void *v = handleArg(program, operand[0], MX_COLL_VEC, "vec_data");
+    returnPtr(program, vec_data(v), sizeof(int64_t), static_cast<uint64_t>(vec_len(v)));
+}
+
+extern "C" void mxvm_collections_heap_new(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 0, "heap_new", "none");
+    returnHandle(program, heap_new(), "heap_new");
+}
+
+extern "C" void mxvm_collections_heap_free(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    freeHandle(program, operand, MX_COLL_HEAP, "heap_free", heap_free);
+}
+
+extern "C" void mxvm_collections_heap_push(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 3, "heap_push", "heap, priority, value");
+    void *h = handleArg(program, operand[0], MX_COLL_HEAP, "heap_push");
+    int64_t len = heap_len(h);
+    int64_t result = heap_push(h, intArg(program, operand[1]), intArg(program, operand[2]));
+    if (result == len)
+        throw mx::Exception("heap_push failed to grow the heap");
+    returnInt(program, result);
+}
+
+/** @brief A heap that must have at least one entry */
+static void *nonEmptyHeap(mxvm::Program *program, std::vector<mxvm::Operand> &operand, const char *name) {
+    checkArgs(operand, 1, name, "heap");
+    void *h = handleArg(program, operand[0], MX_COLL_HEAP, name);
+    if (heap_len(h) == 0)
+        throw mx::Exception(std::string(name) + ": '" + operand[0].op + "' is empty");
+    return h;
+}
+
+extern "C" void mxvm_collections_heap_pop(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    returnInt(program, heap_pop(nonEmptyHeap(program, operand, "heap_pop")));
+}
+
+extern "C" void mxvm_collections_heap_peek(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    returnInt(program, heap_peek(nonEmptyHeap(program, operand, "heap_peek")));
+}
+
+extern "C" void mxvm_collections_heap_min(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    returnInt(program, heap_min(nonEmptyHeap(program, operand, "heap_min")));
+}
+
+extern "C" void mxvm_collections_heap_len(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    checkArgs(operand, 1, "heap_len", "heap");
+    returnInt(program, heap_len(handleArg(program, operand[0], MX_COLL_HEAP, "heap_len")));
+}
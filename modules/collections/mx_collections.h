@@ -0,0 +1,141 @@
+/**
+ * @file mx_collections.h
+ * @brief Collections module C API — hash maps, growable vectors and a binary heap exported to MXVM programs
+ * @author Jared Bruni
+ */
+#ifndef _MX_COLLECTIONS_H__
+#define _MX_COLLECTIONS_H__
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief What a collection handle refers to, as reported by collection_kind() */
+enum {
+    MX_COLL_NONE = 0, ///< null or not a collection
+    MX_COLL_SMAP = 1, ///< string -> int map
+    MX_COLL_IMAP = 2, ///< int -> int map
+    MX_COLL_PMAP = 3, ///< string -> pointer map
+    MX_COLL_VEC = 4,  ///< int vector
+    MX_COLL_HEAP = 5  ///< (priority, value) min-heap
+};
+
+/** @brief The MX_COLL_* kind of @p handle, MX_COLL_NONE for null or freed handles */
+int collection_kind(const void *handle);
+
+/*
+ * Hash maps use open addressing with linear probing and grow at 3/4 load.
+ * String keys are copied into the map.  Functions given a null handle or a
+ * handle of another kind do nothing and return 0 (or the fallback).
+ * Iterate with slot = *_next(m, -1) while slot >= 0, slot = *_next(m, slot);
+ * the order is unspecified and changes when the map grows.
+ */
+
+/** @brief Create an empty string -> int map */
+void *smap_new(void);
+/** @brief Free the map and its key copies */
+void smap_free(void *m);
+/** @brief Set key to value; returns 1 if the key was added, 0 if it was replaced */
+int64_t smap_put(void *m, const char *key, int64_t value);
+/** @brief Add delta to key's value (a missing key counts as 0); returns the new value */
+int64_t smap_add(void *m, const char *key, int64_t delta);
+/** @brief Value of key, or fallback when it is absent */
+int64_t smap_get(void *m, const char *key, int64_t fallback);
+/** @brief 1 if key is present, else 0 */
+int64_t smap_has(void *m, const char *key);
+/** @brief Remove key; returns 1 if it was present */
+int64_t smap_del(void *m, const char *key);
+/** @brief Number of keys */
+int64_t smap_count(void *m);
+/** @brief First occupied slot after @p slot, or -1 */
+int64_t smap_next(void *m, int64_t slot);
+/** @brief Key stored in an occupied slot (owned by the map) */
+const char *smap_key(void *m, int64_t slot);
+/** @brief Value stored in an occupied slot */
+int64_t smap_value(void *m, int64_t slot);
+
+/** @brief Create an empty int -> int map */
+void *imap_new(void);
+/** @brief Free the map */
+void imap_free(void *m);
+/** @brief Set key to value; returns 1 if the key was added, 0 if it was replaced */
+int64_t imap_put(void *m, int64_t key, int64_t value);
+/** @brief Add delta to key's value (a missing key counts as 0); returns the new value */
+int64_t imap_add(void *m, int64_t key, int64_t delta);
+/** @brief Value of key, or fallback when it is absent */
+int64_t imap_get(void *m, int64_t key, int64_t fallback);
+/** @brief 1 if key is present, else 0 */
+int64_t imap_has(void *m, int64_t key);
+/** @brief Remove key; returns 1 if it was present */
+int64_t imap_del(void *m, int64_t key);
+/** @brief Number of keys */
+int64_t imap_count(void *m);
+/** @brief First occupied slot after @p slot, or -1 */
+int64_t imap_next(void *m, int64_t slot);
+/** @brief Key stored in an occupied slot */
+int64_t imap_key(void *m, int64_t slot);
+/** @brief Value stored in an occupied slot */
+int64_t imap_value(void *m, int64_t slot);
+
+/** @brief Create an empty string -> pointer map; the pointers are not owned */
+void *pmap_new(void);
+/** @brief Free the map and its key copies (not the stored pointers) */
+void pmap_free(void *m);
+/** @brief Set key to value; returns 1 if the key was added, 0 if it was replaced */
+int64_t pmap_put(void *m, const char *key, void *value);
+/** @brief Pointer stored for key, or null when it is absent */
+void *pmap_get(void *m, const char *key);
+/** @brief 1 if key is present, else 0 */
+int64_t pmap_has(void *m, const char *key);
+/** @brief Remove key; returns 1 if it was present */
+int64_t pmap_del(void *m, const char *key);
+/** @brief Number of keys */
+int64_t pmap_count(void *m);
+/** @brief First occupied slot after @p slot, or -1 */
+int64_t pmap_next(void *m, int64_t slot);
+/** @brief Key stored in an occupied slot (owned by the map) */
+const char *pmap_key(void *m, int64_t slot);
+/** @brief Pointer stored in an occupied slot */
+void *pmap_value(void *m, int64_t slot);
+
+/** @brief Create an empty int vector */
+void *vec_new(void);
+/** @brief Free the vector */
+void vec_free(void *v);
+/** @brief Append x; returns the new length */
+int64_t vec_push(void *v, int64_t x);
+/** @brief Remove and return the last element, 0 when empty */
+int64_t vec_pop(void *v);
+/** @brief Element i, 0 when out of range */
+int64_t vec_get(void *v, int64_t i);
+/** @brief Set element i; returns 1, or 0 when out of range */
+int64_t vec_set(void *v, int64_t i, int64_t x);
+/** @brief Number of elements */
+int64_t vec_len(void *v);
+/** @brief Remove every element, keeping the storage */
+void vec_clear(void *v);
+/** @brief The elements as a contiguous array (valid until the next push) */
+int64_t *vec_data(void *v);
+
+/** @brief Create an empty min-heap of (priority, value) pairs */
+void *heap_new(void);
+/** @brief Free the heap */
+void heap_free(void *h);
+/** @brief Insert value with priority; returns the new size */
+int64_t heap_push(void *h, int64_t priority, int64_t value);
+/** @brief Remove the entry with the smallest priority and return its value, 0 when empty */
+int64_t heap_pop(void *h);
+/** @brief Value of the entry with the smallest priority, 0 when empty */
+int64_t heap_peek(void *h);
+/** @brief The smallest priority, 0 when empty */
+int64_t heap_min(void *h);
+/** @brief Number of entries */
+int64_t heap_len(void *h);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
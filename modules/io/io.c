@@ -3,11 +3,23 @@
  * @brief I/O module C implementation — file operations, random numbers, and time functions
  * @author Jared Bruni
  */
+#ifndef _WIN32
+#define _POSIX_C_SOURCE 200809L
+#endif
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 int64_t fsize(FILE *fptr) {
     fseek(fptr, 0, SEEK_END);
@@ -26,14 +38,412 @@ int64_t rand_number(int64_t size) {
     return rand() % size;
 }
 
+/* Returns a malloc'd line of any length without its newline, or "" at end of file */
 char *mxvm_fgets(FILE *fp) {
-    static char buf[4096];
-    char *res = fgets(buf, sizeof(buf), fp);
-    if (res) {
-        size_t len = strlen(buf);
-        if (len > 0 && buf[len - 1] == '\n')
-            buf[len - 1] = '\0';
-        return strdup(buf);
-    }
-    return strdup("");
+    char *line = NULL;
+    size_t len = 0;
+#ifndef _WIN32
+    size_t cap = 0;
+    ssize_t n = getline(&line, &cap, fp);
+    if (n < 0) {
+        free(line);
+        return strdup("");
+    }
+    len = (size_t)n;
+#else
+    size_t cap = 256;
+    line = (char *)malloc(cap);
+    if (line == NULL)
+        return strdup("");
+    line[0] = '\0';
+    while (fgets(line + len, (int)(cap - len), fp) != NULL) {
+        len += strlen(line + len);
+        if (line[len - 1] == '\n')
+            break;
+        if (cap - len < 2) {
+            char *grown = (char *)realloc(line, cap * 2);
+            if (grown == NULL)
+                break;
+            line = grown;
+            cap *= 2;
+        }
+    }
+    if (len == 0) {
+        free(line);
+        return strdup("");
+    }
+#endif
+    if (len > 0 && line[len - 1] == '\n')
+        line[len - 1] = '\0';
+    return line;
+}
+
+/* A read-only file mapping, handed to programs as an opaque pointer */
+typedef struct {
+    void *data;
+    int64_t size;
+} mxvm_mmap_t;
+
+void *mmap_open(const char *filename) {
+    mxvm_mmap_t *m = (mxvm_mmap_t *)calloc(1, sizeof(mxvm_mmap_t));
+    if (m == NULL)
+        return NULL;
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    LARGE_INTEGER size;
+    if (file == INVALID_HANDLE_VALUE || !GetFileSizeEx(file, &size)) {
+        if (file != INVALID_HANDLE_VALUE)
+            CloseHandle(file);
+        free(m);
+        return NULL;
+    }
+    m->size = (int64_t)size.QuadPart;
+    if (m->size > 0) {
+        HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL) {
+            m->data = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int fd = open(filename, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0)
+            close(fd);
+        free(m);
+        return NULL;
+    }
+    m->size = (int64_t)st.st_size;
+    if (m->size > 0) {
+        m->data = mmap(NULL, (size_t)m->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (m->data == MAP_FAILED)
+            m->data = NULL;
+    }
+    close(fd);
+#endif
+    if (m->size > 0 && m->data == NULL) {
+        free(m);
+        return NULL;
+    }
+    return m;
+}
+
+void *mmap_ptr(void *handle) {
+    return handle != NULL ? ((mxvm_mmap_t *)handle)->data : NULL;
+}
+
+int64_t mmap_size(void *handle) {
+    return handle != NULL ? ((mxvm_mmap_t *)handle)->size : 0;
+}
+
+/* advice: 0 normal, 1 sequential, 2 random, 3 will need, 4 don't need */
+int64_t mmap_advise(void *handle, int64_t advice) {
+    mxvm_mmap_t *m = (mxvm_mmap_t *)handle;
+    if (m == NULL || m->data == NULL)
+        return -1;
+#ifdef _WIN32
+    (void)advice;
+    return 0;
+#else
+    static const int flags[] = {POSIX_MADV_NORMAL, POSIX_MADV_SEQUENTIAL, POSIX_MADV_RANDOM, POSIX_MADV_WILLNEED, POSIX_MADV_DONTNEED};
+    if (advice < 0 || advice > 4)
+        return -1;
+    return posix_madvise(m->data, (size_t)m->size, flags[advice]) == 0 ? 0 : -1;
+#endif
+}
+
+int64_t mmap_close(void *handle) {
+    mxvm_mmap_t *m = (mxvm_mmap_t *)handle;
+    if (m == NULL)
+        return -1;
+    if (m->data != NULL) {
+#ifdef _WIN32
+        UnmapViewOfFile(m->data);
+#else
+        munmap(m->data, (size_t)m->size);
+#endif
+    }
+    free(m);
+    return 0;
+}
+
+/*
+ * Asynchronous reads and writes.
+ *
+ * Requests are queued to a small pool of worker threads, started on the
+ * first request, which use pread/pwrite on the stream's descriptor so the
+ * FILE position is left alone. async_write flushes the stream when it is
+ * queued so earlier buffered writes land first. On Windows requests run
+ * synchronously when they are queued, seeking to the offset and restoring
+ * the FILE position afterwards.
+ *
+ * A queue owns its workers and every request it handed out that has not
+ * been released by async_wait. async_queue_destroy stops and joins the
+ * workers, drops requests that have not started and frees the rest, so
+ * nothing of the queue outlives it or the library. The interpreter
+ * bindings (io.cpp) give every VM a queue of its own. The async_* functions
+ * called by compiled programs use one queue per process, destroyed when
+ * the library is unloaded or the program exits.
+ *
+ * The exported names avoid aio_*: libc already defines POSIX aio_read and
+ * aio_write, and a native program linking this library would otherwise
+ * replace them for every caller in the process.
+ */
+#define MXVM_AIO_THREADS 4
+
+typedef struct mxvm_aio_queue_s mxvm_aio_queue_t;
+
+typedef struct mxvm_aio_s {
+    struct mxvm_aio_s *next;      /* next request waiting to run */
+    struct mxvm_aio_s *live_prev; /* neighbours among the queue's unreleased requests */
+    struct mxvm_aio_s *live_next;
+    mxvm_aio_queue_t *queue;
+    FILE *fp;
+    void *buf;
+    int64_t size;
+    int64_t offset;
+    int write;
+    int done;
+    int64_t result;
+} mxvm_aio_t;
+
+struct mxvm_aio_queue_s {
+#ifdef _WIN32
+    SRWLOCK lock;
+#else
+    pthread_mutex_t lock;
+    pthread_cond_t queued;
+    pthread_cond_t finished;
+    pthread_t workers[MXVM_AIO_THREADS];
+    int worker_count;
+    int stopping;
+#endif
+    mxvm_aio_t *head; /* requests waiting to run, oldest first */
+    mxvm_aio_t *tail;
+    mxvm_aio_t *live; /* every request not yet released by async_wait */
+};
+
+#ifdef _WIN32
+#define AIO_LOCK(q) AcquireSRWLockExclusive(&(q)->lock)
+#define AIO_UNLOCK(q) ReleaseSRWLockExclusive(&(q)->lock)
+static mxvm_aio_queue_t process_queue = {SRWLOCK_INIT, NULL, NULL, NULL};
+#else
+#define AIO_LOCK(q) pthread_mutex_lock(&(q)->lock)
+#define AIO_UNLOCK(q) pthread_mutex_unlock(&(q)->lock)
+static mxvm_aio_queue_t process_queue = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, {0}, 0, 0, NULL, NULL, NULL};
+#endif
+
+static void aio_run(mxvm_aio_t *r) {
+#ifdef _WIN32
+    /* No pread/pwrite: seek to the 64-bit offset and put the position back afterwards */
+    __int64 saved = _ftelli64(r->fp);
+    if (saved < 0 || _fseeki64(r->fp, (__int64)r->offset, SEEK_SET) != 0) {
+        r->result = -1;
+        return;
+    }
+    r->result = (int64_t)(r->write ? fwrite(r->buf, 1, (size_t)r->size, r->fp) : fread(r->buf, 1, (size_t)r->size, r->fp));
+    if (_fseeki64(r->fp, saved, SEEK_SET) != 0)
+        r->result = -1;
+#else
+    int fd = fileno(r->fp);
+    int64_t total = 0;
+    while (total < r->size) {
+        char *at = (char *)r->buf + total;
+        size_t left = (size_t)(r->size - total);
+        off_t where = (off_t)(r->offset + total);
+        ssize_t n = r->write ? pwrite(fd, at, left, where) : pread(fd, at, left, where);
+        if (n < 0) {
+            r->result = -1;
+            return;
+        }
+        if (n == 0)
+            break;
+        total += n;
+    }
+    r->result = total;
+#endif
+}
+
+/* Unlink a request from its queue's live list; the queue lock must be held */
+static void aio_unlink(mxvm_aio_t *r) {
+    if (r->live_prev != NULL)
+        r->live_prev->live_next = r->live_next;
+    else
+        r->queue->live = r->live_next;
+    if (r->live_next != NULL)
+        r->live_next->live_prev = r->live_prev;
+}
+
+#ifndef _WIN32
+static void *aio_worker(void *arg) {
+    mxvm_aio_queue_t *q = (mxvm_aio_queue_t *)arg;
+    for (;;) {
+        pthread_mutex_lock(&q->lock);
+        while (q->head == NULL && !q->stopping)
+            pthread_cond_wait(&q->queued, &q->lock);
+        if (q->stopping) {
+            pthread_mutex_unlock(&q->lock);
+            return NULL;
+        }
+        mxvm_aio_t *r = q->head;
+        q->head = r->next;
+        if (q->head == NULL)
+            q->tail = NULL;
+        pthread_mutex_unlock(&q->lock);
+
+        aio_run(r);
+
+        pthread_mutex_lock(&q->lock);
+        r->done = 1;
+        pthread_cond_broadcast(&q->finished);
+        pthread_mutex_unlock(&q->lock);
+    }
+}
+#endif
+
+static void aio_shutdown(mxvm_aio_queue_t *q) {
+#ifndef _WIN32
+    pthread_mutex_lock(&q->lock);
+    q->stopping = 1;
+    q->head = q->tail = NULL;
+    pthread_cond_broadcast(&q->queued);
+    pthread_mutex_unlock(&q->lock);
+    /* A worker finishes the request it is running before it sees stopping */
+    for (int i = 0; i < q->worker_count; ++i)
+        pthread_join(q->workers[i], NULL);
+    q->worker_count = 0;
+#endif
+    AIO_LOCK(q);
+    while (q->live != NULL) {
+        mxvm_aio_t *r = q->live;
+        q->live = r->live_next;
+        free(r);
+    }
+    AIO_UNLOCK(q);
+}
+
+/* Create an empty request queue; its workers start with the first request */
+void *async_queue_create(void) {
+    mxvm_aio_queue_t *q = (mxvm_aio_queue_t *)calloc(1, sizeof(mxvm_aio_queue_t));
+    if (q == NULL)
+        return NULL;
+#ifdef _WIN32
+    InitializeSRWLock(&q->lock);
+#else
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->queued, NULL);
+    pthread_cond_init(&q->finished, NULL);
+#endif
+    return q;
+}
+
+/* Stop and join the queue's workers, free its outstanding requests and the queue */
+void async_queue_destroy(void *queue) {
+    mxvm_aio_queue_t *q = (mxvm_aio_queue_t *)queue;
+    if (q == NULL)
+        return;
+    aio_shutdown(q);
+#ifndef _WIN32
+    pthread_cond_destroy(&q->finished);
+    pthread_cond_destroy(&q->queued);
+    pthread_mutex_destroy(&q->lock);
+#endif
+    free(q);
+}
+
+/* Queue a read (write = 0) or write of size bytes at offset; returns a request handle or NULL */
+void *async_queue_submit(void *queue, FILE *fp, void *buf, int64_t size, int64_t offset, int write) {
+    mxvm_aio_queue_t *q = (mxvm_aio_queue_t *)queue;
+    if (q == NULL || fp == NULL || buf == NULL || size < 0 || offset < 0)
+        return NULL;
+    mxvm_aio_t *r = (mxvm_aio_t *)calloc(1, sizeof(mxvm_aio_t));
+    if (r == NULL)
+        return NULL;
+    r->queue = q;
+    r->fp = fp;
+    r->buf = buf;
+    r->size = size;
+    r->offset = offset;
+    r->write = write;
+    if (write)
+        fflush(fp);
+#ifdef _WIN32
+    aio_run(r);
+    r->done = 1;
+    AIO_LOCK(q);
+#else
+    pthread_mutex_lock(&q->lock);
+    if (q->stopping) {
+        pthread_mutex_unlock(&q->lock);
+        free(r);
+        return NULL;
+    }
+    while (q->worker_count < MXVM_AIO_THREADS && pthread_create(&q->workers[q->worker_count], NULL, aio_worker, q) == 0)
+        ++q->worker_count;
+    if (q->worker_count == 0) {
+        pthread_mutex_unlock(&q->lock);
+        free(r);
+        return NULL;
+    }
+    if (q->tail != NULL)
+        q->tail->next = r;
+    else
+        q->head = r;
+    q->tail = r;
+    pthread_cond_signal(&q->queued);
+#endif
+    r->live_next = q->live;
+    if (q->live != NULL)
+        q->live->live_prev = r;
+    q->live = r;
+    AIO_UNLOCK(q);
+    return r;
+}
+
+#if !defined(_WIN32) && (defined(__GNUC__) || defined(__clang__))
+/* Join the process queue's workers before the library is unmapped (dlclose) or the process exits */
+__attribute__((destructor)) static void aio_fini(void) {
+    aio_shutdown(&process_queue);
+}
+#endif
+
+/* Queue a read of size bytes at offset into buf; returns a request handle or NULL */
+void *async_read(void *buf, int64_t size, int64_t offset, FILE *fp) {
+    return async_queue_submit(&process_queue, fp, buf, size, offset, 0);
+}
+
+/* Queue a write of size bytes from buf at offset; returns a request handle or NULL */
+void *async_write(void *buf, int64_t size, int64_t offset, FILE *fp) {
+    return async_queue_submit(&process_queue, fp, buf, size, offset, 1);
+}
+
+/* 1 if the request has finished, 0 while it is still running */
+int64_t async_poll(void *request) {
+    mxvm_aio_t *r = (mxvm_aio_t *)request;
+    if (r == NULL)
+        return 1;
+    AIO_LOCK(r->queue);
+    int done = r->done;
+    AIO_UNLOCK(r->queue);
+    return done;
+}
+
+/* Wait for the request, release it and return the bytes transferred (-1 on error) */
+int64_t async_wait(void *request) {
+    mxvm_aio_t *r = (mxvm_aio_t *)request;
+    if (r == NULL)
+        return -1;
+    mxvm_aio_queue_t *q = r->queue;
+    AIO_LOCK(q);
+#ifndef _WIN32
+    while (!r->done)
+        pthread_cond_wait(&q->finished, &q->lock);
+#endif
+    aio_unlink(r);
+    AIO_UNLOCK(q);
+    int64_t result = r->result;
+    free(r);
+    return result;
 }
@@ -12,6 +12,20 @@
 #include <string>
 #include <vector>
 
+// Shared with compiled programs, see io.c
+extern "C" {
+void *mmap_open(const char *filename);
+void *mmap_ptr(void *handle);
+int64_t mmap_size(void *handle);
+int64_t mmap_advise(void *handle, int64_t advice);
+int64_t mmap_close(void *handle);
+void *async_queue_create(void);
+void async_queue_destroy(void *queue);
+void *async_queue_submit(void *queue, FILE *fp, void *buf, int64_t size, int64_t offset, int write);
+int64_t async_poll(void *request);
+int64_t async_wait(void *request);
+}
+
 extern "C" void mxvm_io_fopen(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
     if (operand.size() == 2) {
         std::string &filename = operand[0].op;
@@ -54,7 +68,7 @@ extern "C" void mxvm_io_fprintf(mxvm::Program *program, std::vector<mxvm::Operan
                 v.push_back(&varval);
             } else {
                 if (operand[i].type == mxvm::OperandType::OP_CONSTANT) {
-                    mxvm::Variable val = program->createTempVariable(mxvm::VarType::VAR_INTEGER, operand[i].op);
+                    mxvm::Variable val = program->createTempVariable(mxvm::VarType::VAR_INTEGER, operand[i]);
                     v.push_back(&val);
                 }
             }
@@ -289,21 +303,11 @@ extern "C" void mxvm_io_mxvm_fgets(mxvm::Program *program, std::vector<mxvm::Ope
         throw mx::Exception("fgets argument must be a pointer variable.");
     }
     FILE *fp = reinterpret_cast<FILE *>(file_v.var_value.ptr_value);
-    char buf[4096];
-    char *res = fgets(buf, sizeof(buf), fp);
-    if (res) {
-        size_t len = strlen(buf);
-        if (len > 0 && buf[len - 1] == '\n')
-            buf[len - 1] = '\0';
-        char *str = strdup(buf);
-        program->vars["%rax"].type = mxvm::VarType::VAR_STRING;
-        program->vars["%rax"].var_value.type = mxvm::VarType::VAR_STRING;
-        program->vars["%rax"].var_value.str_value = str;
-    } else {
-        program->vars["%rax"].type = mxvm::VarType::VAR_STRING;
-        program->vars["%rax"].var_value.type = mxvm::VarType::VAR_STRING;
-        program->vars["%rax"].var_value.str_value = strdup("");
-    }
+    static thread_local mxvm::LineReader reader;
+    mxvm::Variable &rax = program->vars["%rax"];
+    rax.type = mxvm::VarType::VAR_STRING;
+    rax.var_value.type = mxvm::VarType::VAR_STRING;
+    reader.read(fp, rax.var_value.str_value.mutate());
 }
 
 extern "C" void mxvm_io_fputs(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
@@ -334,4 +338,154 @@ extern "C" void mxvm_io_fputs(mxvm::Program *program, std::vector<mxvm::Operand>
     program->vars["%rax"].type = mxvm::VarType::VAR_INTEGER;
     program->vars["%rax"].var_value.type = mxvm::VarType::VAR_INTEGER;
     program->vars["%rax"].var_value.int_value = result;
-}
\ No newline at end of file
+}
+
+/** @brief The mapping or request handle passed as @p op, which must be a pointer variable */
+static void *handle_arg(mxvm::Program *program, const mxvm::Operand &op, const std::string &fn) {
+    if (!program->isVariable(op.op)) {
+        throw mx::Exception(fn + " argument must be a variable (handle).");
+    }
+    mxvm::Variable &v = program->getVariable(op.op);
+    if (v.type != mxvm::VarType::VAR_POINTER) {
+        throw mx::Exception(fn + " argument must be a pointer variable.");
+    }
+    return v.var_value.ptr_value;
+}
+
+static void set_rax_integer(mxvm::Program *program, int64_t value) {
+    mxvm::Variable &rax = program->vars["%rax"];
+    rax.type = mxvm::VarType::VAR_INTEGER;
+    rax.var_value.type = mxvm::VarType::VAR_INTEGER;
+    rax.var_value.int_value = value;
+}
+
+extern "C" void mxvm_io_mmap_open(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 1) {
+        throw mx::Exception("mmap_open requires one filename argument.");
+    }
+    if (!program->isVariable(operand[0].op)) {
+        throw mx::Exception("Variable required for mmap_open.");
+    }
+    mxvm::Variable &name = program->getVariable(operand[0].op);
+    if (name.type != mxvm::VarType::VAR_STRING) {
+        throw mx::Exception("Requires string variable type for mmap_open.");
+    }
+    mxvm::Variable &rax = program->vars["%rax"];
+    rax.type = mxvm::VarType::VAR_POINTER;
+    rax.var_value.type = mxvm::VarType::VAR_POINTER;
+    rax.var_value.ptr_value = mmap_open(name.var_value.str_value.c_str());
+    rax.var_value.ptr_size = 0;
+    rax.var_value.ptr_count = 0;
+    rax.var_value.owns = false;
+}
+
+extern "C" void mxvm_io_mmap_ptr(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 1) {
+        throw mx::Exception("mmap_ptr requires one mapping handle argument.");
+    }
+    void *handle = handle_arg(program, operand[0], "mmap_ptr");
+    mxvm::Variable &rax = program->vars["%rax"];
+    rax.type = mxvm::VarType::VAR_POINTER;
+    rax.var_value.type = mxvm::VarType::VAR_POINTER;
+    rax.var_value.ptr_value = mmap_ptr(handle);
+    // Byte elements, so LOAD bounds checks cover exactly the mapped file
+    rax.var_value.ptr_size = 1;
+    rax.var_value.ptr_count = static_cast<uint64_t>(mmap_size(handle));
+    // munmap'd by mmap_close, never free()d
+    rax.var_value.owns = false;
+}
+
+extern "C" void mxvm_io_mmap_size(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 1) {
+        throw mx::Exception("mmap_size requires one mapping handle argument.");
+    }
+    set_rax_integer(program, mmap_size(handle_arg(program, operand[0], "mmap_size")));
+}
+
+extern "C" void mxvm_io_mmap_advise(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 2) {
+        throw mx::Exception("mmap_advise requires two arguments (handle, advice).");
+    }
+    void *handle = handle_arg(program, operand[0], "mmap_advise");
+    mxvm::Variable advice = program->variableFromOperand(operand[1]);
+    if (advice.type != mxvm::VarType::VAR_INTEGER) {
+        throw mx::Exception("mmap_advise advice must be an integer.");
+    }
+    set_rax_integer(program, mmap_advise(handle, advice.var_value.int_value));
+}
+
+extern "C" void mxvm_io_mmap_close(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 1) {
+        throw mx::Exception("mmap_close requires one mapping handle argument.");
+    }
+    set_rax_integer(program, mmap_close(handle_arg(program, operand[0], "mmap_close")));
+}
+
+/** @brief Async I/O queue of one VM, so programs in the same process never share workers or requests */
+struct AsyncQueue {
+    void *queue = async_queue_create();
+    AsyncQueue() = default;
+    AsyncQueue(const AsyncQueue &) = delete;
+    AsyncQueue &operator=(const AsyncQueue &) = delete;
+    ~AsyncQueue() { async_queue_destroy(queue); }
+};
+
+/** @brief Shared argument handling of async_read/async_write: (buffer, size, offset, file) */
+static void async_submit(mxvm::Program *program, std::vector<mxvm::Operand> &operand, const std::string &fn, bool write) {
+    if (operand.size() != 4) {
+        throw mx::Exception(fn + " requires four arguments (buffer, size, offset, file).");
+    }
+    if (!program->isVariable(operand[0].op)) {
+        throw mx::Exception(fn + " buffer must be a variable pointer.");
+    }
+    mxvm::Variable &buf_v = program->getVariable(operand[0].op);
+    if (buf_v.type != mxvm::VarType::VAR_POINTER) {
+        throw mx::Exception(fn + " buffer must be a pointer variable.");
+    }
+    mxvm::Variable vsize = program->variableFromOperand(operand[1]);
+    mxvm::Variable voffset = program->variableFromOperand(operand[2]);
+    mxvm::Variable file_ptr = program->variableFromOperand(operand[3]);
+    if (vsize.type != mxvm::VarType::VAR_INTEGER || voffset.type != mxvm::VarType::VAR_INTEGER) {
+        throw mx::Exception("Argument type mismatch expected integer for " + fn);
+    }
+    if (file_ptr.type != mxvm::VarType::VAR_POINTER && file_ptr.type != mxvm::VarType::VAR_EXTERN) {
+        throw mx::Exception("Final argument for " + fn + " requires pointer");
+    }
+    // The worker writes into the buffer later, so an overrun would not be caught by anything else
+    uint64_t capacity = buf_v.var_value.ptr_size * buf_v.var_value.ptr_count;
+    if (capacity != 0 && static_cast<uint64_t>(vsize.var_value.int_value) > capacity) {
+        throw mx::Exception(fn + ": size " + std::to_string(vsize.var_value.int_value) + " exceeds buffer of " + std::to_string(capacity) + " bytes");
+    }
+    FILE *fptr = reinterpret_cast<FILE *>(file_ptr.var_value.ptr_value);
+    void *queue = program->context->moduleState<AsyncQueue>("io").queue;
+    void *request = async_queue_submit(queue, fptr, buf_v.var_value.ptr_value, vsize.var_value.int_value, voffset.var_value.int_value, write ? 1 : 0);
+    mxvm::Variable &rax = program->vars["%rax"];
+    rax.type = mxvm::VarType::VAR_POINTER;
+    rax.var_value.type = mxvm::VarType::VAR_POINTER;
+    rax.var_value.ptr_value = request;
+    rax.var_value.ptr_size = 0;
+    rax.var_value.ptr_count = 0;
+    rax.var_value.owns = false;
+}
+
+extern "C" void mxvm_io_async_read(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    async_submit(program, operand, "async_read", false);
+}
+
+extern "C" void mxvm_io_async_write(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    async_submit(program, operand, "async_write", true);
+}
+
+extern "C" void mxvm_io_async_poll(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 1) {
+        throw mx::Exception("async_poll requires one request handle argument.");
+    }
+    set_rax_integer(program, async_poll(handle_arg(program, operand[0], "async_poll")));
+}
+
+extern "C" void mxvm_io_async_wait(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 1) {
+        throw mx::Exception("async_wait requires one request handle argument.");
+    }
+    set_rax_integer(program, async_wait(handle_arg(program, operand[0], "async_wait")));
+}
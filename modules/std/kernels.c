@@ -0,0 +1,303 @@
+/**
+ * @file kernels.c
+ * @brief Standard library module typed array kernels — fill, reduce, copy and sort over 8-byte elements
+ * @author Jared Bruni
+ */
+#include "mx_std.h"
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MXVM_KERNEL_SSE2 1
+#include <emmintrin.h>
+#endif
+
+/* Partitions at or below this size are finished with insertion sort */
+#define SORT_SMALL 16
+
+void fill_i64(int64_t *p, int64_t start, int64_t count, int64_t value) {
+    int64_t i;
+    if (!p || count <= 0)
+        return;
+    p += start;
+    if (value == 0) {
+        memset(p, 0, (size_t)count * sizeof(int64_t));
+        return;
+    }
+    for (i = 0; i < count; ++i)
+        p[i] = value;
+}
+
+void fill_f64(double *p, int64_t start, int64_t count, double value) {
+    int64_t i;
+    if (!p || count <= 0)
+        return;
+    p += start;
+    for (i = 0; i < count; ++i)
+        p[i] = value;
+}
+
+int64_t sum_i64(const int64_t *p, int64_t start, int64_t count) {
+    int64_t i = 0;
+    uint64_t total = 0;
+    if (!p || count <= 0)
+        return 0;
+    p += start;
+#ifdef MXVM_KERNEL_SSE2
+    {
+        __m128i a = _mm_setzero_si128(), b = _mm_setzero_si128();
+        int64_t lanes[2];
+        for (; i + 4 <= count; i += 4) {
+            a = _mm_add_epi64(a, _mm_loadu_si128((const __m128i *)(p + i)));
+            b = _mm_add_epi64(b, _mm_loadu_si128((const __m128i *)(p + i + 2)));
+        }
+        _mm_storeu_si128((__m128i *)lanes, _mm_add_epi64(a, b));
+        total = (uint64_t)lanes[0] + (uint64_t)lanes[1];
+    }
+#endif
+    for (; i < count; ++i)
+        total += (uint64_t)p[i];
+    return (int64_t)total;
+}
+
+double sum_f64(const double *p, int64_t start, int64_t count) {
+    int64_t i = 0;
+    double total = 0.0;
+    if (!p || count <= 0)
+        return 0.0;
+    p += start;
+#ifdef MXVM_KERNEL_SSE2
+    {
+        __m128d a = _mm_setzero_pd(), b = _mm_setzero_pd();
+        double lanes[2];
+        for (; i + 4 <= count; i += 4) {
+            a = _mm_add_pd(a, _mm_loadu_pd(p + i));
+            b = _mm_add_pd(b, _mm_loadu_pd(p + i + 2));
+        }
+        _mm_storeu_pd(lanes, _mm_add_pd(a, b));
+        total = lanes[0] + lanes[1];
+    }
+#endif
+    for (; i < count; ++i)
+        total += p[i];
+    return total;
+}
+
+int64_t min_i64(const int64_t *p, int64_t start, int64_t count) {
+    int64_t i, m;
+    if (!p || count <= 0)
+        return 0;
+    p += start;
+    m = p[0];
+    for (i = 1; i < count; ++i)
+        m = p[i] < m ? p[i] : m;
+    return m;
+}
+
+int64_t max_i64(const int64_t *p, int64_t start, int64_t count) {
+    int64_t i, m;
+    if (!p || count <= 0)
+        return 0;
+    p += start;
+    m = p[0];
+    for (i = 1; i < count; ++i)
+        m = p[i] > m ? p[i] : m;
+    return m;
+}
+
+/* min/max of doubles: _mm_min_pd(x, m) is exactly x < m ? x : m, so both paths agree */
+double min_f64(const double *p, int64_t start, int64_t count) {
+    int64_t i = 0;
+    double m;
+    if (!p || count <= 0)
+        return 0.0;
+    p += start;
+    m = p[0];
+#ifdef MXVM_KERNEL_SSE2
+    if (count >= 4) {
+        __m128d acc = _mm_set1_pd(m);
+        double lanes[2];
+        for (; i + 2 <= count; i += 2)
+            acc = _mm_min_pd(_mm_loadu_pd(p + i), acc);
+        _mm_storeu_pd(lanes, acc);
+        m = lanes[1] < lanes[0] ? lanes[1] : lanes[0];
+    }
+#endif
+    for (; i < count; ++i)
+        m = p[i] < m ? p[i] : m;
+    return m;
+}
+
+double max_f64(const double *p, int64_t start, int64_t count) {
+    int64_t i = 0;
+    double m;
+    if (!p || count <= 0)
+        return 0.0;
+    p += start;
+    m = p[0];
+#ifdef MXVM_KERNEL_SSE2
+    if (count >= 4) {
+        __m128d acc = _mm_set1_pd(m);
+        double lanes[2];
+        for (; i + 2 <= count; i += 2)
+            acc = _mm_max_pd(_mm_loadu_pd(p + i), acc);
+        _mm_storeu_pd(lanes, acc);
+        m = lanes[1] > lanes[0] ? lanes[1] : lanes[0];
+    }
+#endif
+    for (; i < count; ++i)
+        m = p[i] > m ? p[i] : m;
+    return m;
+}
+
+double dot_f64(const double *a, int64_t a_start, const double *b, int64_t b_start, int64_t count) {
+    int64_t i = 0;
+    double total = 0.0;
+    if (!a || !b || count <= 0)
+        return 0.0;
+    a += a_start;
+    b += b_start;
+#ifdef MXVM_KERNEL_SSE2
+    {
+        __m128d x = _mm_setzero_pd(), y = _mm_setzero_pd();
+        double lanes[2];
+        for (; i + 4 <= count; i += 4) {
+            x = _mm_add_pd(x, _mm_mul_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(b + i)));
+            y = _mm_add_pd(y, _mm_mul_pd(_mm_loadu_pd(a + i + 2), _mm_loadu_pd(b + i + 2)));
+        }
+        _mm_storeu_pd(lanes, _mm_add_pd(x, y));
+        total = lanes[0] + lanes[1];
+    }
+#endif
+    for (; i < count; ++i)
+        total += a[i] * b[i];
+    return total;
+}
+
+void copy_strided(int64_t *dest, int64_t dest_start, int64_t dest_stride,
+                  const int64_t *src, int64_t src_start, int64_t src_stride, int64_t count) {
+    int64_t i;
+    if (!dest || !src || count <= 0)
+        return;
+    dest += dest_start;
+    src += src_start;
+    if (dest_stride == 1 && src_stride == 1) {
+        memmove(dest, src, (size_t)count * sizeof(int64_t));
+        return;
+    }
+    for (i = 0; i < count; ++i)
+        dest[i * dest_stride] = src[i * src_stride];
+}
+
+/*
+ * Introsort: median-of-three quicksort that recurses into the smaller side,
+ * falls back to heapsort past a depth limit and finishes small partitions
+ * with insertion sort.  Instantiated once per element type.
+ */
+#define DEFINE_SORT(NAME, T)                                                  \
+    static void NAME##_insertion(T *p, int64_t n) {                           \
+        int64_t i, j;                                                         \
+        for (i = 1; i < n; ++i) {                                             \
+            T v = p[i];                                                       \
+            for (j = i; j > 0 && v < p[j - 1]; --j)                           \
+                p[j] = p[j - 1];                                              \
+            p[j] = v;                                                         \
+        }                                                                     \
+    }                                                                         \
+    static void NAME##_sift(T *p, int64_t root, int64_t n) {                  \
+        T v = p[root];                                                        \
+        int64_t child;                                                        \
+        while ((child = 2 * root + 1) < n) {                                  \
+            if (child + 1 < n && p[child] < p[child + 1])                     \
+                ++child;                                                      \
+            if (!(v < p[child]))                                              \
+                break;                                                        \
+            p[root] = p[child];                                               \
+            root = child;                                                     \
+        }                                                                     \
+        p[root] = v;                                                          \
+    }                                                                         \
+    static void NAME##_heap(T *p, int64_t n) {                                \
+        int64_t i;                                                            \
+        for (i = n / 2; i-- > 0;)                                             \
+            NAME##_sift(p, i, n);                                             \
+        for (i = n - 1; i > 0; --i) {                                         \
+            T t = p[0];                                                       \
+            p[0] = p[i];                                                      \
+            p[i] = t;                                                         \
+            NAME##_sift(p, 0, i);                                             \
+        }                                                                     \
+    }                                                                         \
+    static void NAME##_intro(T *p, int64_t n, int depth) {                    \
+        while (n > SORT_SMALL) {                                              \
+            int64_t i = 0, j = n - 1, mid = n / 2;                            \
+            T pivot, t;                                                       \
+            if (depth-- == 0) {                                               \
+                NAME##_heap(p, n);                                            \
+                return;                                                       \
+            }                                                                 \
+            if (p[mid] < p[0]) {                                              \
+                t = p[mid]; p[mid] = p[0]; p[0] = t;                          \
+            }                                                                 \
+            if (p[n - 1] < p[0]) {                                            \
+                t = p[n - 1]; p[n - 1] = p[0]; p[0] = t;                      \
+            }                                                                 \
+            if (p[n - 1] < p[mid]) {                                          \
+                t = p[n - 1]; p[n - 1] = p[mid]; p[mid] = t;                  \
+            }                                                                 \
+            pivot = p[mid];                                                   \
+            for (;;) {                                                        \
+                while (p[i] < pivot)                                          \
+                    ++i;                                                      \
+                while (pivot < p[j])                                          \
+                    --j;                                                      \
+                if (i >= j)                                                   \
+                    break;                                                    \
+                t = p[i]; p[i] = p[j]; p[j] = t;                              \
+                ++i;                                                          \
+                --j;                                                          \
+            }                                                                 \
+            /* [0, j] <= pivot <= [j + 1, n) */                               \
+            if (j + 1 < n - j - 1) {                                          \
+                NAME##_intro(p, j + 1, depth);                                \
+                p += j + 1;                                                   \
+                n -= j + 1;                                                   \
+            } else {                                                          \
+                NAME##_intro(p + j + 1, n - j - 1, depth);                    \
+                n = j + 1;                                                    \
+            }                                                                 \
+        }                                                                     \
+        NAME##_insertion(p, n);                                               \
+    }                                                                         \
+    static void NAME##_sort(T *p, int64_t n) {                                \
+        int depth = 0;                                                        \
+        int64_t m;                                                            \
+        for (m = n; m > 1; m >>= 1)                                           \
+            depth += 2;                                                       \
+        NAME##_intro(p, n, depth);                                            \
+    }
+
+DEFINE_SORT(i64, int64_t)
+DEFINE_SORT(f64, double)
+
+void sort_i64(int64_t *p, int64_t start, int64_t count) {
+    if (!p || count <= 1)
+        return;
+    i64_sort(p + start, count);
+}
+
+void sort_f64(double *p, int64_t start, int64_t count) {
+    int64_t i, n = 0;
+    if (!p || count <= 1)
+        return;
+    p += start;
+    /* NaNs compare false with everything; move them to the end and sort the rest */
+    for (i = 0; i < count; ++i) {
+        if (p[i] == p[i]) {
+            double t = p[n];
+            p[n++] = p[i];
+            p[i] = t;
+        }
+    }
+    f64_sort(p, n);
+}
@@ -30,6 +30,53 @@ const char *argv(int idx);
 /** @brief Free the stored command-line argument memory */
 void free_program_args(void);
 
+/*
+ * Typed array kernels.  Every array argument is a base pointer plus a start
+ * index; start and count are in elements, which are 8 bytes (int64_t or
+ * double) as for MXVM integer and float arrays.
+ */
+
+/** @brief Set count elements of p from start on to value */
+void fill_i64(int64_t *p, int64_t start, int64_t count, int64_t value);
+
+/** @brief Set count elements of p from start on to value */
+void fill_f64(double *p, int64_t start, int64_t count, double value);
+
+/** @brief Sum of count elements, wrapping on overflow */
+int64_t sum_i64(const int64_t *p, int64_t start, int64_t count);
+
+/** @brief Sum of count elements, added in four interleaved lanes */
+double sum_f64(const double *p, int64_t start, int64_t count);
+
+/** @brief Smallest of count elements, 0 when count is 0 */
+int64_t min_i64(const int64_t *p, int64_t start, int64_t count);
+
+/** @brief Largest of count elements, 0 when count is 0 */
+int64_t max_i64(const int64_t *p, int64_t start, int64_t count);
+
+/** @brief Smallest of count elements, 0.0 when count is 0 */
+double min_f64(const double *p, int64_t start, int64_t count);
+
+/** @brief Largest of count elements, 0.0 when count is 0 */
+double max_f64(const double *p, int64_t start, int64_t count);
+
+/** @brief Sum of a[a_start + i] * b[b_start + i] for i below count */
+double dot_f64(const double *a, int64_t a_start, const double *b, int64_t b_start, int64_t count);
+
+/**
+ * @brief Copy count elements, stepping dest_stride and src_stride elements at a time
+ *
+ * With both strides 1 this is a memmove, so the ranges may overlap.
+ */
+void copy_strided(int64_t *dest, int64_t dest_start, int64_t dest_stride,
+                  const int64_t *src, int64_t src_start, int64_t src_stride, int64_t count);
+
+/** @brief Sort count elements ascending in place */
+void sort_i64(int64_t *p, int64_t start, int64_t count);
+
+/** @brief Sort count elements ascending in place; NaNs end up last */
+void sort_f64(double *p, int64_t start, int64_t count);
+
 #ifdef __cplusplus
 }
 #endif
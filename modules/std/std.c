@@ -8,6 +8,7 @@
 #include <stdlib.h>
 #include <string.h>
 
+/* Process-wide table for compiled programs, filled from main's argc/argv; the interpreter keeps one per VM (std.cpp) */
 static int g_argc = 0;
 static char **g_argv = NULL;
 static int g_args_registered = 0;
@@ -10,6 +10,7 @@
 #include <cstdlib>
 #include <ctime>
 #include <string>
+#include <vector>
 
 extern "C" void mxvm_std_abs(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
     if (operand.size() != 1) {
@@ -757,9 +758,26 @@ extern "C" void mxvm_std_trunc(mxvm::Program *program, std::vector<mxvm::Operand
     program->vars["%rax"].var_value.float_value = r;
 }
 
+/** @brief Argument table of one VM; compiled programs use the process-wide one in std.c */
+struct ProgramArgs {
+    std::vector<std::string> argv;
+    bool seeded = false;
+};
+
+// Starts out as the arguments the host gave the root program with setArgs()
+static ProgramArgs &programArgs(mxvm::Program *program) {
+    ProgramArgs &state = program->context->moduleState<ProgramArgs>("std");
+    if (!state.seeded) {
+        if (program->context->base != nullptr)
+            state.argv = static_cast<mxvm::Program *>(program->context->base)->getArgs();
+        state.seeded = true;
+    }
+    return state;
+}
+
 extern "C" void mxvm_std_argc(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
     (void)operand;
-    int v = argc();
+    int v = static_cast<int>(programArgs(program).argv.size());
     program->vars["%rax"].type = mxvm::VarType::VAR_INTEGER;
     program->vars["%rax"].var_value.type = mxvm::VarType::VAR_INTEGER;
     program->vars["%rax"].var_value.int_value = (int64_t)v;
@@ -783,14 +801,15 @@ extern "C" void mxvm_std_argv(mxvm::Program *program, std::vector<mxvm::Operand>
         throw mx::Exception("argv argument must be an index constant or integer variable");
     }
 
-    const char *s = argv(idx);
+    const std::vector<std::string> &args = programArgs(program).argv;
+    const char *s = idx >= 0 && idx < static_cast<int>(args.size()) ? args[idx].c_str() : nullptr;
     program->vars["%rax"].type = mxvm::VarType::VAR_POINTER;
     program->vars["%rax"].var_value.type = mxvm::VarType::VAR_POINTER;
     program->vars["%rax"].var_value.ptr_value = (void *)s; /* may be NULL */
 }
 
 extern "C" void mxvm_std_free_program_args(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
-    free_program_args();
+    programArgs(program).argv.clear();
 }
 
 extern "C" void mxvm_std_set_program_args(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
@@ -820,7 +839,10 @@ extern "C" void mxvm_std_set_program_args(mxvm::Program *program, std::vector<mx
         throw mx::Exception("set_program_args: argv pointer is null but argc > 0");
     }
 
-    set_program_args(argc, argv);
+    std::vector<std::string> &args = programArgs(program).argv;
+    args.clear();
+    for (int i = 0; i < argc; ++i)
+        args.emplace_back(argv[i] ? argv[i] : "");
 }
 
 extern "C" void mxvm_std_float_to_int(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
@@ -871,4 +893,155 @@ extern "C" void mxvm_std_int_to_float(mxvm::Program *program, std::vector<mxvm::
     program->vars["%rax"].type = mxvm::VarType::VAR_FLOAT;
     program->vars["%rax"].var_value.type = mxvm::VarType::VAR_FLOAT;
     program->vars["%rax"].var_value.float_value = result;
-}
\ No newline at end of file
+}
+/** @brief Integer argument from an integer variable or immediate */
+static int64_t kernelInt(mxvm::Program *program, const mxvm::Operand &op) {
+    if (!program->isVariable(op.op))
+        return op.op_value;
+    mxvm::Variable &var = program->getVariable(op.op);
+    if (var.type == mxvm::VarType::VAR_FLOAT)
+        return static_cast<int64_t>(var.var_value.float_value);
+    return var.var_value.int_value;
+}
+
+/** @brief Float argument from a float or integer variable */
+static double kernelFloat(mxvm::Program *program, const mxvm::Operand &op) {
+    if (!program->isVariable(op.op))
+        return static_cast<double>(op.op_value);
+    mxvm::Variable &var = program->getVariable(op.op);
+    if (var.type == mxvm::VarType::VAR_FLOAT)
+        return var.var_value.float_value;
+    return static_cast<double>(var.var_value.int_value);
+}
+
+/**
+ * @brief Array argument of a kernel, checked against its allocation
+ *
+ * Elements start .. start + span - 1 (8 bytes each) must lie inside the
+ * block when the VM knows its size, as for memory from alloc.
+ */
+static void *kernelArray(mxvm::Program *program, const mxvm::Operand &op, int64_t start, int64_t span, const char *name) {
+    if (!program->isVariable(op.op))
+        throw mx::Exception(std::string(name) + " array argument must be a pointer variable.");
+    mxvm::Variable &var = program->getVariable(op.op);
+    if (var.type != mxvm::VarType::VAR_POINTER)
+        throw mx::Exception(std::string(name) + " array argument must be a pointer variable.");
+    mxvm::except_assert(std::string(name) + ": array pointer is null", var.var_value.ptr_value != nullptr);
+    if (span > 0) {
+        uint64_t bytes = var.var_value.ptr_size * var.var_value.ptr_count;
+        if (start < 0 || (bytes != 0 && static_cast<uint64_t>(start + span) * sizeof(int64_t) > bytes))
+            throw mx::Exception(std::string(name) + ": elements " + std::to_string(start) + ".." + std::to_string(start + span - 1) +
+                                " are outside '" + op.op + "'");
+    }
+    return var.var_value.ptr_value;
+}
+
+static void kernelReturnInt(mxvm::Program *program, int64_t value) {
+    program->vars["%rax"].type = mxvm::VarType::VAR_INTEGER;
+    program->vars["%rax"].var_value.type = mxvm::VarType::VAR_INTEGER;
+    program->vars["%rax"].var_value.int_value = value;
+}
+
+static void kernelReturnFloat(mxvm::Program *program, double value) {
+    program->vars["%rax"].type = mxvm::VarType::VAR_FLOAT;
+    program->vars["%rax"].var_value.type = mxvm::VarType::VAR_FLOAT;
+    program->vars["%rax"].var_value.float_value = value;
+}
+
+extern "C" void mxvm_std_fill_i64(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 4)
+        throw mx::Exception("fill_i64 requires 4 arguments (array, start, count, value).");
+    int64_t start = kernelInt(program, operand[1]);
+    int64_t count = kernelInt(program, operand[2]);
+    void *p = kernelArray(program, operand[0], start, count, "fill_i64");
+    fill_i64(static_cast<int64_t *>(p), start, count, kernelInt(program, operand[3]));
+}
+
+extern "C" void mxvm_std_fill_f64(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 4)
+        throw mx::Exception("fill_f64 requires 4 arguments (array, start, count, value).");
+    int64_t start = kernelInt(program, operand[1]);
+    int64_t count = kernelInt(program, operand[2]);
+    void *p = kernelArray(program, operand[0], start, count, "fill_f64");
+    fill_f64(static_cast<double *>(p), start, count, kernelFloat(program, operand[3]));
+}
+
+/** @brief Shared argument handling for the (array, start, count) reductions */
+template <typename T, typename R>
+static R reduceKernel(mxvm::Program *program, std::vector<mxvm::Operand> &operand, const char *name, R (*fn)(const T *, int64_t, int64_t)) {
+    if (operand.size() != 3)
+        throw mx::Exception(std::string(name) + " requires 3 arguments (array, start, count).");
+    int64_t start = kernelInt(program, operand[1]);
+    int64_t count = kernelInt(program, operand[2]);
+    void *p = kernelArray(program, operand[0], start, count, name);
+    return fn(static_cast<const T *>(p), start, count);
+}
+
+extern "C" void mxvm_std_sum_i64(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    kernelReturnInt(program, reduceKernel<int64_t, int64_t>(program, operand, "sum_i64", sum_i64));
+}
+
+extern "C" void mxvm_std_sum_f64(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    kernelReturnFloat(program, reduceKernel<double, double>(program, operand, "sum_f64", sum_f64));
+}
+
+extern "C" void mxvm_std_min_i64(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    kernelReturnInt(program, reduceKernel<int64_t, int64_t>(program, operand, "min_i64", min_i64));
+}
+
+extern "C" void mxvm_std_max_i64(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    kernelReturnInt(program, reduceKernel<int64_t, int64_t>(program, operand, "max_i64", max_i64));
+}
+
+extern "C" void mxvm_std_min_f64(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    kernelReturnFloat(program, reduceKernel<double, double>(program, operand, "min_f64", min_f64));
+}
+
+extern "C" void mxvm_std_max_f64(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    kernelReturnFloat(program, reduceKernel<double, double>(program, operand, "max_f64", max_f64));
+}
+
+extern "C" void mxvm_std_dot_f64(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 5)
+        throw mx::Exception("dot_f64 requires 5 arguments (a, a_start, b, b_start, count).");
+    int64_t a_start = kernelInt(program, operand[1]);
+    int64_t b_start = kernelInt(program, operand[3]);
+    int64_t count = kernelInt(program, operand[4]);
+    void *a = kernelArray(program, operand[0], a_start, count, "dot_f64");
+    void *b = kernelArray(program, operand[2], b_start, count, "dot_f64");
+    kernelReturnFloat(program, dot_f64(static_cast<const double *>(a), a_start, static_cast<const double *>(b), b_start, count));
+}
+
+extern "C" void mxvm_std_copy_strided(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 7)
+        throw mx::Exception("copy_strided requires 7 arguments (dest, dest_start, dest_stride, src, src_start, src_stride, count).");
+    int64_t dest_start = kernelInt(program, operand[1]);
+    int64_t dest_stride = kernelInt(program, operand[2]);
+    int64_t src_start = kernelInt(program, operand[4]);
+    int64_t src_stride = kernelInt(program, operand[5]);
+    int64_t count = kernelInt(program, operand[6]);
+    if (count > 0 && (dest_stride < 1 || src_stride < 1))
+        throw mx::Exception("copy_strided strides must be positive.");
+    // The last element touched is start + (count - 1) * stride
+    int64_t dest_span = count > 0 ? (count - 1) * dest_stride + 1 : 0;
+    int64_t src_span = count > 0 ? (count - 1) * src_stride + 1 : 0;
+    void *dest = kernelArray(program, operand[0], dest_start, dest_span, "copy_strided");
+    void *src = kernelArray(program, operand[3], src_start, src_span, "copy_strided");
+    copy_strided(static_cast<int64_t *>(dest), dest_start, dest_stride, static_cast<const int64_t *>(src), src_start, src_stride, count);
+}
+
+extern "C" void mxvm_std_sort_i64(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 3)
+        throw mx::Exception("sort_i64 requires 3 arguments (array, start, count).");
+    int64_t start = kernelInt(program, operand[1]);
+    int64_t count = kernelInt(program, operand[2]);
+    sort_i64(static_cast<int64_t *>(kernelArray(program, operand[0], start, count, "sort_i64")), start, count);
+}
+
+extern "C" void mxvm_std_sort_f64(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 3)
+        throw mx::Exception("sort_f64 requires 3 arguments (array, start, count).");
+    int64_t start = kernelInt(program, operand[1]);
+    int64_t count = kernelInt(program, operand[2]);
+    sort_f64(static_cast<double *>(kernelArray(program, operand[0], start, count, "sort_f64")), start, count);
+}
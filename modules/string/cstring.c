@@ -3,6 +3,7 @@
  * @brief String module C implementation — string manipulation, comparison, and formatting
  * @author Jared Bruni
  */
+#include "strsimd.h"
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -15,11 +16,10 @@ int64_t strfind(const char *src, const char *search, long n) {
     size_t src_len = strlen(src);
     if ((size_t)n > src_len)
         return -1;
-    const char *start = src + n;
-    const char *found = strstr(start, search);
-    if (!found)
-        return -1;
-    return (long)(found - src);
+    mxvm_str_t hay = {src + n, src_len - (size_t)n};
+    mxvm_str_t needle = {search, strlen(search)};
+    int64_t found = mxvm_str_find(hay, needle);
+    return found < 0 ? -1 : found + n;
 }
 
 int64_t substr(char *dest, int64_t size, const char *src, int64_t pos, int64_t len) {
@@ -51,10 +51,9 @@ int64_t strat(const char *src, int64_t pos) {
 int64_t pos(const char *substr, const char *s) {
     if (!substr || !s)
         return 0;
-    const char *found = strstr(s, substr);
-    if (!found)
-        return 0;
-    return (int64_t)(found - s) + 1;
+    mxvm_str_t hay = {s, strlen(s)};
+    mxvm_str_t needle = {substr, strlen(substr)};
+    return mxvm_str_find(hay, needle) + 1;
 }
 
 char *copy(const char *s, int64_t index, int64_t count) {
@@ -141,8 +140,112 @@ char *inttostr(int64_t value) {
     return buf;
 }
 
+static char *convert_case(const char *s, int upper) {
+    if (!s)
+        return NULL;
+    mxvm_str_t src = {s, strlen(s)};
+    char *buf = (char *)malloc(src.len + 1);
+    if (!buf)
+        return NULL;
+    if (upper)
+        mxvm_str_upper(buf, src);
+    else
+        mxvm_str_lower(buf, src);
+    buf[src.len] = '\0';
+    return buf;
+}
+
+char *strupper(const char *s) {
+    return convert_case(s, 1);
+}
+
+char *strlower(const char *s) {
+    return convert_case(s, 0);
+}
+
+static int64_t class_run(const char *s, int64_t start, int64_t cls, int match) {
+    if (!s || start < 0)
+        return 0;
+    size_t len = strlen(s);
+    if ((size_t)start >= len)
+        return 0;
+    mxvm_str_t rest = {s + start, len - (size_t)start};
+    return (int64_t)mxvm_str_span(rest, (int)cls, match);
+}
+
+int64_t strspan(const char *s, int64_t start, int64_t cls) {
+    return class_run(s, start, cls, 1);
+}
+
+int64_t strcspan(const char *s, int64_t start, int64_t cls) {
+    return class_run(s, start, cls, 0);
+}
+
 int64_t strtoint(const char *s) {
     if (!s)
         return 0;
     return atoll(s);
 }
+
+/** @brief Growable buffer behind the sb_* handle */
+typedef struct {
+    char *data;
+    size_t len;
+    size_t cap;
+} mxvm_sb_t;
+
+static int sb_reserve(mxvm_sb_t *sb, size_t extra) {
+    if (sb->len + extra + 1 <= sb->cap)
+        return 1;
+    size_t cap = sb->cap ? sb->cap : 64;
+    while (cap < sb->len + extra + 1)
+        cap *= 2;
+    char *data = (char *)realloc(sb->data, cap);
+    if (!data)
+        return 0;
+    sb->data = data;
+    sb->cap = cap;
+    return 1;
+}
+
+static int64_t sb_append_bytes(mxvm_sb_t *sb, const char *s, size_t n) {
+    if (!sb_reserve(sb, n))
+        return -1;
+    memcpy(sb->data + sb->len, s, n);
+    sb->len += n;
+    sb->data[sb->len] = '\0';
+    return (int64_t)sb->len;
+}
+
+void *sb_new(void) {
+    return calloc(1, sizeof(mxvm_sb_t));
+}
+
+int64_t sb_append(void *handle, const char *s) {
+    mxvm_sb_t *sb = (mxvm_sb_t *)handle;
+    if (!sb)
+        return -1;
+    if (!s)
+        return (int64_t)sb->len;
+    return sb_append_bytes(sb, s, strlen(s));
+}
+
+int64_t sb_append_int(void *handle, int64_t value) {
+    mxvm_sb_t *sb = (mxvm_sb_t *)handle;
+    if (!sb)
+        return -1;
+    char buf[24];
+    int n = snprintf(buf, sizeof(buf), "%lld", (long long)value);
+    return sb_append_bytes(sb, buf, (size_t)n);
+}
+
+char *sb_finish(void *handle) {
+    mxvm_sb_t *sb = (mxvm_sb_t *)handle;
+    if (!sb)
+        return NULL;
+    char *s = sb->data;
+    if (!s)
+        s = (char *)calloc(1, 1);
+    free(sb);
+    return s;
+}
@@ -3,6 +3,7 @@
  * @brief String module C++ runtime bindings for the MXVM interpreter
  * @author Jared Bruni
  */
+#include "strsimd.h"
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -28,6 +29,20 @@ static std::string getStringFromVar(mxvm::Program *program, const std::string &v
 static inline bool isStringLike(mxvm::Variable &v) {
     return v.type == mxvm::VarType::VAR_STRING || v.type == mxvm::VarType::VAR_POINTER;
 }
+
+/** @brief A string or pointer variable argument, with getStringFromVar's checks but no copy */
+static mxvm::Variable &stringArg(mxvm::Program *program, const std::string &varName) {
+    if (!program->isVariable(varName)) {
+        throw mx::Exception("Argument must be a variable, got: " + varName);
+    }
+    mxvm::Variable &var = program->getVariable(varName);
+    if (!isStringLike(var)) {
+        throw mx::Exception("Argument '" + varName + "' must be a string or pointer variable.");
+    }
+    mxvm::except_assert("Pointer argument '" + varName + "' is null", var.type != mxvm::VarType::VAR_POINTER || var.var_value.ptr_value != nullptr);
+    return var;
+}
+
 static inline const char *asReadPtr(mxvm::Variable &v) {
     if (v.type == mxvm::VarType::VAR_POINTER) {
         mxvm::except_assert("null pointer", v.var_value.ptr_value != nullptr);
@@ -35,6 +50,13 @@ static inline const char *asReadPtr(mxvm::Variable &v) {
     }
     return v.var_value.str_value.c_str();
 }
+/** @brief The text of a string or pointer variable without copying it; strings carry their length */
+static mxvm_str_t viewOf(mxvm::Variable &v) {
+    if (v.type == mxvm::VarType::VAR_STRING)
+        return {v.var_value.str_value.data(), v.var_value.str_value.size()};
+    const char *p = asReadPtr(v);
+    return {p, std::strlen(p)};
+}
 static inline char *asWritePtr(mxvm::Variable &v) {
     if (v.type == mxvm::VarType::VAR_POINTER) {
         mxvm::except_assert("null pointer", v.var_value.ptr_value != nullptr);
@@ -87,28 +109,22 @@ extern "C" void mxvm_string_strcmp(mxvm::Program *program, std::vector<mxvm::Ope
     mxvm::Variable &v1 = program->getVariable(var1);
     mxvm::Variable &v2 = program->getVariable(var2);
 
-    const char *s1 = nullptr;
-    const char *s2 = nullptr;
-
     if (v1.type == mxvm::VarType::VAR_POINTER) {
         mxvm::except_assert("strcmp: pointer: " + v1.var_name + " is null", (v1.var_value.ptr_value != nullptr));
-        s1 = reinterpret_cast<const char *>(v1.var_value.ptr_value);
-    } else if (v1.type == mxvm::VarType::VAR_STRING) {
-        s1 = v1.var_value.str_value.c_str();
-    } else {
+    } else if (v1.type != mxvm::VarType::VAR_STRING) {
         throw mx::Exception("strcmp first argument must be a pointer or string variable.");
     }
 
     if (v2.type == mxvm::VarType::VAR_POINTER) {
         mxvm::except_assert("strcmp: pointer: " + v2.var_name + " is null", (v2.var_value.ptr_value != nullptr));
-        s2 = reinterpret_cast<const char *>(v2.var_value.ptr_value);
-    } else if (v2.type == mxvm::VarType::VAR_STRING) {
-        s2 = v2.var_value.str_value.c_str();
-    } else {
+    } else if (v2.type != mxvm::VarType::VAR_STRING) {
         throw mx::Exception("strcmp second argument must be a pointer or string variable.");
     }
 
-    int64_t cmp_result = strcmp(s1, s2);
+    // Shared or interned strings compare equal without touching the text
+    bool same = v1.type == mxvm::VarType::VAR_STRING && v2.type == mxvm::VarType::VAR_STRING &&
+                v1.var_value.str_value == v2.var_value.str_value;
+    int64_t cmp_result = same ? 0 : mxvm_str_compare(viewOf(v1), viewOf(v2));
     program->vars["%rax"].type = mxvm::VarType::VAR_INTEGER;
     program->vars["%rax"].var_value.type = mxvm::VarType::VAR_INTEGER;
     program->vars["%rax"].var_value.int_value = cmp_result;
@@ -141,7 +157,7 @@ extern "C" void mxvm_string_strncpy(mxvm::Program *program, std::vector<mxvm::Op
         std::strncpy(dptr, sptr, n);
         dptr[n] = '\0';
     } else {
-        dest.var_value.str_value.assign(sptr, (size_t)n);
+        dest.var_value.str_value.mutate().assign(sptr, (size_t)n);
     }
 
     program->vars["%rax"].type = mxvm::VarType::VAR_INTEGER;
@@ -176,7 +192,7 @@ extern "C" void mxvm_string_strncat(mxvm::Program *program, std::vector<mxvm::Op
         }
         std::strncat(reinterpret_cast<char *>(dest.var_value.ptr_value), sptr, n);
     } else {
-        dest.var_value.str_value.append(sptr, (size_t)n);
+        dest.var_value.str_value.mutate().append(sptr, (size_t)n);
     }
 
     program->vars["%rax"].type = mxvm::VarType::VAR_INTEGER;
@@ -298,11 +314,13 @@ extern "C" void mxvm_string_strfind(mxvm::Program *program, std::vector<mxvm::Op
     if (!isStringLike(hay) || !isStringLike(needle))
         throw mx::Exception("strfind args must be pointer or string");
 
-    std::string H = asReadPtr(hay);
-    std::string N = asReadPtr(needle);
-
-    size_t pos = H.find(N, (size_t)start);
-    int64_t result = (pos == std::string::npos) ? -1 : (int64_t)pos;
+    mxvm_str_t H = viewOf(hay);
+    int64_t result = -1;
+    if (start >= 0 && static_cast<size_t>(start) <= H.len) {
+        int64_t found = mxvm_str_find({H.data + start, H.len - static_cast<size_t>(start)}, viewOf(needle));
+        if (found >= 0)
+            result = found + start;
+    }
     program->vars["%rax"].type = mxvm::VarType::VAR_INTEGER;
     program->vars["%rax"].var_value.int_value = result;
 }
@@ -372,11 +390,9 @@ extern "C" void mxvm_string_pos(mxvm::Program *program, std::vector<mxvm::Operan
     if (operand.size() != 2)
         throw mx::Exception("pos requires 2 arguments: (substr, s)");
 
-    std::string sub = getStringFromVar(program, operand[0].op);
-    std::string s = getStringFromVar(program, operand[1].op);
-
-    size_t position = s.find(sub);
-    int64_t result = (position == std::string::npos) ? 0 : static_cast<int64_t>(position + 1);
+    mxvm_str_t sub = viewOf(stringArg(program, operand[0].op));
+    mxvm_str_t s = viewOf(stringArg(program, operand[1].op));
+    int64_t result = mxvm_str_find(s, sub) + 1;
 
     program->vars["%rax"].var_value.int_value = result;
     program->vars["%rax"].type = mxvm::VarType::VAR_INTEGER;
@@ -514,3 +530,164 @@ extern "C" void mxvm_string_strtoint(mxvm::Program *program, std::vector<mxvm::O
     program->vars["%rax"].var_value.int_value = result;
     program->vars["%rax"].type = mxvm::VarType::VAR_INTEGER;
 }
+
+/**
+ * @brief Heap state behind an sb_* handle
+ *
+ * Appends grow the buffer geometrically, so building a string piece by
+ * piece is linear in its final length instead of copying the whole
+ * string on every `s := s + x`.
+ */
+struct StringBuilder {
+    std::string text;
+};
+
+static StringBuilder *builderArg(mxvm::Program *program, const std::string &varName, const std::string &fn) {
+    if (!program->isVariable(varName))
+        throw mx::Exception(fn + " first argument must be a variable (builder).");
+    mxvm::Variable &v = program->getVariable(varName);
+    if (v.type != mxvm::VarType::VAR_POINTER || v.var_value.ptr_value == nullptr)
+        throw mx::Exception(fn + " first argument must be a builder from sb_new: " + varName);
+    return static_cast<StringBuilder *>(v.var_value.ptr_value);
+}
+
+static void setBuilderLength(mxvm::Program *program, const StringBuilder *sb) {
+    auto &rax = program->vars["%rax"];
+    rax.type = mxvm::VarType::VAR_INTEGER;
+    rax.var_value.type = mxvm::VarType::VAR_INTEGER;
+    rax.var_value.int_value = static_cast<int64_t>(sb->text.length());
+}
+
+extern "C" void mxvm_string_sb_new(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (!operand.empty())
+        throw mx::Exception("sb_new takes no arguments");
+    auto &rax = program->vars["%rax"];
+    if (rax.type == mxvm::VarType::VAR_POINTER && rax.var_value.ptr_value && rax.var_value.owns) {
+        std::free(rax.var_value.ptr_value);
+    }
+    rax.type = mxvm::VarType::VAR_POINTER;
+    rax.var_value.type = mxvm::VarType::VAR_POINTER;
+    rax.var_value.ptr_value = new StringBuilder();
+    rax.var_value.ptr_size = 0;
+    rax.var_value.ptr_count = 0;
+    // Released by sb_finish, never free()d
+    rax.var_value.owns = false;
+}
+
+extern "C" void mxvm_string_sb_append(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 2)
+        throw mx::Exception("sb_append requires 2 arguments: (builder, string)");
+    StringBuilder *sb = builderArg(program, operand[0].op, "sb_append");
+    if (!program->isVariable(operand[1].op))
+        throw mx::Exception("sb_append second argument must be a variable (string | pointer): " + operand[1].op);
+    mxvm::Variable &src = program->getVariable(operand[1].op);
+    if (!isStringLike(src))
+        throw mx::Exception("sb_append second argument must be a string or pointer variable: " + operand[1].op);
+    // A null string pointer is an empty Pascal string
+    if (src.type == mxvm::VarType::VAR_STRING)
+        sb->text += src.var_value.str_value;
+    else if (src.var_value.ptr_value != nullptr)
+        sb->text += static_cast<const char *>(src.var_value.ptr_value);
+    setBuilderLength(program, sb);
+}
+
+extern "C" void mxvm_string_sb_append_int(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 2)
+        throw mx::Exception("sb_append_int requires 2 arguments: (builder, integer)");
+    StringBuilder *sb = builderArg(program, operand[0].op, "sb_append_int");
+    mxvm::Variable value = program->variableFromOperand(operand[1]);
+    if (value.type != mxvm::VarType::VAR_INTEGER && value.type != mxvm::VarType::VAR_BYTE)
+        throw mx::Exception("sb_append_int second argument must be an integer: " + operand[1].op);
+    sb->text += std::to_string(value.var_value.int_value);
+    setBuilderLength(program, sb);
+}
+
+extern "C" void mxvm_string_sb_finish(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    if (operand.size() != 1)
+        throw mx::Exception("sb_finish requires 1 argument: (builder)");
+    StringBuilder *sb = builderArg(program, operand[0].op, "sb_finish");
+    char *new_buf = static_cast<char *>(malloc(sb->text.length() + 1));
+    if (!new_buf)
+        throw mx::Exception("malloc failed in sb_finish()");
+    std::memcpy(new_buf, sb->text.c_str(), sb->text.length() + 1);
+    const int64_t count = static_cast<int64_t>(sb->text.length() + 1);
+    delete sb;
+    // The handle is dead now; clear it so a second sb_finish fails cleanly
+    program->getVariable(operand[0].op).var_value.ptr_value = nullptr;
+
+    auto &rax = program->vars["%rax"];
+    if (rax.type == mxvm::VarType::VAR_POINTER && rax.var_value.ptr_value && rax.var_value.owns) {
+        std::free(rax.var_value.ptr_value);
+    }
+    rax.type = mxvm::VarType::VAR_POINTER;
+    rax.var_value.type = mxvm::VarType::VAR_POINTER;
+    rax.var_value.ptr_value = new_buf;
+    rax.var_value.ptr_size = 1;
+    rax.var_value.ptr_count = count;
+    rax.var_value.owns = true;
+}
+
+/** @brief Put a new malloc'd copy of @p len bytes at @p text in %rax, owned by the VM */
+static void setRaxOwnedString(mxvm::Program *program, char *text, size_t len) {
+    auto &rax = program->vars["%rax"];
+    if (rax.type == mxvm::VarType::VAR_POINTER && rax.var_value.ptr_value && rax.var_value.owns) {
+        std::free(rax.var_value.ptr_value);
+    }
+    rax.type = mxvm::VarType::VAR_POINTER;
+    rax.var_value.type = mxvm::VarType::VAR_POINTER;
+    rax.var_value.ptr_value = text;
+    rax.var_value.ptr_size = 1;
+    rax.var_value.ptr_count = static_cast<int64_t>(len + 1);
+    rax.var_value.owns = true;
+}
+
+static void convertCase(mxvm::Program *program, std::vector<mxvm::Operand> &operand, bool upper) {
+    const char *name = upper ? "strupper" : "strlower";
+    if (operand.size() != 1)
+        throw mx::Exception(std::string(name) + " requires 1 argument: (string)");
+    mxvm_str_t src = viewOf(stringArg(program, operand[0].op));
+    char *new_buf = static_cast<char *>(malloc(src.len + 1));
+    if (!new_buf)
+        throw mx::Exception(std::string("malloc failed in ") + name + "()");
+    if (upper)
+        mxvm_str_upper(new_buf, src);
+    else
+        mxvm_str_lower(new_buf, src);
+    new_buf[src.len] = '\0';
+    setRaxOwnedString(program, new_buf, src.len);
+}
+
+extern "C" void mxvm_string_strupper(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    convertCase(program, operand, true);
+}
+
+extern "C" void mxvm_string_strlower(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    convertCase(program, operand, false);
+}
+
+static void classRun(mxvm::Program *program, std::vector<mxvm::Operand> &operand, bool match) {
+    const char *name = match ? "strspan" : "strcspan";
+    if (operand.size() != 3)
+        throw mx::Exception(std::string(name) + " requires 3 arguments: (string, start, class)");
+    mxvm_str_t s = viewOf(stringArg(program, operand[0].op));
+    mxvm::Variable start = program->variableFromOperand(operand[1]);
+    mxvm::Variable cls = program->variableFromOperand(operand[2]);
+    if (start.type != mxvm::VarType::VAR_INTEGER || cls.type != mxvm::VarType::VAR_INTEGER)
+        throw mx::Exception(std::string(name) + " start and class must be integers");
+    int64_t from = start.var_value.int_value;
+    int64_t result = 0;
+    if (from >= 0 && static_cast<size_t>(from) < s.len)
+        result = static_cast<int64_t>(mxvm_str_span({s.data + from, s.len - static_cast<size_t>(from)}, static_cast<int>(cls.var_value.int_value), match));
+    auto &rax = program->vars["%rax"];
+    rax.type = mxvm::VarType::VAR_INTEGER;
+    rax.var_value.type = mxvm::VarType::VAR_INTEGER;
+    rax.var_value.int_value = result;
+}
+
+extern "C" void mxvm_string_strspan(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    classRun(program, operand, true);
+}
+
+extern "C" void mxvm_string_strcspan(mxvm::Program *program, std::vector<mxvm::Operand> &operand) {
+    classRun(program, operand, false);
+}
@@ -0,0 +1,295 @@
+/**
+ * @file strsimd.c
+ * @brief SSE2/AVX2 string search, compare, case conversion and class scanning
+ * @author Jared Bruni
+ *
+ * Every function works on pointer + length descriptors, never on the NUL.
+ * On x86-64 the SSE2 paths are always available; the AVX2 paths are
+ * chosen at run time from CPUID, so one binary runs on any x86-64 CPU.
+ * Other targets use the scalar loops the vector paths finish with.
+ */
+#include "strsimd.h"
+#include <string.h>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define MXVM_STR_X86 1
+#include <immintrin.h>
+#endif
+
+static int in_class(unsigned char c, int cls) {
+    switch (cls) {
+    case MXVM_CLASS_DIGIT:
+        return c >= '0' && c <= '9';
+    case MXVM_CLASS_ALPHA:
+        return (c | 0x20) >= 'a' && (c | 0x20) <= 'z';
+    case MXVM_CLASS_ALNUM:
+        return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+    case MXVM_CLASS_SPACE:
+        return c == ' ' || (c >= '\t' && c <= '\r');
+    case MXVM_CLASS_UPPER:
+        return c >= 'A' && c <= 'Z';
+    case MXVM_CLASS_LOWER:
+        return c >= 'a' && c <= 'z';
+    default:
+        return 0;
+    }
+}
+
+static int64_t find_scalar(const char *h, size_t hlen, const char *n, size_t nlen, size_t from) {
+    for (size_t i = from; i + nlen <= hlen; ++i) {
+        if (h[i] == n[0] && memcmp(h + i + 1, n + 1, nlen - 1) == 0)
+            return (int64_t)i;
+    }
+    return -1;
+}
+
+static size_t mismatch_scalar(const char *a, const char *b, size_t n, size_t from) {
+    size_t i = from;
+    while (i < n && a[i] == b[i])
+        ++i;
+    return i;
+}
+
+/** @brief Flip the case bit of bytes in [lo, hi] */
+static void case_scalar(char *dst, const char *src, size_t n, size_t from, char lo, char hi) {
+    for (size_t i = from; i < n; ++i) {
+        char c = src[i];
+        dst[i] = (c >= lo && c <= hi) ? (char)(c ^ 0x20) : c;
+    }
+}
+
+static size_t span_scalar(const char *s, size_t n, size_t from, int cls, int match) {
+    size_t i = from;
+    while (i < n && (in_class((unsigned char)s[i], cls) != 0) == (match != 0))
+        ++i;
+    return i;
+}
+
+#ifdef MXVM_STR_X86
+
+/* SSE2 is part of the x86-64 baseline, so these paths need no check */
+
+/* Signed byte compares are fine: bytes >= 0x80 are negative, below every range used here */
+static inline __m128i range_sse2(__m128i x, char lo, char hi) {
+    return _mm_and_si128(_mm_cmpgt_epi8(x, _mm_set1_epi8((char)(lo - 1))), _mm_cmplt_epi8(x, _mm_set1_epi8((char)(hi + 1))));
+}
+
+static inline __m128i class_sse2(__m128i x, int cls) {
+    switch (cls) {
+    case MXVM_CLASS_DIGIT:
+        return range_sse2(x, '0', '9');
+    case MXVM_CLASS_ALPHA:
+        return range_sse2(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z');
+    case MXVM_CLASS_ALNUM:
+        return _mm_or_si128(range_sse2(x, '0', '9'), range_sse2(_mm_or_si128(x, _mm_set1_epi8(0x20)), 'a', 'z'));
+    case MXVM_CLASS_SPACE:
+        return _mm_or_si128(_mm_cmpeq_epi8(x, _mm_set1_epi8(' ')), range_sse2(x, '\t', '\r'));
+    case MXVM_CLASS_UPPER:
+        return range_sse2(x, 'A', 'Z');
+    default:
+        return range_sse2(x, 'a', 'z');
+    }
+}
+
+/* Candidates are positions where both the first and the last needle byte match */
+static int64_t find_sse2(const char *h, size_t hlen, const char *n, size_t nlen) {
+    const __m128i first = _mm_set1_epi8(n[0]);
+    const __m128i last = _mm_set1_epi8(n[nlen - 1]);
+    size_t i = 0;
+    for (; i + nlen - 1 + 16 <= hlen; i += 16) {
+        __m128i bf = _mm_loadu_si128((const __m128i *)(h + i));
+        __m128i bl = _mm_loadu_si128((const __m128i *)(h + i + nlen - 1));
+        unsigned mask = (unsigned)_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(bf, first), _mm_cmpeq_epi8(bl, last)));
+        while (mask != 0) {
+            unsigned bit = (unsigned)__builtin_ctz(mask);
+            if (memcmp(h + i + bit + 1, n + 1, nlen - 2) == 0)
+                return (int64_t)(i + bit);
+            mask &= mask - 1;
+        }
+    }
+    return find_scalar(h, hlen, n, nlen, i);
+}
+
+static size_t mismatch_sse2(const char *a, const char *b, size_t n) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(a + i)), _mm_loadu_si128((const __m128i *)(b + i)));
+        unsigned diff = (unsigned)_mm_movemask_epi8(eq) ^ 0xFFFFu;
+        if (diff != 0)
+            return i + (unsigned)__builtin_ctz(diff);
+    }
+    return mismatch_scalar(a, b, n, i);
+}
+
+static void case_sse2(char *dst, const char *src, size_t n, char lo, char hi) {
+    const __m128i bit = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i *)(src + i));
+        x = _mm_xor_si128(x, _mm_and_si128(range_sse2(x, lo, hi), bit));
+        _mm_storeu_si128((__m128i *)(dst + i), x);
+    }
+    case_scalar(dst, src, n, i, lo, hi);
+}
+
+static size_t span_sse2(const char *s, size_t n, int cls, int match) {
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        unsigned in = (unsigned)_mm_movemask_epi8(class_sse2(_mm_loadu_si128((const __m128i *)(s + i)), cls));
+        unsigned stop = match ? (in ^ 0xFFFFu) : in;
+        if (stop != 0)
+            return i + (unsigned)__builtin_ctz(stop);
+    }
+    return span_scalar(s, n, i, cls, match);
+}
+
+#define MXVM_AVX2 __attribute__((target("avx2")))
+
+MXVM_AVX2 static inline __m256i range_avx2(__m256i x, char lo, char hi) {
+    return _mm256_and_si256(_mm256_cmpgt_epi8(x, _mm256_set1_epi8((char)(lo - 1))), _mm256_cmpgt_epi8(_mm256_set1_epi8((char)(hi + 1)), x));
+}
+
+MXVM_AVX2 static inline __m256i class_avx2(__m256i x, int cls) {
+    switch (cls) {
+    case MXVM_CLASS_DIGIT:
+        return range_avx2(x, '0', '9');
+    case MXVM_CLASS_ALPHA:
+        return range_avx2(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 'z');
+    case MXVM_CLASS_ALNUM:
+        return _mm256_or_si256(range_avx2(x, '0', '9'), range_avx2(_mm256_or_si256(x, _mm256_set1_epi8(0x20)), 'a', 'z'));
+    case MXVM_CLASS_SPACE:
+        return _mm256_or_si256(_mm256_cmpeq_epi8(x, _mm256_set1_epi8(' ')), range_avx2(x, '\t', '\r'));
+    case MXVM_CLASS_UPPER:
+        return range_avx2(x, 'A', 'Z');
+    default:
+        return range_avx2(x, 'a', 'z');
+    }
+}
+
+MXVM_AVX2 static int64_t find_avx2(const char *h, size_t hlen, const char *n, size_t nlen) {
+    const __m256i first = _mm256_set1_epi8(n[0]);
+    const __m256i last = _mm256_set1_epi8(n[nlen - 1]);
+    size_t i = 0;
+    for (; i + nlen - 1 + 32 <= hlen; i += 32) {
+        __m256i bf = _mm256_loadu_si256((const __m256i *)(h + i));
+        __m256i bl = _mm256_loadu_si256((const __m256i *)(h + i + nlen - 1));
+        unsigned mask = (unsigned)_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(bf, first), _mm256_cmpeq_epi8(bl, last)));
+        while (mask != 0) {
+            unsigned bit = (unsigned)__builtin_ctz(mask);
+            if (memcmp(h + i + bit + 1, n + 1, nlen - 2) == 0)
+                return (int64_t)(i + bit);
+            mask &= mask - 1;
+        }
+    }
+    return find_scalar(h, hlen, n, nlen, i);
+}
+
+MXVM_AVX2 static size_t mismatch_avx2(const char *a, const char *b, size_t n) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(a + i)), _mm256_loadu_si256((const __m256i *)(b + i)));
+        unsigned diff = ~(unsigned)_mm256_movemask_epi8(eq);
+        if (diff != 0)
+            return i + (unsigned)__builtin_ctz(diff);
+    }
+    return mismatch_scalar(a, b, n, i);
+}
+
+MXVM_AVX2 static void case_avx2(char *dst, const char *src, size_t n, char lo, char hi) {
+    const __m256i bit = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i *)(src + i));
+        x = _mm256_xor_si256(x, _mm256_and_si256(range_avx2(x, lo, hi), bit));
+        _mm256_storeu_si256((__m256i *)(dst + i), x);
+    }
+    case_scalar(dst, src, n, i, lo, hi);
+}
+
+MXVM_AVX2 static size_t span_avx2(const char *s, size_t n, int cls, int match) {
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        unsigned in = (unsigned)_mm256_movemask_epi8(class_avx2(_mm256_loadu_si256((const __m256i *)(s + i)), cls));
+        unsigned stop = match ? ~in : in;
+        if (stop != 0)
+            return i + (unsigned)__builtin_ctz(stop);
+    }
+    return span_scalar(s, n, i, cls, match);
+}
+
+static int have_avx2(void) {
+    /* Racing first calls store the same answer */
+    static volatile int avx2 = -1;
+    if (avx2 < 0) {
+        __builtin_cpu_init();
+        avx2 = __builtin_cpu_supports("avx2") ? 1 : 0;
+    }
+    return avx2;
+}
+
+#endif
+
+int64_t mxvm_str_find(mxvm_str_t hay, mxvm_str_t needle) {
+    if (needle.len == 0)
+        return 0;
+    if (needle.len > hay.len)
+        return -1;
+    if (needle.len == 1) {
+        const char *p = (const char *)memchr(hay.data, needle.data[0], hay.len);
+        return p ? (int64_t)(p - hay.data) : -1;
+    }
+#ifdef MXVM_STR_X86
+    if (have_avx2())
+        return find_avx2(hay.data, hay.len, needle.data, needle.len);
+    return find_sse2(hay.data, hay.len, needle.data, needle.len);
+#else
+    return find_scalar(hay.data, hay.len, needle.data, needle.len, 0);
+#endif
+}
+
+int mxvm_str_compare(mxvm_str_t a, mxvm_str_t b) {
+    size_t n = a.len < b.len ? a.len : b.len;
+#ifdef MXVM_STR_X86
+    size_t i = have_avx2() ? mismatch_avx2(a.data, b.data, n) : mismatch_sse2(a.data, b.data, n);
+#else
+    size_t i = mismatch_scalar(a.data, b.data, n, 0);
+#endif
+    /* Past the end of the shorter string its terminating NUL is compared, as strcmp does */
+    int ca = i < a.len ? (unsigned char)a.data[i] : 0;
+    int cb = i < b.len ? (unsigned char)b.data[i] : 0;
+    return ca - cb;
+}
+
+void mxvm_str_upper(char *dst, mxvm_str_t src) {
+#ifdef MXVM_STR_X86
+    if (have_avx2())
+        case_avx2(dst, src.data, src.len, 'a', 'z');
+    else
+        case_sse2(dst, src.data, src.len, 'a', 'z');
+#else
+    case_scalar(dst, src.data, src.len, 0, 'a', 'z');
+#endif
+}
+
+void mxvm_str_lower(char *dst, mxvm_str_t src) {
+#ifdef MXVM_STR_X86
+    if (have_avx2())
+        case_avx2(dst, src.data, src.len, 'A', 'Z');
+    else
+        case_sse2(dst, src.data, src.len, 'A', 'Z');
+#else
+    case_scalar(dst, src.data, src.len, 0, 'A', 'Z');
+#endif
+}
+
+size_t mxvm_str_span(mxvm_str_t s, int cls, int match) {
+    if (cls < MXVM_CLASS_DIGIT || cls > MXVM_CLASS_LOWER)
+        return 0;
+#ifdef MXVM_STR_X86
+    if (have_avx2())
+        return span_avx2(s.data, s.len, cls, match);
+    return span_sse2(s.data, s.len, cls, match);
+#else
+    return span_scalar(s.data, s.len, 0, cls, match);
+#endif
+}
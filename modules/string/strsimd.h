@@ -0,0 +1,54 @@
+/**
+ * @file strsimd.h
+ * @brief Length-carrying string primitives with SSE2/AVX2 paths, shared by the string module builds
+ * @author Jared Bruni
+ */
+#ifndef __STRSIMD_H_
+#define __STRSIMD_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief A string as pointer and length, so callers never re-scan for the NUL */
+typedef struct {
+    const char *data;
+    size_t len;
+} mxvm_str_t;
+
+/** @brief Character classes for mxvm_str_span (ASCII, as in the C locale) */
+enum {
+    MXVM_CLASS_DIGIT = 0, ///< 0-9
+    MXVM_CLASS_ALPHA = 1, ///< A-Z a-z
+    MXVM_CLASS_ALNUM = 2, ///< A-Z a-z 0-9
+    MXVM_CLASS_SPACE = 3, ///< space \\t \\n \\v \\f \\r
+    MXVM_CLASS_UPPER = 4, ///< A-Z
+    MXVM_CLASS_LOWER = 5  ///< a-z
+};
+
+/** @brief Offset of the first @p needle in @p hay, or -1 */
+int64_t mxvm_str_find(mxvm_str_t hay, mxvm_str_t needle);
+
+/** @brief <0, 0 or >0 as @p a sorts before, equal to or after @p b (bytes compared unsigned) */
+int mxvm_str_compare(mxvm_str_t a, mxvm_str_t b);
+
+/** @brief Copy @p src to @p dst with a-z mapped to A-Z; @p dst may equal src.data */
+void mxvm_str_upper(char *dst, mxvm_str_t src);
+
+/** @brief Copy @p src to @p dst with A-Z mapped to a-z; @p dst may equal src.data */
+void mxvm_str_lower(char *dst, mxvm_str_t src);
+
+/**
+ * @brief Length of the prefix of @p s whose bytes are in (@p match != 0) or not in class @p cls
+ * @return s.len when every byte qualifies, 0 for an unknown class
+ */
+size_t mxvm_str_span(mxvm_str_t s, int cls, int match);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,152 @@
+/**
+ * @file cache.cpp
+ * @brief Content-hashed on-disk build cache for generated assembly and object files
+ * @author Jared Bruni
+ */
+#include "mxvm/cache.hpp"
+#include "mxvm/icode.hpp"
+#include "mxvm/version_info.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <sstream>
+#include <vector>
+
+namespace mxvm {
+
+    BuildCache::BuildCache(const std::string &d) {
+        if (d.empty())
+            return;
+        std::error_code ec;
+        std::filesystem::create_directories(d, ec);
+        if (!ec && std::filesystem::is_directory(d, ec))
+            dir = d;
+    }
+
+    uint64_t BuildCache::hash(const std::string &data, uint64_t seed) {
+        uint64_t h = seed;
+        for (unsigned char c : data) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    uint64_t BuildCache::hashFile(const std::string &path, uint64_t seed) {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.is_open())
+            return seed;
+        std::ostringstream stream;
+        stream << file.rdbuf();
+        return hash(stream.str(), seed);
+    }
+
+    std::string BuildCache::toKey(uint64_t h) {
+        char buf[17];
+        std::snprintf(buf, sizeof(buf), "%016llx", static_cast<unsigned long long>(h));
+        return buf;
+    }
+
+    static uint64_t hashProgramSources(Program &program, uint64_t h) {
+        h = BuildCache::hash(program.name + (program.object ? ":object\n" : ":program\n"), h);
+        h = BuildCache::hashFile(program.filename, h);
+        for (auto &obj : program.objects)
+            h = hashProgramSources(*obj, h);
+        return h;
+    }
+
+    // Names, types and labels a program exposes to the others; addresses and values are left
+    // out because generated code refers to other programs by symbol only. The std streams are
+    // skipped: add_standard() gives every program the same ones during code generation and the
+    // externs pass copies them into the root, so they only show up for objects not taken from cache
+    static bool isStandardStream(const std::string &var) {
+        auto dot = var.rfind('.');
+        std::string field = dot == std::string::npos ? var : var.substr(dot + 1);
+        return field == "stdin" || field == "stdout" || field == "stderr";
+    }
+
+    static uint64_t hashDeclarations(const Base &program, uint64_t h) {
+        std::vector<std::string> decls;
+        for (const auto &v : program.vars) {
+            if (isStandardStream(v.first))
+                continue;
+            decls.push_back(v.first + ":" + std::to_string(static_cast<int>(v.second.type)) + (v.second.is_global ? ":global" : ""));
+        }
+        for (const auto &l : program.labels)
+            decls.push_back(l.first + (l.second.second ? ":function" : ":label"));
+        std::sort(decls.begin(), decls.end());
+        for (const auto &d : decls)
+            h = BuildCache::hash(d + "\n", h);
+        return h;
+    }
+
+    std::string BuildCache::sourceKey(Program &program, const std::string &flags) {
+        uint64_t h = hash(std::string("mxvm ") + VERSION_INFO + "\n" + flags + "\n");
+        h = hash(std::to_string(static_cast<int>(program.platform)) + (debug_mode ? ":debug\n" : "\n"), h);
+        h = hash(toKey(program.context->interface_hash), h);
+        // Code generation resolves names through the root program and every loaded object,
+        // so an object's assembly also depends on what the rest of the tree declares
+        if (program.context->base != nullptr)
+            h = hashDeclarations(*program.context->base, hash(":root\n", h));
+        std::vector<std::string> names;
+        for (const auto &obj : program.context->object_map)
+            names.push_back(obj.first);
+        std::sort(names.begin(), names.end());
+        for (const auto &n : names)
+            h = hashDeclarations(*program.context->object_map[n], hash(n + ":object\n", h));
+        return toKey(hashProgramSources(program, h));
+    }
+
+    uint64_t BuildCache::toolSeed(Platform platform) {
+        return hash(std::string("mxvm ") + VERSION_INFO + "\n" + std::to_string(static_cast<int>(platform)) + "\n");
+    }
+
+    bool BuildCache::fetch(const std::string &key, const std::string &ext, const std::string &dest) const {
+        if (!enabled())
+            return false;
+        std::error_code ec;
+        std::filesystem::path src = std::filesystem::path(dir) / (key + ext);
+        if (!std::filesystem::is_regular_file(src, ec))
+            return false;
+        std::filesystem::copy_file(src, dest, std::filesystem::copy_options::overwrite_existing, ec);
+        return !ec;
+    }
+
+    void BuildCache::store(const std::string &key, const std::string &ext, const std::string &src) const {
+        if (!enabled())
+            return;
+        std::error_code ec;
+        std::filesystem::path dest = std::filesystem::path(dir) / (key + ext);
+        // Copy under a temporary name first so a concurrent build never sees a partial artifact;
+        // the name is random so two builds storing the same key never write the same file
+        std::random_device rd;
+        std::filesystem::path tmp = dest;
+        tmp += "." + toKey((static_cast<uint64_t>(rd()) << 32) | rd()) + ".tmp";
+        std::filesystem::copy_file(src, tmp, std::filesystem::copy_options::overwrite_existing, ec);
+        if (!ec)
+            std::filesystem::rename(tmp, dest, ec);
+        if (ec)
+            std::filesystem::remove(tmp, ec);
+    }
+
+    std::string BuildCache::readRecord(const std::string &name) const {
+        if (!enabled())
+            return "";
+        std::ifstream file(std::filesystem::path(dir) / name);
+        std::string value;
+        if (file.is_open())
+            std::getline(file, value);
+        return value;
+    }
+
+    void BuildCache::writeRecord(const std::string &name, const std::string &value) const {
+        if (!enabled())
+            return;
+        std::ofstream file(std::filesystem::path(dir) / name);
+        if (file.is_open())
+            file << value << "\n";
+    }
+
+} // namespace mxvm
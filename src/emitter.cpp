@@ -0,0 +1,121 @@
+/**
+ * @file emitter.cpp
+ * @brief Builds a Program from sections supplied in memory by a code generator
+ * @author Jared Bruni
+ */
+#include "mxvm/emitter.hpp"
+#include "mxvm/icode.hpp"
+#include "scanner/exception.hpp"
+
+namespace mxvm {
+
+    namespace {
+        Inc opcode(const std::string &mnemonic) {
+            static const std::unordered_map<std::string, Inc> codes = [] {
+                std::unordered_map<std::string, Inc> m;
+                for (size_t i = 1; i < IncType.size(); ++i)
+                    m[IncType[i]] = static_cast<Inc>(i);
+                return m;
+            }();
+            auto it = codes.find(mnemonic);
+            if (it == codes.end())
+                throw mx::Exception("Error invalid instruction: " + mnemonic);
+            return it->second;
+        }
+    } // namespace
+
+    Emitter::Emitter(Parser &loader, std::unique_ptr<Program> &program, const std::string &name, bool object)
+        : loader(loader), program(program) {
+        program->name = name;
+        program->object = object;
+        if (!object)
+            program->context->root_name = name;
+    }
+
+    void Emitter::object(const std::string &name) {
+        loader.processObjectFile(name, program);
+    }
+
+    void Emitter::module(const std::string &name) {
+        loader.processModuleFile(name, program);
+    }
+
+    void Emitter::variable(VarType type, const std::string &name, const std::string &value) {
+        Variable var;
+        var.type = type;
+        var.var_name = program->name + "." + name;
+        loader.setVariableValue(var, type, value);
+        var.var_value.buffer_size = 0;
+        var.obj_name = program->name;
+        program->add_variable(var.var_name, var);
+    }
+
+    void Emitter::buffer(const std::string &name, size_t size) {
+        Variable var;
+        var.type = VarType::VAR_STRING;
+        var.var_name = program->name + "." + name;
+        loader.setDefaultVariableValue(var, VarType::VAR_STRING);
+        var.var_value.buffer_size = size;
+        var.obj_name = program->name;
+        program->add_variable(var.var_name, var);
+    }
+
+    void Emitter::label(const std::string &name, bool function) {
+        labelMap[name] = code.size();
+        program->add_label(name, code.size(), function);
+    }
+
+    void Emitter::instruction(const std::string &mnemonic, std::vector<Operand> operands) {
+        Instruction instr;
+        instr.instruction = opcode(mnemonic);
+        if (operands.size() > 0)
+            instr.op1 = std::move(operands[0]);
+        if (operands.size() > 1)
+            instr.op2 = std::move(operands[1]);
+        if (operands.size() > 2)
+            instr.op3 = std::move(operands[2]);
+        for (size_t i = 3; i < operands.size(); ++i)
+            instr.vop.push_back(std::move(operands[i]));
+        code.push_back(std::move(instr));
+    }
+
+    void Emitter::finish() {
+        // Labels may be used before they are declared, so they are resolved
+        // once the whole code section is known, as Parser does
+        for (auto &instr : code) {
+            loader.resolveLabelReference(instr.op1, labelMap);
+            loader.resolveLabelReference(instr.op2, labelMap);
+            loader.resolveLabelReference(instr.op3, labelMap);
+            for (auto &op : instr.vop)
+                loader.resolveLabelReference(op, labelMap);
+            program->add_instruction(instr);
+        }
+        code.clear();
+    }
+
+    Operand Emitter::constant(const std::string &text) {
+        Operand operand;
+        operand.op = text;
+        if (text.starts_with("0x") || text.starts_with("0X"))
+            operand.op_value = std::stoll(text, nullptr, 16);
+        else
+            operand.op_value = std::stoll(text);
+        operand.type = OperandType::OP_CONSTANT;
+        return operand;
+    }
+
+    Operand Emitter::symbol(const std::string &name) {
+        Operand operand;
+        auto dot = name.find('.');
+        if (dot != std::string::npos) {
+            operand.object = name.substr(0, dot);
+            operand.label = name.substr(dot + 1);
+        } else {
+            operand.label = name;
+        }
+        operand.op = name;
+        operand.type = OperandType::OP_VARIABLE;
+        return operand;
+    }
+
+} // namespace mxvm
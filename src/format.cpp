@@ -0,0 +1,152 @@
+/**
+ * @file format.cpp
+ * @brief Pre-parsed printf-style format strings for print and string_print
+ * @author Jared Bruni
+ */
+#include "mxvm/format.hpp"
+#include "scanner/exception.hpp"
+#include <cctype>
+#include <charconv>
+#include <cstdio>
+
+namespace mxvm {
+
+    Format::Format(const std::string &source) : src(source), parsed(true) {
+        const char *fmt = source.c_str();
+        const size_t len = source.length();
+        std::string literal;
+        auto flush = [&]() {
+            if (!literal.empty()) {
+                segments.push_back({Kind::LITERAL, Fast::NONE, literal});
+                literal.clear();
+            }
+        };
+        for (size_t i = 0; i < len; ++i) {
+            if (fmt[i] != '%' || i + 1 >= len) {
+                literal += fmt[i];
+                continue;
+            }
+            size_t j = i + 1;
+            while (j < len &&
+                   (fmt[j] == '-' || fmt[j] == '+' || fmt[j] == ' ' || fmt[j] == '#' || fmt[j] == '0' ||
+                    (fmt[j] >= '0' && fmt[j] <= '9') || fmt[j] == '.' ||
+                    fmt[j] == 'l' || fmt[j] == 'h' || fmt[j] == 'z' || fmt[j] == 'j' || fmt[j] == 't')) {
+                ++j;
+            }
+            if (j < len && fmt[j] == '%') {
+                literal += '%';
+                i = j;
+                continue;
+            }
+            // An unterminated conversion ends the output, as printf-style scanning always has here
+            if (j >= len)
+                break;
+            if (!std::isalpha(static_cast<unsigned char>(fmt[j]))) {
+                literal += '%';
+                continue;
+            }
+            std::string spec(fmt + i, fmt + j + 1);
+            Kind kind = Kind::POINTER;
+            switch (fmt[j]) {
+            case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+                kind = Kind::INTEGER;
+                break;
+            case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+                kind = Kind::FLOAT;
+                break;
+            case 's':
+                kind = Kind::STRING;
+                break;
+            default:
+                break;
+            }
+            Fast fast = Fast::NONE;
+            if (spec == "%lld" || spec == "%ld" || spec == "%lli" || spec == "%li")
+                fast = Fast::INT64;
+            else if (spec == "%d" || spec == "%i")
+                fast = Fast::INT32;
+            else if (spec == "%s")
+                fast = Fast::STRING;
+            flush();
+            segments.push_back({kind, fast, std::move(spec)});
+            i = j;
+        }
+        flush();
+    }
+
+    /** @brief snprintf one value onto the end of @p out, without a size limit */
+    template <typename T>
+    static void appendPrintf(std::string &out, const std::string &spec, T value) {
+        char buffer[128];
+        int n = std::snprintf(buffer, sizeof(buffer), spec.c_str(), value);
+        if (n < 0)
+            return;
+        if (static_cast<size_t>(n) < sizeof(buffer)) {
+            out.append(buffer, static_cast<size_t>(n));
+            return;
+        }
+        size_t pos = out.size();
+        out.resize(pos + static_cast<size_t>(n) + 1);
+        std::snprintf(&out[pos], static_cast<size_t>(n) + 1, spec.c_str(), value);
+        out.resize(pos + static_cast<size_t>(n));
+    }
+
+    template <typename T>
+    static void appendInteger(std::string &out, T value) {
+        char buffer[24];
+        auto res = std::to_chars(buffer, buffer + sizeof(buffer), value);
+        out.append(buffer, res.ptr);
+    }
+
+    void Format::append(std::string &out, const std::vector<Variable *> &args) const {
+        size_t argIndex = 0;
+        for (const auto &seg : segments) {
+            if (seg.kind == Kind::LITERAL || argIndex >= args.size()) {
+                out += seg.text;
+                continue;
+            }
+            Variable *arg = args[argIndex++];
+            if (arg->type == VarType::VAR_INTEGER || arg->type == VarType::VAR_BYTE) {
+                int64_t value = arg->var_value.int_value;
+                if (seg.kind == Kind::STRING)
+                    throw mx::Exception("format " + seg.text + " expects a string, got integer: " + arg->var_name);
+                if (seg.fast == Fast::INT64)
+                    appendInteger(out, value);
+                else if (seg.fast == Fast::INT32)
+                    appendInteger(out, static_cast<int>(value));
+                else if (seg.kind == Kind::FLOAT)
+                    appendPrintf(out, seg.text, static_cast<double>(value));
+                else
+                    appendPrintf(out, seg.text, value);
+            } else if (arg->type == VarType::VAR_POINTER || arg->var_value.type == VarType::VAR_EXTERN) {
+                void *ptr = arg->var_value.ptr_value;
+                if (seg.kind == Kind::STRING) {
+                    if (seg.fast == Fast::STRING && ptr != nullptr)
+                        out += static_cast<const char *>(ptr);
+                    else
+                        appendPrintf(out, seg.text, static_cast<const char *>(ptr));
+                } else {
+                    appendPrintf(out, seg.text, ptr);
+                }
+            } else if (arg->type == VarType::VAR_FLOAT) {
+                double value = arg->var_value.float_value;
+                if (seg.kind == Kind::STRING)
+                    throw mx::Exception("format " + seg.text + " expects a string, got float: " + arg->var_name);
+                if (seg.kind == Kind::INTEGER)
+                    appendPrintf(out, seg.text, static_cast<int64_t>(value));
+                else
+                    appendPrintf(out, seg.text, value);
+            } else if (arg->type == VarType::VAR_STRING) {
+                if (seg.kind == Kind::INTEGER || seg.kind == Kind::FLOAT)
+                    throw mx::Exception("format " + seg.text + " expects a number, got string: " + arg->var_name);
+                if (seg.fast == Fast::STRING)
+                    out += arg->var_value.str_value.c_str();
+                else
+                    appendPrintf(out, seg.text, arg->var_value.str_value.c_str());
+            } else {
+                out += "(unsupported)";
+            }
+        }
+    }
+
+} // namespace mxvm
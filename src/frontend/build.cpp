@@ -0,0 +1,302 @@
+/**
+ * @file build.cpp
+ * @brief Multi-unit build support — shared unit interfaces and parallel compilation
+ * @author Jared Bruni
+ */
+#include "build.hpp"
+#include "interface.hpp"
+#include "parser.hpp"
+#include <algorithm>
+#include <cctype>
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+
+namespace pascal {
+
+    /** @brief Translate the body of a {$...} directive into the `{ R± }` form kept for the parser */
+    static std::string rangeDirective(const std::string &body) {
+        std::string kept;
+        std::istringstream items(body);
+        std::string item;
+        while (std::getline(items, item, ',')) {
+            std::string d;
+            for (char c : item)
+                if (!std::isspace(static_cast<unsigned char>(c)))
+                    d += static_cast<char>(std::toupper(static_cast<unsigned char>(c)));
+            if (d == "R-" || d == "RANGECHECKSOFF")
+                kept = "{ R- }";
+            else if (d == "R+" || d == "RANGECHECKSON")
+                kept = "{ R+ }";
+        }
+        return kept;
+    }
+
+    std::string removeComments(const std::string &text, bool keepRangeDirectives) {
+        std::ostringstream stream;
+        std::string directive;
+        enum State {
+            CODE,
+            BRACE_COMMENT,
+            PAREN_COMMENT,
+            STRING
+        };
+        State state = CODE;
+
+        for (size_t i = 0; i < text.length(); ++i) {
+            char c = text[i];
+            char next = (i + 1 < text.length()) ? text[i + 1] : '\0';
+
+            switch (state) {
+            case CODE:
+                if (c == '{') {
+                    state = BRACE_COMMENT;
+                } else if (c == '(' && next == '*') {
+                    state = PAREN_COMMENT;
+                    i++;
+                } else if (c == '\'') {
+                    stream << c;
+                    state = STRING;
+                } else if (c == '/' && next == '/') {
+
+                    while (i < text.length() && text[i] != '\n') {
+                        i++;
+                    }
+                    if (i < text.length()) {
+                        stream << '\n';
+                    }
+                } else {
+                    stream << c;
+                }
+                break;
+
+            case BRACE_COMMENT:
+                if (c == '}') {
+                    state = CODE;
+                    if (keepRangeDirectives && !directive.empty())
+                        stream << rangeDirective(directive.substr(1));
+                    directive.clear();
+                } else if (c == '$' && directive.empty() && text[i - 1] == '{') {
+                    directive = "$";
+                } else if (!directive.empty()) {
+                    directive += c;
+                }
+                break;
+
+            case PAREN_COMMENT:
+                if (c == '*' && next == ')') {
+                    state = CODE;
+                    if (keepRangeDirectives && !directive.empty())
+                        stream << rangeDirective(directive.substr(1));
+                    directive.clear();
+                    i++;
+                } else if (c == '$' && directive.empty() && text[i - 1] == '*' && text[i - 2] == '(') {
+                    directive = "$";
+                } else if (!directive.empty()) {
+                    directive += c;
+                }
+                break;
+
+            case STRING:
+                stream << c;
+                if (c == '\'') {
+                    if (next == '\'') {
+                        stream << next;
+                        i++;
+                    } else {
+                        state = CODE;
+                    }
+                }
+                break;
+            }
+        }
+
+        return stream.str();
+    }
+
+    static std::string toLower(std::string s) {
+        std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+        return s;
+    }
+
+    std::vector<std::string> extractPasUses(const std::string &source) {
+        // 'uses' is a reserved word, so any occurrence outside a string
+        // literal starts a uses clause that runs up to the next ';'
+        std::vector<std::string> uses;
+        bool inUses = false;
+        size_t i = 0;
+        while (i < source.size()) {
+            char c = source[i];
+            if (c == '\'') {
+                ++i;
+                while (i < source.size() && source[i] != '\'')
+                    ++i;
+                ++i;
+            } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+                std::string id;
+                while (i < source.size() && (std::isalnum(static_cast<unsigned char>(source[i])) || source[i] == '_'))
+                    id += source[i++];
+                if (inUses)
+                    uses.push_back(id);
+                else if (toLower(id) == "uses")
+                    inUses = true;
+            } else {
+                if (c == ';')
+                    inUses = false;
+                ++i;
+            }
+        }
+        return uses;
+    }
+
+    const UnitInterface &UnitCache::get(const std::string &dir, const std::string &dep) {
+        Entry *entry = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto &slot = entries[dir + dep];
+            if (!slot)
+                slot = std::make_unique<Entry>();
+            entry = slot.get();
+        }
+        std::call_once(entry->once, [&]() {
+            std::string source;
+            bool haveSource = false;
+            for (const auto &unitFile : {dir + dep + ".pas", dir + toLower(dep) + ".pas"}) {
+                std::ifstream uf(unitFile);
+                if (uf.is_open()) {
+                    std::ostringstream ubuf;
+                    ubuf << uf.rdbuf();
+                    source = ubuf.str();
+                    entry->unit.path = unitFile;
+                    haveSource = true;
+                    break;
+                }
+            }
+            uint64_t hash = haveSource ? sourceHash(source) : 0;
+
+            // Interface files are written next to the unit's .mxvm, which is
+            // either beside the source or in the current directory
+            for (const auto &mxi : {dir + dep + ".mxi", dir + toLower(dep) + ".mxi", dep + ".mxi", toLower(dep) + ".mxi"}) {
+                InterfaceHeader header;
+                std::unique_ptr<UnitNode> ast;
+                if (!readUnitInterface(mxi, header, &ast) || (haveSource && header.hash != hash))
+                    continue;
+                entry->unit.path = mxi;
+                entry->unit.hash = header.hash;
+                entry->unit.ast = std::move(ast);
+                return;
+            }
+
+            if (!haveSource)
+                return;
+            entry->unit.hash = hash;
+            try {
+                PascalParser unitParser(removeComments(source));
+                entry->unit.ast = unitParser.parseUnit();
+            } catch (...) {
+                // Unit source not usable; importers fall back to unchecked calls
+                entry->unit.ast.reset();
+            }
+        });
+        return entry->unit;
+    }
+
+    bool buildAll(const std::vector<BuildJob> &jobs, unsigned int threads, const std::function<bool(const BuildJob &)> &compile) {
+        const size_t count = jobs.size();
+        std::unordered_map<std::string, size_t> byName;
+        for (size_t i = 0; i < count; ++i) {
+            if (!jobs[i].name.empty())
+                byName[toLower(jobs[i].name)] = i;
+        }
+
+        std::vector<std::vector<size_t>> dependents(count);
+        std::vector<size_t> pending(count, 0);
+        for (size_t i = 0; i < count; ++i) {
+            std::vector<size_t> seen;
+            for (const auto &dep : jobs[i].uses) {
+                auto it = byName.find(toLower(dep));
+                if (it == byName.end() || it->second == i)
+                    continue;
+                if (std::find(seen.begin(), seen.end(), it->second) != seen.end())
+                    continue;
+                seen.push_back(it->second);
+                dependents[it->second].push_back(i);
+                ++pending[i];
+            }
+        }
+
+        // Reject cycles up front so workers never wait on a job that cannot start
+        {
+            std::vector<size_t> remaining = pending;
+            std::vector<size_t> order;
+            for (size_t i = 0; i < count; ++i)
+                if (remaining[i] == 0)
+                    order.push_back(i);
+            for (size_t k = 0; k < order.size(); ++k)
+                for (size_t d : dependents[order[k]])
+                    if (--remaining[d] == 0)
+                        order.push_back(d);
+            if (order.size() != count) {
+                for (size_t i = 0; i < count; ++i)
+                    if (remaining[i] != 0)
+                        std::cerr << "mxx: circular unit dependency involving: " << jobs[i].source << "\n";
+                return false;
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable cv;
+        std::deque<size_t> ready;
+        std::vector<bool> failed(count, false);
+        size_t finished = 0;
+        bool ok = true;
+        for (size_t i = 0; i < count; ++i)
+            if (pending[i] == 0)
+                ready.push_back(i);
+
+        auto worker = [&]() {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                cv.wait(lock, [&]() { return !ready.empty() || finished == count; });
+                if (ready.empty())
+                    return;
+                size_t job = ready.front();
+                ready.pop_front();
+                bool success = false;
+                if (failed[job]) {
+                    std::cerr << "mxx: skipping " << jobs[job].source << " (dependency failed)\n";
+                } else {
+                    lock.unlock();
+                    success = compile(jobs[job]);
+                    lock.lock();
+                }
+                if (!success)
+                    ok = false;
+                for (size_t d : dependents[job]) {
+                    if (!success)
+                        failed[d] = true;
+                    if (--pending[d] == 0)
+                        ready.push_back(d);
+                }
+                ++finished;
+                cv.notify_all();
+            }
+        };
+
+        threads = std::max(1u, std::min<unsigned int>(threads, static_cast<unsigned int>(count)));
+        if (threads == 1) {
+            worker();
+        } else {
+            std::vector<std::thread> pool;
+            for (unsigned int t = 0; t < threads; ++t)
+                pool.emplace_back(worker);
+            for (auto &th : pool)
+                th.join();
+        }
+        return ok;
+    }
+
+} // namespace pascal
@@ -0,0 +1,745 @@
+/**
+ * @file fold.cpp
+ * @brief AST-level constant folding and dead-branch elimination
+ * @author Jared Bruni
+ */
+#include "fold.hpp"
+#include <algorithm>
+#include <cctype>
+#include <limits>
+#include <optional>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace pascal {
+
+    namespace {
+
+        /** @brief A compile-time value known to the folder */
+        struct ConstVal {
+            enum Kind { INT, REAL, BOOL, STR } kind = INT;
+            long long i = 0;
+            double d = 0.0;
+            bool b = false;
+            std::string s;
+
+            double asReal() const { return kind == REAL ? d : static_cast<double>(i); }
+            bool isNumeric() const { return kind == INT || kind == REAL; }
+        };
+
+        using FieldSet = std::unordered_set<std::string>;
+
+        /** @brief One lexical scope: constants plus names that hide outer constants */
+        struct FoldScope {
+            std::unordered_map<std::string, ConstVal> consts;
+            FieldSet shadows;
+            bool shadowAll = false;                                  ///< unknown with-record: hide every outer constant
+            std::unordered_map<std::string, FieldSet> recordTypes;   ///< record type → field names
+            std::unordered_map<std::string, std::string> typeAliases; ///< alias → base type
+            std::unordered_map<std::string, std::string> varTypes;   ///< variable → type name
+            std::unordered_map<std::string, FieldSet> varRecords;    ///< variable → fields of an anonymous record
+        };
+
+        std::string lower(std::string s) {
+            std::transform(s.begin(), s.end(), s.begin(), [](unsigned char c) { return std::tolower(c); });
+            return s;
+        }
+
+        long long wrapAdd(long long a, long long b) { return static_cast<long long>(static_cast<unsigned long long>(a) + static_cast<unsigned long long>(b)); }
+        long long wrapSub(long long a, long long b) { return static_cast<long long>(static_cast<unsigned long long>(a) - static_cast<unsigned long long>(b)); }
+        long long wrapMul(long long a, long long b) { return static_cast<long long>(static_cast<unsigned long long>(a) * static_cast<unsigned long long>(b)); }
+
+        bool isIntLiteral(const ASTNode *n, long long v) {
+            auto *num = dynamic_cast<const NumberNode *>(n);
+            if (!num || num->isReal)
+                return false;
+            try {
+                size_t pos = 0;
+                long long x = std::stoll(num->value, &pos);
+                return pos == num->value.size() && x == v;
+            } catch (...) {
+                return false;
+            }
+        }
+
+        /** @brief True when evaluating @p n cannot call user or builtin code */
+        bool sideEffectFree(const ASTNode *n) {
+            if (!n)
+                return true;
+            if (dynamic_cast<const FuncCallNode *>(n))
+                return false;
+            if (auto *b = dynamic_cast<const BinaryOpNode *>(n))
+                return sideEffectFree(b->left.get()) && sideEffectFree(b->right.get());
+            if (auto *u = dynamic_cast<const UnaryOpNode *>(n))
+                return sideEffectFree(u->operand.get());
+            if (auto *a = dynamic_cast<const ArrayAccessNode *>(n))
+                return sideEffectFree(a->base.get()) && sideEffectFree(a->index.get());
+            if (auto *f = dynamic_cast<const FieldAccessNode *>(n))
+                return sideEffectFree(f->recordExpr.get());
+            if (auto *p = dynamic_cast<const PointerDerefNode *>(n))
+                return sideEffectFree(p->pointer.get());
+            if (auto *s = dynamic_cast<const SetLiteralNode *>(n)) {
+                for (const auto &e : s->elements)
+                    if (!sideEffectFree(e.get()))
+                        return false;
+                return true;
+            }
+            return dynamic_cast<const VariableNode *>(n) || dynamic_cast<const NumberNode *>(n) ||
+                   dynamic_cast<const StringNode *>(n) || dynamic_cast<const BooleanNode *>(n) ||
+                   dynamic_cast<const NilNode *>(n) || dynamic_cast<const AddressOfNode *>(n);
+        }
+
+        /** @brief True when a statement subtree defines a goto label (must not be dropped) */
+        bool containsLabel(const ASTNode *n) {
+            if (!n)
+                return false;
+            if (dynamic_cast<const LabelStmtNode *>(n))
+                return true;
+            if (auto *c = dynamic_cast<const CompoundStmtNode *>(n)) {
+                for (const auto &s : c->statements)
+                    if (containsLabel(s.get()))
+                        return true;
+                return false;
+            }
+            if (auto *i = dynamic_cast<const IfStmtNode *>(n))
+                return containsLabel(i->thenStatement.get()) || containsLabel(i->elseStatement.get());
+            if (auto *w = dynamic_cast<const WhileStmtNode *>(n))
+                return containsLabel(w->statement.get());
+            if (auto *f = dynamic_cast<const ForStmtNode *>(n))
+                return containsLabel(f->statement.get());
+            if (auto *r = dynamic_cast<const RepeatStmtNode *>(n)) {
+                for (const auto &s : r->statements)
+                    if (containsLabel(s.get()))
+                        return true;
+                return false;
+            }
+            if (auto *c = dynamic_cast<const CaseStmtNode *>(n)) {
+                for (const auto &br : c->branches)
+                    if (containsLabel(br->statement.get()))
+                        return true;
+                return containsLabel(c->elseStatement.get());
+            }
+            if (auto *w = dynamic_cast<const WithStmtNode *>(n))
+                return containsLabel(w->statement.get());
+            return false;
+        }
+
+        class ConstantFolder {
+          public:
+            void foldProgram(ProgramNode &program) {
+                scopes.emplace_back();
+                if (program.block)
+                    foldBlock(*program.block);
+                scopes.pop_back();
+            }
+
+            void foldUnit(UnitNode &unit) {
+                scopes.emplace_back();
+                for (auto &decl : unit.interfaceDecls)
+                    foldDecl(decl);
+                for (auto &decl : unit.implDecls)
+                    foldDecl(decl);
+                scopes.pop_back();
+            }
+
+          private:
+            std::vector<FoldScope> scopes;
+
+            std::optional<ConstVal> lookup(const std::string &name) const {
+                std::string key = lower(name);
+                for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+                    if (it->shadowAll || it->shadows.count(key))
+                        return std::nullopt;
+                    auto c = it->consts.find(key);
+                    if (c != it->consts.end())
+                        return c->second;
+                }
+                return std::nullopt;
+            }
+
+            std::string resolveType(std::string t) const {
+                t = lower(t);
+                for (int guard = 0; guard < 32; ++guard) {
+                    bool found = false;
+                    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+                        auto a = it->typeAliases.find(t);
+                        if (a != it->typeAliases.end()) {
+                            t = a->second;
+                            found = true;
+                            break;
+                        }
+                    }
+                    if (!found)
+                        break;
+                }
+                return t;
+            }
+
+            /** @brief Field names visible inside `with var do`, if the record type is known */
+            const FieldSet *recordFields(const std::string &var) const {
+                std::string key = lower(var);
+                for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+                    auto r = it->varRecords.find(key);
+                    if (r != it->varRecords.end())
+                        return &r->second;
+                    auto v = it->varTypes.find(key);
+                    if (v != it->varTypes.end()) {
+                        std::string type = resolveType(v->second);
+                        for (auto jt = scopes.rbegin(); jt != scopes.rend(); ++jt) {
+                            auto rt = jt->recordTypes.find(type);
+                            if (rt != jt->recordTypes.end())
+                                return &rt->second;
+                        }
+                        return nullptr;
+                    }
+                }
+                return nullptr;
+            }
+
+            static FieldSet fieldNames(const RecordTypeNode &rec) {
+                FieldSet fields;
+                auto add = [&](const std::vector<std::unique_ptr<ASTNode>> &decls) {
+                    for (const auto &f : decls)
+                        if (auto *vd = dynamic_cast<VarDeclNode *>(f.get()))
+                            for (const auto &id : vd->identifiers)
+                                fields.insert(lower(id));
+                };
+                add(rec.fields);
+                for (const auto &arm : rec.variantArms)
+                    add(arm.fields);
+                if (!rec.variantTagName.empty())
+                    fields.insert(lower(rec.variantTagName));
+                return fields;
+            }
+
+            // ---- declarations -------------------------------------------------
+
+            void foldBlock(BlockNode &block) {
+                for (auto &decl : block.declarations)
+                    foldDecl(decl);
+                if (block.compoundStatement)
+                    for (auto &stmt : block.compoundStatement->statements)
+                        foldStmt(stmt);
+            }
+
+            void declareParams(const std::vector<std::unique_ptr<ASTNode>> &params) {
+                for (const auto &p : params)
+                    if (auto *pn = dynamic_cast<ParameterNode *>(p.get()))
+                        for (const auto &id : pn->identifiers) {
+                            scopes.back().shadows.insert(lower(id));
+                            scopes.back().varTypes[lower(id)] = pn->type;
+                        }
+            }
+
+            void foldDecl(std::unique_ptr<ASTNode> &decl) {
+                FoldScope &scope = scopes.back();
+                if (auto *cd = dynamic_cast<ConstDeclNode *>(decl.get())) {
+                    for (const auto &a : cd->assignments) {
+                        auto v = evaluate(a->value.get());
+                        std::string key = lower(a->identifier);
+                        scope.shadows.erase(key);
+                        if (v)
+                            scope.consts[key] = *v;
+                        else
+                            scope.shadows.insert(key);
+                    }
+                } else if (auto *vd = dynamic_cast<VarDeclNode *>(decl.get())) {
+                    for (const auto &id : vd->identifiers) {
+                        std::string key = lower(id);
+                        scope.consts.erase(key);
+                        scope.shadows.insert(key);
+                        if (std::holds_alternative<std::string>(vd->type)) {
+                            scope.varTypes[key] = std::get<std::string>(vd->type);
+                        } else if (auto *rec = dynamic_cast<RecordTypeNode *>(std::get<std::unique_ptr<ASTNode>>(vd->type).get())) {
+                            scope.varRecords[key] = fieldNames(*rec);
+                        }
+                    }
+                    for (auto &init : vd->initializers)
+                        foldExpr(init);
+                } else if (auto *td = dynamic_cast<TypeDeclNode *>(decl.get())) {
+                    for (const auto &t : td->typeDeclarations) {
+                        if (auto *rd = dynamic_cast<RecordDeclarationNode *>(t.get())) {
+                            if (rd->recordType)
+                                scope.recordTypes[lower(rd->name)] = fieldNames(*rd->recordType);
+                        } else if (auto *ta = dynamic_cast<TypeAliasNode *>(t.get())) {
+                            scope.typeAliases[lower(ta->typeName)] = lower(ta->baseType);
+                        } else if (auto *ed = dynamic_cast<EnumTypeDeclNode *>(t.get())) {
+                            for (const auto &v : ed->values) {
+                                scope.consts.erase(lower(v));
+                                scope.shadows.insert(lower(v));
+                            }
+                        }
+                    }
+                } else if (auto *fd = dynamic_cast<FuncDeclNode *>(decl.get())) {
+                    scope.shadows.insert(lower(fd->name));
+                    foldSubprogram(fd->name, fd->parameters, fd->block.get());
+                } else if (auto *pd = dynamic_cast<ProcDeclNode *>(decl.get())) {
+                    scope.shadows.insert(lower(pd->name));
+                    foldSubprogram(pd->name, pd->parameters, pd->block.get());
+                }
+            }
+
+            void foldSubprogram(const std::string &name, const std::vector<std::unique_ptr<ASTNode>> &params, ASTNode *body) {
+                auto *block = dynamic_cast<BlockNode *>(body);
+                if (!block)
+                    return;
+                scopes.emplace_back();
+                scopes.back().shadows.insert(lower(name));
+                declareParams(params);
+                foldBlock(*block);
+                scopes.pop_back();
+            }
+
+            // ---- statements ---------------------------------------------------
+
+            void foldStmt(std::unique_ptr<ASTNode> &slot) {
+                ASTNode *n = slot.get();
+                if (!n)
+                    return;
+                if (auto *c = dynamic_cast<CompoundStmtNode *>(n)) {
+                    for (auto &s : c->statements)
+                        foldStmt(s);
+                } else if (auto *a = dynamic_cast<AssignmentNode *>(n)) {
+                    foldLValue(a->variable);
+                    foldExpr(a->expression);
+                } else if (auto *aa = dynamic_cast<ArrayAssignmentNode *>(n)) {
+                    foldExpr(aa->index);
+                    foldExpr(aa->value);
+                } else if (auto *i = dynamic_cast<IfStmtNode *>(n)) {
+                    auto cond = foldCondition(i->condition);
+                    foldStmt(i->thenStatement);
+                    foldStmt(i->elseStatement);
+                    if (cond) {
+                        auto &keep = *cond ? i->thenStatement : i->elseStatement;
+                        auto &drop = *cond ? i->elseStatement : i->thenStatement;
+                        if (!containsLabel(drop.get())) {
+                            std::unique_ptr<ASTNode> replacement = std::move(keep);
+                            if (!replacement)
+                                replacement = std::make_unique<EmptyStmtNode>();
+                            slot = std::move(replacement);
+                        }
+                    }
+                } else if (auto *w = dynamic_cast<WhileStmtNode *>(n)) {
+                    auto cond = foldCondition(w->condition);
+                    foldStmt(w->statement);
+                    if (cond && !*cond && !containsLabel(w->statement.get()))
+                        slot = std::make_unique<EmptyStmtNode>();
+                } else if (auto *r = dynamic_cast<RepeatStmtNode *>(n)) {
+                    for (auto &s : r->statements)
+                        foldStmt(s);
+                    foldCondition(r->condition);
+                } else if (auto *f = dynamic_cast<ForStmtNode *>(n)) {
+                    foldExpr(f->startValue);
+                    foldExpr(f->endValue);
+                    foldStmt(f->statement);
+                } else if (auto *cs = dynamic_cast<CaseStmtNode *>(n)) {
+                    foldExpr(cs->expression);
+                    for (auto &br : cs->branches)
+                        foldStmt(br->statement);
+                    foldStmt(cs->elseStatement);
+                } else if (auto *pc = dynamic_cast<ProcCallNode *>(n)) {
+                    for (auto &arg : pc->arguments)
+                        foldArgument(arg);
+                } else if (auto *e = dynamic_cast<ExitNode *>(n)) {
+                    foldExpr(e->expr);
+                } else if (auto *ws = dynamic_cast<WithStmtNode *>(n)) {
+                    // Inside 'with r do' the fields of r hide outer constants
+                    scopes.emplace_back();
+                    if (const FieldSet *fields = recordFields(ws->recordVar))
+                        scopes.back().shadows = *fields;
+                    else
+                        scopes.back().shadowAll = true;
+                    foldStmt(ws->statement);
+                    scopes.pop_back();
+                } else if (auto *l = dynamic_cast<LabelStmtNode *>(n)) {
+                    foldStmt(l->statement);
+                }
+            }
+
+            // ---- expressions --------------------------------------------------
+
+            /** @brief Fold index/record subexpressions of an assignment target, never the target itself */
+            void foldLValue(std::unique_ptr<ASTNode> &slot) {
+                ASTNode *n = slot.get();
+                if (auto *a = dynamic_cast<ArrayAccessNode *>(n)) {
+                    foldLValue(a->base);
+                    foldExpr(a->index);
+                } else if (auto *f = dynamic_cast<FieldAccessNode *>(n)) {
+                    foldLValue(f->recordExpr);
+                } else if (auto *p = dynamic_cast<PointerDerefNode *>(n)) {
+                    foldLValue(p->pointer);
+                }
+            }
+
+            /** @brief Arguments may be var parameters; only composite expressions are rewritten */
+            void foldArgument(std::unique_ptr<ASTNode> &slot) {
+                if (dynamic_cast<VariableNode *>(slot.get()) || dynamic_cast<AddressOfNode *>(slot.get()))
+                    return;
+                if (dynamic_cast<ArrayAccessNode *>(slot.get()) || dynamic_cast<FieldAccessNode *>(slot.get()) ||
+                    dynamic_cast<PointerDerefNode *>(slot.get())) {
+                    foldLValue(slot);
+                    return;
+                }
+                foldExpr(slot);
+            }
+
+            /**
+             * @brief Fold a value expression in place
+             *
+             * Only integer and string results are materialised as literals;
+             * comparisons keep their runtime (integer) form outside conditions.
+             */
+            void foldExpr(std::unique_ptr<ASTNode> &slot) {
+                ASTNode *n = slot.get();
+                if (!n)
+                    return;
+                if (auto *b = dynamic_cast<BinaryOpNode *>(n)) {
+                    foldExpr(b->left);
+                    foldExpr(b->right);
+                    if (auto v = evaluate(n)) {
+                        if (auto lit = makeLiteral(*v, n->getLineNumber())) {
+                            if (b->operator_ == BinaryOpNode::PLUS || b->operator_ == BinaryOpNode::MINUS ||
+                                b->operator_ == BinaryOpNode::MULTIPLY || b->operator_ == BinaryOpNode::DIV ||
+                                b->operator_ == BinaryOpNode::MOD) {
+                                slot = std::move(lit);
+                                return;
+                            }
+                        }
+                    }
+                    simplifyIdentity(slot);
+                } else if (auto *u = dynamic_cast<UnaryOpNode *>(n)) {
+                    foldExpr(u->operand);
+                    if (u->operator_ != UnaryOpNode::NOT) {
+                        if (auto v = evaluate(n)) {
+                            if (v->kind == ConstVal::INT) {
+                                slot = makeLiteral(*v, n->getLineNumber());
+                                return;
+                            }
+                        }
+                    }
+                } else if (auto *fc = dynamic_cast<FuncCallNode *>(n)) {
+                    for (auto &arg : fc->arguments)
+                        foldArgument(arg);
+                } else if (auto *a = dynamic_cast<ArrayAccessNode *>(n)) {
+                    foldLValue(a->base);
+                    foldExpr(a->index);
+                } else if (auto *f = dynamic_cast<FieldAccessNode *>(n)) {
+                    foldLValue(f->recordExpr);
+                } else if (auto *s = dynamic_cast<SetLiteralNode *>(n)) {
+                    for (auto &e : s->elements)
+                        foldExpr(e);
+                }
+            }
+
+            /** @brief x+0, 0+x, x-0, x*1, 1*x, x div 1 → x */
+            void simplifyIdentity(std::unique_ptr<ASTNode> &slot) {
+                auto *b = dynamic_cast<BinaryOpNode *>(slot.get());
+                if (!b)
+                    return;
+                std::unique_ptr<ASTNode> keep;
+                switch (b->operator_) {
+                case BinaryOpNode::PLUS:
+                    if (isIntLiteral(b->right.get(), 0) && !dynamic_cast<StringNode *>(b->left.get()))
+                        keep = std::move(b->left);
+                    else if (isIntLiteral(b->left.get(), 0) && !dynamic_cast<StringNode *>(b->right.get()))
+                        keep = std::move(b->right);
+                    break;
+                case BinaryOpNode::MINUS:
+                    if (isIntLiteral(b->right.get(), 0))
+                        keep = std::move(b->left);
+                    break;
+                case BinaryOpNode::MULTIPLY:
+                    if (isIntLiteral(b->right.get(), 1))
+                        keep = std::move(b->left);
+                    else if (isIntLiteral(b->left.get(), 1))
+                        keep = std::move(b->right);
+                    break;
+                case BinaryOpNode::DIV:
+                    if (isIntLiteral(b->right.get(), 1))
+                        keep = std::move(b->left);
+                    break;
+                default:
+                    break;
+                }
+                if (keep)
+                    slot = std::move(keep);
+            }
+
+            /**
+             * @brief Fold a boolean condition; returns its value when known
+             *
+             * `and`/`or` short-circuit on a known operand when the other
+             * operand has no side effects, and a known-neutral operand is
+             * removed (true and X → X).
+             */
+            std::optional<bool> foldCondition(std::unique_ptr<ASTNode> &slot) {
+                ASTNode *n = slot.get();
+                if (!n)
+                    return std::nullopt;
+                if (auto *b = dynamic_cast<BinaryOpNode *>(n)) {
+                    if (b->operator_ == BinaryOpNode::AND || b->operator_ == BinaryOpNode::OR) {
+                        bool isAnd = b->operator_ == BinaryOpNode::AND;
+                        auto l = foldCondition(b->left);
+                        auto r = foldCondition(b->right);
+                        if (l && r)
+                            return replaceWithBool(slot, isAnd ? (*l && *r) : (*l || *r));
+                        // false and X → false, true or X → true
+                        if (l && *l != isAnd && sideEffectFree(b->right.get()))
+                            return replaceWithBool(slot, *l);
+                        if (r && *r != isAnd && sideEffectFree(b->left.get()))
+                            return replaceWithBool(slot, *r);
+                        // true and X → X, false or X → X
+                        if (l && *l == isAnd) {
+                            slot = std::move(b->right);
+                            return std::nullopt;
+                        }
+                        if (r && *r == isAnd) {
+                            slot = std::move(b->left);
+                            return std::nullopt;
+                        }
+                        return std::nullopt;
+                    }
+                    foldExpr(b->left);
+                    foldExpr(b->right);
+                    auto v = evaluate(slot.get());
+                    if (v && v->kind == ConstVal::BOOL)
+                        return replaceWithBool(slot, v->b);
+                    return std::nullopt;
+                }
+                if (auto *u = dynamic_cast<UnaryOpNode *>(n)) {
+                    if (u->operator_ == UnaryOpNode::NOT) {
+                        auto v = foldCondition(u->operand);
+                        if (v)
+                            return replaceWithBool(slot, !*v);
+                        return std::nullopt;
+                    }
+                }
+                auto v = evaluate(n);
+                if (v && v->kind == ConstVal::BOOL)
+                    return v->b;
+                foldExpr(slot);
+                return std::nullopt;
+            }
+
+            static bool replaceWithBool(std::unique_ptr<ASTNode> &slot, bool value) {
+                int line = slot ? slot->getLineNumber() : 0;
+                slot = std::make_unique<BooleanNode>(value);
+                slot->setLineNumber(line);
+                return value;
+            }
+
+            static std::unique_ptr<ASTNode> makeLiteral(const ConstVal &v, int line) {
+                std::unique_ptr<ASTNode> lit;
+                if (v.kind == ConstVal::INT)
+                    lit = std::make_unique<NumberNode>(std::to_string(v.i), true, false);
+                else if (v.kind == ConstVal::STR && v.s.size() > 1)
+                    lit = std::make_unique<StringNode>(v.s);
+                if (lit)
+                    lit->setLineNumber(line);
+                return lit;
+            }
+
+            /** @brief Evaluate a side-effect-free constant expression, if possible */
+            std::optional<ConstVal> evaluate(const ASTNode *n) const {
+                if (!n)
+                    return std::nullopt;
+                if (auto *num = dynamic_cast<const NumberNode *>(n)) {
+                    ConstVal v;
+                    try {
+                        size_t pos = 0;
+                        if (num->isReal || num->value.find_first_of(".eE") != std::string::npos) {
+                            v.kind = ConstVal::REAL;
+                            v.d = std::stod(num->value, &pos);
+                        } else {
+                            v.kind = ConstVal::INT;
+                            v.i = std::stoll(num->value, &pos);
+                        }
+                        if (pos != num->value.size())
+                            return std::nullopt;
+                    } catch (...) {
+                        return std::nullopt;
+                    }
+                    return v;
+                }
+                if (auto *b = dynamic_cast<const BooleanNode *>(n)) {
+                    ConstVal v;
+                    v.kind = ConstVal::BOOL;
+                    v.b = b->value;
+                    return v;
+                }
+                if (auto *s = dynamic_cast<const StringNode *>(n)) {
+                    ConstVal v;
+                    v.kind = ConstVal::STR;
+                    v.s = s->value;
+                    return v;
+                }
+                if (auto *var = dynamic_cast<const VariableNode *>(n)) {
+                    std::string key = lower(var->name);
+                    if (key == "true" || key == "false") {
+                        ConstVal v;
+                        v.kind = ConstVal::BOOL;
+                        v.b = key == "true";
+                        return v;
+                    }
+                    return lookup(var->name);
+                }
+                if (auto *u = dynamic_cast<const UnaryOpNode *>(n)) {
+                    auto v = evaluate(u->operand.get());
+                    if (!v)
+                        return std::nullopt;
+                    switch (u->operator_) {
+                    case UnaryOpNode::PLUS:
+                        return v->isNumeric() ? v : std::nullopt;
+                    case UnaryOpNode::MINUS:
+                        if (v->kind == ConstVal::INT)
+                            v->i = wrapSub(0, v->i);
+                        else if (v->kind == ConstVal::REAL)
+                            v->d = -v->d;
+                        else
+                            return std::nullopt;
+                        return v;
+                    case UnaryOpNode::NOT:
+                        if (v->kind != ConstVal::BOOL)
+                            return std::nullopt;
+                        v->b = !v->b;
+                        return v;
+                    }
+                    return std::nullopt;
+                }
+                if (auto *b = dynamic_cast<const BinaryOpNode *>(n))
+                    return evaluateBinary(*b);
+                return std::nullopt;
+            }
+
+            std::optional<ConstVal> evaluateBinary(const BinaryOpNode &b) const {
+                auto l = evaluate(b.left.get());
+                auto r = evaluate(b.right.get());
+                if (!l || !r)
+                    return std::nullopt;
+                ConstVal out;
+                auto boolean = [&](bool value) {
+                    out.kind = ConstVal::BOOL;
+                    out.b = value;
+                    return std::optional<ConstVal>(out);
+                };
+
+                if (l->kind == ConstVal::STR || r->kind == ConstVal::STR) {
+                    if (l->kind != ConstVal::STR || r->kind != ConstVal::STR)
+                        return std::nullopt;
+                    switch (b.operator_) {
+                    case BinaryOpNode::PLUS:
+                        out.kind = ConstVal::STR;
+                        out.s = l->s + r->s;
+                        return out;
+                    case BinaryOpNode::EQUAL:
+                        return boolean(l->s == r->s);
+                    case BinaryOpNode::NOT_EQUAL:
+                        return boolean(l->s != r->s);
+                    default:
+                        return std::nullopt;
+                    }
+                }
+
+                if (l->kind == ConstVal::BOOL || r->kind == ConstVal::BOOL) {
+                    if (l->kind != ConstVal::BOOL || r->kind != ConstVal::BOOL)
+                        return std::nullopt;
+                    switch (b.operator_) {
+                    case BinaryOpNode::AND:
+                        return boolean(l->b && r->b);
+                    case BinaryOpNode::OR:
+                        return boolean(l->b || r->b);
+                    case BinaryOpNode::EQUAL:
+                        return boolean(l->b == r->b);
+                    case BinaryOpNode::NOT_EQUAL:
+                        return boolean(l->b != r->b);
+                    default:
+                        return std::nullopt;
+                    }
+                }
+
+                bool real = l->kind == ConstVal::REAL || r->kind == ConstVal::REAL;
+                switch (b.operator_) {
+                case BinaryOpNode::EQUAL:
+                    return boolean(real ? l->asReal() == r->asReal() : l->i == r->i);
+                case BinaryOpNode::NOT_EQUAL:
+                    return boolean(real ? l->asReal() != r->asReal() : l->i != r->i);
+                case BinaryOpNode::LESS:
+                    return boolean(real ? l->asReal() < r->asReal() : l->i < r->i);
+                case BinaryOpNode::LESS_EQUAL:
+                    return boolean(real ? l->asReal() <= r->asReal() : l->i <= r->i);
+                case BinaryOpNode::GREATER:
+                    return boolean(real ? l->asReal() > r->asReal() : l->i > r->i);
+                case BinaryOpNode::GREATER_EQUAL:
+                    return boolean(real ? l->asReal() >= r->asReal() : l->i >= r->i);
+                default:
+                    break;
+                }
+
+                if (real) {
+                    // Real arithmetic is left to code generation, which owns float constant symbols
+                    out.kind = ConstVal::REAL;
+                    switch (b.operator_) {
+                    case BinaryOpNode::PLUS:
+                        out.d = l->asReal() + r->asReal();
+                        return out;
+                    case BinaryOpNode::MINUS:
+                        out.d = l->asReal() - r->asReal();
+                        return out;
+                    case BinaryOpNode::MULTIPLY:
+                        out.d = l->asReal() * r->asReal();
+                        return out;
+                    case BinaryOpNode::DIVIDE:
+                        if (r->asReal() == 0.0)
+                            return std::nullopt;
+                        out.d = l->asReal() / r->asReal();
+                        return out;
+                    default:
+                        return std::nullopt;
+                    }
+                }
+
+                out.kind = ConstVal::INT;
+                switch (b.operator_) {
+                case BinaryOpNode::PLUS:
+                    out.i = wrapAdd(l->i, r->i);
+                    return out;
+                case BinaryOpNode::MINUS:
+                    out.i = wrapSub(l->i, r->i);
+                    return out;
+                case BinaryOpNode::MULTIPLY:
+                    out.i = wrapMul(l->i, r->i);
+                    return out;
+                case BinaryOpNode::DIV:
+                    if (r->i == 0 || (r->i == -1 && l->i == std::numeric_limits<long long>::min()))
+                        return std::nullopt;
+                    out.i = l->i / r->i;
+                    return out;
+                case BinaryOpNode::MOD:
+                    if (r->i == 0 || r->i == -1)
+                        return std::nullopt;
+                    out.i = l->i % r->i;
+                    return out;
+                case BinaryOpNode::DIVIDE:
+                    if (r->i == 0)
+                        return std::nullopt;
+                    out.kind = ConstVal::REAL;
+                    out.d = static_cast<double>(l->i) / static_cast<double>(r->i);
+                    return out;
+                default:
+                    return std::nullopt;
+                }
+            }
+        };
+    } // namespace
+
+    void foldConstants(ProgramNode &program) {
+        ConstantFolder folder;
+        folder.foldProgram(program);
+    }
+
+    void foldConstants(UnitNode &unit) {
+        ConstantFolder folder;
+        folder.foldUnit(unit);
+    }
+
+} // namespace pascal
@@ -619,6 +619,23 @@ namespace pascal {
         for (size_t i = cStart; i <= cEnd; ++i)
             code.push_back(lines[i]);
 
+        std::vector<std::string> pass3 = mxvmOptCode(code);
+
+        std::vector<std::string> finalLines;
+        finalLines.insert(finalLines.end(), lines.begin(), lines.begin() + cStart);
+        finalLines.insert(finalLines.end(), pass3.begin(), pass3.end());
+        if (cEnd + 1 < lines.size())
+            finalLines.insert(finalLines.end(), lines.begin() + cEnd + 1, lines.end());
+
+        sweep_unused_data(finalLines);
+
+        std::string result;
+        for (auto &ln : finalLines)
+            result += ln + "\n";
+        return result;
+    }
+
+    std::vector<std::string> mxvmOptCode(const std::vector<std::string> &code) {
         std::vector<std::string> pass1;
         pass1.reserve(code.size());
         std::regex movPat("^\\s*(\\s*)mov\\s+([^,\\s]+)\\s*,\\s*([^\\s#;]+)\\s*(?:[;#].*)?$", std::regex::icase);
@@ -702,18 +719,6 @@ namespace pascal {
         for (auto &ln : pass2)
             if (!ln.empty())
                 pass3.push_back(ln);
-
-        std::vector<std::string> finalLines;
-        finalLines.insert(finalLines.end(), lines.begin(), lines.begin() + cStart);
-        finalLines.insert(finalLines.end(), pass3.begin(), pass3.end());
-        if (cEnd + 1 < lines.size())
-            finalLines.insert(finalLines.end(), lines.begin() + cEnd + 1, lines.end());
-
-        sweep_unused_data(finalLines);
-
-        std::string result;
-        for (auto &ln : finalLines)
-            result += ln + "\n";
-        return result;
+        return pass3;
     }
 } // namespace pascal
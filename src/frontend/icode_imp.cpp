@@ -5,6 +5,7 @@
  */
 #include "icode.hpp"
 #include <algorithm>
+#include <unordered_map>
 
 namespace pascal {
 
@@ -896,7 +897,7 @@ namespace pascal {
 
     bool StringFunctionHandler::canHandle(const std::string &f) const {
         static const std::unordered_set<std::string> funcs = {
-            "length", "pos", "copy", "insert", "delete", "inttostr", "strtoint"};
+            "length", "pos", "copy", "insert", "delete", "inttostr", "strtoint", "uppercase", "lowercase"};
         return funcs.count(toLower(f)) != 0;
     }
 
@@ -904,7 +905,7 @@ namespace pascal {
         auto f = toLower(f_);
         if (f == "length" || f == "pos" || f == "strtoint")
             return VarType::INT;
-        if (f == "copy" || f == "insert" || f == "delete" || f == "inttostr")
+        if (f == "copy" || f == "insert" || f == "delete" || f == "inttostr" || f == "uppercase" || f == "lowercase")
             return VarType::PTR;
         return VarType::UNKNOWN;
     }
@@ -973,6 +974,14 @@ namespace pascal {
             if (a.size() != 3)
                 throw std::runtime_error("delete expects 3 args");
             emitPtrRet("delete");
+        } else if (f == "uppercase") {
+            if (a.size() != 1)
+                throw std::runtime_error("uppercase expects 1 arg");
+            emitPtrRet("strupper");
+        } else if (f == "lowercase") {
+            if (a.size() != 1)
+                throw std::runtime_error("lowercase expects 1 arg");
+            emitPtrRet("strlower");
         } else {
             freeArgs();
             return false;
@@ -1101,4 +1110,123 @@ namespace pascal {
         return VarType::UNKNOWN;
     }
 
+
+    namespace {
+        /** @brief What a collections call leaves in %rax */
+        enum class CollectionsResult { NONE, INT, PTR };
+
+        struct CollectionsFunction {
+            size_t argc;
+            CollectionsResult result;
+            const char *usage;
+        };
+
+        const std::unordered_map<std::string, CollectionsFunction> &collectionsFunctions() {
+            using R = CollectionsResult;
+            static const std::unordered_map<std::string, CollectionsFunction> funcs = {
+                {"smap_new", {0, R::PTR, ""}},
+                {"smap_free", {1, R::NONE, "map"}},
+                {"smap_put", {3, R::INT, "map, key, value"}},
+                {"smap_add", {3, R::INT, "map, key, delta"}},
+                {"smap_get", {3, R::INT, "map, key, fallback"}},
+                {"smap_has", {2, R::INT, "map, key"}},
+                {"smap_del", {2, R::INT, "map, key"}},
+                {"smap_count", {1, R::INT, "map"}},
+                {"smap_next", {2, R::INT, "map, slot"}},
+                {"smap_key", {2, R::PTR, "map, slot"}},
+                {"smap_value", {2, R::INT, "map, slot"}},
+                {"imap_new", {0, R::PTR, ""}},
+                {"imap_free", {1, R::NONE, "map"}},
+                {"imap_put", {3, R::INT, "map, key, value"}},
+                {"imap_add", {3, R::INT, "map, key, delta"}},
+                {"imap_get", {3, R::INT, "map, key, fallback"}},
+                {"imap_has", {2, R::INT, "map, key"}},
+                {"imap_del", {2, R::INT, "map, key"}},
+                {"imap_count", {1, R::INT, "map"}},
+                {"imap_next", {2, R::INT, "map, slot"}},
+                {"imap_key", {2, R::INT, "map, slot"}},
+                {"imap_value", {2, R::INT, "map, slot"}},
+                {"pmap_new", {0, R::PTR, ""}},
+                {"pmap_free", {1, R::NONE, "map"}},
+                {"pmap_put", {3, R::INT, "map, key, pointer"}},
+                {"pmap_get", {2, R::PTR, "map, key"}},
+                {"pmap_has", {2, R::INT, "map, key"}},
+                {"pmap_del", {2, R::INT, "map, key"}},
+                {"pmap_count", {1, R::INT, "map"}},
+                {"pmap_next", {2, R::INT, "map, slot"}},
+                {"pmap_key", {2, R::PTR, "map, slot"}},
+                {"pmap_value", {2, R::PTR, "map, slot"}},
+                {"vec_new", {0, R::PTR, ""}},
+                {"vec_free", {1, R::NONE, "vec"}},
+                {"vec_push", {2, R::INT, "vec, value"}},
+                {"vec_pop", {1, R::INT, "vec"}},
+                {"vec_get", {2, R::INT, "vec, index"}},
+                {"vec_set", {3, R::INT, "vec, index, value"}},
+                {"vec_len", {1, R::INT, "vec"}},
+                {"vec_clear", {1, R::NONE, "vec"}},
+                {"vec_data", {1, R::PTR, "vec"}},
+                {"heap_new", {0, R::PTR, ""}},
+                {"heap_free", {1, R::NONE, "heap"}},
+                {"heap_push", {3, R::INT, "heap, priority, value"}},
+                {"heap_pop", {1, R::INT, "heap"}},
+                {"heap_peek", {1, R::INT, "heap"}},
+                {"heap_min", {1, R::INT, "heap"}},
+                {"heap_len", {1, R::INT, "heap"}}};
+            return funcs;
+        }
+    } // namespace
+
+    std::vector<std::string> CollectionsFunctionHandler::emitCall(CodeGenVisitor &visitor, const std::string &funcName,
+                                                                  const std::vector<std::unique_ptr<ASTNode>> &arguments) {
+        const CollectionsFunction &fn = collectionsFunctions().at(funcName);
+        if (arguments.size() != fn.argc) {
+            int lineNum = arguments.empty() ? 1 : arguments[0]->getLineNumber();
+            throw std::runtime_error("Error on line " + std::to_string(lineNum) + ": " + funcName + " requires " +
+                                     std::to_string(fn.argc) + " argument" + (fn.argc == 1 ? "" : "s") +
+                                     (fn.argc ? std::string(" (") + fn.usage + ")" : std::string()));
+        }
+        visitor.usedModules.insert("collections");
+        std::vector<std::string> args;
+        args.reserve(arguments.size());
+        for (auto &arg : arguments)
+            args.push_back(visitor.eval(arg.get()));
+        visitor.emit_invoke(funcName, args);
+        return args;
+    }
+
+    bool CollectionsFunctionHandler::canHandle(const std::string &funcName) const {
+        return collectionsFunctions().count(toLower(funcName)) != 0;
+    }
+
+    VarType CollectionsFunctionHandler::getReturnType(const std::string &funcName) const {
+        auto it = collectionsFunctions().find(toLower(funcName));
+        if (it == collectionsFunctions().end() || it->second.result == CollectionsResult::NONE)
+            return VarType::UNKNOWN;
+        return it->second.result == CollectionsResult::PTR ? VarType::PTR : VarType::INT;
+    }
+
+    void CollectionsFunctionHandler::generate(CodeGenVisitor &visitor, const std::string &funcName,
+                                              const std::vector<std::unique_ptr<ASTNode>> &arguments) {
+        for (const std::string &a : emitCall(visitor, toLower(funcName), arguments))
+            if (visitor.isReg(a) && !visitor.isParmReg(a))
+                visitor.freeReg(a);
+    }
+
+    bool CollectionsFunctionHandler::generateWithResult(CodeGenVisitor &visitor, const std::string &funcName_,
+                                                        const std::vector<std::unique_ptr<ASTNode>> &arguments) {
+        auto funcName = toLower(funcName_);
+        CollectionsResult result = collectionsFunctions().at(funcName).result;
+        if (result == CollectionsResult::NONE)
+            throw std::runtime_error(funcName + " does not return a value");
+        std::vector<std::string> args = emitCall(visitor, funcName, arguments);
+        // Handles, keys and vec_data belong to the collection, so the result is never marked for release
+        std::string dst = result == CollectionsResult::PTR ? visitor.allocTempPtr() : visitor.allocReg();
+        visitor.emit("return " + dst);
+        for (const std::string &a : args)
+            if (visitor.isReg(a) && !visitor.isParmReg(a))
+                visitor.freeReg(a);
+        visitor.pushValue(dst);
+        return true;
+    }
+
 } // namespace pascal
\ No newline at end of file
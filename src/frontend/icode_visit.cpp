@@ -17,7 +17,7 @@ namespace pascal {
     void CodeGenVisitor::visit(ProgramNode &node) {
         name = node.name;
         // Separate native modules from unit dependencies
-        static const std::unordered_set<std::string> nativeModules = {"io", "std", "string", "sdl", "strlib"};
+        static const std::unordered_set<std::string> nativeModules = {"io", "std", "string", "sdl", "strlib", "collections"};
         for (const auto &mod : node.uses) {
             if (mod == "strlib")
                 usedModules.insert("string");
@@ -27,6 +27,7 @@ namespace pascal {
                 objectDeps.push_back(mod);
         }
         if (node.block) {
+            programBlock = dynamic_cast<BlockNode *>(node.block.get());
             node.block->accept(*this);
         }
     }
@@ -35,7 +36,7 @@ namespace pascal {
         name = node.name;
         isUnit = true;
         // Process uses clause
-        static const std::unordered_set<std::string> nativeModules = {"io", "std", "string", "sdl", "strlib"};
+        static const std::unordered_set<std::string> nativeModules = {"io", "std", "string", "sdl", "strlib", "collections"};
         for (const auto &mod : node.uses) {
             if (mod == "strlib")
                 usedModules.insert("string");
@@ -49,11 +50,16 @@ namespace pascal {
         emitLabel("function PROC_UNIT_INIT");
 
         // Register interface declarations' signatures WITHOUT deferring code
-        // (interface declarations have null blocks — they are forward declarations)
-        for (auto &decl : node.interfaceDecls) {
+        // (interface declarations have null blocks — they are forward declarations),
+        // followed by those imported from other units
+        std::vector<ASTNode *> interfaceDecls;
+        for (auto &decl : node.interfaceDecls)
+            interfaceDecls.push_back(decl.get());
+        interfaceDecls.insert(interfaceDecls.end(), importedDecls.begin(), importedDecls.end());
+        for (ASTNode *decl : interfaceDecls) {
             if (!decl)
                 continue;
-            if (auto *funcDecl = dynamic_cast<FuncDeclNode *>(decl.get())) {
+            if (auto *funcDecl = dynamic_cast<FuncDeclNode *>(decl)) {
                 // Just register the signature info; don't call accept()
                 FuncInfo funcInfo;
                 funcInfo.returnType = getTypeFromString(funcDecl->returnType);
@@ -66,9 +72,9 @@ namespace pascal {
                 }
                 funcSignatures[funcDecl->name] = funcInfo;
                 setVarType(funcDecl->name, funcInfo.returnType);
-            } else if (dynamic_cast<ConstDeclNode *>(decl.get()) ||
-                       dynamic_cast<VarDeclNode *>(decl.get()) ||
-                       dynamic_cast<TypeDeclNode *>(decl.get())) {
+            } else if (dynamic_cast<ConstDeclNode *>(decl) ||
+                       dynamic_cast<VarDeclNode *>(decl) ||
+                       dynamic_cast<TypeDeclNode *>(decl)) {
                 // Process interface const/var/type so they are available
                 // to the unit's own implementation code
                 decl->accept(*this);
@@ -88,23 +94,30 @@ namespace pascal {
     }
 
     void CodeGenVisitor::visit(BlockNode &node) {
-        for (auto &decl : node.declarations) {
+        // Declarations imported from units follow the program's own
+        std::vector<ASTNode *> decls;
+        for (auto &decl : node.declarations)
+            decls.push_back(decl.get());
+        if (&node == programBlock)
+            decls.insert(decls.end(), importedDecls.begin(), importedDecls.end());
+
+        for (ASTNode *decl : decls) {
             if (!decl)
                 continue;
-            if (dynamic_cast<TypeDeclNode *>(decl.get())) {
+            if (dynamic_cast<TypeDeclNode *>(decl)) {
                 decl->accept(*this);
             }
         }
 
-        for (auto &decl : node.declarations) {
+        for (ASTNode *decl : decls) {
             if (!decl)
                 continue;
-            if (dynamic_cast<TypeDeclNode *>(decl.get()))
+            if (dynamic_cast<TypeDeclNode *>(decl))
                 continue;
 
             if (generatingDeferredCode) {
-                if (dynamic_cast<ProcDeclNode *>(decl.get()) ||
-                    dynamic_cast<FuncDeclNode *>(decl.get())) {
+                if (dynamic_cast<ProcDeclNode *>(decl) ||
+                    dynamic_cast<FuncDeclNode *>(decl)) {
                     continue;
                 }
             }
@@ -189,21 +202,8 @@ namespace pascal {
                     setVars.insert(mangledName);
                     setVars.insert(varName);
                     updateDataSectionInitialValue(slotVar(slot), "ptr", "null");
-                    // Allocate 256 bytes (one byte per ordinal 0..255)
+                    // One 8-byte slot per ordinal 0..255; alloc returns zeroed memory, so the set starts empty
                     emit3("alloc", slotVar(slot), "8", "256");
-                    // Zero-fill the set
-                    std::string loopIdx = allocReg();
-                    std::string loopStart = newLabel("SET_INIT");
-                    std::string loopEnd = newLabel("SET_INIT_END");
-                    emit2("mov", loopIdx, "0");
-                    emitLabel(loopStart);
-                    emit2("cmp", loopIdx, "256");
-                    emit1("jge", loopEnd);
-                    emit4("store", "0", slotVar(slot), loopIdx, "8");
-                    emit2("add", loopIdx, "1");
-                    emit1("jmp", loopStart);
-                    emitLabel(loopEnd);
-                    freeReg(loopIdx);
 
                     std::string currentScope = getCurrentScopeName();
                     if (currentScope.empty())
@@ -235,20 +235,8 @@ namespace pascal {
                 setVars.insert(mangledName);
                 setVars.insert(varName);
                 updateDataSectionInitialValue(slotVar(slot), "ptr", "null");
+                // alloc returns zeroed memory, so the set starts empty
                 emit3("alloc", slotVar(slot), "8", "256");
-                // Zero-fill the set
-                std::string loopIdx = allocReg();
-                std::string loopStart = newLabel("SET_INIT");
-                std::string loopEnd = newLabel("SET_INIT_END");
-                emit2("mov", loopIdx, "0");
-                emitLabel(loopStart);
-                emit2("cmp", loopIdx, "256");
-                emit1("jge", loopEnd);
-                emit4("store", "0", slotVar(slot), loopIdx, "8");
-                emit2("add", loopIdx, "1");
-                emit1("jmp", loopStart);
-                emitLabel(loopEnd);
-                freeReg(loopIdx);
                 std::string currentScope = getCurrentScopeName();
                 if (currentScope.empty())
                     globalArrays.push_back(slotVar(slot));
@@ -1077,6 +1065,7 @@ namespace pascal {
         std::string end = newLabel("ENDWHILE");
         loopContinueLabels.push_back(start);
         loopEndLabels.push_back(end);
+        auto builders = beginStringBuilders({node.condition.get(), node.statement.get()});
         emitLabel(start);
         std::string c = eval(node.condition.get());
         emit2("cmp", c, "0");
@@ -1087,11 +1076,15 @@ namespace pascal {
             node.statement->accept(*this);
         emit1("jmp", start);
         emitLabel(end);
+        endStringBuilders(builders);
         loopContinueLabels.pop_back();
         loopEndLabels.pop_back();
     }
 
     void CodeGenVisitor::visit(ForStmtNode &node) {
+        if (lowerArrayLoop(node))
+            return;
+
         std::string startVal = eval(node.startValue.get());
         std::string endVal = eval(node.endValue.get());
 
@@ -1113,6 +1106,31 @@ namespace pascal {
 
         std::string endCmp = endVal;
 
+        // Inside the body the loop variable stays within [start..end] unless
+        // the body can change it (or the arrays its bounds depend on)
+        bool rangeKnown = false;
+        {
+            auto lo = boundOf(node.isDownto ? node.endValue.get() : node.startValue.get(), false);
+            auto hi = boundOf(node.isDownto ? node.startValue.get() : node.endValue.get(), true);
+            if (lo && hi && lo->lengthOf.empty()) {
+                std::unordered_set<std::string> written;
+                bool opaque = false;
+                scanLoopBody(node.statement.get(), written, opaque);
+                std::string var = lc(node.variable);
+                bool stable = !opaque && !written.count(var);
+                if (stable && !hi->lengthOf.empty()) {
+                    for (const auto &w : written)
+                        if (findMangledArrayName(w) == hi->lengthOf)
+                            stable = false;
+                }
+                if (stable) {
+                    loopRanges.push_back({var, *lo, *hi});
+                    rangeKnown = true;
+                }
+            }
+        }
+
+        auto builders = beginStringBuilders({node.statement.get()});
         emitLabel(loopStartLabel);
 
         emit2("cmp", slotVar(slot), endCmp);
@@ -1123,6 +1141,8 @@ namespace pascal {
 
         if (node.statement)
             node.statement->accept(*this);
+        if (rangeKnown)
+            loopRanges.pop_back();
         emitLabel(continueLabel);
         if (node.isDownto)
             emit2("sub", slotVar(slot), "1");
@@ -1130,6 +1150,7 @@ namespace pascal {
             emit2("add", slotVar(slot), "1");
         emit1("jmp", loopStartLabel);
         emitLabel(loopEndLabel);
+        endStringBuilders(builders);
 
         loopContinueLabels.pop_back();
         loopEndLabels.pop_back();
@@ -1138,6 +1159,418 @@ namespace pascal {
             freeReg(endCmp);
     }
 
+    void CodeGenVisitor::scanLoopBody(ASTNode *node, std::unordered_set<std::string> &written, bool &opaque) {
+        if (!node || opaque)
+            return;
+        auto callArgs = [&](const std::string &name, std::vector<std::unique_ptr<ASTNode>> &args) {
+            std::string fn = lc(name);
+            static const std::unordered_set<std::string> inlineBuiltins = {"new", "dispose", "setlength", "length", "high", "low"};
+            if (!inlineBuiltins.count(fn) && !builtinRegistry.findHandler(fn))
+                opaque = true;
+            bool inquiry = fn == "length" || fn == "high" || fn == "low";
+            for (auto &arg : args) {
+                // A bare variable may be bound to a var parameter
+                auto *v = dynamic_cast<VariableNode *>(arg.get());
+                if (v && !inquiry)
+                    written.insert(lc(v->name));
+                else
+                    scanLoopBody(arg.get(), written, opaque);
+            }
+        };
+
+        if (auto *c = dynamic_cast<CompoundStmtNode *>(node)) {
+            for (auto &st : c->statements)
+                scanLoopBody(st.get(), written, opaque);
+        } else if (auto *a = dynamic_cast<AssignmentNode *>(node)) {
+            if (auto *v = dynamic_cast<VariableNode *>(a->variable.get()))
+                written.insert(lc(v->name));
+            else
+                scanLoopBody(a->variable.get(), written, opaque);
+            scanLoopBody(a->expression.get(), written, opaque);
+        } else if (auto *aa = dynamic_cast<ArrayAssignmentNode *>(node)) {
+            scanLoopBody(aa->index.get(), written, opaque);
+            scanLoopBody(aa->value.get(), written, opaque);
+        } else if (auto *i = dynamic_cast<IfStmtNode *>(node)) {
+            scanLoopBody(i->condition.get(), written, opaque);
+            scanLoopBody(i->thenStatement.get(), written, opaque);
+            scanLoopBody(i->elseStatement.get(), written, opaque);
+        } else if (auto *w = dynamic_cast<WhileStmtNode *>(node)) {
+            scanLoopBody(w->condition.get(), written, opaque);
+            scanLoopBody(w->statement.get(), written, opaque);
+        } else if (auto *r = dynamic_cast<RepeatStmtNode *>(node)) {
+            for (auto &st : r->statements)
+                scanLoopBody(st.get(), written, opaque);
+            scanLoopBody(r->condition.get(), written, opaque);
+        } else if (auto *f = dynamic_cast<ForStmtNode *>(node)) {
+            written.insert(lc(f->variable));
+            scanLoopBody(f->startValue.get(), written, opaque);
+            scanLoopBody(f->endValue.get(), written, opaque);
+            scanLoopBody(f->statement.get(), written, opaque);
+        } else if (auto *cs = dynamic_cast<CaseStmtNode *>(node)) {
+            scanLoopBody(cs->expression.get(), written, opaque);
+            for (auto &br : cs->branches)
+                scanLoopBody(br->statement.get(), written, opaque);
+            scanLoopBody(cs->elseStatement.get(), written, opaque);
+        } else if (auto *pc = dynamic_cast<ProcCallNode *>(node)) {
+            callArgs(pc->name, pc->arguments);
+        } else if (auto *fc = dynamic_cast<FuncCallNode *>(node)) {
+            callArgs(fc->name, fc->arguments);
+        } else if (auto *e = dynamic_cast<ExitNode *>(node)) {
+            scanLoopBody(e->expr.get(), written, opaque);
+        } else if (auto *b = dynamic_cast<BinaryOpNode *>(node)) {
+            scanLoopBody(b->left.get(), written, opaque);
+            scanLoopBody(b->right.get(), written, opaque);
+        } else if (auto *u = dynamic_cast<UnaryOpNode *>(node)) {
+            scanLoopBody(u->operand.get(), written, opaque);
+        } else if (auto *ac = dynamic_cast<ArrayAccessNode *>(node)) {
+            scanLoopBody(ac->base.get(), written, opaque);
+            scanLoopBody(ac->index.get(), written, opaque);
+        } else if (auto *fa = dynamic_cast<FieldAccessNode *>(node)) {
+            scanLoopBody(fa->recordExpr.get(), written, opaque);
+        } else if (auto *pd = dynamic_cast<PointerDerefNode *>(node)) {
+            scanLoopBody(pd->pointer.get(), written, opaque);
+        } else if (auto *ad = dynamic_cast<AddressOfNode *>(node)) {
+            if (auto *v = dynamic_cast<VariableNode *>(ad->operand.get()))
+                written.insert(lc(v->name));
+            else
+                scanLoopBody(ad->operand.get(), written, opaque);
+        } else if (auto *sl = dynamic_cast<SetLiteralNode *>(node)) {
+            for (auto &el : sl->elements)
+                scanLoopBody(el.get(), written, opaque);
+        } else if (dynamic_cast<WithStmtNode *>(node) || dynamic_cast<LabelStmtNode *>(node) ||
+                   dynamic_cast<GotoStmtNode *>(node)) {
+            opaque = true;
+        }
+    }
+
+    bool CodeGenVisitor::stringAppendParts(AssignmentNode &node, std::string &var, std::vector<ASTNode *> &parts) {
+        auto *target = dynamic_cast<VariableNode *>(node.variable.get());
+        if (!target || !isStringVar(target->name))
+            return false;
+        if (currentParamLocations.count(target->name))
+            return false;
+        if (!currentFunctionName.empty() && (target->name == currentFunctionName || lc(target->name) == "result"))
+            return false;
+
+        // s + e1 + e2 parses as ((s + e1) + e2): walk down the left spine
+        std::vector<ASTNode *> reversed;
+        ASTNode *n = node.expression.get();
+        while (auto *b = dynamic_cast<BinaryOpNode *>(n)) {
+            if (b->operator_ != BinaryOpNode::PLUS)
+                return false;
+            reversed.push_back(b->right.get());
+            n = b->left.get();
+        }
+        auto *first = dynamic_cast<VariableNode *>(n);
+        if (!first || lc(first->name) != lc(target->name) || reversed.empty())
+            return false;
+
+        for (ASTNode *part : reversed) {
+            auto *fc = dynamic_cast<FuncCallNode *>(part);
+            if (fc && lc(fc->name) == "inttostr" && fc->arguments.size() == 1 &&
+                getExpressionType(fc->arguments[0].get()) == VarType::INT)
+                continue;
+            VarType t = getExpressionType(part);
+            if (t != VarType::STRING && t != VarType::PTR)
+                return false;
+        }
+        var = target->name;
+        parts.assign(reversed.rbegin(), reversed.rend());
+        return true;
+    }
+
+    void CodeGenVisitor::scanStringAppends(ASTNode *node, std::unordered_map<std::string, int> &refs, std::map<std::string, StringBuilderVar> &appends, bool &exits) {
+        if (!node || exits)
+            return;
+        auto scan = [&](ASTNode *n) { scanStringAppends(n, refs, appends, exits); };
+
+        if (auto *v = dynamic_cast<VariableNode *>(node)) {
+            // A bare routine name is a call scanLoopBody does not see
+            if (declaredProcs.count(findMangledFuncName(v->name, true)) || declaredFuncs.count(findMangledFuncName(v->name, false)))
+                exits = true;
+            ++refs[lc(v->name)];
+        } else if (auto *c = dynamic_cast<CompoundStmtNode *>(node)) {
+            for (auto &st : c->statements)
+                scan(st.get());
+        } else if (auto *a = dynamic_cast<AssignmentNode *>(node)) {
+            std::string var;
+            std::vector<ASTNode *> parts;
+            if (stringAppendParts(*a, var, parts)) {
+                auto &sb = appends[lc(var)];
+                sb.name = var;
+                ++sb.appends;
+            }
+            scan(a->variable.get());
+            scan(a->expression.get());
+        } else if (auto *aa = dynamic_cast<ArrayAssignmentNode *>(node)) {
+            ++refs[lc(aa->arrayName)];
+            scan(aa->index.get());
+            scan(aa->value.get());
+        } else if (auto *i = dynamic_cast<IfStmtNode *>(node)) {
+            scan(i->condition.get());
+            scan(i->thenStatement.get());
+            scan(i->elseStatement.get());
+        } else if (auto *w = dynamic_cast<WhileStmtNode *>(node)) {
+            scan(w->condition.get());
+            scan(w->statement.get());
+        } else if (auto *r = dynamic_cast<RepeatStmtNode *>(node)) {
+            for (auto &st : r->statements)
+                scan(st.get());
+            scan(r->condition.get());
+        } else if (auto *f = dynamic_cast<ForStmtNode *>(node)) {
+            ++refs[lc(f->variable)];
+            scan(f->startValue.get());
+            scan(f->endValue.get());
+            scan(f->statement.get());
+        } else if (auto *cs = dynamic_cast<CaseStmtNode *>(node)) {
+            scan(cs->expression.get());
+            for (auto &br : cs->branches)
+                scan(br->statement.get());
+            scan(cs->elseStatement.get());
+        } else if (auto *pc = dynamic_cast<ProcCallNode *>(node)) {
+            for (auto &arg : pc->arguments)
+                scan(arg.get());
+        } else if (auto *fc = dynamic_cast<FuncCallNode *>(node)) {
+            for (auto &arg : fc->arguments)
+                scan(arg.get());
+        } else if (auto *b = dynamic_cast<BinaryOpNode *>(node)) {
+            scan(b->left.get());
+            scan(b->right.get());
+        } else if (auto *u = dynamic_cast<UnaryOpNode *>(node)) {
+            scan(u->operand.get());
+        } else if (auto *ac = dynamic_cast<ArrayAccessNode *>(node)) {
+            scan(ac->base.get());
+            scan(ac->index.get());
+        } else if (auto *fa = dynamic_cast<FieldAccessNode *>(node)) {
+            scan(fa->recordExpr.get());
+        } else if (auto *pd = dynamic_cast<PointerDerefNode *>(node)) {
+            scan(pd->pointer.get());
+        } else if (auto *ad = dynamic_cast<AddressOfNode *>(node)) {
+            scan(ad->operand.get());
+        } else if (auto *sl = dynamic_cast<SetLiteralNode *>(node)) {
+            for (auto &el : sl->elements)
+                scan(el.get());
+        } else if (dynamic_cast<ExitNode *>(node) || dynamic_cast<WithStmtNode *>(node) ||
+                   dynamic_cast<LabelStmtNode *>(node) || dynamic_cast<GotoStmtNode *>(node)) {
+            exits = true;
+        }
+    }
+
+    std::vector<std::string> CodeGenVisitor::beginStringBuilders(const std::vector<ASTNode *> &loop) {
+        std::unordered_set<std::string> written;
+        bool opaque = false;
+        std::unordered_map<std::string, int> refs;
+        std::map<std::string, StringBuilderVar> appends;
+        bool exits = false;
+        for (ASTNode *n : loop) {
+            scanLoopBody(n, written, opaque);
+            scanStringAppends(n, refs, appends, exits);
+        }
+        std::vector<std::string> started;
+        if (opaque || exits)
+            return started;
+        for (auto &[key, sb] : appends) {
+            // Each append reads and writes the variable once; anything more is another use
+            if (refs[key] != 2 * sb.appends || stringBuilders.count(key))
+                continue;
+            int slot = newSlotFor("__sb_" + std::to_string(nextStringBuilder++));
+            setSlotType(slot, VarType::PTR);
+            sb.handle = slotVar(slot);
+            usedModules.insert("string");
+            emit_invoke("sb_new", {});
+            emit("return " + sb.handle);
+            emit_invoke("sb_append", {sb.handle, variableStorage(sb.name)});
+            stringBuilders[key] = sb;
+            started.push_back(key);
+        }
+        return started;
+    }
+
+    void CodeGenVisitor::endStringBuilders(const std::vector<std::string> &started) {
+        for (const auto &key : started) {
+            auto it = stringBuilders.find(key);
+            std::string result = allocTempPtr();
+            emit_invoke("sb_finish", {it->second.handle});
+            emit("return " + result);
+            markAllocatedPtr(result);
+            std::string storage = variableStorage(it->second.name);
+            emit2("mov", storage, result);
+            recordLocation(it->second.name, {ValueLocation::MEMORY, storage});
+            escapedTempPtrs.insert(result);
+            stringBuilders.erase(it);
+        }
+    }
+
+    /** @brief Element type of a static array the std kernels handle: INT, DOUBLE, or UNKNOWN */
+    static VarType kernelElementType(const ArrayInfo &info, const std::string &resolvedType) {
+        if (info.isDynamic || info.elementIsArray || info.elementSize != 8)
+            return VarType::UNKNOWN;
+        if (resolvedType == "real")
+            return VarType::DOUBLE;
+        if (resolvedType == "integer" || resolvedType == "boolean" || resolvedType == "char")
+            return VarType::INT;
+        return VarType::UNKNOWN;
+    }
+
+    void CodeGenVisitor::emitArrayCopy(const std::string &dest, const std::string &src, int count) {
+        usedModules.insert("std");
+        emit_invoke("copy_strided", {dest, "0", "1", src, "0", "1", std::to_string(count)});
+    }
+
+    bool CodeGenVisitor::emitWholeArrayAssignment(const std::string &dest, ASTNode *src) {
+        auto *srcVar = dynamic_cast<VariableNode *>(src);
+        if (!srcVar)
+            return false;
+        auto findArray = [&](const std::string &name) -> ArrayInfo * {
+            auto it = arrayInfo.find(findMangledArrayName(name));
+            if (it == arrayInfo.end())
+                it = arrayInfo.find(name);
+            return it != arrayInfo.end() ? &it->second : nullptr;
+        };
+        ArrayInfo *to = findArray(dest);
+        ArrayInfo *from = findArray(srcVar->name);
+        if (!to || !from || to->size != from->size)
+            return false;
+        VarType kind = kernelElementType(*to, resolveTypeName(lc(to->elementType)));
+        if (kind == VarType::UNKNOWN || kind != kernelElementType(*from, resolveTypeName(lc(from->elementType))))
+            return false;
+        std::string dstBase = ensurePtrBase(storageSymbolFor(findMangledArrayName(dest)));
+        std::string srcBase = ensurePtrBase(storageSymbolFor(findMangledArrayName(srcVar->name)));
+        emitArrayCopy(dstBase, srcBase, to->size);
+        return true;
+    }
+
+    bool CodeGenVisitor::lowerArrayLoop(ForStmtNode &node) {
+        if (node.isDownto)
+            return false;
+        ASTNode *body = node.statement.get();
+        if (auto *block = dynamic_cast<CompoundStmtNode *>(body))
+            body = block->statements.size() == 1 ? block->statements[0].get() : nullptr;
+        auto *assign = dynamic_cast<AssignmentNode *>(body);
+        if (!assign)
+            return false;
+
+        // Both bounds must be exact constants (lower and upper bound agree)
+        auto exact = [&](ASTNode *n) -> std::optional<long long> {
+            auto lo = boundOf(n, false);
+            auto hi = boundOf(n, true);
+            if (!lo || !hi || !lo->lengthOf.empty() || !hi->lengthOf.empty() || lo->offset != hi->offset)
+                return std::nullopt;
+            return lo->offset;
+        };
+        auto first = exact(node.startValue.get());
+        auto last = exact(node.endValue.get());
+        if (!first || !last || *first > *last)
+            return false;
+
+        std::string loopVar = lc(node.variable);
+        // a[i] over [first..last] with a static kernel-friendly array; returns its info
+        auto element = [&](ASTNode *n, std::string &arrName) -> ArrayInfo * {
+            auto *acc = dynamic_cast<ArrayAccessNode *>(n);
+            if (!acc)
+                return nullptr;
+            auto *base = dynamic_cast<VariableNode *>(acc->base.get());
+            auto *index = dynamic_cast<VariableNode *>(acc->index.get());
+            if (!base || !index || lc(index->name) != loopVar || lc(base->name) == loopVar)
+                return nullptr;
+            auto it = arrayInfo.find(findMangledArrayName(base->name));
+            if (it == arrayInfo.end())
+                it = arrayInfo.find(base->name);
+            if (it == arrayInfo.end() || it->second.isDynamic)
+                return nullptr;
+            if (*first < it->second.lowerBound || *last > it->second.upperBound)
+                return nullptr;
+            arrName = base->name;
+            return &it->second;
+        };
+        // A scalar variable of this routine (not the loop variable, a function result or a parameter)
+        auto plainScalar = [&](const std::string &name) {
+            std::string key = lc(name);
+            if (key == loopVar || key == "result" || name == currentFunctionName || currentParamLocations.count(name))
+                return false;
+            if (!varSlot.count(findMangledName(name)))
+                return false;
+            VarType t = getVarType(name);
+            return t == VarType::INT || t == VarType::DOUBLE || t == VarType::BOOL || t == VarType::CHAR;
+        };
+
+        std::string arrName;
+        std::string fn;
+        ArrayInfo *info = nullptr;
+        ASTNode *value = nullptr;
+        std::string sumVar;
+        if ((info = element(assign->variable.get(), arrName))) {
+            // a[i] := v
+            VarType kind = kernelElementType(*info, resolveTypeName(lc(info->elementType)));
+            value = assign->expression.get();
+            bool invariant = false;
+            if (auto *num = dynamic_cast<NumberNode *>(value))
+                invariant = kind == VarType::DOUBLE || !num->isReal;
+            else if (dynamic_cast<BooleanNode *>(value))
+                invariant = kind == VarType::INT;
+            else if (auto *var = dynamic_cast<VariableNode *>(value)) {
+                std::string constValue;
+                bool isConst = tryGetConstNumeric(var->name, constValue);
+                invariant = lc(var->name) != lc(arrName) && (isConst || plainScalar(var->name)) &&
+                            (kind == VarType::DOUBLE || getExpressionType(value) != VarType::DOUBLE);
+            }
+            if (kind == VarType::UNKNOWN || !invariant)
+                return false;
+            fn = kind == VarType::DOUBLE ? "fill_f64" : "fill_i64";
+        } else if (auto *target = dynamic_cast<VariableNode *>(assign->variable.get())) {
+            // s := s + a[i] or s := a[i] + s, integers only
+            auto *add = dynamic_cast<BinaryOpNode *>(assign->expression.get());
+            if (!add || add->operator_ != BinaryOpNode::PLUS || !plainScalar(target->name) || getVarType(target->name) != VarType::INT)
+                return false;
+            auto isTarget = [&](ASTNode *n) {
+                auto *v = dynamic_cast<VariableNode *>(n);
+                return v && lc(v->name) == lc(target->name);
+            };
+            ASTNode *other = isTarget(add->left.get()) ? add->right.get() : isTarget(add->right.get()) ? add->left.get() : nullptr;
+            if (!other || !(info = element(other, arrName)))
+                return false;
+            if (lc(arrName) == lc(target->name) || kernelElementType(*info, resolveTypeName(lc(info->elementType))) != VarType::INT)
+                return false;
+            fn = "sum_i64";
+            sumVar = target->name;
+        } else {
+            return false;
+        }
+
+        usedModules.insert("std");
+        std::string base = ensurePtrBase(storageSymbolFor(findMangledArrayName(arrName)));
+        std::string start = std::to_string(*first - info->lowerBound);
+        std::string count = std::to_string(*last - *first + 1);
+        if (sumVar.empty()) {
+            std::string v = eval(value);
+            if (fn == "fill_f64" && !isFloatReg(v) && getExpressionType(value) != VarType::DOUBLE) {
+                std::string f = allocFloatReg();
+                emit2("mov", f, v);
+                if (isReg(v) && !isParmReg(v))
+                    freeReg(v);
+                v = f;
+            }
+            emit_invoke(fn, {base, start, count, v});
+            if (isReg(v) && !isParmReg(v))
+                freeReg(v);
+        } else {
+            std::string total = allocReg();
+            emit_invoke(fn, {base, start, count});
+            emit("return " + total);
+            std::string storage = variableStorage(sumVar);
+            emit2("add", storage, total);
+            recordLocation(sumVar, {ValueLocation::MEMORY, storage});
+            freeReg(total);
+        }
+        if (isReg(base) && !isParmReg(base))
+            freeReg(base);
+
+        // Leave the loop variable where the loop would have
+        int slot = newSlotFor(mangleVariableName(node.variable));
+        emit2("mov", slotVar(slot), std::to_string(*last + 1));
+        return true;
+    }
+
     void CodeGenVisitor::visit(BinaryOpNode &node) {
         auto isStrLike = [&](VarType v) { return v == VarType::STRING || v == VarType::PTR; };
         VarType lt = getExpressionType(node.left.get());
@@ -1607,6 +2040,11 @@ namespace pascal {
         loopContinueLabels.push_back(continueLabel);
         loopEndLabels.push_back(endLabel);
 
+        std::vector<ASTNode *> loop;
+        for (auto &stmt : node.statements)
+            loop.push_back(stmt.get());
+        loop.push_back(node.condition.get());
+        auto builders = beginStringBuilders(loop);
         emitLabel(startLabel);
         for (auto &stmt : node.statements)
             if (stmt)
@@ -1618,6 +2056,7 @@ namespace pascal {
         if (isReg(condResult) && !isParmReg(condResult))
             freeReg(condResult);
         emitLabel(endLabel);
+        endStringBuilders(builders);
         loopContinueLabels.pop_back();
         loopEndLabels.pop_back();
     }
@@ -1878,7 +2317,11 @@ namespace pascal {
             }
 
 #ifdef MXVM_BOUNDS_CHECK
-            if (info->isDynamic) {
+            std::string plainName;
+            if (auto *baseVar = dynamic_cast<VariableNode *>(arr->base.get()))
+                plainName = baseVar->name;
+            bool checkIndex = needsBoundsCheck(arr->index.get(), *info, plainName, arr->rangeChecks);
+            if (checkIndex && info->isDynamic) {
                 std::string arrName = getArrayNameFromBase(arr->base.get());
                 std::string mangled = findMangledArrayName(arrName);
                 auto lenIt = dynArrayLenSlot.find(mangled);
@@ -1886,7 +2329,7 @@ namespace pascal {
                     lenIt = dynArrayLenSlot.find(arrName);
                 if (lenIt != dynArrayLenSlot.end())
                     emitDynArrayBoundsCheck(idx, slotVar(lenIt->second));
-            } else {
+            } else if (checkIndex) {
                 emitArrayBoundsCheck(idx, info->lowerBound, info->upperBound);
             }
 #endif
@@ -2050,7 +2493,7 @@ namespace pascal {
 
         std::string varName = varPtr->name;
 
-        // Set assignment: copy 256 bytes from RHS set to LHS set
+        // Set assignment: copy the 256 slots of the RHS set to the LHS set
         if (setVars.count(lc(varName)) || setVars.count(lc(findMangledName(varName)))) {
             std::string rhs = eval(node.expression.get());
             std::string mangled = findMangledName(varName);
@@ -2063,26 +2506,34 @@ namespace pascal {
 
             std::string srcBase = ensurePtrBase(rhs);
             std::string dstBase = ensurePtrBase(destBase);
-            std::string idx = allocReg();
-            std::string byteVal = allocReg();
-            emit2("mov", idx, "0");
-            std::string loopLbl = newLabel("set_copy");
-            std::string endLbl = newLabel("set_copy_end");
-            emitLabel(loopLbl);
-            emit2("cmp", idx, "256");
-            emit1("jge", endLbl);
-            emit4("load", byteVal, srcBase, idx, "8");
-            emit4("store", byteVal, dstBase, idx, "8");
-            emit2("add", idx, "1");
-            emit1("jmp", loopLbl);
-            emitLabel(endLbl);
-            freeReg(idx);
-            freeReg(byteVal);
+            emitArrayCopy(dstBase, srcBase, 256);
             if (isReg(rhs) && !isParmReg(rhs))
                 freeReg(rhs);
             return;
         }
 
+        // Inside a loop that builds varName: append the new parts instead of copying
+        if (stringBuilders.count(lc(varName))) {
+            std::string var;
+            std::vector<ASTNode *> parts;
+            if (stringAppendParts(node, var, parts)) {
+                const std::string &handle = stringBuilders[lc(varName)].handle;
+                for (ASTNode *part : parts) {
+                    auto *fc = dynamic_cast<FuncCallNode *>(part);
+                    bool isInt = fc && lc(fc->name) == "inttostr";
+                    std::string value = eval(isInt ? fc->arguments[0].get() : part);
+                    emit_invoke(isInt ? "sb_append_int" : "sb_append", {handle, value});
+                    if (isReg(value) && !isParmReg(value))
+                        freeReg(value);
+                }
+                return;
+            }
+        }
+
+        // Whole-array assignment copies the elements; a plain mov would alias the two arrays
+        if (emitWholeArrayAssignment(varName, node.expression.get()))
+            return;
+
         std::string rhs;
         VarType varType = getVarType(varName);
         if ((varType == VarType::CHAR || varType == VarType::INT)) {
@@ -2169,11 +2620,12 @@ namespace pascal {
         }
 
 #ifdef MXVM_BOUNDS_CHECK
-        if (info.isDynamic) {
+        bool checkIndex = needsBoundsCheck(node.index.get(), info, node.arrayName, true);
+        if (checkIndex && info.isDynamic) {
             auto lenIt = dynArrayLenSlot.find(node.arrayName);
             if (lenIt != dynArrayLenSlot.end())
                 emitDynArrayBoundsCheck(index, slotVar(lenIt->second));
-        } else {
+        } else if (checkIndex) {
             emitArrayBoundsCheck(index, info.lowerBound, info.upperBound);
         }
 #endif
@@ -2621,24 +3073,10 @@ namespace pascal {
     }
 
     void CodeGenVisitor::visit(SetLiteralNode &node) {
-        // Build a runtime set value: allocate 256 bytes, zero-fill, then set each element
+        // Build a runtime set value: allocate 256 zeroed slots, then set each element
         std::string setPtr = allocTempPtr();
         emit3("alloc", setPtr, "8", "256");
 
-        // Zero-fill
-        std::string loopIdx = allocReg();
-        std::string loopStart = newLabel("SET_LIT_INIT");
-        std::string loopEnd = newLabel("SET_LIT_INIT_END");
-        emit2("mov", loopIdx, "0");
-        emitLabel(loopStart);
-        emit2("cmp", loopIdx, "256");
-        emit1("jge", loopEnd);
-        emit4("store", "0", setPtr, loopIdx, "8");
-        emit2("add", loopIdx, "1");
-        emit1("jmp", loopStart);
-        emitLabel(loopEnd);
-        freeReg(loopIdx);
-
         // Set each element
         for (auto &elem : node.elements) {
             std::string elemVal = eval(elem.get());
@@ -322,6 +322,7 @@ namespace pascal {
       public:
         std::unique_ptr<ASTNode> base;   ///< array expression
         std::unique_ptr<ASTNode> index;  ///< index expression
+        bool rangeChecks = true;         ///< false inside a {$R-} region
 
         ArrayAccessNode(std::unique_ptr<ASTNode> base, std::unique_ptr<ASTNode> index)
             : base(std::move(base)), index(std::move(index)) {}
@@ -0,0 +1,92 @@
+/**
+ * @file build.hpp
+ * @brief Multi-unit build support — shared unit interfaces and parallel compilation
+ * @author Jared Bruni
+ */
+#ifndef __BUILD_H_
+#define __BUILD_H_
+
+#include "ast.hpp"
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace pascal {
+
+    /**
+     * @brief Strip Pascal comments ({ }, (* *) and //) from source text
+     * @param text Pascal source
+     * @param keepRangeDirectives Keep {$R-}/{$R+} directives, rewritten as
+     *        `{ R- }`/`{ R+ }` for PascalParser to pick up
+     * @return Source with comments removed (string literals preserved)
+     */
+    std::string removeComments(const std::string &text, bool keepRangeDirectives = false);
+
+    /**
+     * @brief Collect every unit/module named in the uses clauses of a source
+     * @param source Pascal source with comments removed
+     * @return Names in order of appearance
+     */
+    std::vector<std::string> extractPasUses(const std::string &source);
+
+    /** @brief Parsed interface of a unit, shared read-only between importers */
+    struct UnitInterface {
+        std::string path;              ///< unit source or .mxi file the interface was loaded from
+        uint64_t hash = 0;             ///< sourceHash() of the unit source (0 if unknown)
+        std::unique_ptr<UnitNode> ast; ///< parsed unit, or null if the source was missing or invalid
+    };
+
+    /**
+     * @brief Thread-safe cache that loads each unit interface at most once
+     *
+     * A precompiled interface file (<unit>.mxi) is used when its hash matches
+     * the unit source; otherwise the source is parsed. Importers borrow the
+     * interface declarations for the duration of their own code generation;
+     * the cache keeps ownership.
+     */
+    class UnitCache {
+      public:
+        /**
+         * @brief Look up (parsing on first use) the unit @p dep next to an importer
+         * @param dir Directory of the importing source, with trailing separator
+         * @param dep Unit name as written in the uses clause
+         */
+        const UnitInterface &get(const std::string &dir, const std::string &dep);
+
+      private:
+        struct Entry {
+            std::once_flag once;
+            UnitInterface unit;
+        };
+        std::mutex mutex;
+        std::unordered_map<std::string, std::unique_ptr<Entry>> entries;
+    };
+
+    /** @brief One source file to compile in a multi-file build */
+    struct BuildJob {
+        std::string source;            ///< input .pas file
+        std::string output;            ///< output .mxvm file
+        std::string name;              ///< declared program/unit name
+        std::vector<std::string> uses; ///< names from the uses clauses
+    };
+
+    /**
+     * @brief Compile jobs in dependency order on a pool of worker threads
+     *
+     * A job starts only after every other job it uses has finished, so
+     * independent units compile concurrently. Jobs depending on a failed job
+     * are skipped.
+     * @param jobs Files to compile
+     * @param threads Maximum number of concurrent compiles (at least 1)
+     * @param compile Callback compiling a single job
+     * @return true if every job compiled successfully
+     */
+    bool buildAll(const std::vector<BuildJob> &jobs, unsigned int threads, const std::function<bool(const BuildJob &)> &compile);
+
+} // namespace pascal
+
+#endif
@@ -0,0 +1,34 @@
+/**
+ * @file fold.hpp
+ * @brief AST-level constant folding and dead-branch elimination
+ * @author Jared Bruni
+ */
+#ifndef __FOLD_H_
+#define __FOLD_H_
+
+#include "ast.hpp"
+
+namespace pascal {
+
+    /**
+     * @brief Fold constant subexpressions in a program before code generation
+     *
+     * Integer arithmetic and string concatenation on constants collapse to
+     * literals, and the algebraic identities x+0, 0+x, x-0, x*1, 1*x and
+     * x div 1 are removed. When the condition of an if or while is a known
+     * constant (for example `const DEBUG = false`), the dead branch is
+     * dropped. Constants resolve through nested scopes and `with` blocks.
+     * Record fields and local declarations shadow outer constants.
+     * @param program Parsed program, rewritten in place
+     */
+    void foldConstants(ProgramNode &program);
+
+    /**
+     * @brief Fold constant subexpressions in a unit before code generation
+     * @param unit Parsed unit, rewritten in place
+     */
+    void foldConstants(UnitNode &unit);
+
+} // namespace pascal
+
+#endif
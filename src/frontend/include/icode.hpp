@@ -11,6 +11,7 @@
 #include <cstdlib>
 #include <map>
 #include <memory>
+#include <optional>
 #include <set>
 #include <sstream>
 #include <stdexcept>
@@ -21,6 +22,11 @@
 #include <vector>
 #define MXVM_BOUNDS_CHECK
 
+namespace mxvm {
+    class Parser;
+    class Program;
+} // namespace mxvm
+
 namespace pascal {
 
     /**
@@ -168,6 +174,19 @@ namespace pascal {
         VarType getReturnType(const std::string &funcName) const override;
     };
 
+    /** @brief Built-in handler for the collections module (smap_*, imap_*, pmap_*, vec_*, heap_*) */
+    class CollectionsFunctionHandler : public BuiltinFunctionHandler {
+      public:
+        bool canHandle(const std::string &funcName) const override;
+        void generate(CodeGenVisitor &visitor, const std::string &funcName, const std::vector<std::unique_ptr<ASTNode>> &arguments) override;
+        bool generateWithResult(CodeGenVisitor &visitor, const std::string &funcName, const std::vector<std::unique_ptr<ASTNode>> &arguments) override;
+        VarType getReturnType(const std::string &funcName) const override;
+
+      private:
+        /** @brief Check the argument count, evaluate the arguments and emit the invoke; returns the argument slots */
+        std::vector<std::string> emitCall(CodeGenVisitor &visitor, const std::string &funcName, const std::vector<std::unique_ptr<ASTNode>> &arguments);
+    };
+
     /**
      * @brief AST visitor that generates MXVM intermediate code
      *
@@ -188,6 +207,8 @@ namespace pascal {
         std::unordered_set<std::string> importedUnitNames;  ///< names of units imported via uses clause
         std::unordered_map<std::string, ArrayInfo> importedArrayInfo;  ///< array metadata for imported unit vars
         std::unordered_map<std::string, VarType> importedVarTypes;  ///< var types for imported unit vars
+        std::vector<ASTNode *> importedDecls;       ///< imported unit function/procedure/type declarations, owned by the UnitCache
+        BlockNode *programBlock = nullptr;          ///< top-level block of the program being generated
         std::vector<std::string> globalArrays;
         std::unordered_map<std::string, std::vector<std::string>> functionScopedArrays;
         std::vector<std::string> scopeHierarchy;
@@ -885,6 +906,7 @@ namespace pascal {
         friend class SDLFunctionHandler;
         friend class StringFunctionHandler;
         friend class FileFunctionHandler;
+        friend class CollectionsFunctionHandler;
 
         BuiltinFunctionRegistry builtinRegistry; ///< registry of built-in function handlers
 
@@ -961,17 +983,29 @@ namespace pascal {
             }
         }
 
+        /**
+         * @brief Register a function, procedure or type declaration from a dependency unit
+         *
+         * The declaration is processed as if it followed the unit's interface
+         * declarations (units) or the program's top-level declarations
+         * (programs). It is not owned and must outlive code generation.
+         */
+        void registerImportedDecl(ASTNode *decl) {
+            importedDecls.push_back(decl);
+        }
+
         /** @brief Construct and initialise registers and float register pool */
         CodeGenVisitor();
         virtual ~CodeGenVisitor() = default;
 
-        /** @brief Register all built-in function handlers (IO, Std, SDL, String) */
+        /** @brief Register all built-in function handlers (IO, Std, SDL, String, File, Collections) */
         void initializeBuiltins() {
             builtinRegistry.registerHandler(std::make_unique<IOFunctionHandler>());
             builtinRegistry.registerHandler(std::make_unique<StdFunctionHandler>());
             builtinRegistry.registerHandler(std::make_unique<SDLFunctionHandler>());
             builtinRegistry.registerHandler(std::make_unique<StringFunctionHandler>());
             builtinRegistry.registerHandler(std::make_unique<FileFunctionHandler>());
+            builtinRegistry.registerHandler(std::make_unique<CollectionsFunctionHandler>());
         }
 
         std::string name = "App"; ///< program name emitted in the output header
@@ -1314,45 +1348,27 @@ namespace pascal {
             return true;
         }
 
+        /** @brief One declaration of the data section */
+        struct DataDecl {
+            std::string type;   ///< int, float, string or ptr
+            std::string name;   ///< variable name
+            std::string value;  ///< initial value; string text is unescaped
+            size_t buffer = 0;  ///< size of a `string name, size` buffer, 0 for an initialised variable
+        };
+
         /**
-         * @brief Write the complete MXVM program to a stream
-         * @param out Output stream
+         * @brief Data section in output order
          *
-         * Emits the program header, module section, data section (registers,
-         * variables, string literals, real constants), and code section.
+         * Registers, temporary pointers, real constants, string literals and
+         * format strings, then the program's variables.
          */
-        void writeTo(std::ostream &out) const {
-            out << (isUnit ? "object " : "program ") << name << " {\n";
-
-            // section object (unit/object dependencies)
-            if (!objectDeps.empty()) {
-                out << "\tsection object {\n\t\t";
-                bool first = true;
-                for (const auto &dep : objectDeps) {
-                    if (!first)
-                        out << ", ";
-                    out << dep;
-                    first = false;
-                }
-                out << "\n\t}\n";
-            }
-
-            out << "\tsection module {\n ";
-            bool first = true;
-            for (const auto &mod : usedModules) {
-                if (!first)
-                    out << ",\n";
-                out << "\t\t" << mod;
-                first = false;
-            }
-            out << "\n\t}\n";
-            out << "\tsection data {\n";
-
+        std::vector<DataDecl> dataSection() const {
+            std::vector<DataDecl> data;
             for (const auto &reg : registers)
-                out << "\t\tint " << reg << " = 0\n";
+                data.push_back({"int", reg, "0"});
 
             for (size_t i = 0; i < floatRegisters.size(); ++i) {
-                out << "\t\tfloat " << floatRegisters[i] << " = 0.0\n";
+                data.push_back({"float", floatRegisters[i], "0.0"});
             }
 
             {
@@ -1365,26 +1381,26 @@ namespace pascal {
                     for (const auto &t : kv.second)
                         temps.insert(t);
                 for (const auto &tempPtr : temps)
-                    out << "\t\tptr " << tempPtr << " = null\n";
+                    data.push_back({"ptr", tempPtr, "null"});
             }
 
             for (const auto &constant : realConstants)
-                out << "\t\tfloat " << constant.first << " = " << constant.second << "\n";
+                data.push_back({"float", constant.first, constant.second});
             if (needsEmptyString)
-                out << "\t\tstring empty_str = \"\"\n";
+                data.push_back({"string", "empty_str", ""});
             for (const auto &pair : stringLiterals)
-                out << "\t\tstring " << pair.second << " = " << escapeStringForMxvm(pair.first) << "\n";
+                data.push_back({"string", pair.second, pair.first});
             if (usedStrings.count("fmt_int"))
-                out << "\t\tstring fmt_int = \"%lld \"\n";
+                data.push_back({"string", "fmt_int", "%lld "});
             if (usedStrings.count("fmt_str"))
-                out << "\t\tstring fmt_str = \"%s \"\n";
+                data.push_back({"string", "fmt_str", "%s "});
             if (usedStrings.count("fmt_chr"))
-                out << "\t\tstring fmt_chr = \"%c \"\n";
+                data.push_back({"string", "fmt_chr", "%c "});
             if (usedStrings.count("fmt_float"))
-                out << "\t\tstring fmt_float = \"%.6f \"\n";
+                data.push_back({"string", "fmt_float", "%.6f "});
             if (usedStrings.count("newline"))
-                out << "\t\tstring newline = \"\\n\"\n";
-            out << "\t\tstring input_buffer, 256\n";
+                data.push_back({"string", "newline", "\n"});
+            data.push_back({"string", "input_buffer", "", 256});
             for (int i = 0; i < nextSlot; ++i) {
                 if (!isRegisterSlot(i) && !isTempVar(slotVar(i)) && !isPtrReg(slotVar(i))) {
                     auto it = slotToType.find(i);
@@ -1392,49 +1408,118 @@ namespace pascal {
                         std::string varName = slotVar(i);
                         auto bufIt = bufferStringVars.find(varName);
                         if (bufIt != bufferStringVars.end())
-                            out << "\t\tstring " << varName << ", " << bufIt->second << "\n";
+                            data.push_back({"string", varName, "", bufIt->second});
                         else {
                         auto constIt = constInitialValues.find(varName);
                         if (constIt != constInitialValues.end())
-                            out << "\t\t" << constIt->second.first << " " << varName << " = " << constIt->second.second << "\n";
+                            data.push_back({constIt->second.first, varName, constIt->second.second});
                         else {
                             if (it->second == VarType::STRING)
-                                out << "\t\tstring " << varName << " = \"\"\n";
+                                data.push_back({"string", varName, ""});
                             else if (it->second == VarType::PTR)
-                                out << "\t\tptr " << varName << " = null\n";
+                                data.push_back({"ptr", varName, "null"});
                             else if (it->second == VarType::CHAR)
-                                out << "\t\tint " << varName << " = 0\n";
+                                data.push_back({"int", varName, "0"});
                             else if (it->second == VarType::DOUBLE)
-                                out << "\t\tfloat " << varName << " = 0.0\n";
+                                data.push_back({"float", varName, "0.0"});
                             else
-                                out << "\t\tint " << varName << " = 0\n";
+                                data.push_back({"int", varName, "0"});
                         }
                         }
                     } else
-                        out << "\t\tint " << slotVar(i) << " = 0\n";
+                        data.push_back({"int", slotVar(i), "0"});
                 }
             }
-            out << "\t}\n";
-            out << "\tsection code {\n";
+            return data;
+        }
+
+        /**
+         * @brief Code section lines as written to the output
+         *
+         * Labels are indented by one tab and end with ':', instructions are
+         * indented by two and read `op a, b, ...`. A program starts with its
+         * units' PROC_UNIT_INIT calls and the prolog.
+         */
+        std::vector<std::string> codeSection() const {
+            std::vector<std::string> code;
             if (!isUnit) {
-                out << "\tstart:\n";
+                code.push_back("\tstart:");
                 // Call each dependency unit's UNIT_INIT to allocate their arrays
                 for (const auto &dep : objectDeps) {
-                    out << "\t\tcall " << dep << ".PROC_UNIT_INIT\n";
+                    code.push_back("\t\tcall " + dep + ".PROC_UNIT_INIT");
                 }
                 for (auto &s : prolog)
-                    out << "\t\t" << s << "\n";
+                    code.push_back("\t\t" + s);
             }
             for (auto &s : instructions) {
                 if (endsWithColon(s))
-                    out << "\t" << s << "\n";
+                    code.push_back("\t" + s);
                 else
-                    out << "\t\t" << s << "\n";
+                    code.push_back("\t\t" + s);
             }
+            return code;
+        }
+
+        /**
+         * @brief Write the complete MXVM program to a stream
+         * @param out Output stream
+         *
+         * Emits the program header, module section, data section (registers,
+         * variables, string literals, real constants), and code section.
+         */
+        void writeTo(std::ostream &out) const {
+            out << (isUnit ? "object " : "program ") << name << " {\n";
+
+            // section object (unit/object dependencies)
+            if (!objectDeps.empty()) {
+                out << "\tsection object {\n\t\t";
+                bool first = true;
+                for (const auto &dep : objectDeps) {
+                    if (!first)
+                        out << ", ";
+                    out << dep;
+                    first = false;
+                }
+                out << "\n\t}\n";
+            }
+
+            out << "\tsection module {\n ";
+            bool first = true;
+            for (const auto &mod : usedModules) {
+                if (!first)
+                    out << ",\n";
+                out << "\t\t" << mod;
+                first = false;
+            }
+            out << "\n\t}\n";
+            out << "\tsection data {\n";
+            for (const auto &decl : dataSection()) {
+                if (decl.buffer != 0)
+                    out << "\t\tstring " << decl.name << ", " << decl.buffer << "\n";
+                else if (decl.type == "string")
+                    out << "\t\tstring " << decl.name << " = " << escapeStringForMxvm(decl.value) << "\n";
+                else
+                    out << "\t\t" << decl.type << " " << decl.name << " = " << decl.value << "\n";
+            }
+            out << "\t}\n";
+            out << "\tsection code {\n";
+            for (const auto &line : codeSection())
+                out << line << "\n";
             out << "\t}\n";
             out << "}\n";
         }
 
+        /**
+         * @brief Build the program straight into an interpreter Program
+         *
+         * Produces the sections writeTo() prints, with the code passed through
+         * mxvmOptCode(), without formatting MXVM source for the VM to scan and
+         * parse again. Defined in run.cpp.
+         * @param loader Parser that loads the program's modules and unit objects
+         * @param program Program to fill
+         */
+        void emitTo(mxvm::Parser &loader, std::unique_ptr<mxvm::Program> &program) const;
+
         /** @name AST Visitor Overrides
          *  Code generation for each Pascal AST node type.
          *  @{ */
@@ -1611,6 +1696,193 @@ namespace pascal {
 #endif
         }
 
+        /** @brief A provable integer bound, optionally relative to a dynamic array's runtime length */
+        struct IndexBound {
+            std::string lengthOf; ///< mangled dynamic array name ("" for a compile-time constant)
+            long long offset = 0; ///< the constant, or the offset from length(lengthOf)
+        };
+
+        /** @brief Known [lo..hi] range of a for-loop variable while its body runs */
+        struct LoopRange {
+            std::string var; ///< lower-cased loop variable name
+            IndexBound lo;   ///< smallest value the variable takes
+            IndexBound hi;   ///< largest value the variable takes
+        };
+
+        std::vector<LoopRange> loopRanges; ///< ranges of the enclosing for loops, innermost last
+
+        /**
+         * @brief Collect the variables a loop body may change
+         * @param node    Statement or expression to scan
+         * @param written Receives lower-cased names assigned, passed bare to a call, or address-taken
+         * @param opaque  Set when the body calls user routines or uses with/goto/labels
+         */
+        void scanLoopBody(ASTNode *node, std::unordered_set<std::string> &written, bool &opaque);
+
+        /** @brief A string variable accumulated in a string builder while a loop runs */
+        struct StringBuilderVar {
+            std::string name;   ///< variable as written in the source
+            std::string handle; ///< ptr holding the sb_new handle
+            int appends = 0;    ///< `name := name + ...` statements in the loop
+        };
+
+        std::unordered_map<std::string, StringBuilderVar> stringBuilders; ///< active builders by lower-cased variable name
+        int nextStringBuilder = 0;
+
+        /**
+         * @brief Match `s := s + e1 + ... + ek` on a string variable
+         * @param node  Assignment to inspect
+         * @param var   Receives the variable name
+         * @param parts Receives e1..ek
+         * @return true if every part can go to sb_append (strings) or sb_append_int (IntToStr of an integer)
+         */
+        bool stringAppendParts(AssignmentNode &node, std::string &var, std::vector<ASTNode *> &parts);
+
+        /**
+         * @brief Count variable references and append statements in a loop
+         * @param node    Statement or expression to scan
+         * @param refs    Receives the number of references to each lower-cased name
+         * @param appends Receives the append statements per lower-cased name
+         * @param exits   Set when the loop can be left other than through its end label
+         */
+        void scanStringAppends(ASTNode *node, std::unordered_map<std::string, int> &refs, std::map<std::string, StringBuilderVar> &appends, bool &exits);
+
+        /**
+         * @brief Start string builders for the variables a loop only appends to
+         * @param loop Body statements and condition of the loop
+         * @return Lower-cased names of the builders started, for endStringBuilders
+         *
+         * A variable qualifies when every reference to it in the loop is an
+         * append statement, the loop calls no user routines and cannot exit
+         * the routine. Emits sb_new and an append of the current value; the
+         * appends themselves are emitted by the AssignmentNode visitor.
+         */
+        std::vector<std::string> beginStringBuilders(const std::vector<ASTNode *> &loop);
+
+        /** @brief Emit sb_finish into each variable after its loop's end label */
+        void endStringBuilders(const std::vector<std::string> &started);
+
+        /** @brief Emit a std copy_strided of @p count contiguous 8-byte elements from @p src to @p dest */
+        void emitArrayCopy(const std::string &dest, const std::string &src, int count);
+
+        /**
+         * @brief Emit `dest := src` for two static arrays of the same shape as one element copy
+         * @return false (emitting nothing) unless both are static arrays of 8-byte integer or real elements
+         */
+        bool emitWholeArrayAssignment(const std::string &dest, ASTNode *src);
+
+        /**
+         * @brief Replace a for loop with one std kernel call when its body is a recognised idiom
+         * @return false (emitting nothing) when the loop does not qualify
+         *
+         * Recognises `a[i] := v` (fill_i64/fill_f64) and `s := s + a[i]` on
+         * integers (sum_i64), where the bounds are constants inside the
+         * array's declared range and v does not depend on the loop. Float
+         * sums are left alone, since the kernel adds in a different order.
+         */
+        bool lowerArrayLoop(ForStmtNode &node);
+
+        /** @brief The data symbol holding a named variable */
+        std::string variableStorage(const std::string &name) {
+            std::string mangled = findMangledName(name);
+            auto it = varSlot.find(mangled);
+            return it != varSlot.end() ? slotVar(it->second) : mangled;
+        }
+
+        /**
+         * @brief Compute a lower or upper bound for an integer expression
+         * @param node  Expression to bound
+         * @param upper true for the upper bound, false for the lower bound
+         * @return The bound, or nullopt when it cannot be proven
+         *
+         * Understands integer literals and constants, low/high/length of
+         * arrays, enclosing for-loop variables, and +/- by a constant.
+         */
+        std::optional<IndexBound> boundOf(ASTNode *node, bool upper) {
+            if (auto num = dynamic_cast<NumberNode *>(node)) {
+                if (num->isReal || !isIntegerLiteral(num->value) || num->value.size() > 18)
+                    return std::nullopt;
+                return IndexBound{"", std::stoll(num->value)};
+            }
+            if (auto var = dynamic_cast<VariableNode *>(node)) {
+                std::string v;
+                if (tryGetConstNumeric(var->name, v)) {
+                    if (!isIntegerLiteral(v) || v.size() > 18)
+                        return std::nullopt;
+                    return IndexBound{"", std::stoll(v)};
+                }
+                std::string key = lc(var->name);
+                for (auto it = loopRanges.rbegin(); it != loopRanges.rend(); ++it)
+                    if (it->var == key)
+                        return upper ? it->hi : it->lo;
+                return std::nullopt;
+            }
+            if (auto call = dynamic_cast<FuncCallNode *>(node)) {
+                std::string fn = lc(call->name);
+                if ((fn != "low" && fn != "high" && fn != "length") || call->arguments.size() != 1)
+                    return std::nullopt;
+                auto arg = dynamic_cast<VariableNode *>(call->arguments[0].get());
+                if (!arg)
+                    return std::nullopt;
+                std::string mangled = findMangledArrayName(arg->name);
+                auto it = arrayInfo.find(mangled);
+                if (it == arrayInfo.end())
+                    return std::nullopt;
+                const ArrayInfo &info = it->second;
+                if (fn == "low")
+                    return IndexBound{"", info.isDynamic ? 0 : info.lowerBound};
+                if (!info.isDynamic)
+                    return IndexBound{"", fn == "high" ? info.upperBound : info.size};
+                return IndexBound{mangled, fn == "high" ? -1 : 0};
+            }
+            if (auto un = dynamic_cast<UnaryOpNode *>(node)) {
+                if (un->operator_ != UnaryOpNode::MINUS)
+                    return std::nullopt;
+                auto b = boundOf(un->operand.get(), !upper);
+                if (!b || !b->lengthOf.empty())
+                    return std::nullopt;
+                return IndexBound{"", -b->offset};
+            }
+            if (auto bin = dynamic_cast<BinaryOpNode *>(node)) {
+                if (bin->operator_ == BinaryOpNode::PLUS) {
+                    auto l = boundOf(bin->left.get(), upper);
+                    auto r = boundOf(bin->right.get(), upper);
+                    if (!l || !r || (!l->lengthOf.empty() && !r->lengthOf.empty()))
+                        return std::nullopt;
+                    return IndexBound{l->lengthOf.empty() ? r->lengthOf : l->lengthOf, l->offset + r->offset};
+                }
+                if (bin->operator_ == BinaryOpNode::MINUS) {
+                    auto l = boundOf(bin->left.get(), upper);
+                    auto r = boundOf(bin->right.get(), !upper);
+                    if (!l || !r || !r->lengthOf.empty())
+                        return std::nullopt;
+                    return IndexBound{l->lengthOf, l->offset - r->offset};
+                }
+            }
+            return std::nullopt;
+        }
+
+        /**
+         * @brief Decide whether an array store still needs its bounds check
+         * @param index    Index expression
+         * @param info     Array metadata the check would use
+         * @param arrName  Array name as written (empty if the base is not a plain variable)
+         * @param enabled  false inside a {$R-} region
+         * @return false when checks are off or the index is provably in range
+         */
+        bool needsBoundsCheck(ASTNode *index, const ArrayInfo &info, const std::string &arrName, bool enabled) {
+            if (!enabled)
+                return false;
+            auto lo = boundOf(index, false);
+            auto hi = boundOf(index, true);
+            if (!lo || !hi || !lo->lengthOf.empty())
+                return true;
+            if (!info.isDynamic)
+                return !(hi->lengthOf.empty() && lo->offset >= info.lowerBound && hi->offset <= info.upperBound);
+            // Dynamic arrays are 0-based; index <= length(a) - 1 must refer to this very array
+            return arrName.empty() || lo->offset < 0 || hi->lengthOf != findMangledArrayName(arrName) || hi->offset > -1;
+        }
+
         VarType getExpressionType(ASTNode *node) {
             if (dynamic_cast<NilNode *>(node))
                 return VarType::PTR;
@@ -2252,6 +2524,8 @@ namespace pascal {
     };
 
     std::string mxvmOpt(const std::string &text);
+    /** @brief The code section passes of mxvmOpt(), applied to lines as returned by CodeGenVisitor::codeSection() */
+    std::vector<std::string> mxvmOptCode(const std::vector<std::string> &code);
 
 } // namespace pascal
 #endif
@@ -0,0 +1,63 @@
+/**
+ * @file interface.hpp
+ * @brief Precompiled unit interface (.mxi) files for the Pascal frontend
+ * @author Jared Bruni
+ */
+#ifndef __INTERFACE_H_
+#define __INTERFACE_H_
+
+#include "ast.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace pascal {
+
+    /**
+     * @brief 64-bit FNV-1a hash of a unit source, used to detect changes
+     * @param text Raw source text
+     */
+    uint64_t sourceHash(const std::string &text);
+
+    /** @brief Header of a unit interface file */
+    struct InterfaceHeader {
+        uint64_t hash = 0;                                   ///< hash of the unit source the file was built from
+        std::string compiler;                                ///< mxx version and code generation settings that produced the unit
+        std::string name;                                    ///< declared unit name
+        std::vector<std::pair<std::string, uint64_t>> deps;  ///< imported units and their source hashes at compile time
+    };
+
+    /**
+     * @brief Encode the interface declarations of a unit
+     *
+     * Only declaration-level nodes (signatures, var/const/type declarations
+     * and constant expressions) can be encoded.
+     * @param decls Interface declarations of the unit
+     * @param payload Receives the encoded declarations
+     * @return false if a declaration cannot be represented
+     */
+    bool encodeInterfaceDecls(const std::vector<std::unique_ptr<ASTNode>> &decls, std::string &payload);
+
+    /**
+     * @brief Write an interface file
+     * @param path Output path (normally next to the unit's .mxvm)
+     * @param header Source hash, unit name and dependency hashes
+     * @param payload Declarations from encodeInterfaceDecls()
+     * @return true on success
+     */
+    bool writeUnitInterface(const std::string &path, const InterfaceHeader &header, const std::string &payload);
+
+    /**
+     * @brief Read an interface file
+     * @param path Interface file path
+     * @param header Receives the header
+     * @param unit If non-null, receives a UnitNode holding the decoded interface declarations
+     * @return false if the file is missing, malformed or from another format version
+     */
+    bool readUnitInterface(const std::string &path, InterfaceHeader &header, std::unique_ptr<UnitNode> *unit = nullptr);
+
+} // namespace pascal
+
+#endif
@@ -135,7 +135,10 @@ namespace pascal {
         mxx::TPValidator validator; ///< semantic validator
 
       private:
-        /** @brief Remove {brace} comments from the token stream */
+        std::vector<std::pair<size_t, bool>> rangeDirectives; ///< {$R±} directives: (first token index, enabled)
+        /** @brief Whether range checks are enabled at the current token ({$R-} turns them off) */
+        bool rangeChecksEnabled() const;
+        /** @brief Remove {brace} comments from the token stream, recording `{ R± }` directives */
         void removeBraceComments();
         /** @brief Report a parse error with the given message */
         void error(const std::string &message);
@@ -0,0 +1,40 @@
+/**
+ * @file run.hpp
+ * @brief In-memory handoff of generated MXVM code to the interpreter (mxx --run)
+ * @author Jared Bruni
+ */
+#ifndef __RUN_H_
+#define __RUN_H_
+
+#include <string>
+#include <vector>
+
+namespace pascal {
+
+    class CodeGenVisitor;
+
+    /** @brief Interpreter settings used when running a compiled program directly */
+    struct RunOptions {
+        std::string module_path = "/usr/local/lib";                    ///< directory containing modules/<name>/libmxvm_<name>.so
+        std::string include_path = "/usr/local/include/mxvm/modules"; ///< directory containing module .mxvm interfaces
+        std::string object_path = ".";                                ///< directory containing compiled unit objects
+        std::vector<std::string> argv;                                 ///< arguments passed to the running program
+        bool only_test = false;                                        ///< build the program but do not execute it
+    };
+
+    /**
+     * @brief Execute a program straight from the code generator
+     *
+     * The visitor fills an mxvm::Program through CodeGenVisitor::emitTo(), so
+     * no MXVM source is formatted, written or scanned. Modules and unit objects
+     * are loaded from the paths in @p options as mxvmc would load them.
+     * @param filename Name used for diagnostics (normally the Pascal input)
+     * @param code Code generator that has visited the program
+     * @param options Module/include/object paths and program arguments
+     * @return Program exit code, or EXIT_FAILURE on error
+     */
+    int runProgram(const std::string &filename, const CodeGenVisitor &code, const RunOptions &options);
+
+} // namespace pascal
+
+#endif
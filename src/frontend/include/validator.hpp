@@ -8,9 +8,11 @@
 
 #include "scanner/scanner.hpp"
 #include "scanner/types.hpp"
+#include <functional>
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 namespace mxx {
 
@@ -24,6 +26,15 @@ namespace mxx {
         std::unordered_set<std::string> params;  ///< parameter names
     };
 
+    /** @brief Names exported by the interface section of a unit */
+    struct UnitSymbols {
+        std::vector<std::string> procs;  ///< procedure names
+        std::vector<std::string> funcs;  ///< function names
+        std::vector<std::string> consts; ///< constant names
+        std::vector<std::string> vars;   ///< variable names
+        std::vector<std::string> types;  ///< type names
+    };
+
     /**
      * @brief Semantic validator for Pascal programs
      *
@@ -46,6 +57,14 @@ namespace mxx {
          */
         bool validate(const std::string &name);
 
+        /**
+         * @brief Optional source of unit interface names
+         *
+         * Called with the unit name and the importer's directory. When it
+         * returns true the unit's source is not scanned.
+         */
+        std::function<bool(const std::string &unit, const std::string &dir, UnitSymbols &symbols)> unitResolver;
+
       private:
         std::unordered_map<std::string, std::unordered_set<std::string>> recordFieldScopesByType; ///< field names per record type
         std::string currentRecordTypeName; ///< name of record type currently being parsed
@@ -0,0 +1,501 @@
+/**
+ * @file interface.cpp
+ * @brief Precompiled unit interface (.mxi) files — binary encoding of interface declarations
+ * @author Jared Bruni
+ */
+#include "interface.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+namespace pascal {
+
+    namespace {
+        constexpr char MAGIC[4] = {'M', 'X', 'I', 'F'};
+        constexpr uint32_t FORMAT_VERSION = 2;
+
+        /** @brief Node kinds that may appear in a unit interface */
+        enum class NodeTag : uint8_t {
+            Null = 0,
+            FuncDecl,
+            ProcDecl,
+            Parameter,
+            VarDecl,
+            ConstDecl,
+            TypeDecl,
+            TypeAlias,
+            ArrayTypeDecl,
+            RecordDecl,
+            RecordType,
+            EnumTypeDecl,
+            ArrayType,
+            SimpleType,
+            PointerType,
+            SetType,
+            Number,
+            String,
+            Boolean,
+            Nil,
+            Variable,
+            BinaryOp,
+            UnaryOp,
+            FuncCall,
+            SetLiteral,
+            FieldAccess,
+            ArrayAccess
+        };
+
+        /** @brief Thrown while encoding a node that has no interface representation */
+        struct Unsupported {};
+
+        class Writer {
+          public:
+            std::string out;
+
+            void u8(uint8_t v) { out.push_back(static_cast<char>(v)); }
+            void u32(uint32_t v) {
+                for (int i = 0; i < 4; ++i)
+                    u8(static_cast<uint8_t>(v >> (i * 8)));
+            }
+            void u64(uint64_t v) {
+                for (int i = 0; i < 8; ++i)
+                    u8(static_cast<uint8_t>(v >> (i * 8)));
+            }
+            void str(const std::string &s) {
+                u32(static_cast<uint32_t>(s.size()));
+                out += s;
+            }
+            void strings(const std::vector<std::string> &v) {
+                u32(static_cast<uint32_t>(v.size()));
+                for (const auto &s : v)
+                    str(s);
+            }
+            void nodes(const std::vector<std::unique_ptr<ASTNode>> &v) {
+                u32(static_cast<uint32_t>(v.size()));
+                for (const auto &n : v)
+                    node(n.get());
+            }
+
+            void node(const ASTNode *n) {
+                if (!n) {
+                    u8(static_cast<uint8_t>(NodeTag::Null));
+                    return;
+                }
+                if (auto *fd = dynamic_cast<const FuncDeclNode *>(n)) {
+                    if (fd->block)
+                        throw Unsupported{};
+                    tag(NodeTag::FuncDecl, n);
+                    str(fd->name);
+                    nodes(fd->parameters);
+                    str(fd->returnType);
+                } else if (auto *pd = dynamic_cast<const ProcDeclNode *>(n)) {
+                    if (pd->block)
+                        throw Unsupported{};
+                    tag(NodeTag::ProcDecl, n);
+                    str(pd->name);
+                    nodes(pd->parameters);
+                } else if (auto *pn = dynamic_cast<const ParameterNode *>(n)) {
+                    tag(NodeTag::Parameter, n);
+                    strings(pn->identifiers);
+                    str(pn->type);
+                    u8(pn->isVar ? 1 : 0);
+                } else if (auto *vd = dynamic_cast<const VarDeclNode *>(n)) {
+                    tag(NodeTag::VarDecl, n);
+                    strings(vd->identifiers);
+                    if (std::holds_alternative<std::string>(vd->type)) {
+                        u8(0);
+                        str(std::get<std::string>(vd->type));
+                    } else {
+                        u8(1);
+                        node(std::get<std::unique_ptr<ASTNode>>(vd->type).get());
+                    }
+                    nodes(vd->initializers);
+                } else if (auto *cd = dynamic_cast<const ConstDeclNode *>(n)) {
+                    tag(NodeTag::ConstDecl, n);
+                    u32(static_cast<uint32_t>(cd->assignments.size()));
+                    for (const auto &a : cd->assignments) {
+                        str(a->identifier);
+                        node(a->value.get());
+                    }
+                } else if (auto *td = dynamic_cast<const TypeDeclNode *>(n)) {
+                    tag(NodeTag::TypeDecl, n);
+                    nodes(td->typeDeclarations);
+                } else if (auto *ta = dynamic_cast<const TypeAliasNode *>(n)) {
+                    tag(NodeTag::TypeAlias, n);
+                    str(ta->typeName);
+                    str(ta->baseType);
+                } else if (auto *atd = dynamic_cast<const ArrayTypeDeclarationNode *>(n)) {
+                    tag(NodeTag::ArrayTypeDecl, n);
+                    str(atd->name);
+                    node(atd->arrayType.get());
+                } else if (auto *rd = dynamic_cast<const RecordDeclarationNode *>(n)) {
+                    tag(NodeTag::RecordDecl, n);
+                    str(rd->name);
+                    node(rd->recordType.get());
+                } else if (auto *rt = dynamic_cast<const RecordTypeNode *>(n)) {
+                    tag(NodeTag::RecordType, n);
+                    nodes(rt->fields);
+                    str(rt->variantTagName);
+                    str(rt->variantTagType);
+                    u32(static_cast<uint32_t>(rt->variantArms.size()));
+                    for (const auto &arm : rt->variantArms) {
+                        nodes(arm.caseLabels);
+                        nodes(arm.fields);
+                    }
+                } else if (auto *ed = dynamic_cast<const EnumTypeDeclNode *>(n)) {
+                    tag(NodeTag::EnumTypeDecl, n);
+                    str(ed->typeName);
+                    strings(ed->values);
+                } else if (auto *at = dynamic_cast<const ArrayTypeNode *>(n)) {
+                    tag(NodeTag::ArrayType, n);
+                    node(at->elementType.get());
+                    node(at->lowerBound.get());
+                    node(at->upperBound.get());
+                } else if (auto *st = dynamic_cast<const SimpleTypeNode *>(n)) {
+                    tag(NodeTag::SimpleType, n);
+                    str(st->typeName);
+                } else if (auto *pt = dynamic_cast<const PointerTypeNode *>(n)) {
+                    tag(NodeTag::PointerType, n);
+                    str(pt->baseTypeName);
+                } else if (auto *set = dynamic_cast<const SetTypeNode *>(n)) {
+                    tag(NodeTag::SetType, n);
+                    str(set->baseTypeName);
+                } else if (auto *num = dynamic_cast<const NumberNode *>(n)) {
+                    tag(NodeTag::Number, n);
+                    str(num->value);
+                    u8(num->isInteger ? 1 : 0);
+                    u8(num->isReal ? 1 : 0);
+                } else if (auto *s = dynamic_cast<const StringNode *>(n)) {
+                    tag(NodeTag::String, n);
+                    str(s->value);
+                } else if (auto *b = dynamic_cast<const BooleanNode *>(n)) {
+                    tag(NodeTag::Boolean, n);
+                    u8(b->value ? 1 : 0);
+                } else if (dynamic_cast<const NilNode *>(n)) {
+                    tag(NodeTag::Nil, n);
+                } else if (auto *v = dynamic_cast<const VariableNode *>(n)) {
+                    tag(NodeTag::Variable, n);
+                    str(v->name);
+                } else if (auto *bin = dynamic_cast<const BinaryOpNode *>(n)) {
+                    tag(NodeTag::BinaryOp, n);
+                    u8(static_cast<uint8_t>(bin->operator_));
+                    node(bin->left.get());
+                    node(bin->right.get());
+                } else if (auto *un = dynamic_cast<const UnaryOpNode *>(n)) {
+                    tag(NodeTag::UnaryOp, n);
+                    u8(static_cast<uint8_t>(un->operator_));
+                    node(un->operand.get());
+                } else if (auto *fc = dynamic_cast<const FuncCallNode *>(n)) {
+                    tag(NodeTag::FuncCall, n);
+                    str(fc->name);
+                    nodes(fc->arguments);
+                } else if (auto *sl = dynamic_cast<const SetLiteralNode *>(n)) {
+                    tag(NodeTag::SetLiteral, n);
+                    nodes(sl->elements);
+                } else if (auto *fa = dynamic_cast<const FieldAccessNode *>(n)) {
+                    tag(NodeTag::FieldAccess, n);
+                    node(fa->recordExpr.get());
+                    str(fa->fieldName);
+                } else if (auto *aa = dynamic_cast<const ArrayAccessNode *>(n)) {
+                    tag(NodeTag::ArrayAccess, n);
+                    node(aa->base.get());
+                    node(aa->index.get());
+                } else {
+                    throw Unsupported{};
+                }
+            }
+
+          private:
+            void tag(NodeTag t, const ASTNode *n) {
+                u8(static_cast<uint8_t>(t));
+                u32(static_cast<uint32_t>(n->getLineNumber()));
+            }
+        };
+
+        class Reader {
+          public:
+            explicit Reader(const std::string &data) : data(data) {}
+
+            bool done() const { return pos == data.size(); }
+
+            uint8_t u8() {
+                if (pos >= data.size())
+                    throw std::runtime_error("truncated interface file");
+                return static_cast<uint8_t>(data[pos++]);
+            }
+            uint32_t u32() {
+                uint32_t v = 0;
+                for (int i = 0; i < 4; ++i)
+                    v |= static_cast<uint32_t>(u8()) << (i * 8);
+                return v;
+            }
+            uint64_t u64() {
+                uint64_t v = 0;
+                for (int i = 0; i < 8; ++i)
+                    v |= static_cast<uint64_t>(u8()) << (i * 8);
+                return v;
+            }
+            std::string str() {
+                uint32_t len = u32();
+                if (len > data.size() - pos)
+                    throw std::runtime_error("truncated interface file");
+                std::string s = data.substr(pos, len);
+                pos += len;
+                return s;
+            }
+            std::vector<std::string> strings() {
+                std::vector<std::string> v(count());
+                for (auto &s : v)
+                    s = str();
+                return v;
+            }
+            std::vector<std::unique_ptr<ASTNode>> nodes() {
+                std::vector<std::unique_ptr<ASTNode>> v(count());
+                for (auto &n : v)
+                    n = node();
+                return v;
+            }
+
+            template <typename T>
+            std::unique_ptr<T> nodeAs() {
+                auto n = node();
+                if (!n)
+                    return nullptr;
+                auto *p = dynamic_cast<T *>(n.get());
+                if (!p)
+                    throw std::runtime_error("unexpected node in interface file");
+                n.release();
+                return std::unique_ptr<T>(p);
+            }
+
+            std::unique_ptr<ASTNode> node() {
+                auto t = static_cast<NodeTag>(u8());
+                if (t == NodeTag::Null)
+                    return nullptr;
+                int line = static_cast<int>(u32());
+                std::unique_ptr<ASTNode> n;
+                switch (t) {
+                case NodeTag::FuncDecl: {
+                    std::string name = str();
+                    auto params = nodes();
+                    std::string rt = str();
+                    n = std::make_unique<FuncDeclNode>(name, std::move(params), rt, nullptr);
+                } break;
+                case NodeTag::ProcDecl: {
+                    std::string name = str();
+                    auto params = nodes();
+                    n = std::make_unique<ProcDeclNode>(name, std::move(params), nullptr);
+                } break;
+                case NodeTag::Parameter: {
+                    auto ids = strings();
+                    std::string type = str();
+                    bool isVar = u8() != 0;
+                    n = std::make_unique<ParameterNode>(std::move(ids), type, isVar);
+                } break;
+                case NodeTag::VarDecl: {
+                    auto ids = strings();
+                    std::variant<std::string, std::unique_ptr<ASTNode>> type;
+                    if (u8() == 0)
+                        type = str();
+                    else
+                        type = node();
+                    auto init = nodes();
+                    n = std::make_unique<VarDeclNode>(std::move(ids), std::move(type), std::move(init));
+                } break;
+                case NodeTag::ConstDecl: {
+                    std::vector<std::unique_ptr<ConstDeclNode::ConstAssignment>> assigns(count());
+                    for (auto &a : assigns) {
+                        std::string id = str();
+                        a = std::make_unique<ConstDeclNode::ConstAssignment>(id, node());
+                    }
+                    n = std::make_unique<ConstDeclNode>(std::move(assigns));
+                } break;
+                case NodeTag::TypeDecl:
+                    n = std::make_unique<TypeDeclNode>(nodes());
+                    break;
+                case NodeTag::TypeAlias: {
+                    std::string name = str();
+                    std::string base = str();
+                    n = std::make_unique<TypeAliasNode>(name, base);
+                } break;
+                case NodeTag::ArrayTypeDecl: {
+                    std::string name = str();
+                    n = std::make_unique<ArrayTypeDeclarationNode>(name, nodeAs<ArrayTypeNode>());
+                } break;
+                case NodeTag::RecordDecl: {
+                    std::string name = str();
+                    n = std::make_unique<RecordDeclarationNode>(name, nodeAs<RecordTypeNode>());
+                } break;
+                case NodeTag::RecordType: {
+                    auto rt = std::make_unique<RecordTypeNode>(nodes());
+                    rt->variantTagName = str();
+                    rt->variantTagType = str();
+                    rt->variantArms.resize(count());
+                    for (auto &arm : rt->variantArms) {
+                        arm.caseLabels = nodes();
+                        arm.fields = nodes();
+                    }
+                    n = std::move(rt);
+                } break;
+                case NodeTag::EnumTypeDecl: {
+                    std::string name = str();
+                    n = std::make_unique<EnumTypeDeclNode>(name, strings());
+                } break;
+                case NodeTag::ArrayType: {
+                    auto elem = node();
+                    auto lower = node();
+                    auto upper = node();
+                    n = std::make_unique<ArrayTypeNode>(std::move(elem), std::move(lower), std::move(upper));
+                } break;
+                case NodeTag::SimpleType:
+                    n = std::make_unique<SimpleTypeNode>(str());
+                    break;
+                case NodeTag::PointerType:
+                    n = std::make_unique<PointerTypeNode>(str());
+                    break;
+                case NodeTag::SetType:
+                    n = std::make_unique<SetTypeNode>(str());
+                    break;
+                case NodeTag::Number: {
+                    std::string value = str();
+                    bool isInteger = u8() != 0;
+                    bool isReal = u8() != 0;
+                    n = std::make_unique<NumberNode>(value, isInteger, isReal);
+                } break;
+                case NodeTag::String:
+                    n = std::make_unique<StringNode>(str());
+                    break;
+                case NodeTag::Boolean:
+                    n = std::make_unique<BooleanNode>(u8() != 0);
+                    break;
+                case NodeTag::Nil:
+                    n = std::make_unique<NilNode>();
+                    break;
+                case NodeTag::Variable:
+                    n = std::make_unique<VariableNode>(str());
+                    break;
+                case NodeTag::BinaryOp: {
+                    auto op = static_cast<BinaryOpNode::OpType>(u8());
+                    auto left = node();
+                    auto right = node();
+                    n = std::make_unique<BinaryOpNode>(std::move(left), op, std::move(right));
+                } break;
+                case NodeTag::UnaryOp: {
+                    auto op = static_cast<UnaryOpNode::Operator>(u8());
+                    n = std::make_unique<UnaryOpNode>(op, node());
+                } break;
+                case NodeTag::FuncCall: {
+                    std::string name = str();
+                    n = std::make_unique<FuncCallNode>(name, nodes());
+                } break;
+                case NodeTag::SetLiteral:
+                    n = std::make_unique<SetLiteralNode>(nodes());
+                    break;
+                case NodeTag::FieldAccess: {
+                    auto rec = node();
+                    n = std::make_unique<FieldAccessNode>(std::move(rec), str());
+                } break;
+                case NodeTag::ArrayAccess: {
+                    auto base = node();
+                    auto index = node();
+                    n = std::make_unique<ArrayAccessNode>(std::move(base), std::move(index));
+                } break;
+                default:
+                    throw std::runtime_error("unknown node in interface file");
+                }
+                n->setLineNumber(line);
+                return n;
+            }
+
+          private:
+            const std::string &data;
+            size_t pos = 0;
+
+            size_t count() {
+                uint32_t n = u32();
+                // every element takes at least one byte; reject corrupt counts early
+                if (n > data.size() - pos)
+                    throw std::runtime_error("corrupt interface file");
+                return n;
+            }
+        };
+    } // namespace
+
+    uint64_t sourceHash(const std::string &text) {
+        uint64_t h = 1469598103934665603ULL;
+        for (unsigned char c : text) {
+            h ^= c;
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    bool encodeInterfaceDecls(const std::vector<std::unique_ptr<ASTNode>> &decls, std::string &payload) {
+        try {
+            Writer w;
+            w.nodes(decls);
+            payload = std::move(w.out);
+            return true;
+        } catch (const Unsupported &) {
+            return false;
+        }
+    }
+
+    bool writeUnitInterface(const std::string &path, const InterfaceHeader &header, const std::string &payload) {
+        Writer w;
+        w.out.append(MAGIC, sizeof(MAGIC));
+        w.u32(FORMAT_VERSION);
+        w.u64(header.hash);
+        w.str(header.compiler);
+        w.str(header.name);
+        w.u32(static_cast<uint32_t>(header.deps.size()));
+        for (const auto &dep : header.deps) {
+            w.str(dep.first);
+            w.u64(dep.second);
+        }
+        w.out += payload;
+        std::ofstream file(path, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!file.is_open())
+            return false;
+        file.write(w.out.data(), static_cast<std::streamsize>(w.out.size()));
+        return static_cast<bool>(file);
+    }
+
+    bool readUnitInterface(const std::string &path, InterfaceHeader &header, std::unique_ptr<UnitNode> *unit) {
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.is_open())
+            return false;
+        std::ostringstream buf;
+        buf << file.rdbuf();
+        std::string data = buf.str();
+        if (data.size() < sizeof(MAGIC) || data.compare(0, sizeof(MAGIC), MAGIC, sizeof(MAGIC)) != 0)
+            return false;
+        try {
+            Reader r(data);
+            for (size_t i = 0; i < sizeof(MAGIC); ++i)
+                r.u8();
+            if (r.u32() != FORMAT_VERSION)
+                return false;
+            header.hash = r.u64();
+            header.compiler = r.str();
+            header.name = r.str();
+            header.deps.clear();
+            uint32_t deps = r.u32();
+            for (uint32_t i = 0; i < deps; ++i) {
+                std::string name = r.str();
+                header.deps.emplace_back(name, r.u64());
+            }
+            if (unit) {
+                auto node = std::make_unique<UnitNode>(header.name);
+                node->interfaceDecls = r.nodes();
+                if (!r.done())
+                    return false;
+                *unit = std::move(node);
+            }
+            return true;
+        } catch (const std::exception &) {
+            return false;
+        }
+    }
+
+} // namespace pascal
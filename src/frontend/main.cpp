@@ -3,87 +3,113 @@
  * @brief Pascal-to-MXVM compiler command-line entry point
  * @author Jared Bruni
  */
+#include "build.hpp"
+#include "fold.hpp"
 #include "icode.hpp"
+#include "interface.hpp"
 #include "parser.hpp"
+#include "run.hpp"
 #include <algorithm>
 #include <cstdlib>
+#include <filesystem>
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <thread>
 #include <unordered_set>
 #include "argz.hpp"
 #include "version_info.hpp"
 
 
 
-std::string removeComments(const std::string &text) {
-    std::ostringstream stream;
-    enum State {
-        CODE,
-        BRACE_COMMENT,
-        PAREN_COMMENT,
-        STRING
-    };
-    State state = CODE;
+// Output of compiling one source file
+struct CompileResult {
+    std::string code;                     // optimized MXVM code
+    bool isUnit = false;                  // true when the source is a unit
+    bool hasInterface = false;            // true when interfaceData holds encoded declarations
+    std::string interfaceData;            // encoded interface declarations (units only)
+    pascal::InterfaceHeader header;       // source hash, name and imported unit hashes
+};
 
-    for (size_t i = 0; i < text.length(); ++i) {
-        char c = text[i];
-        char next = (i + 1 < text.length()) ? text[i + 1] : '\0';
+static std::string sourceDir(const std::string &inputPath) {
+    std::string inputDir = inputPath.substr(0, inputPath.find_last_of("/\\") + 1);
+    if (inputDir.empty()) inputDir = "./";
+    return inputDir;
+}
 
-        switch (state) {
-        case CODE:
-            if (c == '{') {
-                state = BRACE_COMMENT;
-            } else if (c == '(' && next == '*') {
-                state = PAREN_COMMENT;
-                i++;
-            } else if (c == '\'') {
-                stream << c;
-                state = STRING;
-            } else if (c == '/' && next == '/') {
+// Register the interface of every non-native unit in 'uses' with the code
+// generator. Function, procedure and type declarations stay owned by 'units'
+// and are only referenced by the generator. The hash of each
+// imported unit is appended to 'deps'.
+static void importUnits(const std::string &inputPath, const std::vector<std::string> &uses, pascal::UnitCache &units,
+                        pascal::CodeGenVisitor &emiter,
+                        std::vector<std::pair<std::string, uint64_t>> &deps) {
+    std::string inputDir = sourceDir(inputPath);
 
-                while (i < text.length() && text[i] != '\n') {
-                    i++;
-                }
-                if (i < text.length()) {
-                    stream << '\n';
-                }
-            } else {
-                stream << c;
-            }
-            break;
+    static const std::unordered_set<std::string> nativeModules = {"io", "std", "string", "sdl", "strlib", "collections"};
+    for (const auto &dep : uses) {
+        if (nativeModules.count(dep)) continue;
 
-        case BRACE_COMMENT:
-            if (c == '}') {
-                state = CODE;
-            }
-            break;
+        // Unit source not available; user must ensure correct call signatures
+        const pascal::UnitInterface &unit = units.get(inputDir, dep);
+        deps.emplace_back(dep, unit.hash);
+        if (!unit.ast) continue;
 
-        case PAREN_COMMENT:
-            if (c == '*' && next == ')') {
-                state = CODE;
-                i++;
+        for (auto &decl : unit.ast->interfaceDecls) {
+            if (auto *fd = dynamic_cast<pascal::FuncDeclNode *>(decl.get()))
+                emiter.registerExternalFunc(fd->name, dep);
+            else if (auto *pd = dynamic_cast<pascal::ProcDeclNode *>(decl.get()))
+                emiter.registerExternalFunc(pd->name, dep);
+            else if (auto *vd = dynamic_cast<pascal::VarDeclNode *>(decl.get())) {
+                emiter.registerImportedVar(dep, *vd);
+                continue;
+            } else if (auto *cd = dynamic_cast<pascal::ConstDeclNode *>(decl.get())) {
+                emiter.registerImportedConst(dep, *cd);
+                continue;
             }
-            break;
+            emiter.registerImportedDecl(decl.get());
+        }
+    }
+}
 
-        case STRING:
-            stream << c;
-            if (c == '\'') {
-                if (next == '\'') {
-                    stream << next;
-                    i++;
-                } else {
-                    state = CODE;
-                }
+// Names a unit exports, for the validator of an importing source.
+static bool collectUnitSymbols(const pascal::UnitInterface &unit, mxx::UnitSymbols &symbols) {
+    if (!unit.ast)
+        return false;
+    for (const auto &decl : unit.ast->interfaceDecls) {
+        if (auto *fd = dynamic_cast<pascal::FuncDeclNode *>(decl.get())) {
+            symbols.funcs.push_back(fd->name);
+        } else if (auto *pd = dynamic_cast<pascal::ProcDeclNode *>(decl.get())) {
+            symbols.procs.push_back(pd->name);
+        } else if (auto *vd = dynamic_cast<pascal::VarDeclNode *>(decl.get())) {
+            symbols.vars.insert(symbols.vars.end(), vd->identifiers.begin(), vd->identifiers.end());
+        } else if (auto *cd = dynamic_cast<pascal::ConstDeclNode *>(decl.get())) {
+            for (const auto &a : cd->assignments)
+                symbols.consts.push_back(a->identifier);
+        } else if (auto *td = dynamic_cast<pascal::TypeDeclNode *>(decl.get())) {
+            for (const auto &t : td->typeDeclarations) {
+                if (auto *ta = dynamic_cast<pascal::TypeAliasNode *>(t.get()))
+                    symbols.types.push_back(ta->typeName);
+                else if (auto *rd = dynamic_cast<pascal::RecordDeclarationNode *>(t.get()))
+                    symbols.types.push_back(rd->name);
+                else if (auto *ad = dynamic_cast<pascal::ArrayTypeDeclarationNode *>(t.get()))
+                    symbols.types.push_back(ad->name);
+                else if (auto *ed = dynamic_cast<pascal::EnumTypeDeclNode *>(t.get()))
+                    symbols.types.push_back(ed->typeName);
             }
-            break;
         }
     }
+    return true;
+}
 
-    return stream.str();
+// Identifies the compiler that generated a unit. Any option that changes the
+// generated code must be added here so existing outputs are rebuilt.
+static std::string compilerStamp() {
+    return std::string("mxx ") + VERSION_INFO + " mxvmOpt";
 }
 
-static bool compileFile(const std::string &inputPath, const std::string &outputPath) {
+// Parse and validate a Pascal source file and run the code generator over it.
+static bool generateSource(const std::string &inputPath, pascal::CodeGenVisitor &emiter, CompileResult &result, pascal::UnitCache &units) {
     try {
         std::ifstream file(inputPath);
         if (!file.is_open()) {
@@ -99,134 +125,37 @@ static bool compileFile(const std::string &inputPath, const std::string &outputP
         }
 
         std::string source = buffer.str();
-        pascal::PascalParser parser(removeComments(source));
+        pascal::PascalParser parser(pascal::removeComments(source, true));
+        parser.validator.unitResolver = [&units](const std::string &unit, const std::string &dir, mxx::UnitSymbols &symbols) {
+            return collectUnitSymbols(units.get(dir, unit), symbols);
+        };
         if (!parser.validator.validate(inputPath)) {
             std::cerr << "mxx: validation failed: " << inputPath << "\n";
             return false;
         }
 
-        pascal::CodeGenVisitor emiter;
-
+        // For units and programs with a uses clause, register each
+        // dependency's interface (vars, arrays, consts, types, funcs)
+        result.header.hash = pascal::sourceHash(source);
+        result.header.compiler = compilerStamp();
         if (parser.isUnitSource()) {
             auto ast = parser.parseUnit();
             if (ast) {
-                // For units with uses clause, parse each dependency's interface
-                // to import their declarations (vars, arrays, consts, types, funcs)
-                std::string inputDir = inputPath.substr(0, inputPath.find_last_of("/\\") + 1);
-                if (inputDir.empty()) inputDir = "./";
-
-                static const std::unordered_set<std::string> nativeModules = {"io", "std", "string", "sdl", "strlib"};
-                for (const auto &dep : ast->uses) {
-                    if (nativeModules.count(dep)) continue;
-
-                    std::string unitFile = inputDir + dep + ".pas";
-                    std::ifstream uf(unitFile);
-                    if (!uf.is_open()) {
-                        std::string lowerDep = dep;
-                        std::transform(lowerDep.begin(), lowerDep.end(), lowerDep.begin(), ::tolower);
-                        unitFile = inputDir + lowerDep + ".pas";
-                        uf.open(unitFile);
-                    }
-                    if (uf.is_open()) {
-                        std::ostringstream ubuf;
-                        ubuf << uf.rdbuf();
-                        uf.close();
-                        try {
-                            pascal::PascalParser unitParser(removeComments(ubuf.str()));
-                            auto unitAst = unitParser.parseUnit();
-                            if (unitAst) {
-                                for (auto &decl : unitAst->interfaceDecls) {
-                                    if (auto *fd = dynamic_cast<pascal::FuncDeclNode *>(decl.get()))
-                                        emiter.registerExternalFunc(fd->name, dep);
-                                    else if (auto *pd = dynamic_cast<pascal::ProcDeclNode *>(decl.get()))
-                                        emiter.registerExternalFunc(pd->name, dep);
-                                    else if (auto *vd = dynamic_cast<pascal::VarDeclNode *>(decl.get())) {
-                                        emiter.registerImportedVar(dep, *vd);
-                                        continue;
-                                    } else if (auto *cd = dynamic_cast<pascal::ConstDeclNode *>(decl.get())) {
-                                        emiter.registerImportedConst(dep, *cd);
-                                        continue;
-                                    }
-                                    ast->interfaceDecls.push_back(std::move(decl));
-                                }
-                            }
-                        } catch (...) {
-                        }
-                    }
-                }
-
+                result.isUnit = true;
+                result.header.name = ast->name;
+                result.hasInterface = pascal::encodeInterfaceDecls(ast->interfaceDecls, result.interfaceData);
+                pascal::foldConstants(*ast);
+                importUnits(inputPath, ast->uses, units, emiter, result.header.deps);
                 emiter.generate(ast.get());
             }
         } else {
             auto ast = parser.parseProgram();
             if (ast) {
-                // For programs with unit imports, parse each unit's interface
-                // to register function/procedure signatures
-                std::string inputDir = inputPath.substr(0, inputPath.find_last_of("/\\") + 1);
-                if (inputDir.empty()) inputDir = "./";
-
-                for (const auto &dep : ast->uses) {
-                    // Skip native modules
-                    static const std::unordered_set<std::string> nativeModules = {"io", "std", "string", "sdl", "strlib"};
-                    if (nativeModules.count(dep)) continue;
-
-                    // Try to find and parse the unit's .pas file for interface declarations
-                    std::string unitFile = inputDir + dep + ".pas";
-                    std::ifstream uf(unitFile);
-                    if (!uf.is_open()) {
-                        // Try lowercase
-                        std::string lowerDep = dep;
-                        std::transform(lowerDep.begin(), lowerDep.end(), lowerDep.begin(), ::tolower);
-                        unitFile = inputDir + lowerDep + ".pas";
-                        uf.open(unitFile);
-                    }
-                    if (uf.is_open()) {
-                        std::ostringstream ubuf;
-                        ubuf << uf.rdbuf();
-                        uf.close();
-                        try {
-                            pascal::PascalParser unitParser(removeComments(ubuf.str()));
-                            auto unitAst = unitParser.parseUnit();
-                            if (unitAst) {
-                                // Register interface declarations as forward declarations in the main AST
-                                // and track which functions/procedures are external
-                                for (auto &decl : unitAst->interfaceDecls) {
-                                    if (auto *fd = dynamic_cast<pascal::FuncDeclNode *>(decl.get()))
-                                        emiter.registerExternalFunc(fd->name, dep);
-                                    else if (auto *pd = dynamic_cast<pascal::ProcDeclNode *>(decl.get()))
-                                        emiter.registerExternalFunc(pd->name, dep);
-                                    else if (auto *vd = dynamic_cast<pascal::VarDeclNode *>(decl.get())) {
-                                        emiter.registerImportedVar(dep, *vd);
-                                        continue;
-                                    } else if (auto *cd = dynamic_cast<pascal::ConstDeclNode *>(decl.get())) {
-                                        emiter.registerImportedConst(dep, *cd);
-                                        continue;
-                                    }
-                                    ast->block->declarations.push_back(std::move(decl));
-                                }
-                            }
-                        } catch (...) {
-                            // Unit source not available; user must ensure correct call signatures
-                        }
-                    }
-                }
-
+                pascal::foldConstants(*ast);
+                importUnits(inputPath, ast->uses, units, emiter, result.header.deps);
                 emiter.generate(ast.get());
             }
         }
-
-        {
-            std::fstream outFile;
-            outFile.open(outputPath, std::ios::out);
-            if (!outFile.is_open()) {
-                std::cerr << "mxx: cannot open output file: " << outputPath << "\n";
-                return false;
-            }
-            std::ostringstream output;
-            emiter.writeTo(output);
-            std::string opt = pascal::mxvmOpt(output.str());
-            outFile << opt << "\n";
-        }
         return true;
     } catch (const pascal::ParseException &e) {
         std::cerr << "Parse Error: " << e.what() << "\n";
@@ -240,6 +169,94 @@ static bool compileFile(const std::string &inputPath, const std::string &outputP
     }
 }
 
+// Compile a Pascal source file to optimized MXVM code held in memory.
+static bool compileSource(const std::string &inputPath, CompileResult &result, pascal::UnitCache &units) {
+    pascal::CodeGenVisitor emiter;
+    if (!generateSource(inputPath, emiter, result, units))
+        return false;
+    try {
+        std::ostringstream output;
+        emiter.writeTo(output);
+        result.code = pascal::mxvmOpt(output.str());
+        return true;
+    } catch (const std::exception &e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return false;
+    }
+}
+
+// Path of the unit interface file written next to a .mxvm output.
+static std::string interfacePath(const std::string &outputPath) {
+    if (outputPath.size() > 5 && outputPath.substr(outputPath.size() - 5) == ".mxvm")
+        return outputPath.substr(0, outputPath.size() - 5) + ".mxi";
+    return outputPath + ".mxi";
+}
+
+// A unit is up to date when its .mxvm exists and its .mxi records this
+// compiler and the current hash of both the unit source and every unit it
+// imports.
+static bool unitUpToDate(const std::string &inputPath, const std::string &outputPath, pascal::UnitCache &units) {
+    pascal::InterfaceHeader header;
+    if (!std::filesystem::exists(outputPath) || !pascal::readUnitInterface(interfacePath(outputPath), header))
+        return false;
+    if (header.compiler != compilerStamp())
+        return false;
+    std::ifstream file(inputPath);
+    if (!file.is_open())
+        return false;
+    std::ostringstream buffer;
+    buffer << file.rdbuf();
+    if (header.hash != pascal::sourceHash(buffer.str()))
+        return false;
+    std::string inputDir = sourceDir(inputPath);
+    for (const auto &dep : header.deps) {
+        if (units.get(inputDir, dep.first).hash != dep.second)
+            return false;
+    }
+    return true;
+}
+
+static bool compileFile(const std::string &inputPath, const std::string &outputPath, pascal::UnitCache &units) {
+    if (unitUpToDate(inputPath, outputPath, units))
+        return true;
+    CompileResult result;
+    if (!compileSource(inputPath, result, units))
+        return false;
+    std::fstream outFile;
+    outFile.open(outputPath, std::ios::out);
+    if (!outFile.is_open()) {
+        std::cerr << "mxx: cannot open output file: " << outputPath << "\n";
+        return false;
+    }
+    outFile << result.code << "\n";
+    outFile.close();
+    if (result.isUnit) {
+        std::string mxi = interfacePath(outputPath);
+        if (!result.hasInterface || !pascal::writeUnitInterface(mxi, result.header, result.interfaceData)) {
+            // Importers fall back to parsing the unit source
+            std::error_code ec;
+            std::filesystem::remove(mxi, ec);
+        }
+    }
+    return true;
+}
+
+// Compile a Pascal program and execute it immediately. The code generator
+// fills the interpreter's Program directly, so no MXVM source is written,
+// formatted or parsed.
+static int runFile(const std::string &inputPath, pascal::RunOptions &options) {
+    CompileResult result;
+    pascal::UnitCache units;
+    pascal::CodeGenVisitor emiter;
+    if (!generateSource(inputPath, emiter, result, units))
+        return EXIT_FAILURE;
+    if (options.object_path.empty()) {
+        options.object_path = inputPath.substr(0, inputPath.find_last_of("/\\") + 1);
+        if (options.object_path.empty()) options.object_path = ".";
+    }
+    return pascal::runProgram(inputPath, emiter, options);
+}
+
 // Extract the declared program or unit name from a Pascal source file.
 // Returns empty string if not found.
 static std::string extractPasName(const std::string &filePath) {
@@ -247,7 +264,7 @@ static std::string extractPasName(const std::string &filePath) {
     if (!f.is_open()) return {};
     std::ostringstream buf;
     buf << f.rdbuf();
-    std::string src = removeComments(buf.str());
+    std::string src = pascal::removeComments(buf.str());
     // Scan tokens: skip whitespace, look for "program"|"unit" then the identifier before ';'
     size_t i = 0;
     auto skipWS = [&]() {
@@ -272,12 +289,35 @@ static std::string extractPasName(const std::string &filePath) {
 }
 
 int main(int argc, char **argv) {
-    mx::Argz<std::string> args(argc, argv);
+    // Everything after --args is handed to the program when using --run
+    pascal::RunOptions run_options;
+    run_options.object_path.clear();
+    int run_argc = argc;
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == "--args") {
+            run_argc = i;
+            for (int j = i + 1; j < argc; ++j)
+                run_options.argv.push_back(argv[j]);
+            break;
+        }
+    }
+    mx::Argz<std::string> args(run_argc, argv);
     args.addOptionSingle('c', "Compile one or more Pascal source files to .mxvm bytecode")
         .addOptionSingleValue('i', "Input Pascal source file")
-        .addOptionSingleValue('o', "Output .mxvm file");
+        .addOptionSingleValue('o', "Output .mxvm file")
+        .addOptionSingleValue('j', "Number of parallel compile jobs for -c (0 = one per CPU)")
+        .addOptionSingle('r', "Compile and run the program in memory")
+        .addOptionDouble(128, "run", "Compile and run the program in memory")
+        .addOptionSingleValue('p', "Module path (run mode)")
+        .addOptionDoubleValue(129, "path", "Module path (run mode)")
+        .addOptionSingleValue('I', "Module include path (run mode)")
+        .addOptionDoubleValue(130, "include", "Module include path (run mode)")
+        .addOptionSingleValue('x', "Object path (run mode)")
+        .addOptionDoubleValue(131, "object-path", "Object path (run mode)");
 
     bool compile_mode = false;
+    bool run_mode = false;
+    unsigned int jobs = 1;
     std::string input_file;
     std::string output_file;
     std::vector<std::string> files;
@@ -296,6 +336,33 @@ int main(int argc, char **argv) {
             case 'o':
                 output_file = arg.arg_value;
                 break;
+            case 'j':
+                try {
+                    int n = std::stoi(arg.arg_value);
+                    if (n < 0)
+                        throw std::invalid_argument(arg.arg_value);
+                    jobs = n == 0 ? std::max(1u, std::thread::hardware_concurrency()) : static_cast<unsigned int>(n);
+                } catch (const std::exception &) {
+                    std::cerr << "mxx: invalid job count: " << arg.arg_value << "\n";
+                    return EXIT_FAILURE;
+                }
+                break;
+            case 'r':
+            case 128:
+                run_mode = true;
+                break;
+            case 'p':
+            case 129:
+                run_options.module_path = arg.arg_value;
+                break;
+            case 'I':
+            case 130:
+                run_options.include_path = arg.arg_value;
+                break;
+            case 'x':
+            case 131:
+                run_options.object_path = arg.arg_value;
+                break;
             case '-':
                 files.push_back(arg.arg_value);
                 break;
@@ -306,7 +373,15 @@ int main(int argc, char **argv) {
         return EXIT_FAILURE;
     }
 
-    if (!input_file.empty()) {
+    if (run_mode) {
+        if (!input_file.empty())
+            files.insert(files.begin(), input_file);
+        if (files.size() != 1) {
+            std::cerr << "mxx: --run requires exactly one program source file\n";
+            return EXIT_FAILURE;
+        }
+        return runFile(files[0], run_options);
+    } else if (!input_file.empty()) {
         // -i / -o mode
         if (output_file.empty()) {
             std::string name = extractPasName(input_file);
@@ -320,27 +395,42 @@ int main(int argc, char **argv) {
                     output_file += ".mxvm";
             }
         }
-        return compileFile(input_file, output_file) ? 0 : EXIT_FAILURE;
+        pascal::UnitCache units;
+        return compileFile(input_file, output_file, units) ? 0 : EXIT_FAILURE;
     } else if (compile_mode) {
         if (files.empty()) {
             std::cerr << "mxx: -c requires at least one source file\n";
             return EXIT_FAILURE;
         }
+        std::vector<pascal::BuildJob> build;
         for (const auto &src : files) {
-            std::string name = extractPasName(src);
-            std::string out;
-            if (!name.empty()) {
-                out = name + ".mxvm";
+            pascal::BuildJob job;
+            job.source = src;
+            job.name = extractPasName(src);
+            if (!job.name.empty()) {
+                job.output = job.name + ".mxvm";
             } else {
-                out = src;
-                if (out.size() > 4 && out.substr(out.size() - 4) == ".pas")
-                    out = out.substr(0, out.size() - 4) + ".mxvm";
+                job.output = src;
+                if (job.output.size() > 4 && job.output.substr(job.output.size() - 4) == ".pas")
+                    job.output = job.output.substr(0, job.output.size() - 4) + ".mxvm";
                 else
-                    out += ".mxvm";
+                    job.output += ".mxvm";
             }
-            if (!compileFile(src, out))
-                return EXIT_FAILURE;
+            std::ifstream f(src);
+            if (f.is_open()) {
+                std::ostringstream buf;
+                buf << f.rdbuf();
+                job.uses = pascal::extractPasUses(pascal::removeComments(buf.str()));
+            }
+            build.push_back(std::move(job));
         }
+        // Units are compiled before their importers; each unit interface is
+        // parsed once and shared by every file that uses it.
+        pascal::UnitCache units;
+        if (!pascal::buildAll(build, jobs, [&units](const pascal::BuildJob &job) {
+                return compileFile(job.source, job.output, units);
+            }))
+            return EXIT_FAILURE;
     } else {
         // Legacy mode: mxx <source> <output>
         if (files.size() != 2) {
@@ -348,10 +438,12 @@ int main(int argc, char **argv) {
             std::cerr << "Usage:\n"
                       << "  " << argv[0] << " <source.pas> <output.mxvm>\n"
                       << "  " << argv[0] << " -i <source.pas> [-o <output.mxvm>]\n"
-                      << "  " << argv[0] << " -c <source1.pas> [source2.pas ...]\n";
+                      << "  " << argv[0] << " -c [-j N] <source1.pas> [source2.pas ...]\n"
+                      << "  " << argv[0] << " --run <source.pas> [--path <module_path>] [--args ...]\n";
             return EXIT_FAILURE;
         }
-        if (!compileFile(files[0], files[1]))
+        pascal::UnitCache units;
+        if (!compileFile(files[0], files[1], units))
             return EXIT_FAILURE;
     }
 
@@ -14,13 +14,18 @@ namespace pascal {
         for (size_t i = 0; i < toks.size();) {
             if (toks[i].getTokenValue() == "{") {
                 size_t start = i;
+                std::string body;
                 ++i;
                 while (i < toks.size() && toks[i].getTokenValue() != "}") {
+                    body += toks[i].getTokenValue();
                     ++i;
                 }
                 if (i < toks.size()) {
                     ++i; // skip closing }
                 }
+                // removeComments() keeps {$R-}/{$R+} as { R- }/{ R+ }
+                if (body == "R-" || body == "R+")
+                    rangeDirectives.emplace_back(start, body == "R+");
                 toks.erase(toks.begin() + static_cast<int64_t>(start),
                            toks.begin() + static_cast<int64_t>(i));
                 i = start;
@@ -30,6 +35,16 @@ namespace pascal {
         }
     }
 
+    bool PascalParser::rangeChecksEnabled() const {
+        bool enabled = true;
+        for (const auto &d : rangeDirectives) {
+            if (d.first > index)
+                break;
+            enabled = d.second;
+        }
+        return enabled;
+    }
+
     void PascalParser::error(const std::string &message) {
         throw ParseException("Parse error: " + message + (token ? " at '" + token->getTokenValue() + "'" : " at end of input"));
     }
@@ -774,10 +789,13 @@ namespace pascal {
             while (true) {
                 if (peekIs("[")) {
                     next();
+                    bool checks = rangeChecksEnabled();
                     auto index = parseExpression();
                     expectToken("]");
                     next();
-                    left = std::make_unique<ArrayAccessNode>(std::move(left), std::move(index));
+                    auto access = std::make_unique<ArrayAccessNode>(std::move(left), std::move(index));
+                    access->rangeChecks = checks;
+                    left = std::move(access);
                     left->setLineNumber(lineNum);
                 } else if (peekIs(".")) {
                     next();
@@ -1284,10 +1302,13 @@ namespace pascal {
         while (true) {
             if (peekIs("[")) {
                 next();
+                bool checks = rangeChecksEnabled();
                 auto index = parseExpression();
                 expectToken("]");
                 next();
-                left = std::make_unique<ArrayAccessNode>(std::move(left), std::move(index));
+                auto access = std::make_unique<ArrayAccessNode>(std::move(left), std::move(index));
+                access->rangeChecks = checks;
+                left = std::move(access);
                 left->setLineNumber(lineNum);
             } else if (peekIs(".")) {
                 next();
@@ -0,0 +1,142 @@
+/**
+ * @file run.cpp
+ * @brief In-memory handoff of generated MXVM code to the interpreter (mxx --run)
+ * @author Jared Bruni
+ */
+#include "run.hpp"
+#include "icode.hpp"
+#include <cctype>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <mxvm/emitter.hpp>
+#include <mxvm/icode.hpp>
+#include <sstream>
+
+namespace pascal {
+
+    namespace {
+        mxvm::VarType dataType(const std::string &type) {
+            if (type == "float")
+                return mxvm::VarType::VAR_FLOAT;
+            if (type == "string")
+                return mxvm::VarType::VAR_STRING;
+            if (type == "ptr")
+                return mxvm::VarType::VAR_POINTER;
+            return mxvm::VarType::VAR_INTEGER;
+        }
+
+        std::string trim(const std::string &s) {
+            size_t a = s.find_first_not_of(" \t");
+            if (a == std::string::npos)
+                return "";
+            size_t b = s.find_last_not_of(" \t");
+            return s.substr(a, b - a + 1);
+        }
+
+        // Integer operands as the code generator writes them: decimal with an
+        // optional sign, or 0x hex
+        bool isNumber(const std::string &s) {
+            if (s.size() > 2 && s[0] == '0' && (s[1] == 'x' || s[1] == 'X'))
+                return s.find_first_not_of("0123456789abcdefABCDEF", 2) == std::string::npos;
+            size_t start = (!s.empty() && s[0] == '-') ? 1 : 0;
+            if (start >= s.size() || !std::isdigit(static_cast<unsigned char>(s[start])))
+                return false;
+            return s.find_first_not_of("0123456789.", start) == std::string::npos;
+        }
+
+        // Variable, label or function name, optionally qualified by a unit object
+        bool isSymbol(const std::string &s) {
+            bool start = true;
+            int dots = 0;
+            for (char c : s) {
+                if (c == '.') {
+                    if (start || ++dots > 1)
+                        return false;
+                    start = true;
+                } else if (std::isalpha(static_cast<unsigned char>(c)) || c == '_' || (!start && std::isdigit(static_cast<unsigned char>(c)))) {
+                    start = false;
+                } else {
+                    return false;
+                }
+            }
+            return !start;
+        }
+    } // namespace
+
+    void CodeGenVisitor::emitTo(mxvm::Parser &loader, std::unique_ptr<mxvm::Program> &program) const {
+        mxvm::Emitter out(loader, program, name, isUnit);
+        for (const auto &dep : objectDeps)
+            out.object(dep);
+        for (const auto &mod : usedModules)
+            out.module(mod);
+        for (const auto &decl : dataSection()) {
+            if (decl.buffer != 0)
+                out.buffer(decl.name, decl.buffer);
+            else
+                out.variable(dataType(decl.type), decl.name, decl.value);
+        }
+        for (const auto &line : mxvmOptCode(codeSection())) {
+            std::string text = trim(line);
+            if (text.empty())
+                continue;
+            if (text.back() == ':') {
+                bool function = text.starts_with("function ");
+                out.label(trim(text.substr(function ? 9 : 0, text.size() - (function ? 10 : 1))), function);
+                continue;
+            }
+            size_t space = text.find_first_of(" \t");
+            std::vector<mxvm::Operand> operands;
+            if (space != std::string::npos) {
+                std::istringstream args(text.substr(space + 1));
+                std::string arg;
+                while (std::getline(args, arg, ',')) {
+                    arg = trim(arg);
+                    if (isNumber(arg))
+                        operands.push_back(mxvm::Emitter::constant(arg));
+                    else if (isSymbol(arg))
+                        operands.push_back(mxvm::Emitter::symbol(arg));
+                    else
+                        throw mx::Exception("unsupported operand '" + arg + "' in: " + text);
+                }
+            }
+            out.instruction(text.substr(0, space), std::move(operands));
+        }
+        out.finish();
+    }
+
+    int runProgram(const std::string &filename, const CodeGenVisitor &code, const RunOptions &options) {
+        int exitCode = 0;
+        std::unique_ptr<mxvm::Program> program(new mxvm::Program());
+        std::vector<std::string> program_argv{"mxx"};
+        program_argv.insert(program_argv.end(), options.argv.begin(), options.argv.end());
+        program->setArgs(program_argv);
+        program->setMainBase(program.get());
+        program->filename = filename;
+        try {
+            mxvm::Parser loader("");
+            loader.parser_mode = mxvm::Mode::MODE_INTERPRET;
+            loader.module_path = options.module_path;
+            loader.object_path = options.object_path;
+            loader.include_path = options.include_path;
+            code.emitTo(loader, program);
+            if (program->object) {
+                throw mx::Exception("Requires one program object to execute");
+            }
+            program->flatten(program.get());
+            if (!options.only_test)
+                exitCode = program->exec();
+        } catch (const mx::Exception &e) {
+            std::cerr << "mxx: runtime error: " << e.what() << "\n";
+            return EXIT_FAILURE;
+        } catch (const scan::ScanExcept &e) {
+            std::cerr << "mxx: syntax error in unit object: " << e.why() << "\n";
+            return EXIT_FAILURE;
+        } catch (const std::exception &e) {
+            std::cerr << "mxx: error: " << e.what() << "\n";
+            return EXIT_FAILURE;
+        }
+        return exitCode;
+    }
+
+} // namespace pascal
@@ -353,7 +353,7 @@ namespace mxx {
         next();
 
         // Import interface declarations from used units
-        static const std::unordered_set<std::string> nativeModules = {"io", "std", "string", "sdl", "strlib"};
+        static const std::unordered_set<std::string> nativeModules = {"io", "std", "string", "sdl", "strlib", "collections"};
         std::string inputDir;
         {
             auto pos = filename.find_last_of("/\\");
@@ -363,6 +363,20 @@ namespace mxx {
             importedUnits.insert(lower(unit));
             if (nativeModules.count(unit))
                 continue;
+            UnitSymbols symbols;
+            if (unitResolver && unitResolver(unit, inputDir, symbols)) {
+                for (const auto &n : symbols.procs)
+                    declaredProcs.insert(lower(n));
+                for (const auto &n : symbols.funcs)
+                    declaredFuncs.insert(lower(n));
+                for (const auto &n : symbols.consts)
+                    scopeStack.back().consts.insert(lower(n));
+                for (const auto &n : symbols.vars)
+                    scopeStack.back().vars.insert(lower(n));
+                for (const auto &n : symbols.types)
+                    scopeStack.back().types.insert(lower(n));
+                continue;
+            }
             // Try to find the unit's .pas file
             std::string unitFile = inputDir + unit + ".pas";
             std::ifstream uf(unitFile);
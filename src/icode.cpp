@@ -17,7 +17,24 @@
 
 namespace mxvm {
 
-    std::unordered_map<std::string, Program *> Base::object_map;
+    Context::~Context() {
+        // Module state may run code from the libraries closed below
+        module_state.clear();
+        for (auto &h : handles) {
+            if (h.second) {
+                dlclose(h.second);
+                h.second = nullptr;
+                char *errf = dlerror();
+                if (errf != nullptr) {
+                    std::cerr << "Error releaseing module: " << errf << "\n";
+                } else {
+                    if (mxvm::debug_mode) {
+                        std::cout << "Released module: " << h.first << "\n";
+                    }
+                }
+            }
+        }
+    }
 
     std::string Program::getMangledName(const std::string &var) {
         auto dot_pos = var.find('.');
@@ -70,7 +87,7 @@ namespace mxvm {
     }
 
     Base::Base(Base &&other) noexcept
-        : name(std::move(other.name)), inc(std::move(other.inc)), vars(std::move(other.vars)), labels(std::move(other.labels)), external(std::move(other.external)), external_functions(std::move(other.external_functions)) {
+        : name(std::move(other.name)), inc(std::move(other.inc)), vars(std::move(other.vars)), labels(std::move(other.labels)), external(std::move(other.external)), external_functions(std::move(other.external_functions)), context(other.context) {
     }
 
     Base &Base::operator=(Base &&other) noexcept {
@@ -81,16 +98,15 @@ namespace mxvm {
             labels = std::move(other.labels);
             external = std::move(other.external);
             external_functions = std::move(other.external_functions);
+            context = other.context;
         }
         return *this;
     }
 
-    std::unordered_map<std::string, Variable> Base::allocated;
-
     void Base::add_allocated(const std::string &name, Variable &v) {
-        auto it = allocated.find(name);
-        if (it == allocated.end())
-            allocated[name] = v;
+        auto it = context->allocated.find(name);
+        if (it == context->allocated.end())
+            context->allocated[name] = v;
     }
 
     Program::Program() : pc(0), running(false) {
@@ -134,14 +150,17 @@ namespace mxvm {
     }
 
     void Base::add_object(const std::string &name, Program *prog) {
-        if (base != nullptr) {
-            auto it = base->object_map.find(name);
-            if (it == base->object_map.end())
-                base->object_map[name] = prog;
+        if (context->base != nullptr) {
+            auto it = context->object_map.find(name);
+            if (it == context->object_map.end())
+                context->object_map[name] = prog;
         }
     }
 
     Program::~Program() {
+        // Module state (async I/O workers, for one) may still use the buffers freed below
+        if (context && context->base == this)
+            context->module_state.clear();
         std::unordered_set<void *> freed_ptrs;
         for (auto &i : vars) {
             if (i.second.var_value.ptr_value != nullptr && i.second.var_value.owns) {
@@ -156,30 +175,16 @@ namespace mxvm {
                 i.second.var_value.owns = false;
             }
         }
-
-        for (auto &h : RuntimeFunction::handles) {
-            if (h.second) {
-                dlclose(h.second);
-                h.second = nullptr;
-                char *errf = dlerror();
-                if (errf != nullptr) {
-                    std::cerr << "Error releaseing module: " << errf << "\n";
-                } else {
-                    if (mxvm::debug_mode) {
-                        std::cout << "Released module: " << h.first << "\n";
-                    }
-                }
-            }
-        }
     }
+
     bool Program::isFunctionValid(const std::string &label) {
         auto dot_pos = label.find('.');
         if (dot_pos != std::string::npos) {
             std::string obj_name = label.substr(0, dot_pos);
             std::string func_name = label.substr(dot_pos + 1);
 
-            auto it = object_map.find(obj_name);
-            if (it != object_map.end() && it->second != nullptr) {
+            auto it = context->object_map.find(obj_name);
+            if (it != context->object_map.end() && it->second != nullptr) {
                 Program *obj_prog = it->second;
                 auto label_it = obj_prog->labels.find(func_name);
                 return label_it != obj_prog->labels.end() && label_it->second.second; // second==true means function
@@ -195,25 +200,40 @@ namespace mxvm {
         return false;
     }
 
-    std::unordered_map<std::string, void *> RuntimeFunction::handles;
-    std::string Base::root_name;
-
-    RuntimeFunction::RuntimeFunction(const std::string &mod, const std::string &name) {
+    RuntimeFunction::RuntimeFunction(const std::string &mod, const std::string &name, std::unordered_map<std::string, void *> &h) {
         fname = name;
-        handle = nullptr;
-        if (handles.find(mod) == handles.end()) {
-            handle = dlopen(mod.c_str(), RTLD_LAZY);
-            handles[mod] = handle;
+        mod_path = mod;
+        handles = &h;
+    }
+
+    void *RuntimeFunction::module() {
+        if (handle != nullptr)
+            return handle;
+        if (handles == nullptr)
+            throw mx::Exception("RuntimeFunction: function: " + fname + " has no module: " + mod_name);
+        auto it = handles->find(mod_path);
+        if (it == handles->end()) {
+            handle = dlopen(mod_path.c_str(), RTLD_LAZY);
+            (*handles)[mod_path] = handle;
+            if (handle != nullptr && mxvm::debug_mode)
+                std::cout << "Loaded module: " << mod_path << "\n";
         } else {
-            handle = handles[mod];
+            handle = it->second;
         }
         if (handle == nullptr) {
-            throw mx::Exception("Error could not open module: " + mod + " try using --path to point to module path");
+            throw mx::Exception("Error could not open module: " + mod_path + " try using --path to point to module path");
         }
-        func = (void *)dlsym(handle, name.c_str());
+        return handle;
+    }
+
+    void RuntimeFunction::resolve() {
+        if (func != nullptr)
+            return;
+        void *h = module();
+        func = (void *)dlsym(h, fname.c_str());
         if (func == nullptr) {
             char *dl_e = dlerror();
-            throw mx::Exception("Error could not find symbol: " + name + " in: " + mod + " Error: " + ((dl_e != nullptr) ? dl_e : ""));
+            throw mx::Exception("Error could not find symbol: " + fname + " in: " + mod_path + " Error: " + ((dl_e != nullptr) ? dl_e : ""));
         }
         char *dl_err = dlerror();
         if (dl_err != nullptr) {
@@ -222,18 +242,15 @@ namespace mxvm {
     }
 
     void RuntimeFunction::call(Program *program, std::vector<Operand> &operands) {
-        if (!func || !handle) {
-            throw mx::Exception("RuntimeFunction: function: " + this->fname + " pointer is null: " + this->mod_name);
-        }
+        if (func == nullptr)
+            resolve();
+        MXVM_STAT(program->context, ++stats->native_calls[mod_name + "." + fname]);
         using FuncType = void (*)(Program *program, std::vector<Operand> &);
         FuncType f = reinterpret_cast<FuncType>(func);
         if (f != nullptr)
             f(program, operands);
     }
 
-    Base *Base::base = nullptr;
-    std::vector<std::string> Base::filenames;
-
     void Base::add_instruction(const Instruction &i) {
         inc.push_back(i);
     }
@@ -255,10 +272,11 @@ namespace mxvm {
     }
 
     void Base::add_filename(const std::string &fname) {
-        if (base != nullptr) {
-            auto it = std::find(base->filenames.begin(), base->filenames.end(), fname);
-            if (it == base->filenames.end()) {
-                base->filenames.push_back(fname);
+        if (context->base != nullptr) {
+            auto &filenames = context->filenames;
+            auto it = std::find(filenames.begin(), filenames.end(), fname);
+            if (it == filenames.end()) {
+                filenames.push_back(fname);
             }
         }
     }
@@ -275,10 +293,11 @@ namespace mxvm {
             throw mx::Exception("External function missing information.");
         }
 
-        if (base != nullptr) {
-            if (base->external_functions.find(name) == base->external_functions.end()) {
-                base->external_functions[name] = RuntimeFunction(mod, func_name);
-                base->external_functions[name].mod_name = mod_name;
+        Base *root = context->base;
+        if (root != nullptr) {
+            if (root->external_functions.find(name) == root->external_functions.end()) {
+                root->external_functions[name] = RuntimeFunction(mod, func_name, context->handles);
+                root->external_functions[name].mod_name = mod_name;
             }
         }
     }
@@ -406,7 +425,7 @@ namespace mxvm {
                         }
                         break;
                     case VarType::VAR_LABEL:
-                        out << std::setw(30) << var.second.var_value.label_value;
+                        out << std::setw(30) << var.second.var_value.label_value.str();
                         break;
                     default:
                         out << std::setw(30) << var.second.var_value.int_value;
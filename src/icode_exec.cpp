@@ -129,9 +129,17 @@ namespace mxvm {
         }
         pc = 0;
         running = true;
+        invoke_cache.assign(inc.size(), nullptr);
+        format_cache.assign(inc.size(), Format());
+        if (profiling)
+            profiler = std::make_unique<Profiler>(inc, labels, name);
+        Profiler *prof = profiler.get();
 
         while (running && pc < inc.size()) {
             const Instruction &instr = inc.at(pc);
+            if (prof)
+                prof->step(pc);
+            MXVM_STAT(context, ++stats->opcodes[instr.instruction]; stats->stack_peak = std::max<uint64_t>(stats->stack_peak, stack.size()));
             if (mxvm::instruct_mode)
                 std::cout << instr << "\n";
 
@@ -375,7 +383,7 @@ namespace mxvm {
                 dest.var_value.type = VarType::VAR_POINTER;
                 dest.var_value.owns = false;
             } else {
-                setVariableFromConstant(dest, instr.op2.op);
+                setVariableFromConstant(dest, instr.op2);
             }
         }
     }
@@ -396,20 +404,20 @@ namespace mxvm {
                 if (isVariable(instr.op2.op)) {
                     src2 = &getVariable(instr.op2.op);
                 } else {
-                    temp2 = createTempVariable(constType, instr.op2.op);
+                    temp2 = createTempVariable(constType, instr.op2);
                     src2 = &temp2;
                 }
             } else {
                 if (isVariable(instr.op2.op)) {
                     src1 = &getVariable(instr.op2.op);
                 } else {
-                    temp1 = createTempVariable(constType, instr.op2.op);
+                    temp1 = createTempVariable(constType, instr.op2);
                     src1 = &temp1;
                 }
                 if (isVariable(instr.op3.op)) {
                     src2 = &getVariable(instr.op3.op);
                 } else {
-                    temp2 = createTempVariable(constType, instr.op3.op);
+                    temp2 = createTempVariable(constType, instr.op3);
                     src2 = &temp2;
                 }
             }
@@ -435,20 +443,20 @@ namespace mxvm {
                 if (isVariable(instr.op2.op)) {
                     src2 = &getVariable(instr.op2.op);
                 } else {
-                    temp2 = createTempVariable(constType, instr.op2.op);
+                    temp2 = createTempVariable(constType, instr.op2);
                     src2 = &temp2;
                 }
             } else {
                 if (isVariable(instr.op2.op)) {
                     src1 = &getVariable(instr.op2.op);
                 } else {
-                    temp1 = createTempVariable(constType, instr.op2.op);
+                    temp1 = createTempVariable(constType, instr.op2);
                     src1 = &temp1;
                 }
                 if (isVariable(instr.op3.op)) {
                     src2 = &getVariable(instr.op3.op);
                 } else {
-                    temp2 = createTempVariable(constType, instr.op3.op);
+                    temp2 = createTempVariable(constType, instr.op3);
                     src2 = &temp2;
                 }
             }
@@ -472,20 +480,20 @@ namespace mxvm {
             if (isVariable(instr.op2.op)) {
                 src2 = &getVariable(instr.op2.op);
             } else {
-                temp2 = createTempVariable(dest.type, instr.op2.op);
+                temp2 = createTempVariable(dest.type, instr.op2);
                 src2 = &temp2;
             }
         } else {
             if (isVariable(instr.op2.op)) {
                 src1 = &getVariable(instr.op2.op);
             } else {
-                temp1 = createTempVariable(dest.type, instr.op2.op);
+                temp1 = createTempVariable(dest.type, instr.op2);
                 src1 = &temp1;
             }
             if (isVariable(instr.op3.op)) {
                 src2 = &getVariable(instr.op3.op);
             } else {
-                temp2 = createTempVariable(dest.type, instr.op3.op);
+                temp2 = createTempVariable(dest.type, instr.op3);
                 src2 = &temp2;
             }
         }
@@ -508,20 +516,20 @@ namespace mxvm {
             if (isVariable(instr.op2.op)) {
                 src2 = &getVariable(instr.op2.op);
             } else {
-                temp2 = createTempVariable(dest.type, instr.op2.op);
+                temp2 = createTempVariable(dest.type, instr.op2);
                 src2 = &temp2;
             }
         } else {
             if (isVariable(instr.op2.op)) {
                 src1 = &getVariable(instr.op2.op);
             } else {
-                temp1 = createTempVariable(dest.type, instr.op2.op);
+                temp1 = createTempVariable(dest.type, instr.op2);
                 src1 = &temp1;
             }
             if (isVariable(instr.op3.op)) {
                 src2 = &getVariable(instr.op3.op);
             } else {
-                temp2 = createTempVariable(dest.type, instr.op3.op);
+                temp2 = createTempVariable(dest.type, instr.op3);
                 src2 = &temp2;
             }
         }
@@ -537,13 +545,13 @@ namespace mxvm {
         if (isVariable(instr.op1.op)) {
             var1 = &getVariable(instr.op1.op);
         } else {
-            temp1 = createTempVariable(VarType::VAR_INTEGER, instr.op1.op);
+            temp1 = createTempVariable(VarType::VAR_INTEGER, instr.op1);
             var1 = &temp1;
         }
         if (isVariable(instr.op2.op)) {
             var2 = &getVariable(instr.op2.op);
         } else {
-            temp2 = createTempVariable(VarType::VAR_INTEGER, instr.op2.op);
+            temp2 = createTempVariable(VarType::VAR_INTEGER, instr.op2);
             var2 = &temp2;
         }
         zero_flag = false;
@@ -628,18 +636,29 @@ namespace mxvm {
         }
     }
 
+    const Format &Program::formatFor(const Instruction &instr, const std::string &format, Format &local) {
+        if (pc < format_cache.size() && &inc[pc] == &instr) {
+            Format &cached = format_cache[pc];
+            if (!cached.matches(format))
+                cached = Format(format);
+            return cached;
+        }
+        local = Format(format);
+        return local;
+    }
+
     void Program::exec_print(const Instruction &instr) {
-        std::string format;
+        const std::string *format = &instr.op1.op;
         std::vector<Variable> tempArgs;
         std::vector<Variable *> args;
         if (isVariable(instr.op1.op)) {
             Variable &fmt = getVariable(instr.op1.op);
             if (fmt.type != VarType::VAR_STRING)
                 throw mx::Exception("PRINT format must be a string variable");
-            format = fmt.var_value.str_value;
-        } else {
-            format = instr.op1.op;
+            format = &fmt.var_value.str_value.str();
         }
+        // Reserve so the temporaries do not move while args points at them
+        tempArgs.reserve(2 + instr.vop.size());
         auto getArgVariable = [&](const Operand &op, VarType type = VarType::VAR_INTEGER) -> Variable * {
             if (isVariable(op.op)) {
                 return &getVariable(op.op);
@@ -647,7 +666,7 @@ namespace mxvm {
                 if (op.type == OperandType::OP_VARIABLE) {
                     throw mx::Exception("Instruction variable not defined: " + op.op);
                 }
-                tempArgs.push_back(createTempVariable(type, op.op));
+                tempArgs.push_back(createTempVariable(type, op));
                 return &tempArgs.back();
             }
         };
@@ -662,7 +681,11 @@ namespace mxvm {
                 args.push_back(getArgVariable(vop));
             }
         }
-        printFormatted(format, args);
+        Format local;
+        const Format &compiled = formatFor(instr, *format, local);
+        format_buffer.clear();
+        compiled.append(format_buffer, args);
+        writeOutput(format_buffer.data(), format_buffer.size());
     }
 
     void Program::exec_exit(const Instruction &instr) {
@@ -675,10 +698,12 @@ namespace mxvm {
             }
         }
         exitCode = exit_code;
+        flushOutput();
         stop();
     }
 
     Variable &Program::getVariable(const std::string &n) {
+        MXVM_STAT(context, ++stats->get_variable);
         auto rax_pos = n.find("%");
         if (rax_pos != std::string::npos) {
             auto dot = n.find(".");
@@ -705,8 +730,8 @@ namespace mxvm {
                 return it->second;
         }
 
-        if (Program::base != nullptr) {
-            for (auto &obj : Base::base->object_map) {
+        if (context->base != nullptr) {
+            for (auto &obj : context->object_map) {
                 if (pos == std::string::npos) {
                     auto it = obj.second->vars.find(name + "." + n);
                     if (it != obj.second->vars.end())
@@ -722,6 +747,7 @@ namespace mxvm {
     }
 
     bool Program::isVariable(const std::string &n) {
+        MXVM_STAT(context, ++stats->is_variable);
 
         auto rax_pos = n.find("%");
 
@@ -729,8 +755,8 @@ namespace mxvm {
             return true;
         }
 
-        if (Program::base != nullptr) {
-            for (auto &obj : Base::base->object_map) {
+        if (context->base != nullptr) {
+            for (auto &obj : context->object_map) {
                 auto it = obj.second->vars.find(n);
                 if (it != obj.second->vars.end()) {
                     return true;
@@ -1203,6 +1229,7 @@ namespace mxvm {
         dest.var_value.ptr_size = size;
         dest.var_value.ptr_count = count;
         dest.var_value.owns = true;
+        MXVM_STAT(context, ++stats->allocs; stats->alloc_bytes += static_cast<uint64_t>(size * count));
     }
     void Program::exec_free(const Instruction &instr) {
         if (!isVariable(instr.op1.op)) {
@@ -1211,6 +1238,7 @@ namespace mxvm {
         Variable &var = getVariable(instr.op1.op);
         if (var.type == VarType::VAR_POINTER && var.var_value.ptr_value != nullptr) {
             void *ptr_to_free = var.var_value.ptr_value;
+            MXVM_STAT(context, ++stats->frees; stats->free_bytes += static_cast<uint64_t>(var.var_value.ptr_size * var.var_value.ptr_count));
             std::free(ptr_to_free);
             // Clear this variable
             var.var_value.ptr_value = nullptr;
@@ -1293,20 +1321,20 @@ namespace mxvm {
             if (isVariable(instr.op2.op)) {
                 src2 = &getVariable(instr.op2.op);
             } else {
-                temp2 = createTempVariable(dest.type, instr.op2.op);
+                temp2 = createTempVariable(dest.type, instr.op2);
                 src2 = &temp2;
             }
         } else {
             if (isVariable(instr.op2.op)) {
                 src1 = &getVariable(instr.op2.op);
             } else {
-                temp1 = createTempVariable(dest.type, instr.op2.op);
+                temp1 = createTempVariable(dest.type, instr.op2);
                 src1 = &temp1;
             }
             if (isVariable(instr.op3.op)) {
                 src2 = &getVariable(instr.op3.op);
             } else {
-                temp2 = createTempVariable(dest.type, instr.op3.op);
+                temp2 = createTempVariable(dest.type, instr.op3);
                 src2 = &temp2;
             }
         }
@@ -1405,17 +1433,16 @@ namespace mxvm {
             throw mx::Exception("STRING_PRINT destination must be a string variable");
         }
 
-        std::string format;
+        const std::string *format = &instr.op2.op;
         std::vector<Variable> tempArgs;
         std::vector<Variable *> args;
         if (isVariable(instr.op2.op)) {
             Variable &fmtVar = getVariable(instr.op2.op);
             if (fmtVar.type != VarType::VAR_STRING)
                 throw mx::Exception("STRING_PRINT format must be a string variable");
-            format = fmtVar.var_value.str_value;
-        } else {
-            format = instr.op2.op;
+            format = &fmtVar.var_value.str_value.str();
         }
+        tempArgs.reserve(1 + instr.vop.size());
 
         auto getArgVariable = [&](const Operand &op, VarType type = VarType::VAR_INTEGER) -> Variable * {
             if (isVariable(op.op)) {
@@ -1424,7 +1451,7 @@ namespace mxvm {
                 if (op.type == OperandType::OP_VARIABLE) {
                     throw mx::Exception("string_print instruction variable not defined: " + op.op);
                 }
-                tempArgs.push_back(createTempVariable(type, op.op));
+                tempArgs.push_back(createTempVariable(type, op));
                 return &tempArgs.back();
             }
         };
@@ -1438,137 +1465,33 @@ namespace mxvm {
             }
         }
 
-        std::ostringstream oss;
-        size_t argIndex = 0;
-        const char *fmt = format.c_str();
-        char buffer[4096];
-
-        for (size_t i = 0; i < format.length(); ++i) {
-            if (fmt[i] == '%' && i + 1 < format.length()) {
-                size_t start = i;
-                size_t j = i + 1;
-                while (j < format.length() &&
-                       (fmt[j] == '-' || fmt[j] == '+' || fmt[j] == ' ' || fmt[j] == '#' || fmt[j] == '0' ||
-                        (fmt[j] >= '0' && fmt[j] <= '9') || fmt[j] == '.' ||
-                        fmt[j] == 'l' || fmt[j] == 'h' || fmt[j] == 'z' || fmt[j] == 'j' || fmt[j] == 't')) {
-                    ++j;
-                }
-                if (j < format.length() && fmt[j] == '%') {
-                    oss << '%';
-                    i = j;
-                    continue;
-                }
-                if (j >= format.length())
-                    break;
-                if (!std::isalpha(fmt[j])) {
-                    oss << fmt[i];
-                    continue;
-                }
-                std::string spec(fmt + start, fmt + j + 1);
-                if (argIndex < args.size()) {
-                    Variable *arg = args[argIndex++];
-                    if (arg->type == VarType::VAR_INTEGER) {
-                        std::snprintf(buffer, sizeof(buffer), spec.c_str(), arg->var_value.int_value);
-                    } else if (arg->type == VarType::VAR_POINTER || arg->var_value.type == VarType::VAR_EXTERN) {
-                        if (spec.find("%s") != std::string::npos) {
-                            std::snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<char *>(arg->var_value.ptr_value));
-                        } else {
-                            std::snprintf(buffer, sizeof(buffer), spec.c_str(), arg->var_value.ptr_value);
-                        }
-                    } else if (arg->type == VarType::VAR_FLOAT) {
-                        std::snprintf(buffer, sizeof(buffer), spec.c_str(), arg->var_value.float_value);
-                    } else if (arg->type == VarType::VAR_STRING) {
-                        std::snprintf(buffer, sizeof(buffer), spec.c_str(), arg->var_value.str_value.c_str());
-                    } else if (arg->type == VarType::VAR_BYTE) {
-                        std::snprintf(buffer, sizeof(buffer), spec.c_str(), arg->var_value.int_value);
-                    } else {
-                        std::snprintf(buffer, sizeof(buffer), "%s", "(unsupported)");
-                    }
-                    oss << buffer;
-                } else {
-                    oss << spec;
-                }
-                i = j;
-            } else {
-                oss << fmt[i];
-            }
-        }
-
-        dest.var_value.str_value = oss.str();
+        // Format into the shared buffer first: dest may also be one of the arguments
+        Format local;
+        const Format &compiled = formatFor(instr, *format, local);
+        format_buffer.clear();
+        compiled.append(format_buffer, args);
+        dest.var_value.str_value.mutate().assign(format_buffer);
         dest.var_value.type = VarType::VAR_STRING;
     }
 
     std::string Program::printFormatted(const std::string &format, const std::vector<Variable *> &args, bool output) {
-        std::ostringstream oss;
-        size_t argIndex = 0;
-        const char *fmt = format.c_str();
-        char buffer[4096];
-        for (size_t i = 0; i < format.length(); ++i) {
-            if (fmt[i] == '%' && i + 1 < format.length()) {
-                size_t start = i;
-                size_t j = i + 1;
-                while (j < format.length() &&
-                       (fmt[j] == '-' || fmt[j] == '+' || fmt[j] == ' ' || fmt[j] == '#' || fmt[j] == '0' ||
-                        (fmt[j] >= '0' && fmt[j] <= '9') || fmt[j] == '.' ||
-                        fmt[j] == 'l' || fmt[j] == 'h' || fmt[j] == 'z' || fmt[j] == 'j' || fmt[j] == 't')) {
-                    ++j;
-                }
-                if (j < format.length() && fmt[j] == '%') {
-                    oss << '%';
-                    i = j;
-                    continue;
-                }
-                if (j >= format.length())
-                    break;
-                if (!std::isalpha(fmt[j])) {
-                    oss << fmt[i];
-                    continue;
-                }
-                std::string spec(fmt + start, fmt + j + 1);
-                if (argIndex < args.size()) {
-
-                    Variable *arg = args[argIndex++];
-                    if (arg->type == VarType::VAR_INTEGER) {
-                        std::snprintf(buffer, sizeof(buffer), spec.c_str(), arg->var_value.int_value);
-                    } else if (arg->type == VarType::VAR_POINTER || arg->var_value.type == VarType::VAR_EXTERN) {
-                        if (spec.find("%s") != std::string::npos) {
-                            std::snprintf(buffer, sizeof(buffer), spec.c_str(), static_cast<char *>(arg->var_value.ptr_value));
-                        } else {
-                            std::snprintf(buffer, sizeof(buffer), spec.c_str(), arg->var_value.ptr_value);
-                        }
-                    } else if (arg->type == VarType::VAR_FLOAT) {
-                        std::snprintf(buffer, sizeof(buffer), spec.c_str(), arg->var_value.float_value);
-                    } else if (arg->type == VarType::VAR_STRING) {
-                        std::snprintf(buffer, sizeof(buffer), spec.c_str(), arg->var_value.str_value.c_str());
-                    } else if (arg->type == VarType::VAR_BYTE) {
-                        std::snprintf(buffer, sizeof(buffer), spec.c_str(), arg->var_value.int_value);
-                    } else {
-                        std::snprintf(buffer, sizeof(buffer), "%s", "(unsupported)");
-                    }
-                    oss << buffer;
-                } else {
-                    oss << spec;
-                }
-                i = j;
-            } else {
-                oss << fmt[i];
-            }
-        }
+        std::string text;
+        Format(format).append(text, args);
         if (output)
-            std::cout << oss.str();
-        return oss.str();
+            writeOutput(text.data(), text.size());
+        return text;
     }
+
     void Program::exec_getline(const Instruction &instr) {
         if (!isVariable(instr.op1.op)) {
             throw mx::Exception("GETLINE destination must be a variable");
         }
         Variable &dest = getVariable(instr.op1.op);
-        std::string input;
-        std::getline(std::cin, input);
-
         switch (dest.type) {
         case VarType::VAR_STRING:
-            dest.var_value.str_value = input;
+            // A fully buffered stdout would otherwise hold back the prompt
+            flushOutput();
+            line_reader.read(stdin, dest.var_value.str_value.mutate());
             dest.var_value.type = VarType::VAR_STRING;
             break;
         default:
@@ -1603,7 +1526,7 @@ namespace mxvm {
         } else if (var.var_value.type == VarType::VAR_FLOAT) {
             stack.push(var.var_value.float_value);
         } else if (var.var_value.type == VarType::VAR_STRING) {
-            stack.push(var.var_value.str_value);
+            stack.push(var.var_value.str_value.str());
         } else {
             throw mx::Exception("PUSH: unsupported variable type");
         }
@@ -1733,7 +1656,7 @@ namespace mxvm {
         } else if (src.type == VarType::VAR_FLOAT) {
             value = src.var_value.float_value;
         } else if (src.type == VarType::VAR_STRING) {
-            value = src.var_value.str_value;
+            value = src.var_value.str_value.str();
         } else {
             throw mx::Exception("STACK_STORE: unsupported variable type");
         }
@@ -1764,6 +1687,8 @@ namespace mxvm {
         if (it != labels.end()) {
             stack.push(static_cast<int64_t>(pc + 1));
             pc = it->second.first;
+            if (profiler)
+                profiler->enter(pc);
         } else {
             throw mx::Exception("CALL Label not found: " + instr.op1.op);
         }
@@ -1778,10 +1703,13 @@ namespace mxvm {
             throw mx::Exception("RET: return address on stack is not an integer");
         }
         pc = static_cast<size_t>(std::get<int64_t>(value)) - 1;
+        if (profiler)
+            profiler->leave();
     }
 
     void Program::exec_done(const Instruction &i) {
         exitCode = 0;
+        flushOutput();
         stop();
     }
 
@@ -1936,6 +1864,7 @@ namespace mxvm {
 
         size_t newBytes = static_cast<size_t>(count) * static_cast<size_t>(size);
         size_t oldBytes = static_cast<size_t>(dest.var_value.ptr_count) * static_cast<size_t>(dest.var_value.ptr_size);
+        MXVM_STAT(context, ++stats->reallocs; stats->realloc_bytes += newBytes);
 
         if (count == 0) {
             // SetLength(arr, 0) — free the memory
@@ -1969,7 +1898,15 @@ namespace mxvm {
         dest.var_value.owns = true;
     }
 
-    Variable Program::createTempVariable(VarType type, const std::string &value) {
+    SharedString Program::constantText(const Operand &op) {
+        if (op.text.empty() && !op.op.empty())
+            return SharedString(op.op);
+        return op.text;
+    }
+
+    Variable Program::createTempVariable(VarType type, const Operand &op) {
+        MXVM_STAT(context, ++stats->temp_variables);
+        const std::string &value = op.op;
         Variable temp;
         temp.type = type;
         temp.var_name = "";
@@ -1982,13 +1919,14 @@ namespace mxvm {
             temp.var_value.float_value = std::stod(value);
             temp.var_value.type = VarType::VAR_FLOAT;
         } else if (type == VarType::VAR_STRING) {
-            temp.var_value.str_value = value;
+            temp.var_value.str_value = constantText(op);
             temp.var_value.type = VarType::VAR_STRING;
         }
         return temp;
     }
 
-    void Program::setVariableFromConstant(Variable &var, const std::string &value) {
+    void Program::setVariableFromConstant(Variable &var, const Operand &op) {
+        const std::string &value = op.op;
         if (var.type == VarType::VAR_INTEGER) {
             var.var_value.int_value = std::stoll(value, nullptr, 0);
             var.var_value.type = VarType::VAR_INTEGER;
@@ -1996,7 +1934,7 @@ namespace mxvm {
             var.var_value.float_value = std::stod(value);
             var.var_value.type = VarType::VAR_FLOAT;
         } else if (var.type == VarType::VAR_STRING) {
-            var.var_value.str_value = value;
+            var.var_value.str_value = constantText(op);
             var.var_value.type = VarType::VAR_STRING;
         } else if (var.type == VarType::VAR_POINTER) {
             if (value == "null" || value == "NULL" || value == "0") {
@@ -2054,9 +1992,17 @@ namespace mxvm {
     }
 
     void Program::exec_invoke(const Instruction &instr) {
-        auto it = external_functions.find(instr.op1.op);
-        if (it == external_functions.end()) {
-            throw mx::Exception("INVOKE: external function not found: " + instr.op1.op);
+        // Each call site looks its function up once; later executions reuse the cached entry
+        bool site = pc < invoke_cache.size() && &inc[pc] == &instr;
+        RuntimeFunction *fn = site ? invoke_cache[pc] : nullptr;
+        if (fn == nullptr) {
+            auto it = external_functions.find(instr.op1.op);
+            if (it == external_functions.end()) {
+                throw mx::Exception("INVOKE: external function not found: " + instr.op1.op);
+            }
+            fn = &it->second;
+            if (site)
+                invoke_cache[pc] = fn;
         }
 
         std::vector<Operand> args;
@@ -2086,7 +2032,13 @@ namespace mxvm {
             process_operand(vop);
         }
 
-        it->second.call(this, args);
+        if (profiler) {
+            auto start = std::chrono::steady_clock::now();
+            fn->call(this, args);
+            profiler->invoked(instr.op1.op, std::chrono::steady_clock::now() - start);
+        } else {
+            fn->call(this, args);
+        }
         result.op = "%rax";
     }
 
@@ -2124,7 +2076,7 @@ namespace mxvm {
         if (isVariable(op.op)) {
             return getVariable(op.op);
         } else if (op.type == OperandType::OP_CONSTANT) {
-            return createTempVariable(VarType::VAR_INTEGER, op.op);
+            return createTempVariable(VarType::VAR_INTEGER, op);
         }
         throw mx::Exception("Could not create variable from operand: " + op.op);
     }
@@ -2137,13 +2089,13 @@ namespace mxvm {
         if (isVariable(instr.op1.op)) {
             var1 = &getVariable(instr.op1.op);
         } else {
-            temp1 = createTempVariable(VarType::VAR_FLOAT, instr.op1.op);
+            temp1 = createTempVariable(VarType::VAR_FLOAT, instr.op1);
             var1 = &temp1;
         }
         if (isVariable(instr.op2.op)) {
             var2 = &getVariable(instr.op2.op);
         } else {
-            temp2 = createTempVariable(VarType::VAR_FLOAT, instr.op2.op);
+            temp2 = createTempVariable(VarType::VAR_FLOAT, instr.op2);
             var2 = &temp2;
         }
 
@@ -9,7 +9,7 @@
 
 namespace mxvm {
 
-    static int error_label_count = 0;
+    static thread_local int error_label_count = 0;
 
     std::string Program::getPlatformSymbolName(const std::string &name) {
         if (platform == Platform::DARWIN) {
@@ -183,7 +183,7 @@ namespace mxvm {
             }
         }
 
-        if (base != nullptr) {
+        if (context->base != nullptr) {
 
             for (auto &v : var_names) {
                 auto varx = getVariable(v);
@@ -313,9 +313,12 @@ namespace mxvm {
             out << "\n\n\n.section .note.GNU-stack,\"\",@progbits\n\n";
 
         std::string mainFunc = " Object";
-        if (root_name == name)
+        if (context->root_name == name)
             mainFunc = " Program";
-        std::cout << Col("MXVM: Compiled: ", mx::Color::BRIGHT_BLUE) << name << ".s" << mainFunc << Col(" platform: ", mx::Color::BRIGHT_CYAN) << ((platform == Platform::LINUX) ? "Linux" : "macOS") << "\n";
+        // Built as one string so lines from concurrent object builds do not interleave
+        std::ostringstream compiled;
+        compiled << Col("MXVM: Compiled: ", mx::Color::BRIGHT_BLUE) << name << ".s" << mainFunc << Col(" platform: ", mx::Color::BRIGHT_CYAN) << ((platform == Platform::LINUX) ? "Linux" : "macOS") << "\n";
+        std::cout << compiled.str();
     }
 
     void Program::generateInstruction(std::ostream &out, const Instruction &i) {
@@ -1276,7 +1279,7 @@ namespace mxvm {
         if (dest.type != VarType::VAR_STRING || dest.var_value.buffer_size == 0) {
             throw mx::Exception("GETLINE destination must be a string buffer variable");
         }
-        static int over_count = 0;
+        static thread_local int over_count = 0;
         out << "\tleaq " << getMangledName(i.op1) << "(%rip), %rdi\n";
         out << "\tmovq $" << dest.var_value.buffer_size << ", %rsi\n";
         out << "\tmovq " << getPlatformSymbolName("stdin") << "(%rip), %rdx\n";
@@ -13,9 +13,7 @@
 
 namespace mxvm {
 
-    static unsigned x64_sp_mod16 = 0;
-    extern size_t xmm_offset;
-    static int error_label_count = 0;
+    static thread_local int error_label_count = 0;
 
     std::string Program::x64_getRegisterByIndex(int index, VarType type) {
         if (type == VarType::VAR_FLOAT) {
@@ -326,6 +324,7 @@ namespace mxvm {
         }
 
         x64_analyzeRegAlloc(uses_std_module);
+        x64_sp_mod16 = 0;
 
         out << ".section .data\n";
 
@@ -358,7 +357,7 @@ namespace mxvm {
             }
         }
 
-        if (base != nullptr) {
+        if (context->base != nullptr) {
             for (auto &v : var_names) {
                 auto varx = getVariable(v);
                 if (varx.is_global || object) {
@@ -468,9 +467,12 @@ namespace mxvm {
         out << "\n\n";
 
         std::string mainFunc = " Object";
-        if (root_name == name)
+        if (context->root_name == name)
             mainFunc = " Program";
-        std::cout << Col("MXVM: Compiled: ", mx::Color::BRIGHT_BLUE) << name << ".s" << mainFunc << Col(" platform: ", mx::Color::BRIGHT_CYAN) << "Windows" << "\n";
+        // Built as one string so lines from concurrent object builds do not interleave
+        std::ostringstream compiled;
+        compiled << Col("MXVM: Compiled: ", mx::Color::BRIGHT_BLUE) << name << ".s" << mainFunc << Col(" platform: ", mx::Color::BRIGHT_CYAN) << "Windows" << "\n";
+        std::cout << compiled.str();
     }
 
     void Program::x64_gen_done(std::ostream &out, const Instruction &) {
@@ -1359,7 +1361,7 @@ namespace mxvm {
         out << "\tcall fgets\n";
         x64_release_call_area(out, total);
 
-        static size_t over_count = 0;
+        static thread_local size_t over_count = 0;
         out << "\ttest %rax, %rax\n";
         out << "\tje .over" << over_count << "\n";
 
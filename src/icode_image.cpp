@@ -0,0 +1,418 @@
+/**
+ * @file icode_image.cpp
+ * @brief Precompiled bytecode image (.mxb) — serialisation and memory-mapped loading of parsed programs
+ * @author Jared Bruni
+ */
+#include "mxvm/icode.hpp"
+#include "scanner/exception.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#ifdef _WIN32
+#include <sstream>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace mxvm {
+
+    /*
+     * Image layout (all integers little-endian, no alignment requirements):
+     *
+     *   header       magic "MXB\0", version, opcode count, string count,
+     *                offsets of the string table and the root program record
+     *   strings      string_count x { u64 offset, u64 length } followed by the bytes;
+     *                every name, operand and literal is an index into this pool
+     *   programs     the root program record, whose objects follow recursively
+     *
+     * Offsets are relative to the start of the file, so an image can be mapped
+     * anywhere. Module imports are stored relative to the module path and are
+     * resolved again when the image is loaded.
+     */
+    static constexpr char image_magic[4] = {'M', 'X', 'B', '\0'};
+    static constexpr uint32_t image_version = 2;
+    static constexpr size_t image_header_size = 4 + 4 + 4 + 4 + 8 + 8;
+
+    /** @brief Reads and writes Program state in the .mxb format (friend of Program) */
+    class Image {
+      public:
+        /** @brief Serialise a root program and its objects into a complete image */
+        static std::string write(Program &program) {
+            Image img;
+            img.writeProgram(program);
+            std::string out;
+            img.header(out);
+            out += img.body;
+            return out;
+        }
+
+        /** @brief Populate a root program from a mapped image */
+        static void read(Program &program, const unsigned char *data, size_t size, const std::string &module_path) {
+            Image img;
+            img.data = data;
+            img.size = size;
+            img.module_path = module_path;
+            img.readHeader();
+            img.readProgram(program);
+        }
+
+      private:
+        std::string body;
+        std::vector<std::string> strings;
+        std::unordered_map<std::string, uint32_t> string_index;
+
+        const unsigned char *data = nullptr;
+        size_t size = 0;
+        size_t pos = 0;
+        std::vector<std::pair<uint64_t, uint64_t>> string_table;
+        std::string module_path;
+
+        void put8(uint8_t v) { body += static_cast<char>(v); }
+
+        void put32(uint32_t v) {
+            for (int i = 0; i < 4; ++i)
+                body += static_cast<char>((v >> (i * 8)) & 0xFF);
+        }
+
+        void put64(uint64_t v) {
+            for (int i = 0; i < 8; ++i)
+                body += static_cast<char>((v >> (i * 8)) & 0xFF);
+        }
+
+        void putStr(const std::string &s) {
+            auto it = string_index.find(s);
+            if (it == string_index.end()) {
+                it = string_index.emplace(s, static_cast<uint32_t>(strings.size())).first;
+                strings.push_back(s);
+            }
+            put32(it->second);
+        }
+
+        void header(std::string &out) {
+            std::string saved = std::move(body);
+            body.clear();
+            uint64_t table = image_header_size;
+            uint64_t bytes = table + strings.size() * 16;
+            uint64_t total = bytes;
+            for (const auto &s : strings)
+                total += s.size();
+            body.append(image_magic, 4);
+            put32(image_version);
+            put32(static_cast<uint32_t>(IncType.size()));
+            put32(static_cast<uint32_t>(strings.size()));
+            put64(table);
+            put64(total);
+            for (const auto &s : strings) {
+                put64(bytes);
+                put64(s.size());
+                bytes += s.size();
+            }
+            for (const auto &s : strings)
+                body += s;
+            out = std::move(body);
+            body = std::move(saved);
+        }
+
+        void writeOperand(const Operand &op) {
+            putStr(op.label);
+            putStr(op.op);
+            put32(static_cast<uint32_t>(op.op_value));
+            put8(static_cast<uint8_t>(op.type));
+            putStr(op.object);
+            put8(op.text.empty() ? 0 : 1);
+        }
+
+        void writeProgram(Program &p) {
+            putStr(p.name);
+            putStr(p.filename);
+            putStr(p.context->root_name);
+            put8(p.object);
+            put8(p.object_external);
+
+            put32(static_cast<uint32_t>(p.inc.size()));
+            for (const auto &i : p.inc) {
+                put32(static_cast<uint32_t>(i.instruction));
+                writeOperand(i.op1);
+                writeOperand(i.op2);
+                writeOperand(i.op3);
+                put32(static_cast<uint32_t>(i.vop.size()));
+                for (const auto &op : i.vop)
+                    writeOperand(op);
+                putStr(i.label);
+            }
+
+            // Hash maps are written in key order so the same source always yields the same image
+            std::vector<std::string> keys;
+            for (const auto &v : p.vars)
+                keys.push_back(v.first);
+            std::sort(keys.begin(), keys.end());
+            put32(static_cast<uint32_t>(keys.size()));
+            for (const auto &k : keys) {
+                const Variable &v = p.vars.at(k);
+                putStr(k);
+                put32(static_cast<uint32_t>(v.type));
+                putStr(v.var_name);
+                put8(v.is_global);
+                putStr(v.obj_name);
+                const Variable_Value &val = v.var_value;
+                put32(static_cast<uint32_t>(val.type));
+                putStr(val.str_value);
+                putStr(val.label_value);
+                put64(val.type == VarType::VAR_POINTER || val.type == VarType::VAR_EXTERN ? 0 : static_cast<uint64_t>(val.int_value));
+                put64(val.ptr_size);
+                put64(val.ptr_count);
+                put64(val.buffer_size);
+            }
+
+            keys.clear();
+            for (const auto &l : p.labels)
+                keys.push_back(l.first);
+            std::sort(keys.begin(), keys.end());
+            put32(static_cast<uint32_t>(keys.size()));
+            for (const auto &k : keys) {
+                putStr(k);
+                put64(p.labels.at(k).first);
+                put8(p.labels.at(k).second);
+            }
+
+            put32(static_cast<uint32_t>(p.external.size()));
+            for (const auto &e : p.external) {
+                putStr(e.name);
+                putStr(e.mod);
+                put8(e.module);
+            }
+
+            keys.clear();
+            for (const auto &f : p.external_functions)
+                keys.push_back(f.first);
+            std::sort(keys.begin(), keys.end());
+            put32(static_cast<uint32_t>(keys.size()));
+            for (const auto &k : keys) {
+                const RuntimeFunction &f = p.external_functions.at(k);
+                std::string rel = f.mod_path;
+                auto mod_dir = rel.rfind("modules/");
+                if (mod_dir != std::string::npos)
+                    rel = rel.substr(mod_dir);
+                putStr(k);
+                putStr(f.mod_name);
+                putStr(f.fname);
+                putStr(rel);
+            }
+
+            put32(static_cast<uint32_t>(p.objects.size()));
+            for (auto &obj : p.objects)
+                writeProgram(*obj);
+        }
+
+        void need(size_t n) {
+            if (n > size || pos > size - n)
+                throw mx::Exception("Bytecode image is truncated or corrupt");
+        }
+
+        uint8_t get8() {
+            need(1);
+            return data[pos++];
+        }
+
+        uint32_t get32() {
+            need(4);
+            uint32_t v = 0;
+            for (int i = 0; i < 4; ++i)
+                v |= static_cast<uint32_t>(data[pos++]) << (i * 8);
+            return v;
+        }
+
+        uint64_t get64() {
+            need(8);
+            uint64_t v = 0;
+            for (int i = 0; i < 8; ++i)
+                v |= static_cast<uint64_t>(data[pos++]) << (i * 8);
+            return v;
+        }
+
+        std::string getStr() {
+            uint32_t id = get32();
+            if (id >= string_table.size())
+                throw mx::Exception("Bytecode image string index out of range");
+            return std::string(reinterpret_cast<const char *>(data) + string_table[id].first, string_table[id].second);
+        }
+
+        void readHeader() {
+            need(image_header_size);
+            if (std::memcmp(data, image_magic, 4) != 0)
+                throw mx::Exception("Not an MXVM bytecode image");
+            pos = 4;
+            uint32_t version = get32();
+            if (version != image_version)
+                throw mx::Exception("Bytecode image version " + std::to_string(version) + " is not supported (expected " + std::to_string(image_version) + "), rebuild it with -a image");
+            if (get32() != IncType.size())
+                throw mx::Exception("Bytecode image was built for a different instruction set, rebuild it with -a image");
+            uint32_t count = get32();
+            uint64_t table = get64();
+            uint64_t program_offset = get64();
+            pos = table;
+            string_table.reserve(count);
+            for (uint32_t i = 0; i < count; ++i) {
+                uint64_t off = get64();
+                uint64_t len = get64();
+                if (off > size || len > size - off)
+                    throw mx::Exception("Bytecode image string table is corrupt");
+                string_table.emplace_back(off, len);
+            }
+            pos = program_offset;
+        }
+
+        Operand readOperand() {
+            Operand op;
+            op.label = getStr();
+            op.op = getStr();
+            op.op_value = static_cast<int>(get32());
+            op.type = static_cast<OperandType>(get8());
+            op.object = getStr();
+            if (get8() != 0)
+                op.text = SharedString::intern(op.op);
+            return op;
+        }
+
+        void readProgram(Program &p) {
+            p.name = getStr();
+            p.filename = getStr();
+            std::string root_name = getStr();
+            if (!root_name.empty())
+                p.context->root_name = root_name;
+            p.object = get8() != 0;
+            p.object_external = get8() != 0;
+
+            uint32_t count = get32();
+            p.inc.reserve(count);
+            for (uint32_t n = 0; n < count; ++n) {
+                Instruction i;
+                uint32_t opcode = get32();
+                if (opcode >= IncType.size())
+                    throw mx::Exception("Bytecode image contains an invalid opcode");
+                i.instruction = static_cast<Inc>(opcode);
+                i.op1 = readOperand();
+                i.op2 = readOperand();
+                i.op3 = readOperand();
+                uint32_t extra = get32();
+                for (uint32_t e = 0; e < extra; ++e)
+                    i.vop.push_back(readOperand());
+                i.label = getStr();
+                p.inc.push_back(std::move(i));
+            }
+
+            count = get32();
+            p.vars.reserve(count);
+            for (uint32_t n = 0; n < count; ++n) {
+                std::string key = getStr();
+                Variable v;
+                v.type = static_cast<VarType>(get32());
+                v.var_name = getStr();
+                v.is_global = get8() != 0;
+                v.obj_name = getStr();
+                v.var_value.type = static_cast<VarType>(get32());
+                v.var_value.str_value = SharedString::intern(getStr());
+                v.var_value.label_value = SharedString::intern(getStr());
+                v.var_value.int_value = static_cast<int64_t>(get64());
+                if (v.var_value.type == VarType::VAR_POINTER || v.var_value.type == VarType::VAR_EXTERN)
+                    v.var_value.ptr_value = nullptr;
+                v.var_value.ptr_size = get64();
+                v.var_value.ptr_count = get64();
+                v.var_value.buffer_size = get64();
+                p.add_variable(key, v);
+            }
+
+            count = get32();
+            for (uint32_t n = 0; n < count; ++n) {
+                std::string label = getStr();
+                uint64_t address = get64();
+                p.add_label(label, address, get8() != 0);
+            }
+
+            count = get32();
+            for (uint32_t n = 0; n < count; ++n) {
+                std::string fname = getStr();
+                std::string mod = getStr();
+                p.add_extern(mod, fname, get8() != 0);
+            }
+
+            count = get32();
+            for (uint32_t n = 0; n < count; ++n) {
+                std::string key = getStr();
+                std::string mod_name = getStr();
+                std::string symbol = getStr();
+                std::string path = resolveModule(getStr());
+                p.add_runtime_extern(mod_name, path, symbol, key);
+            }
+
+            count = get32();
+            for (uint32_t n = 0; n < count; ++n) {
+                auto obj = std::make_unique<Program>();
+                obj->shareContext(p);
+                obj->platform = p.platform;
+                readProgram(*obj);
+                if (obj->mainBase() != nullptr && obj->object)
+                    obj->add_object(obj->name, obj.get());
+                p.objects.push_back(std::move(obj));
+            }
+        }
+
+        std::string resolveModule(const std::string &rel) {
+            if (!rel.starts_with("modules/"))
+                return rel;
+            std::string path = module_path;
+            if (!path.ends_with("/"))
+                path += "/";
+            return path + rel;
+        }
+    };
+
+    void Program::saveImage(const std::string &path) {
+        std::string image = Image::write(*this);
+        std::ofstream file(path, std::ios::out | std::ios::binary);
+        if (!file.is_open())
+            throw mx::Exception("Could not create bytecode image: " + path);
+        file.write(image.data(), static_cast<std::streamsize>(image.size()));
+        if (!file)
+            throw mx::Exception("Error writing bytecode image: " + path);
+    }
+
+    void Program::loadImage(const std::string &path, const std::string &module_path) {
+#ifdef _WIN32
+        std::ifstream file(path, std::ios::in | std::ios::binary);
+        if (!file.is_open())
+            throw mx::Exception("Could not open bytecode image: " + path);
+        std::ostringstream stream;
+        stream << file.rdbuf();
+        std::string image = stream.str();
+        Image::read(*this, reinterpret_cast<const unsigned char *>(image.data()), image.size(), module_path);
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw mx::Exception("Could not open bytecode image: " + path);
+        struct stat st;
+        if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+            close(fd);
+            throw mx::Exception("Bytecode image is empty: " + path);
+        }
+        size_t length = static_cast<size_t>(st.st_size);
+        void *map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED)
+            throw mx::Exception("Could not map bytecode image: " + path);
+        try {
+            Image::read(*this, static_cast<const unsigned char *>(map), length, module_path);
+        } catch (...) {
+            munmap(map, length);
+            throw;
+        }
+        munmap(map, length);
+#endif
+    }
+
+} // namespace mxvm
@@ -0,0 +1,59 @@
+/**
+ * @file line_reader.cpp
+ * @brief Reusable-buffer line reader for getline and the io module
+ * @author Jared Bruni
+ */
+#include "mxvm/line_reader.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <sys/types.h>
+
+namespace mxvm {
+
+    LineReader::~LineReader() {
+        std::free(buffer);
+    }
+
+    bool LineReader::read(FILE *fp, std::string_view &line) {
+        line = {};
+        if (fp == nullptr)
+            return false;
+#ifndef _WIN32
+        ssize_t n = ::getline(&buffer, &capacity, fp);
+        if (n < 0)
+            return false;
+        size_t len = static_cast<size_t>(n);
+#else
+        size_t len = 0;
+        for (;;) {
+            if (capacity - len < 2) {
+                size_t grown = capacity == 0 ? 4096 : capacity * 2;
+                char *p = static_cast<char *>(std::realloc(buffer, grown));
+                if (p == nullptr)
+                    return false;
+                buffer = p;
+                capacity = grown;
+            }
+            if (std::fgets(buffer + len, static_cast<int>(capacity - len), fp) == nullptr)
+                break;
+            len += std::strlen(buffer + len);
+            if (buffer[len - 1] == '\n')
+                break;
+        }
+        if (len == 0)
+            return false;
+#endif
+        if (len > 0 && buffer[len - 1] == '\n')
+            --len;
+        line = std::string_view(buffer, len);
+        return true;
+    }
+
+    bool LineReader::read(FILE *fp, std::string &line) {
+        std::string_view view;
+        bool ok = read(fp, view);
+        line.assign(view);
+        return ok;
+    }
+
+} // namespace mxvm
@@ -0,0 +1,30 @@
+/**
+ * @file output.cpp
+ * @brief Buffered stdout used by the interpreter's PRINT instruction
+ * @author Jared Bruni
+ */
+#include "mxvm/output.hpp"
+#include <cstdio>
+#include <unistd.h>
+
+namespace mxvm {
+
+    void setOutputBuffer(size_t size) {
+        if (size == 0)
+            size = output_buffer_default;
+        // Never freed: stdio flushes stdout during exit(), after static destructors have run
+        char *buffer = new char[size];
+        int mode = isatty(fileno(stdout)) ? _IOLBF : _IOFBF;
+        if (std::setvbuf(stdout, buffer, mode, size) != 0)
+            delete[] buffer;
+    }
+
+    void writeOutput(const char *data, size_t len) {
+        std::fwrite(data, 1, len, stdout);
+    }
+
+    void flushOutput() {
+        std::fflush(stdout);
+    }
+
+} // namespace mxvm
@@ -5,15 +5,21 @@
  */
 #include "mxvm/parser.hpp"
 #include "mxvm/ast.hpp"
+#include "mxvm/cache.hpp"
 #include "mxvm/icode.hpp"
 #include "scanner/exception.hpp"
 #include "scanner/scanner.hpp"
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <exception>
 #include <filesystem>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
 #include <set>
+#include <sstream>
+#include <thread>
 #include <unordered_map>
 
 namespace {
@@ -89,6 +95,35 @@ namespace {
         }
         return html_escape(out);
     }
+
+    /** @brief Marks an object file as being loaded until the scope ends, however it ends */
+    class ProcessingGuard {
+      public:
+        ProcessingGuard(std::set<std::string> &files, const std::string &name) : files(files), name(name) { files.insert(name); }
+        ProcessingGuard(const ProcessingGuard &) = delete;
+        ProcessingGuard &operator=(const ProcessingGuard &) = delete;
+        ~ProcessingGuard() { files.erase(name); }
+
+      private:
+        std::set<std::string> &files;
+        std::string name;
+    };
+
+    /** @brief Background colour for a profiled row, on a log scale so cold code stays visible next to a hot loop */
+    static std::string heat_style(uint64_t count, uint64_t hottest) {
+        if (count == 0 || hottest == 0)
+            return "";
+        double t = std::log1p(static_cast<double>(count)) / std::log1p(static_cast<double>(hottest));
+        std::ostringstream style;
+        style << std::fixed << std::setprecision(2) << " style=\"background: rgba(255, 82, 82, " << (0.08 + 0.62 * t) << ");\"";
+        return style.str();
+    }
+
+    static std::string percent_text(uint64_t part, uint64_t whole) {
+        std::ostringstream text;
+        text << std::fixed << std::setprecision(2) << (whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(whole)) << "%";
+        return text.str();
+    }
 } // namespace
 
 namespace mxvm {
@@ -265,11 +300,11 @@ namespace mxvm {
     }
 
     void Parser::processObjectFile(const std::string &src, std::unique_ptr<Program> &program) {
-        static std::set<std::string> processing_files;
+        std::set<std::string> &processing_files = program->context->processing_files;
         if (processing_files.count(src)) {
             return;
         }
-        processing_files.insert(src);
+        ProcessingGuard processing(processing_files, src);
         std::fstream file;
         std::string path;
         if (object_path.ends_with("/"))
@@ -314,6 +349,7 @@ namespace mxvm {
 
         for (const auto &inlineObj : ast->inlineObjects) {
             auto objProgram = std::make_unique<Program>();
+            objProgram->shareContext(*program);
             objProgram->name = inlineObj->name;
             objProgram->object = true;
             objProgram->object_external = true;
@@ -335,14 +371,13 @@ namespace mxvm {
                 }
             }
 
-            if (Program::base != nullptr && objProgram->object)
-                Program::base->add_object(objProgram->name, objProgram.get());
+            if (objProgram->mainBase() != nullptr && objProgram->object)
+                objProgram->add_object(objProgram->name, objProgram.get());
 
             registerObjectExterns(program, objProgram);
 
             program->objects.push_back(std::move(objProgram));
         }
-        processing_files.erase(src);
     }
     std::unique_ptr<SectionNode> Parser::parseSection(uint64_t &index) {
         index++;
@@ -663,6 +698,7 @@ namespace mxvm {
             case types::TokenType::TT_STR:
                 operand.op = value;
                 operand.type = OperandType::OP_CONSTANT;
+                operand.text = SharedString::intern(value);
                 break;
 
             case types::TokenType::TT_SYM:
@@ -736,20 +772,22 @@ namespace mxvm {
 
     bool Parser::generateProgramCode(const Mode &mode, std::unique_ptr<Program> &program) {
         parser_mode = mode;
-        try {
-            if (!validator.validate(program->filename)) {
+        if (validate_source) {
+            try {
+                if (!validator.validate(program->filename)) {
+                    return false;
+                }
+            } catch (mx::Exception &e) {
+                std::cerr << e.what() << "\n";
                 return false;
             }
-        } catch (mx::Exception &e) {
-            std::cerr << e.what() << "\n";
-            return false;
         }
 
         auto ast = parseAST();
         if (ast) {
             program->name = ast->name;
             if (!ast->root_name.empty()) {
-                program->root_name = ast->root_name;
+                program->context->root_name = ast->root_name;
                 program->name = ast->root_name;
                 program->object = false;
             } else {
@@ -774,6 +812,7 @@ namespace mxvm {
 
             for (const auto &inlineObj : ast->inlineObjects) {
                 auto objProgram = std::make_unique<Program>();
+                objProgram->shareContext(*program);
                 objProgram->name = inlineObj->name;
                 objProgram->object = true;
                 objProgram->object_external = false;
@@ -799,36 +838,90 @@ namespace mxvm {
 
                 registerObjectExterns(program, objProgram);
 
-                if (Program::base != nullptr && objProgram->object)
-                    Program::base->add_object(objProgram->name, objProgram.get());
+                if (objProgram->mainBase() != nullptr && objProgram->object)
+                    objProgram->add_object(objProgram->name, objProgram.get());
 
                 program->objects.push_back(std::move(objProgram));
             }
 
             if (mode == Mode::MODE_COMPILE) {
                 std::set<std::string> generated_objects;
+                std::vector<std::unique_ptr<Program> *> pending;
 
-                std::function<void(std::unique_ptr<Program> &)> compileAllObjects;
-                compileAllObjects =
+                std::function<void(std::unique_ptr<Program> &)> collectAllObjects;
+                collectAllObjects =
                     [&](std::unique_ptr<Program> &p) {
                         if (!p)
                             return;
                         for (auto &obj : p->objects) {
                             if (obj && generated_objects.find(obj->name) == generated_objects.end()) {
-                                generateObjectAssemblyFile(obj);
+                                pending.push_back(&obj);
                                 generated_objects.insert(obj->name);
-                                if (html_mode) {
-                                    std::ofstream htmlFile(obj->name + ".html");
-                                    if (htmlFile.is_open()) {
-                                        generateDebugHTML(htmlFile, obj);
-                                        std::cout << Col("MXVM: Generated ", mx::Color::BRIGHT_GREEN) << "Debug HTML for: " << obj->name << "\n";
-                                    }
-                                }
                             }
-                            compileAllObjects(obj);
+                            collectAllObjects(obj);
                         }
                     };
-                compileAllObjects(program);
+                collectAllObjects(program);
+
+                // Keys read the declarations of every object, so take them all before any
+                // worker starts adding to its own object during code generation
+                std::vector<std::string> keys(pending.size());
+                if (BuildCache(cache_dir).enabled()) {
+                    for (size_t i = 0; i < pending.size(); ++i)
+                        keys[i] = BuildCache::sourceKey(**pending[i], "object");
+                }
+
+                // Code generation only reads the shared program tree, so each
+                // object's assembly can be produced on its own worker
+                std::vector<std::exception_ptr> errors(pending.size());
+                std::atomic<size_t> next_object{0};
+                auto worker = [&]() {
+                    for (size_t i = next_object++; i < pending.size(); i = next_object++) {
+                        try {
+                            generateObjectAssemblyFile(*pending[i], keys[i]);
+                        } catch (...) {
+                            errors[i] = std::current_exception();
+                        }
+                    }
+                };
+                size_t threads = std::min<size_t>(std::max(1u, jobs), pending.size());
+                if (threads <= 1) {
+                    worker();
+                } else {
+                    std::vector<std::thread> pool;
+                    for (size_t t = 0; t < threads; ++t)
+                        pool.emplace_back(worker);
+                    for (auto &th : pool)
+                        th.join();
+                }
+
+                std::exception_ptr first_error;
+                for (size_t i = 0; i < pending.size(); ++i) {
+                    if (!errors[i])
+                        continue;
+                    if (!first_error) {
+                        first_error = errors[i];
+                        continue;
+                    }
+                    try {
+                        std::rethrow_exception(errors[i]);
+                    } catch (const std::exception &e) {
+                        std::cerr << Col("MXVM: Exception: ", mx::Color::RED) << (*pending[i])->name << ": " << e.what() << "\n";
+                    }
+                }
+                if (first_error)
+                    std::rethrow_exception(first_error);
+
+                for (auto *obj : pending) {
+                    (*obj)->add_filename((*obj)->name + ".s");
+                    if (html_mode) {
+                        std::ofstream htmlFile((*obj)->name + ".html");
+                        if (htmlFile.is_open()) {
+                            generateDebugHTML(htmlFile, *obj);
+                            std::cout << Col("MXVM: Generated ", mx::Color::BRIGHT_GREEN) << "Debug HTML for: " << (*obj)->name << "\n";
+                        }
+                    }
+                }
             }
 
             if (program->object == false) {
@@ -942,7 +1035,7 @@ namespace mxvm {
                         out << var.second.var_value.ptr_value;
                     break;
                 case VarType::VAR_LABEL:
-                    out << var.second.var_value.label_value;
+                    out << var.second.var_value.label_value.str();
                     break;
                 default:
                     out << var.second.var_value.int_value;
@@ -1055,6 +1148,64 @@ namespace mxvm {
 )";
     }
 
+    void Parser::printProfileHTML(std::ostream &out, const Profiler &profiler) {
+        const uint64_t all = profiler.total();
+        auto functions = profiler.functionCosts();
+        auto blocks = profiler.blockCosts();
+        uint64_t hottest_function = functions.empty() ? 0 : functions.front().self;
+        uint64_t hottest_block = blocks.empty() ? 0 : blocks.front().second;
+
+        out << R"(<div class="section">
+                    <div class="section-header">
+                        <span class="icon">&#x1F525;</span>
+                        Profile
+                    </div>
+                    <div class="section-content">
+                        <table class="instructions-table">
+                            <thead>
+                                <tr>
+                                    <th>Function</th>
+                                    <th>Calls</th>
+                                    <th>Self</th>
+                                    <th>Self %</th>
+                                    <th>Inclusive</th>
+                                    <th>Inclusive %</th>
+                                </tr>
+                            </thead>
+                            <tbody>)";
+        for (const auto &f : functions) {
+            out << "<tr" << heat_style(f.self, hottest_function) << ">"
+                << "<td class=\"opcode\">" << html_escape(f.name) << "</td>"
+                << "<td class=\"hits\">" << f.calls << "</td>"
+                << "<td class=\"hits\">" << f.self << "</td>"
+                << "<td class=\"hits\">" << percent_text(f.self, all) << "</td>"
+                << "<td class=\"hits\">" << f.inclusive << "</td>"
+                << "<td class=\"hits\">" << percent_text(f.inclusive, all) << "</td></tr>";
+        }
+        out << R"(</tbody>
+                        </table>
+                        <br>
+                        <table class="instructions-table">
+                            <thead>
+                                <tr>
+                                    <th>Hot Block</th>
+                                    <th>Instructions</th>
+                                    <th>%</th>
+                                </tr>
+                            </thead>
+                            <tbody>)";
+        for (size_t b = 0; b < blocks.size() && b < 20; ++b) {
+            out << "<tr" << (b < 5 ? " class=\"hot-block\"" : "") << heat_style(blocks[b].second, hottest_block) << ">"
+                << "<td class=\"operand\">" << html_escape(blocks[b].first) << "</td>"
+                << "<td class=\"hits\">" << blocks[b].second << "</td>"
+                << "<td class=\"hits\">" << percent_text(blocks[b].second, all) << "</td></tr>";
+        }
+        out << R"(</tbody>
+                        </table>
+                    </div>
+                </div>)";
+    }
+
     bool Parser::generateDebugHTML(std::ostream &out, std::unique_ptr<Program> &program) {
         out << R"(<!DOCTYPE html>
                 <html lang="en">
@@ -1221,6 +1372,13 @@ namespace mxvm {
                             font-weight: 600;
                             color: #ff5252;
                         }
+                        .instructions-table tr.hot-block td:first-child {
+                            border-left: 4px solid #ffd740;
+                        }
+                        .hits {
+                            font-family: 'Courier New', monospace;
+                            text-align: right;
+                        }
                         .operand {
                             font-family: 'Courier New', monospace;
                             color: #e0e0e0;
@@ -1314,10 +1472,23 @@ namespace mxvm {
                                     <span class="number">)"
             << program->labels.size() << R"(</span>
                                     <span class="label">Labels</span>
-                                </div>
+                                </div>)";
+        const Profiler *profiler = program->getProfiler();
+        if (profiler) {
+            out << R"(
+                                <div class="stat-card">
+                                    <span class="number">)"
+                << profiler->total() << R"(</span>
+                                    <span class="label">Executed</span>
+                                </div>)";
+        }
+        out << R"(
                             </div>
                         </div>)";
 
+        if (profiler)
+            printProfileHTML(out, *profiler);
+
         if (mainHasContent) {
             out << R"(<div class="section">
                         <div class="section-header">
@@ -1388,7 +1559,7 @@ namespace mxvm {
                             out << var.second.var_value.ptr_value;
                         break;
                     case VarType::VAR_LABEL:
-                        out << var.second.var_value.label_value;
+                        out << var.second.var_value.label_value.str();
                         break;
                     default:
                         out << var.second.var_value.int_value;
@@ -1439,10 +1610,23 @@ namespace mxvm {
             if (program->inc.empty()) {
                 out << R"(<div class="no-data">No instructions defined</div>)";
             } else {
+                // Hottest few blocks get a marker on every row so they stand out when scrolling
+                uint64_t hottest = 0;
+                std::set<std::string> hot_blocks;
+                if (profiler) {
+                    for (size_t i = 0; i < program->inc.size(); ++i)
+                        hottest = std::max(hottest, profiler->count(i));
+                    auto blocks = profiler->blockCosts();
+                    for (size_t b = 0; b < blocks.size() && b < 5; ++b)
+                        hot_blocks.insert(blocks[b].first);
+                }
                 out << R"(<table class="instructions-table">
                             <thead>
                                 <tr>
-                                    <th>#</th>
+                                    <th>#</th>)";
+                if (profiler)
+                    out << "<th>Hits</th><th>Block</th>";
+                out << R"(
                                     <th>Opcode</th>
                                     <th>Instruction</th>
                                     <th>Operand 1</th>
@@ -1455,9 +1639,18 @@ namespace mxvm {
 
                 for (size_t i = 0; i < program->inc.size(); ++i) {
                     const auto &instr = program->inc[i];
-                    out << "<tr>"
-                        << "<td>0x" << std::hex << std::uppercase << i << std::dec << "</td>"
-                        << "<td class=\"opcode\">0x" << std::hex << std::uppercase << static_cast<int>(instr.instruction) << std::dec << "</td>"
+                    if (profiler) {
+                        uint64_t hits = profiler->count(i);
+                        const std::string &block = profiler->blockOf(i);
+                        out << "<tr" << (hot_blocks.count(block) ? " class=\"hot-block\"" : "") << heat_style(hits, hottest) << ">"
+                            << "<td>0x" << std::hex << std::uppercase << i << std::dec << "</td>"
+                            << "<td class=\"hits\">" << hits << "</td>"
+                            << "<td class=\"operand\">" << html_escape(block) << "</td>";
+                    } else {
+                        out << "<tr>"
+                            << "<td>0x" << std::hex << std::uppercase << i << std::dec << "</td>";
+                    }
+                    out << "<td class=\"opcode\">0x" << std::hex << std::uppercase << static_cast<int>(instr.instruction) << std::dec << "</td>"
                         << "<td class=\"opcode-name\">" << html_escape(IncType[static_cast<int>(instr.instruction)]) << "</td>"
                         << "<td class=\"operand\">" << html_escape(instr.op1.op) << "</td>"
                         << "<td class=\"operand\">" << html_escape(instr.op2.op) << "</td>"
@@ -1610,6 +1803,7 @@ namespace mxvm {
         }
         std::ostringstream data;
         data << file.rdbuf();
+        program->context->interface_hash = BuildCache::hash(src + "\n" + data.str(), program->context->interface_hash);
         ModuleParser mod_parser(this->parser_mode, src, data.str());
         if (mod_parser.scan() > 0) {
             if (mod_parser.parse() && mod_parser.generateProgramCode(this->parser_mode, src, module_path_so, program)) {
@@ -1678,7 +1872,7 @@ namespace mxvm {
             var.var_value.type = VarType::VAR_FLOAT;
             break;
         case VarType::VAR_STRING:
-            var.var_value.str_value = value;
+            var.var_value.str_value = SharedString::intern(value);
             var.var_value.type = VarType::VAR_STRING;
             var.var_value.buffer_size = buf_size;
             break;
@@ -1687,13 +1881,13 @@ namespace mxvm {
             var.var_value.ptr_value = nullptr;
             if (value == "null" || value == "0") {
                 var.var_value.ptr_value = nullptr;
-                var.var_value.str_value = "null";
+                var.var_value.str_value = SharedString::intern("null");
             }
             var.var_value.type = VarType::VAR_POINTER;
             break;
 
         case VarType::VAR_LABEL:
-            var.var_value.label_value = value;
+            var.var_value.label_value = SharedString::intern(value);
             var.var_value.type = VarType::VAR_LABEL;
             break;
 
@@ -1786,8 +1980,21 @@ namespace mxvm {
         return program;
     }
 
-    void Parser::generateObjectAssemblyFile(std::unique_ptr<Program> &objProgram) {
+    void Parser::generateObjectAssemblyFile(std::unique_ptr<Program> &objProgram, const std::string &key) {
         std::string objectFileName = objProgram->name + ".s";
+        BuildCache cache(cache_dir);
+        if (cache.enabled()) {
+            if (cache.fetch(key, ".s", objectFileName)) {
+                std::ifstream cached(objectFileName);
+                std::ostringstream code;
+                code << cached.rdbuf();
+                objProgram->assembly_code = code.str();
+                if (debug_mode) {
+                    std::cout << ("Reused cached object assembly file: " + objectFileName + "\n") << std::flush;
+                }
+                return;
+            }
+        }
         std::ofstream objectFile(objectFileName);
         if (!objectFile.is_open()) {
             throw mx::Exception("Could not create object assembly file: " + objectFileName);
@@ -1800,23 +2007,24 @@ namespace mxvm {
         objProgram->assembly_code = opt_code;
         objectFile << opt_code;
         objectFile.close();
+        if (cache.enabled())
+            cache.store(key, ".s", objectFileName);
         if (debug_mode) {
-            std::cout << "Generated object assembly file: " << objectFileName << std::endl;
+            std::cout << ("Generated object assembly file: " + objectFileName + "\n") << std::flush;
         }
-        if (Program::base != nullptr)
-            Program::base->add_filename(objectFileName);
     }
 
     void Parser::registerObjectExterns(std::unique_ptr<Program> &mainProgram,
                                        const std::unique_ptr<Program> &objProgram) {
+        Base *root = mainProgram->mainBase();
         for (const auto &[labelName, labelInfo] : objProgram->labels) {
-            if (labelInfo.second && Program::base != nullptr)
-                Program::base->add_extern(objProgram->name, labelName, false);
+            if (labelInfo.second && root != nullptr)
+                root->add_extern(objProgram->name, labelName, false);
         }
 
         for (const auto &ext : objProgram->external) {
-            if (Program::base != nullptr)
-                Program::base->add_extern(ext.mod, ext.name, true);
+            if (root != nullptr)
+                root->add_extern(ext.mod, ext.name, true);
         }
 
         for (const auto &child : objProgram->objects) {
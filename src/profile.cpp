@@ -0,0 +1,281 @@
+/**
+ * @file profile.cpp
+ * @brief Low-overhead execution profiler for the MXVM interpreter
+ * @author Jared Bruni
+ */
+#include "mxvm/profile.hpp"
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+
+namespace mxvm {
+
+    Profiler::Profiler(const std::vector<Instruction> &code, const std::unordered_map<std::string, std::pair<uint64_t, bool>> &labels, const std::string &entry)
+        : inc(code), hits(code.size(), 0), function_of(code.size(), 0), block_of(code.size(), entry) {
+        std::vector<std::pair<uint64_t, std::string>> sorted_functions;
+        std::vector<std::pair<uint64_t, std::string>> sorted_labels;
+        for (const auto &l : labels) {
+            sorted_labels.emplace_back(l.second.first, l.first);
+            if (l.second.second)
+                sorted_functions.emplace_back(l.second.first, l.first);
+        }
+        std::sort(sorted_functions.begin(), sorted_functions.end());
+        std::sort(sorted_labels.begin(), sorted_labels.end());
+
+        functions.push_back(entry);
+        for (const auto &f : sorted_functions) {
+            if (function_at.count(f.first))
+                continue;
+            function_at[f.first] = functions.size();
+            functions.push_back(f.second);
+        }
+
+        size_t fi = 0, li = 0, owner = 0;
+        std::string block = entry;
+        for (size_t pc = 0; pc < code.size(); ++pc) {
+            while (fi < sorted_functions.size() && sorted_functions[fi].first <= pc) {
+                owner = function_at[sorted_functions[fi].first];
+                ++fi;
+            }
+            while (li < sorted_labels.size() && sorted_labels[li].first <= pc) {
+                block = sorted_labels[li].second;
+                ++li;
+            }
+            function_of[pc] = owner;
+            block_of[pc] = block;
+        }
+
+        root = std::make_unique<Node>();
+        root->function = 0;
+        root->parent = nullptr;
+        root->calls = 1;
+        current = root.get();
+    }
+
+    void Profiler::enter(size_t target) {
+        size_t f = 0;
+        auto it = function_at.find(target);
+        if (it != function_at.end())
+            f = it->second;
+        else if (target < function_of.size())
+            f = function_of[target];
+        if (depth >= max_depth) {
+            ++beyond_edges[beyond.empty() ? current->function : beyond.back()][f];
+            beyond.push_back(f);
+            return;
+        }
+        auto &child = current->children[f];
+        if (!child) {
+            child = std::make_unique<Node>();
+            child->function = f;
+            child->parent = current;
+        }
+        ++child->calls;
+        current = child.get();
+        ++depth;
+    }
+
+    void Profiler::leave() {
+        if (!beyond.empty()) {
+            beyond.pop_back();
+            return;
+        }
+        if (current->parent != nullptr) {
+            current = current->parent;
+            --depth;
+        }
+    }
+
+    void Profiler::invoked(const std::string &name, std::chrono::steady_clock::duration elapsed) {
+        NativeCall &n = native[name];
+        ++n.calls;
+        n.time += elapsed;
+    }
+
+    uint64_t Profiler::total() const {
+        return std::accumulate(hits.begin(), hits.end(), uint64_t{0});
+    }
+
+    uint64_t Profiler::inclusive(const Node &n) const {
+        uint64_t sum = n.self;
+        for (const auto &c : n.children)
+            sum += inclusive(*c.second);
+        return sum;
+    }
+
+    void Profiler::collect(const Node &n, std::vector<uint64_t> &self, std::vector<uint64_t> &incl, std::vector<bool> &on_stack,
+                           std::unordered_map<size_t, std::unordered_map<size_t, uint64_t>> &edges) const {
+        self[n.function] += n.self;
+        // Recursive re-entries are already inside the outer frame's inclusive cost
+        bool outer = !on_stack[n.function];
+        if (outer) {
+            incl[n.function] += inclusive(n);
+            on_stack[n.function] = true;
+        }
+        for (const auto &c : n.children) {
+            edges[n.function][c.first] += c.second->calls;
+            collect(*c.second, self, incl, on_stack, edges);
+        }
+        if (outer)
+            on_stack[n.function] = false;
+    }
+
+    void Profiler::collectAll(std::vector<uint64_t> &self, std::vector<uint64_t> &incl,
+                              std::unordered_map<size_t, std::unordered_map<size_t, uint64_t>> &edges) const {
+        std::vector<bool> on_stack(functions.size(), false);
+        collect(*root, self, incl, on_stack, edges);
+        for (const auto &caller : beyond_edges)
+            for (const auto &callee : caller.second)
+                edges[caller.first][callee.first] += callee.second;
+    }
+
+    static double percent(uint64_t part, uint64_t whole) {
+        return whole == 0 ? 0.0 : 100.0 * static_cast<double>(part) / static_cast<double>(whole);
+    }
+
+    std::vector<Profiler::FunctionCost> Profiler::functionCosts() const {
+        std::vector<uint64_t> self(functions.size(), 0), incl(functions.size(), 0);
+        std::unordered_map<size_t, std::unordered_map<size_t, uint64_t>> edges;
+        collectAll(self, incl, edges);
+        std::vector<FunctionCost> costs(functions.size());
+        for (size_t f = 0; f < functions.size(); ++f) {
+            costs[f].name = functions[f];
+            costs[f].self = self[f];
+            costs[f].inclusive = incl[f];
+        }
+        for (const auto &caller : edges)
+            for (const auto &callee : caller.second)
+                costs[callee.first].calls += callee.second;
+        costs.erase(std::remove_if(costs.begin(), costs.end(), [](const FunctionCost &c) { return c.inclusive == 0; }), costs.end());
+        std::stable_sort(costs.begin(), costs.end(), [](const FunctionCost &a, const FunctionCost &b) { return a.self > b.self; });
+        return costs;
+    }
+
+    std::vector<std::pair<std::string, uint64_t>> Profiler::blockCosts() const {
+        std::unordered_map<std::string, uint64_t> blocks;
+        for (size_t pc = 0; pc < hits.size(); ++pc)
+            if (hits[pc] != 0)
+                blocks[block_of[pc]] += hits[pc];
+        std::vector<std::pair<std::string, uint64_t>> sorted(blocks.begin(), blocks.end());
+        std::sort(sorted.begin(), sorted.end(), [](const auto &a, const auto &b) { return a.second > b.second || (a.second == b.second && a.first < b.first); });
+        return sorted;
+    }
+
+    void Profiler::writeFlat(std::ostream &out) const {
+        const uint64_t all = total();
+        out << "MXVM flat profile: " << all << " instructions executed\n\n";
+        out << std::fixed << std::setprecision(2);
+
+        out << "Functions\n";
+        out << std::setw(8) << "self %" << std::setw(14) << "self" << std::setw(8) << "incl %" << std::setw(14) << "inclusive" << std::setw(10) << "calls" << "  name\n";
+        for (const auto &f : functionCosts()) {
+            out << std::setw(8) << percent(f.self, all) << std::setw(14) << f.self << std::setw(8) << percent(f.inclusive, all) << std::setw(14) << f.inclusive
+                << std::setw(10) << f.calls << "  " << f.name << "\n";
+        }
+
+        out << "\nLabels\n";
+        out << std::setw(8) << "%" << std::setw(14) << "instructions" << "  label\n";
+        for (const auto &b : blockCosts())
+            out << std::setw(8) << percent(b.second, all) << std::setw(14) << b.second << "  " << b.first << "\n";
+
+        std::vector<size_t> hot;
+        for (size_t pc = 0; pc < hits.size(); ++pc)
+            if (hits[pc] != 0)
+                hot.push_back(pc);
+        std::sort(hot.begin(), hot.end(), [&](size_t a, size_t b) { return hits[a] > hits[b] || (hits[a] == hits[b] && a < b); });
+        if (hot.size() > 25)
+            hot.resize(25);
+        out << "\nHot instructions\n";
+        out << std::setw(8) << "%" << std::setw(14) << "count" << std::setw(8) << "pc" << "  instruction\n";
+        for (size_t pc : hot)
+            out << std::setw(8) << percent(hits[pc], all) << std::setw(14) << hits[pc] << std::setw(8) << pc << "  " << inc[pc].toString() << "  [" << block_of[pc] << "]\n";
+
+        if (!native.empty()) {
+            std::vector<std::pair<std::string, NativeCall>> sorted_native(native.begin(), native.end());
+            std::sort(sorted_native.begin(), sorted_native.end(), [](const auto &a, const auto &b) { return a.second.time > b.second.time; });
+            out << "\nNative functions (invoke)\n";
+            out << std::setw(10) << "calls" << std::setw(14) << "total ms" << std::setw(14) << "avg us" << "  name\n";
+            for (const auto &n : sorted_native) {
+                double ms = std::chrono::duration<double, std::milli>(n.second.time).count();
+                out << std::setw(10) << n.second.calls << std::setw(14) << ms << std::setw(14) << (ms * 1000.0 / static_cast<double>(n.second.calls)) << "  " << n.first << "\n";
+            }
+        }
+    }
+
+    void Profiler::writeCallGraph(std::ostream &out) const {
+        const uint64_t all = total();
+        std::vector<uint64_t> self(functions.size(), 0), incl(functions.size(), 0);
+        std::unordered_map<size_t, std::unordered_map<size_t, uint64_t>> edges;
+        collectAll(self, incl, edges);
+
+        std::unordered_map<size_t, std::vector<std::pair<size_t, uint64_t>>> callers, callees;
+        for (const auto &caller : edges) {
+            for (const auto &callee : caller.second) {
+                callees[caller.first].emplace_back(callee.first, callee.second);
+                callers[callee.first].emplace_back(caller.first, callee.second);
+            }
+        }
+        auto by_count = [](const auto &a, const auto &b) { return a.second > b.second || (a.second == b.second && a.first < b.first); };
+
+        std::vector<size_t> order(functions.size());
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return incl[a] > incl[b]; });
+
+        out << "MXVM call graph: " << all << " instructions executed (inclusive cost counts recursion once)\n";
+        out << std::fixed << std::setprecision(2);
+        for (size_t f : order) {
+            if (incl[f] == 0 && callers[f].empty())
+                continue;
+            out << "\n"
+                << functions[f] << "\n";
+            out << "    self " << self[f] << " (" << percent(self[f], all) << "%)  inclusive " << incl[f] << " (" << percent(incl[f], all) << "%)\n";
+            auto &in = callers[f];
+            std::sort(in.begin(), in.end(), by_count);
+            for (const auto &c : in)
+                out << "    <- " << std::setw(10) << c.second << "  " << functions[c.first] << "\n";
+            auto &outgoing = callees[f];
+            std::sort(outgoing.begin(), outgoing.end(), by_count);
+            for (const auto &c : outgoing)
+                out << "    -> " << std::setw(10) << c.second << "  " << functions[c.first] << "\n";
+        }
+    }
+
+    void Profiler::writeFolded(std::ostream &out) const {
+        // Depth-first with an explicit stack; each entry remembers how long the
+        // shared path buffer was at its parent so the buffer is trimmed, not copied
+        std::vector<std::pair<const Node *, size_t>> pending{{root.get(), 0}};
+        std::vector<const Node *> kids;
+        std::string path;
+        while (!pending.empty()) {
+            auto [n, len] = pending.back();
+            pending.pop_back();
+            path.resize(len);
+            if (len != 0)
+                path += ';';
+            path += functions[n->function];
+            if (n->self != 0)
+                out << path << " " << n->self << "\n";
+            kids.clear();
+            for (const auto &c : n->children)
+                kids.push_back(c.second.get());
+            // Reverse order so children are popped, and written, alphabetically
+            std::sort(kids.begin(), kids.end(), [&](const Node *a, const Node *b) { return functions[a->function] > functions[b->function]; });
+            for (const Node *k : kids)
+                pending.emplace_back(k, path.size());
+        }
+    }
+
+    bool Profiler::write(const std::string &prefix) const {
+        std::ofstream flat(prefix + ".profile.txt");
+        std::ofstream graph(prefix + ".callgraph.txt");
+        std::ofstream folded(prefix + ".folded");
+        if (!flat.is_open() || !graph.is_open() || !folded.is_open())
+            return false;
+        writeFlat(flat);
+        writeCallGraph(graph);
+        writeFolded(folded);
+        return flat.good() && graph.good() && folded.good();
+    }
+
+} // namespace mxvm
@@ -0,0 +1,58 @@
+/**
+ * @file shared_string.cpp
+ * @brief The intern table behind SharedString::intern
+ * @author Jared Bruni
+ */
+#include "mxvm/shared_string.hpp"
+#include <mutex>
+#include <unordered_map>
+
+namespace mxvm {
+
+    namespace {
+        // Keys view the text of their own block, which is not moved while it is in the table.
+        // Allocated once and never destroyed, so handles released during static destruction still find it.
+        std::mutex &tableMutex() {
+            static std::mutex *m = new std::mutex;
+            return *m;
+        }
+        template <typename Rep>
+        std::unordered_map<std::string_view, Rep *> &table() {
+            static auto *t = new std::unordered_map<std::string_view, Rep *>;
+            return *t;
+        }
+    } // namespace
+
+    SharedString SharedString::intern(std::string_view s) {
+        if (s.empty())
+            return SharedString();
+        auto &entries = table<Rep>();
+        std::lock_guard<std::mutex> lock(tableMutex());
+        auto it = entries.find(s);
+        if (it != entries.end()) {
+            // A count of zero means the last handle is being released; replace the entry
+            Rep *found = it->second;
+            uint32_t refs = found->refs.load(std::memory_order_relaxed);
+            while (refs != 0 && !found->refs.compare_exchange_weak(refs, refs + 1, std::memory_order_relaxed))
+                ;
+            if (refs != 0)
+                return SharedString(found);
+            entries.erase(it);
+        }
+        Rep *rep = new Rep(std::string(s), true);
+        entries.emplace(std::string_view(rep->text), rep);
+        return SharedString(rep);
+    }
+
+    void SharedString::releaseInterned(Rep *r) noexcept {
+        {
+            auto &entries = table<Rep>();
+            std::lock_guard<std::mutex> lock(tableMutex());
+            auto it = entries.find(std::string_view(r->text));
+            if (it != entries.end() && it->second == r)
+                entries.erase(it);
+        }
+        delete r;
+    }
+
+} // namespace mxvm
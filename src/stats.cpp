@@ -0,0 +1,54 @@
+/**
+ * @file stats.cpp
+ * @brief Interpreter event counters reported by mxvmc --stats
+ * @author Jared Bruni
+ */
+#include "mxvm/stats.hpp"
+#include "mxvm/instruct.hpp"
+#include <algorithm>
+#include <iomanip>
+#include <numeric>
+
+namespace mxvm {
+
+    Stats::Stats() : opcodes(IncType.size(), 0) {}
+
+    void Stats::write(std::ostream &out) const {
+        const uint64_t total = std::accumulate(opcodes.begin(), opcodes.end(), uint64_t{0});
+        out << "MXVM stats\n";
+        out << "  instructions executed  " << total << "\n";
+        out << "  isVariable lookups     " << is_variable << "\n";
+        out << "  getVariable lookups    " << get_variable << "\n";
+        out << "  temp variables         " << temp_variables << "\n";
+        out << "  stack peak depth       " << stack_peak << "\n";
+        out << "  alloc                  " << allocs << " (" << alloc_bytes << " bytes)\n";
+        out << "  realloc                " << reallocs << " (" << realloc_bytes << " bytes)\n";
+        out << "  free                   " << frees << " (" << free_bytes << " bytes)\n";
+
+        std::vector<size_t> order;
+        for (size_t i = 0; i < opcodes.size(); ++i)
+            if (opcodes[i] != 0)
+                order.push_back(i);
+        std::sort(order.begin(), order.end(), [&](size_t a, size_t b) { return opcodes[a] > opcodes[b] || (opcodes[a] == opcodes[b] && a < b); });
+        out << "\nOpcodes\n";
+        // out is usually std::cerr, shared with the program's own output; leave its formatting as it was
+        const std::ios_base::fmtflags flags = out.flags();
+        const std::streamsize precision = out.precision();
+        out << std::fixed << std::setprecision(2);
+        for (size_t i : order) {
+            double pct = total == 0 ? 0.0 : 100.0 * static_cast<double>(opcodes[i]) / static_cast<double>(total);
+            out << std::setw(14) << opcodes[i] << std::setw(8) << pct << "%  " << IncType[i] << "\n";
+        }
+        out.flags(flags);
+        out.precision(precision);
+
+        if (!native_calls.empty()) {
+            std::vector<std::pair<std::string, uint64_t>> calls(native_calls.begin(), native_calls.end());
+            std::stable_sort(calls.begin(), calls.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+            out << "\nNative calls\n";
+            for (const auto &c : calls)
+                out << std::setw(14) << c.second << "  " << c.first << "\n";
+        }
+    }
+
+} // namespace mxvm
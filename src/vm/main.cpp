@@ -5,27 +5,36 @@
  */
 #include "version_info.hpp"
 #include "argz.hpp"
+#include <algorithm>
+#include <cerrno>
 #include <csignal>
-#include <dlfcn.h>
+#include <cstring>
 #include <filesystem>
 #include <fstream>
 #include <iostream>
+#include <map>
 #include <memory>
 #include <mxvm/mxvm.hpp>
 #include <set>
 #include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <vector>
 #ifdef _WIN32
 #include <windows.h>
+#else
+#include <spawn.h>
+#include <sys/wait.h>
+extern char **environ;
 #endif
 
 enum class vm_action {
     null_action = 0,
     translate,
     interpret,
-    compile
+    compile,
+    image
 };
 enum class vm_target {
     x86_64_linux,
@@ -47,6 +56,9 @@ std::ostream &operator<<(std::ostream &out, const vm_action &ae) {
     case vm_action::compile:
         out << "compille";
         break;
+    case vm_action::image:
+        out << "image";
+        break;
     default:
         std::cerr << "Error: ";
         break;
@@ -84,6 +96,20 @@ struct Args {
     bool Makefile = false;
     bool only_test = false;
     std::string toolchain;
+    std::string cache_dir = ".mxvm_cache";
+    unsigned int jobs = 1;
+    bool profile = false;
+    bool stats = false;
+    bool unbuffered = false;
+    size_t output_buffer = mxvm::output_buffer_default;
+};
+
+/** @brief One assembler or linker invocation of the compile step */
+struct BuildCommand {
+    std::vector<std::string> argv; ///< program and arguments
+    std::string output;            ///< file the command produces
+    std::string key;               ///< build cache key of the output
+    bool ok = false;               ///< set once the command has exited successfully
 };
 
 template <typename T>
@@ -96,7 +122,9 @@ void print_help(T &type) {
 
 int process_arguments(Args *args);
 int action_translate(const mxvm::Platform &platform, std::unique_ptr<mxvm::Program> &program, Args *args);
-int action_interpret(bool only_test, std::string_view include_path, std::string_view object_path, const std::vector<std::string> &argv, std::string_view input, std::string_view mod_path);
+int action_image(Args *args);
+bool assemble_and_link(Args *args, std::unique_ptr<mxvm::Program> &program);
+int action_interpret(bool only_test, bool profile, bool stats, std::string_view include_path, std::string_view object_path, const std::vector<std::string> &argv, std::string_view input, std::string_view mod_path);
 int translate_x64(const mxvm::Platform &platform, std::unique_ptr<mxvm::Program> &program, Args *args);
 void collectAndRegisterAllExterns(std::unique_ptr<mxvm::Program> &program);
 void createMakefile(Args *args);
@@ -143,7 +171,7 @@ Args proc_args(int argc, char **argv) {
     args.platform_argv = argv;
     argz.addOptionSingleValue('o', "output file")
         .addOptionSingleValue('a', "action")
-        .addOptionDoubleValue(128, "action", "action to take [translate,  interpret]")
+        .addOptionDoubleValue(128, "action", "action to take [translate, interpret, image]")
         .addOptionSingleValue('t', "target")
         .addOptionDoubleValue(129, "target", "output target: [linux, macos]")
         .addOptionSingle('d', "debug mode")
@@ -164,7 +192,15 @@ Args proc_args(int argc, char **argv) {
         .addOptionDouble(140, "makefile", "generate Makefile")
         .addOptionDouble(141, "dry-run", "check for correctness do not execute")
         .addOptionSingleValue('T', "toolchain prefix")
-        .addOptionDoubleValue(142, "toolchain", "cross-compilation toolchain prefix (e.g. x86_64-w64-mingw32)");
+        .addOptionDoubleValue(142, "toolchain", "cross-compilation toolchain prefix (e.g. x86_64-w64-mingw32)")
+        .addOptionDoubleValue(143, "cache-dir", "build cache directory (default .mxvm_cache)")
+        .addOptionDouble(144, "no-cache", "always regenerate, assemble and link")
+        .addOptionSingleValue('j', "parallel jobs for object codegen and assembly (0 = one per CPU)")
+        .addOptionDoubleValue(145, "jobs", "parallel jobs for object codegen and assembly (0 = one per CPU)")
+        .addOptionDouble(146, "profile", "profile the interpreted program (writes <name>.profile.txt, .callgraph.txt, .folded)")
+        .addOptionDouble(147, "stats", "print interpreter counters (opcodes, lookups, allocations, native calls) at exit")
+        .addOptionDouble(148, "unbuffered", "leave stdout with the C library's default buffering instead of the interpreter's output buffer")
+        .addOptionDoubleValue(149, "output-buffer", "interpreter stdout buffer size in bytes (default 65536)");
 
     if (argc == 1) {
         print_help(argz);
@@ -181,6 +217,44 @@ Args proc_args(int argc, char **argv) {
             case 142:
                 args.toolchain = arg.arg_value;
                 break;
+            case 143:
+                args.cache_dir = arg.arg_value;
+                break;
+            case 144:
+                args.cache_dir.clear();
+                break;
+            case 146:
+                args.profile = true;
+                break;
+            case 147:
+                args.stats = true;
+                break;
+            case 148:
+                args.unbuffered = true;
+                break;
+            case 149:
+                try {
+                    long long n = std::stoll(arg.arg_value);
+                    if (n <= 0)
+                        throw std::invalid_argument(arg.arg_value);
+                    args.output_buffer = static_cast<size_t>(n);
+                } catch (const std::exception &) {
+                    std::cerr << Col("MXVM: Error ", mx::Color::RED) << "invalid output buffer size: " << arg.arg_value << "\n";
+                    exit(EXIT_FAILURE);
+                }
+                break;
+            case 'j':
+            case 145:
+                try {
+                    int n = std::stoi(arg.arg_value);
+                    if (n < 0)
+                        throw std::invalid_argument(arg.arg_value);
+                    args.jobs = n == 0 ? std::max(1u, std::thread::hardware_concurrency()) : static_cast<unsigned int>(n);
+                } catch (const std::exception &) {
+                    std::cerr << Col("MXVM: Error ", mx::Color::RED) << "invalid job count: " << arg.arg_value << "\n";
+                    exit(EXIT_FAILURE);
+                }
+                break;
             case 'm':
             case 140:
                 args.Makefile = true;
@@ -224,6 +298,8 @@ Args proc_args(int argc, char **argv) {
                     args.action = vm_action::interpret;
                 } else if (arg.arg_value == "compile") {
                     args.action = vm_action::compile;
+                } else if (arg.arg_value == "image") {
+                    args.action = vm_action::image;
                 } else {
                     throw mx::ArgException<std::string>("Error invalid action value");
                 }
@@ -258,8 +334,7 @@ Args proc_args(int argc, char **argv) {
 
     if (!args.source_file.empty()) {
         constexpr std::string_view ext = ".mxvm";
-        if (args.source_file.size() < ext.size() ||
-            std::string_view(args.source_file).substr(args.source_file.size() - ext.size()) != ext) {
+        if (!args.source_file.ends_with(ext) && !args.source_file.ends_with(".mxb")) {
             args.source_file += ext;
         }
     }
@@ -296,155 +371,18 @@ int process_arguments(Args *args) {
     program->platform = args->platform;
     if (args->action == vm_action::compile) {
         exitCode = action_translate(args->platform, program, args);
-        if (exitCode == 0) {
-            if (mxvm::Program::base != nullptr && !mxvm::Program::base->root_name.empty()) {
-                if (args->platform == mxvm::Platform::LINUX || args->platform == mxvm::Platform::WINX64) {
-                    std::vector<std::string> object_files;
-                    std::string assembler = args->toolchain.empty() ? "as" : args->toolchain + "-as";
-                    const char *as_env = getenv("AS");
-                    if (as_env != nullptr) {
-                        assembler = as_env;
-                    }
-                    std::string asflags;
-                    const char *asf = getenv("ASFLAGS");
-                    if (asf != nullptr) {
-                        asflags = asf;
-                    }
-
-                    for (auto &f : mxvm::Program::base->filenames) {
-                        std::string obj_file = f;
-                        size_t pos = obj_file.rfind(".s");
-                        if (pos != std::string::npos) {
-                            obj_file.replace(pos, 2, ".o");
-                        } else {
-                            obj_file += ".o";
-                        }
-                        std::ostringstream as_cmd;
-                        as_cmd << assembler << " " << asflags << " " << f << " -o " << obj_file;
-                        std::cout << as_cmd.str() << "\n";
-
-                        int as_result = system(as_cmd.str().c_str());
-                        if (as_result != 0) {
-                            std::cerr << Col("MXVM: ", mx::Color::RED) << "Assembly failed\n";
-                            return EXIT_FAILURE;
-                        }
-                        object_files.push_back(obj_file);
-                    }
-
-                    std::string linker = args->toolchain.empty() ? "cc" : args->toolchain + "-gcc";
-                    const char *cc_env = getenv("CC");
-                    if (cc_env != nullptr) {
-                        linker = cc_env;
-                    }
-                    std::string ldflags;
-                    const char *ldf = getenv("LDFLAGS");
-                    if (ldf != nullptr) {
-                        ldflags = ldf;
-                    }
-                    ldflags += " -lm ";
-
-                    std::ostringstream modules_archives;
-                    std::set<std::string> arch;
-                    for (auto &m : mxvm::Program::base->external) {
-                        if (m.module == true && m.mod != "main" && m.name != "strlen") {
-                            arch.insert(m.mod);
-                        }
-                    }
-
-                    for (auto &m : arch) {
-                        modules_archives << args->module_path << "/modules/" << m << "/libmxvm_" << m << "_static.a ";
-                    }
-
-                    std::ostringstream cc_cmd;
-                    cc_cmd << linker << " ";
-
-                    for (auto &obj : object_files) {
-                        cc_cmd << obj << " ";
-                    }
-
-                    cc_cmd << modules_archives.str() << " "
-                           << ldflags << " "
-                           << "-o " << mxvm::Program::base->root_name;
-
-                    std::cout << cc_cmd.str() << "\n";
-                    int cc_result = system(cc_cmd.str().c_str());
-                    if (cc_result != 0) {
-                        std::cerr << Col("MXVM: ", mx::Color::RED) << "Linking failed\n";
-                        return EXIT_FAILURE;
-                    }
-                } else if (args->platform == mxvm::Platform::DARWIN) {
-                    std::vector<std::string> object_files;
-                    std::string clang = args->toolchain.empty() ? "clang" : args->toolchain + "-clang";
-                    const char *clang_env = getenv("CLANG");
-                    if (clang_env != nullptr) {
-                        clang = clang_env;
-                    }
-                    std::string cflags;
-                    const char *cflags_env = getenv("CFLAGS");
-                    if (cflags_env != nullptr) {
-                        cflags = cflags_env;
-                    }
-
-                    for (auto &f : mxvm::Program::base->filenames) {
-                        std::string obj_file = f;
-                        size_t pos = obj_file.rfind(".s");
-                        if (pos != std::string::npos) {
-                            obj_file.replace(pos, 2, ".o");
-                        } else {
-                            obj_file += ".o";
-                        }
-                        std::ostringstream clang_cmd;
-                        clang_cmd << clang << " -c " << cflags << " " << f << " -o " << obj_file;
-                        std::cout << clang_cmd.str() << "\n";
-                        int clang_result = system(clang_cmd.str().c_str());
-                        if (clang_result != 0) {
-                            std::cerr << Col("MXVM: ", mx::Color::RED) << "Assembly failed\n";
-                            return EXIT_FAILURE;
-                        }
-                        object_files.push_back(obj_file);
-                    }
-
-                    std::string ldflags;
-                    const char *ldf = getenv("LDFLAGS");
-                    if (ldf != nullptr) {
-                        ldflags = ldf;
-                    }
-
-                    ldflags += " -lm ";
-
-                    std::ostringstream modules_archives;
-                    std::set<std::string> arch;
-                    for (auto &m : mxvm::Program::base->external) {
-                        if (m.module == true && m.mod != "main" && m.name != "strlen") {
-                            arch.insert(m.mod);
-                        }
-                    }
-                    for (auto &m : arch) {
-                        modules_archives << args->module_path << "/modules/" << m << "/libmxvm_" << m << "_static.a ";
-                    }
-                    std::ostringstream clang_link_cmd;
-                    clang_link_cmd << clang << " ";
-                    for (auto &obj : object_files) {
-                        clang_link_cmd << obj << " ";
-                    }
-                    clang_link_cmd << modules_archives.str() << " "
-                                   << ldflags << " "
-                                   << "-o " << mxvm::Program::base->root_name;
-                    std::cout << clang_link_cmd.str() << "\n";
-                    int clang_link_result = system(clang_link_cmd.str().c_str());
-                    if (clang_link_result != 0) {
-                        std::cerr << Col("MXVM: ", mx::Color::RED) << "Linking failed\n";
-                        return EXIT_FAILURE;
-                    }
-                }
-            }
+        if (exitCode == 0 && !program->context->root_name.empty()) {
+            if (!assemble_and_link(args, program))
+                return EXIT_FAILURE;
         }
     } else if (args->action == vm_action::translate) {
         exitCode = action_translate(args->platform, program, args);
-    } else if (args->action == vm_action::interpret && !args->source_file.empty()) {
-        exitCode = action_interpret(args->only_test, args->include_path, args->object_path, args->argv, args->source_file, args->module_path);
-    } else if (args->action == vm_action::null_action && !args->source_file.empty()) {
-        exitCode = action_interpret(args->only_test, args->include_path, args->object_path, args->argv, args->source_file, args->module_path);
+    } else if (args->action == vm_action::image) {
+        exitCode = action_image(args);
+    } else if ((args->action == vm_action::interpret || args->action == vm_action::null_action) && !args->source_file.empty()) {
+        if (!args->unbuffered)
+            mxvm::setOutputBuffer(args->output_buffer);
+        exitCode = action_interpret(args->only_test, args->profile, args->stats, args->include_path, args->object_path, args->argv, args->source_file, args->module_path);
     } else {
         std::cerr << Col("MXVM: Error ", mx::Color::RED) << "invalid action/command\n";
         return EXIT_FAILURE;
@@ -481,34 +419,55 @@ int translate_x64(const mxvm::Platform &platform, std::unique_ptr<mxvm::Program>
         parser.module_path = std::string(mod_path);
         parser.object_path = std::string(object_path);
         parser.include_path = include_path;
+        parser.cache_dir = args->cache_dir;
+        parser.jobs = args->jobs;
         if (parser.generateProgramCode(mxvm::Mode::MODE_COMPILE, program)) {
             collectAndRegisterAllExterns(program);
             std::string output_file(output);
             std::string program_name = output_file.empty() ? program->name + ".s" : output_file;
             std::fstream file;
-            if (program->root_name == program->name)
+            if (program->context->root_name == program->name)
                 program->object = false;
             else
                 program->object = true;
-            file.open(program_name, std::ios::out);
-            if (file.is_open()) {
+            mxvm::BuildCache cache(args->cache_dir);
+            std::string key;
+            bool cached = false;
+            if (cache.enabled()) {
+                key = mxvm::BuildCache::sourceKey(*program, "program");
+                cached = cache.fetch(key, ".s", program_name);
+            }
+            if (cached) {
+                std::ifstream cached_file(program_name);
+                std::ostringstream code;
+                code << cached_file.rdbuf();
+                program->assembly_code = code.str();
+                if (mxvm::debug_mode) {
+                    std::cout << Col("MXVM: ", mx::Color::BRIGHT_GREEN) << "Reused cached assembly: " << program_name << "\n";
+                }
+            } else {
+                file.open(program_name, std::ios::out);
+                if (!file.is_open()) {
+                    throw mx::Exception("Error could not create file: " + program_name);
+                }
                 std::ostringstream code_v;
                 program->generateCode(platform, program->object, code_v);
                 program->assembly_code = code_v.str();
                 std::string opt_code = program->gen_optimize(program->assembly_code, platform);
                 file << opt_code;
-                if (mxvm::html_mode) {
-                    std::ofstream htmlFile(program->name + ".html");
-                    if (htmlFile.is_open()) {
-                        parser.generateDebugHTML(htmlFile, program);
-                        std::cout << Col("MXVM: Generated Debug HTML for: ", mx::Color::BRIGHT_GREEN) << program->name << "\n";
-                    }
-                    htmlFile.close();
-                }
                 file.close();
-                if (mxvm::Program::base != nullptr) {
-                    mxvm::Program::base->add_filename(program->name + ".s");
+                cache.store(key, ".s", program_name);
+            }
+            if (mxvm::html_mode) {
+                std::ofstream htmlFile(program->name + ".html");
+                if (htmlFile.is_open()) {
+                    parser.generateDebugHTML(htmlFile, program);
+                    std::cout << Col("MXVM: Generated Debug HTML for: ", mx::Color::BRIGHT_GREEN) << program->name << "\n";
                 }
+                htmlFile.close();
+            }
+            if (program->mainBase() != nullptr) {
+                program->add_filename(program->name + ".s");
             }
         } else {
             std::cerr << Col("MXVM: Exception: ", mx::Color::RED) << "Failed to generate intermedaite code" << "\n";
@@ -548,6 +507,30 @@ int translate_x64(const mxvm::Platform &platform, std::unique_ptr<mxvm::Program>
 
 mxvm::Program *signal_program = nullptr;
 
+/** @brief Write the profile of signal_program once, either after exec() or when a module calls exit() */
+void write_profile() {
+    static bool written = false;
+    if (written || signal_program == nullptr || signal_program->getProfiler() == nullptr)
+        return;
+    written = true;
+    const std::string &prefix = signal_program->name;
+    if (signal_program->getProfiler()->write(prefix)) {
+        std::cerr << Col("MXVM: ", mx::Color::BRIGHT_GREEN) << "Profile written to " << prefix << ".profile.txt, " << prefix << ".callgraph.txt and " << prefix << ".folded\n";
+    } else {
+        std::cerr << Col("MXVM: Error ", mx::Color::RED) << "could not write profile for " << prefix << "\n";
+    }
+}
+
+/** @brief Print the counters of signal_program once, either after exec() or when a module calls exit() */
+void write_stats() {
+    static bool written = false;
+    if (written || signal_program == nullptr || signal_program->getStats() == nullptr)
+        return;
+    written = true;
+    std::cout.flush();
+    signal_program->getStats()->write(std::cerr);
+}
+
 #ifndef _WIN32
 void signal_action(int signum) {
     if (signum == SIGINT) {
@@ -581,10 +564,12 @@ BOOL WINAPI CtrlHandler(DWORD ctrlType) {
 }
 #endif
 
-int action_interpret(bool only_test, std::string_view include_path, std::string_view object_path, const std::vector<std::string> &argv, std::string_view input, std::string_view mod_path) {
+int action_interpret(bool only_test, bool profile, bool stats, std::string_view include_path, std::string_view object_path, const std::vector<std::string> &argv, std::string_view input, std::string_view mod_path) {
     int exitCode = 0;
     std::unique_ptr<mxvm::Program> program(new mxvm::Program());
-    program->setArgs(argv);
+    std::vector<std::string> program_argv{"mxvmc"};
+    program_argv.insert(program_argv.end(), argv.begin(), argv.end());
+    program->setArgs(program_argv);
     program->setMainBase(program.get());
     std::fstream debug_output;
     if (mxvm::debug_mode) {
@@ -594,6 +579,14 @@ int action_interpret(bool only_test, std::string_view include_path, std::string_
         }
     }
     signal_program = program.get();
+    // Written on every way out of this function, before the program is destroyed
+    struct ReportGuard {
+        ~ReportGuard() {
+            write_profile();
+            write_stats();
+            signal_program = nullptr;
+        }
+    } report_guard;
 #ifndef _WIN32
     struct sigaction sa;
     sa.sa_handler = signal_action;
@@ -606,75 +599,44 @@ int action_interpret(bool only_test, std::string_view include_path, std::string_
 
     try {
         std::string input_file(input);
-        std::fstream file;
-        file.open(input_file, std::ios::in);
-        if (!file.is_open()) {
-            throw mx::Exception("Error could not open file: " + input_file);
-        }
-        program->filename = input_file;
-        std::ostringstream stream;
-        stream << file.rdbuf();
-        file.close();
-        mxvm::Parser parser(stream.str());
-        parser.scan();
-        bool uses_std_module = false;
-        parser.module_path = std::string(mod_path);
-        parser.object_path = std::string(object_path);
-        parser.include_path = std::string(include_path);
-
-        class ArgsRaii {
-          public:
-            ArgsRaii() = default;
-            void init(const std::vector<std::string> &argv, void *handle) {
-                std::vector<const char *> c_argv;
-                c_argv.push_back("mxvmc");
-                for (const auto &arg : argv) {
-                    c_argv.push_back(arg.c_str());
-                }
-
-                void *set_args = (void *)dlsym(handle, "set_program_args");
-                using set_program_args_t = void (*)(int, const char **);
-                if (set_args) {
-                    auto func = reinterpret_cast<set_program_args_t>(set_args);
-                    func(static_cast<int>(c_argv.size()), c_argv.data());
-                    set = true;
-                    handle_ = handle;
-                }
-            }
-            ~ArgsRaii() {
-                void *free_args = (void *)dlsym(handle_, "free_program_args");
-                using set_program_args_t = void (*)();
-                if (free_args) {
-                    auto func = reinterpret_cast<set_program_args_t>(free_args);
-                    func();
-                    set = false;
-                }
+        std::unique_ptr<mxvm::Parser> parser;
+        bool generated = false;
+        if (input_file.ends_with(".mxb")) {
+            program->loadImage(input_file, std::string(mod_path));
+            generated = true;
+        } else {
+            std::fstream file;
+            file.open(input_file, std::ios::in);
+            if (!file.is_open()) {
+                throw mx::Exception("Error could not open file: " + input_file);
             }
+            program->filename = input_file;
+            std::ostringstream stream;
+            stream << file.rdbuf();
+            file.close();
+            parser = std::make_unique<mxvm::Parser>(stream.str());
+            parser->scan();
+            parser->module_path = std::string(mod_path);
+            parser->object_path = std::string(object_path);
+            parser->include_path = std::string(include_path);
+            generated = parser->generateProgramCode(mxvm::Mode::MODE_INTERPRET, program);
+        }
 
-            bool set = false;
-            void *handle_ = nullptr;
-        };
-
-        if (parser.generateProgramCode(mxvm::Mode::MODE_INTERPRET, program)) {
+        if (generated) {
             if (program->object) {
                 throw mx::Exception("Requires one program object to execute");
             }
-            ArgsRaii args_raii;
-
-            if (mxvm::Program::base != nullptr) {
-                void *handle = nullptr;
-                for (const auto &ext : mxvm::Program::base->external_functions) {
-                    if (ext.second.mod_name == "std") {
-                        uses_std_module = true;
-                        handle = ext.second.handle;
-                        break;
-                    }
-                }
-                if (uses_std_module) {
-                    args_raii.init(argv, handle);
-                }
-            }
             program->flatten(program.get());
+            program->setProfiling(profile);
+            if (profile) {
+                std::atexit(write_profile);
+            }
+            if (stats) {
+                if (!mxvm::stats_available)
+                    std::cerr << Col("MXVM: Warning: ", mx::Color::YELLOW) << "this build has no interpreter counters (configure with -DWITH_STATS=ON)\n";
+                program->setStats(true);
+                std::atexit(write_stats);
+            }
             if (only_test == false)
                 exitCode = program->exec();
 
@@ -689,7 +651,13 @@ int action_interpret(bool only_test, std::string_view include_path, std::string_
             if (mxvm::html_mode) {
                 std::cout << Col("MXVM: Generated ", mx::Color::BRIGHT_GREEN) << program->name << ".html\n";
                 std::ofstream fout(program->name + ".html");
-                parser.generateDebugHTML(fout, program);
+                if (parser) {
+                    parser->generateDebugHTML(fout, program);
+                } else {
+                    // Loaded from an image: there is no source, but the report only needs the program
+                    mxvm::Parser report("");
+                    report.generateDebugHTML(fout, program);
+                }
                 fout.close();
             }
         } else {
@@ -746,14 +714,260 @@ int action_interpret(bool only_test, std::string_view include_path, std::string_
     return exitCode;
 }
 
+int action_image(Args *args) {
+    std::unique_ptr<mxvm::Program> program(new mxvm::Program());
+    program->setMainBase(program.get());
+    program->platform = args->platform;
+    try {
+        if (args->source_file.ends_with(".mxb"))
+            throw mx::Exception("Input is already a bytecode image: " + args->source_file);
+        std::fstream file;
+        file.open(args->source_file, std::ios::in);
+        if (!file.is_open()) {
+            throw mx::Exception("Error could not open file: " + args->source_file);
+        }
+        program->filename = args->source_file;
+        std::ostringstream stream;
+        stream << file.rdbuf();
+        file.close();
+        mxvm::Parser parser(stream.str());
+        parser.scan();
+        parser.module_path = args->module_path;
+        parser.object_path = args->object_path;
+        parser.include_path = args->include_path;
+        if (!parser.generateProgramCode(mxvm::Mode::MODE_INTERPRET, program)) {
+            std::cerr << Col("MXVM: Error: ", mx::Color::RED) << "Failed to generate intermediate code.\n";
+            return EXIT_FAILURE;
+        }
+        if (program->object) {
+            throw mx::Exception("Requires one program object to build an image");
+        }
+        std::string output_file = args->output_file;
+        if (output_file.empty())
+            output_file = std::filesystem::path(args->source_file).replace_extension(".mxb").string();
+        program->saveImage(output_file);
+        if (mxvm::debug_mode) {
+            std::cout << Col("MXVM: Generated ", mx::Color::BRIGHT_GREEN) << "bytecode image: " << output_file << "\n";
+        }
+    } catch (const mx::Exception &e) {
+        std::cerr << Col("MXVM: Exception: ", mx::Color::RED) << e.what() << "\n";
+        return EXIT_FAILURE;
+    } catch (const std::exception &e) {
+        std::cerr << Col("MXVM: Exception: ", mx::Color::RED) << e.what() << "\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
+
+std::vector<std::string> split_command(const std::string &text) {
+    std::vector<std::string> words;
+    std::istringstream in(text);
+    std::string word;
+    while (in >> word)
+        words.push_back(word);
+    return words;
+}
+
+std::string join_command(const std::vector<std::string> &argv) {
+    std::string text;
+    for (const auto &a : argv) {
+        if (!text.empty())
+            text += " ";
+        text += a;
+    }
+    return text;
+}
+
+bool run_commands(std::vector<BuildCommand> &commands, unsigned int jobs) {
+    bool ok = true;
+#ifdef _WIN32
+    for (auto &c : commands) {
+        std::cout << join_command(c.argv) << "\n";
+        c.ok = system(join_command(c.argv).c_str()) == 0;
+        if (!c.ok) {
+            std::cerr << Col("MXVM: ", mx::Color::RED) << "Failed: " << c.output << "\n";
+            ok = false;
+        }
+    }
+#else
+    std::map<pid_t, size_t> running;
+    size_t next = 0;
+    jobs = std::max(1u, jobs);
+    while (next < commands.size() || !running.empty()) {
+        while (next < commands.size() && running.size() < jobs) {
+            BuildCommand &c = commands[next++];
+            std::vector<char *> argv;
+            for (auto &a : c.argv)
+                argv.push_back(const_cast<char *>(a.c_str()));
+            argv.push_back(nullptr);
+            std::cout << join_command(c.argv) << "\n";
+            std::cout.flush();
+            pid_t pid = 0;
+            int rc = argv[0] == nullptr ? EINVAL : posix_spawnp(&pid, argv[0], nullptr, nullptr, argv.data(), environ);
+            if (rc != 0) {
+                std::cerr << Col("MXVM: ", mx::Color::RED) << "Could not run " << (c.argv.empty() ? std::string("(empty command)") : c.argv[0]) << ": " << strerror(rc) << "\n";
+                ok = false;
+                continue;
+            }
+            running[pid] = next - 1;
+        }
+        if (running.empty())
+            break;
+        int status = 0;
+        pid_t pid = waitpid(-1, &status, 0);
+        if (pid < 0) {
+            if (errno == EINTR)
+                continue;
+            std::cerr << Col("MXVM: ", mx::Color::RED) << "waitpid failed: " << strerror(errno) << "\n";
+            return false;
+        }
+        auto it = running.find(pid);
+        if (it == running.end())
+            continue;
+        BuildCommand &c = commands[it->second];
+        running.erase(it);
+        c.ok = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+        if (!c.ok) {
+            std::cerr << Col("MXVM: ", mx::Color::RED) << "Failed: " << c.output;
+            if (WIFSIGNALED(status))
+                std::cerr << " (signal " << WTERMSIG(status) << ")";
+            else if (WIFEXITED(status))
+                std::cerr << " (exit " << WEXITSTATUS(status) << ")";
+            std::cerr << "\n";
+            ok = false;
+        }
+    }
+#endif
+    return ok;
+}
+
+bool assemble_and_link(Args *args, std::unique_ptr<mxvm::Program> &program) {
+    mxvm::BuildCache cache(args->cache_dir);
+    std::vector<std::string> assembler;
+    std::vector<std::string> linker;
+    std::string flags_env;
+    if (args->platform == mxvm::Platform::DARWIN) {
+        std::string clang = args->toolchain.empty() ? "clang" : args->toolchain + "-clang";
+        const char *clang_env = getenv("CLANG");
+        if (clang_env != nullptr) {
+            clang = clang_env;
+        }
+        assembler = split_command(clang);
+        assembler.push_back("-c");
+        linker = split_command(clang);
+        flags_env = "CFLAGS";
+    } else {
+        std::string as = args->toolchain.empty() ? "as" : args->toolchain + "-as";
+        const char *as_env = getenv("AS");
+        if (as_env != nullptr) {
+            as = as_env;
+        }
+        assembler = split_command(as);
+        std::string cc = args->toolchain.empty() ? "cc" : args->toolchain + "-gcc";
+        const char *cc_env = getenv("CC");
+        if (cc_env != nullptr) {
+            cc = cc_env;
+        }
+        linker = split_command(cc);
+        flags_env = "ASFLAGS";
+    }
+    const char *asflags = getenv(flags_env.c_str());
+    if (asflags != nullptr) {
+        for (auto &f : split_command(asflags))
+            assembler.push_back(f);
+    }
+
+    uint64_t seed = mxvm::BuildCache::toolSeed(args->platform);
+    std::vector<std::string> object_files;
+    std::vector<BuildCommand> pending;
+    for (auto &f : program->context->filenames) {
+        std::string obj_file = f;
+        size_t pos = obj_file.rfind(".s");
+        if (pos != std::string::npos) {
+            obj_file.replace(pos, 2, ".o");
+        } else {
+            obj_file += ".o";
+        }
+        object_files.push_back(obj_file);
+        BuildCommand c;
+        c.argv = assembler;
+        c.argv.push_back(f);
+        c.argv.push_back("-o");
+        c.argv.push_back(obj_file);
+        c.output = obj_file;
+        c.key = mxvm::BuildCache::toKey(mxvm::BuildCache::hashFile(f, mxvm::BuildCache::hash(join_command(c.argv), seed)));
+        if (cache.fetch(c.key, ".o", obj_file)) {
+            if (mxvm::debug_mode) {
+                std::cout << Col("MXVM: ", mx::Color::BRIGHT_GREEN) << "Reused cached object: " << obj_file << "\n";
+            }
+            continue;
+        }
+        pending.push_back(std::move(c));
+    }
+    bool assembled = run_commands(pending, args->jobs);
+    for (auto &c : pending) {
+        if (c.ok)
+            cache.store(c.key, ".o", c.output);
+    }
+    if (!assembled) {
+        std::cerr << Col("MXVM: ", mx::Color::RED) << "Assembly failed\n";
+        return false;
+    }
+
+    std::set<std::string> arch;
+    for (auto &m : program->mainBase()->external) {
+        if (m.module == true && m.mod != "main" && m.name != "strlen") {
+            arch.insert(m.mod);
+        }
+    }
+    BuildCommand link;
+    link.argv = linker;
+    std::vector<std::string> inputs = object_files;
+    for (auto &obj : object_files)
+        link.argv.push_back(obj);
+    for (auto &m : arch) {
+        std::string archive = args->module_path + "/modules/" + m + "/libmxvm_" + m + "_static.a";
+        link.argv.push_back(archive);
+        inputs.push_back(archive);
+    }
+    const char *ldf = getenv("LDFLAGS");
+    if (ldf != nullptr) {
+        for (auto &f : split_command(ldf))
+            link.argv.push_back(f);
+    }
+    link.argv.push_back("-lm");
+    if (args->platform != mxvm::Platform::WINX64)
+        link.argv.push_back("-lpthread");
+    link.argv.push_back("-o");
+    link.argv.push_back(program->context->root_name);
+    link.output = program->context->root_name;
+
+    uint64_t h = mxvm::BuildCache::hash(join_command(link.argv), seed);
+    for (const auto &in : inputs)
+        h = mxvm::BuildCache::hashFile(in, h);
+    std::string key = mxvm::BuildCache::toKey(h);
+    std::string record = link.output + ".link";
+    if (cache.enabled() && std::filesystem::exists(link.output) && cache.readRecord(record) == key) {
+        std::cout << Col("MXVM: ", mx::Color::BRIGHT_GREEN) << link.output << " is up to date\n";
+        return true;
+    }
+    std::vector<BuildCommand> link_step{link};
+    if (!run_commands(link_step, 1)) {
+        std::cerr << Col("MXVM: ", mx::Color::RED) << "Linking failed\n";
+        return false;
+    }
+    cache.writeRecord(record, key);
+    return true;
+}
+
 void collectAndRegisterAllExterns(std::unique_ptr<mxvm::Program> &program) {
     for (const auto &obj : program->objects) {
         for (auto &lbl : obj->labels) {
             if (lbl.second.second)
-                mxvm::Program::base->add_extern(obj->name, lbl.first, false);
+                program->mainBase()->add_extern(obj->name, lbl.first, false);
         }
         for (auto &v : obj->vars) {
-            mxvm::Program::base->add_extern(obj->name, v.first, false);
+            program->mainBase()->add_extern(obj->name, v.first, false);
         }
     }
 }
@@ -39,17 +39,6 @@ namespace {
         return out;
     }
 
-    struct BaseGuard {
-        mxvm::Base *prev;
-        explicit BaseGuard(mxvm::Base *p)
-            : prev(mxvm::Program::base) {
-            if (p)
-                mxvm::Program::base = p;
-        }
-        ~BaseGuard() {
-            mxvm::Program::base = prev;
-        }
-    };
 } // namespace
 
 static void collectAndRegisterAllExterns(mxvm::Program &program) {
@@ -68,8 +57,7 @@ class MXVM_Debug {
 
     std::string parseToHTML(int output_type, const std::string &code) {
         std::unique_ptr<mxvm::Program> program(new mxvm::Program());
-        BaseGuard guard(program.get());
-        mxvm::Base::object_map.clear();
+        program->setMainBase(program.get());
         const bool html_mode_prev = mxvm::html_mode;
         mxvm::html_mode = true;
 
@@ -104,7 +92,7 @@ class MXVM_Debug {
 
                 collectAndRegisterAllExterns(*program);
 
-                program->object = (program->root_name != program->name);
+                program->object = (program->context->root_name != program->name);
                 program->generateCode(platform, program->object, code_v);
                 program->assembly_code = program->gen_optimize(code_v.str(), platform);
 